@@ -24,3 +24,6 @@ static const uint8_t KEY[16] = {
   0x59, 0x02, 0xEF, 0xC4, 0x6A, 0x90, 0x13, 0xDD
 };
 
+// Viaja en claro delante del bloque cifrado; el gateway elige la clave por este ID
+#define BEACON_KEY_ID 1
+
@@ -338,9 +338,10 @@ void setup()
       goToSleep(cfg);
     }
 
-    uint8_t pkt[2 + 16];
+    uint8_t pkt[2 + 1 + 16];
     memcpy(pkt + 0, head, 2);
-    memcpy(pkt + 2, cipher, 16);
+    pkt[2] = BEACON_KEY_ID;
+    memcpy(pkt + 3, cipher, 16);
 
     bool ok = adv_publish_mfg(pkt, sizeof(pkt));
 
@@ -25,4 +25,90 @@
 #define ETH_SPI_CLOCK_MHZ   25
 
 #define ADV_DATA_QUEUE_LEN  64
-#define MAX_SLOTS           32
\ No newline at end of file
+#define MAX_SLOTS           32
+
+#define ALARM_MAX_RULES             32
+#define ALARM_MAX_RULES_PER_SLOT    8
+#define ALARM_MAX_DELAY_S           86400
+
+#define MAX_ZONES                   8
+#define ZONE_NAME_LEN               24
+#define SLOT_OFFLINE_MS             300000UL
+
+#define CHECKPOINT_RTC_INTERVAL_MS  10000UL
+#define CHECKPOINT_FS_INTERVAL_MS   300000UL
+
+#define MAP_JOURNAL_COMPACT_BYTES   4096
+
+#define SCAN_DUP_RESET_MS           5000UL
+#define SCAN_DISCOVERY_PERIOD_MS    60000UL
+#define SCAN_DISCOVERY_WINDOW_MS    5000UL
+
+#define HISTORY_DEPTH               4096
+
+#define HISTORY_LOG_PARTITION       "history"
+#define HISTORY_LOG_SEGMENT_BYTES   32768
+#define HISTORY_LOG_PERIOD_MS       60000UL
+#define HISTORY_LOG_FLUSH_MS        300000UL
+#define HISTORY_LOG_TICK_MS         10000UL
+
+#define ROLLUP_HOURS                24
+#define ROLLUP_DAYS                 31
+#define ROLLUP_SAVE_MS              600000UL
+
+#define CLOCK_TZ                    "<-05>5"
+#define CLOCK_NTP_SERVER            "pool.ntp.org"
+
+#define BEACON_KEY_ID_DEFAULT       1
+
+#define SCAN_INTERVAL_UNITS         160
+#define SCAN_WINDOW_BASE_UNITS      120
+#define SCAN_WINDOW_WIDE_UNITS      160
+#define SCAN_WINDOW_NARROW_UNITS    16
+#define SCAN_SCHEDULE_LEAD_MS       500UL
+
+#define RADIO_BUDGET_TICK_MS        1000UL
+#define RADIO_WIFI_BUSY_PERMILLE    250
+#define RADIO_WIFI_IDLE_PERMILLE    20
+#define RADIO_BLE_LOSS_HIGH_PERMILLE 50
+#define RADIO_BLE_LOSS_LOW_PERMILLE 10
+#define RADIO_BUDGET_HOLD_TICKS     5
+#define RADIO_WIFI_SCAN_WINDOW_UNITS 64
+
+#define PIPELINE_FUSED_DEFAULT      false
+#define PIPELINE_DECODE_PRIORITY    2
+#define PIPELINE_DECODE_CORE        1
+#define PIPELINE_DECODE_STACK       4096
+#define PIPELINE_LOGIC_PRIORITY     2
+#define PIPELINE_LOGIC_CORE         1
+#define PIPELINE_LOGIC_STACK        4096
+#define PIPELINE_BENCH_MAX_PACKETS  20000
+#define WEB_LOOP_IDLE_MS            1000UL
+
+#define APP_EVENT_RING_LEN          256
+#define APP_EVENT_MAX_SUBSCRIBERS   8
+#define APP_EVENT_SWEEP_MS          1000UL
+
+#define HARNESS_CAPTURE_QUEUE_LEN   64
+#define HARNESS_CAPTURE_MAX_FRAMES  50000
+#define HARNESS_CAPTURE_PATH        "/capture/adv.bin"
+#define HARNESS_KEY_ID              0xFD
+
+#define JSON_ARENA_BYTES            (64 * 1024)
+
+#define WS_PUSH_TICK_MS             250UL
+#define WS_PUSH_MAX_CLIENTS         8
+#define WS_PUSH_FRAME_MAX           1400
+
+#define GZIP_WINDOW_BITS            12
+#define GZIP_HASH_BITS              12
+#define GZIP_MAX_CHAIN              16
+#define GZIP_OUT_BYTES              1024
+#define GZIP_STAGE_BYTES            1024
+#define GZIP_MIN_BYTES              1024
+#define GZIP_POOL_SLOTS             2
+#define GZIP_BENCH_BYTES            (32 * 1024)
+
+#define API_BODY_MAX                1024
+#define API_BODY_MAX_BULK           8192
+#define API_BODY_MAX_PENDING        4
\ No newline at end of file
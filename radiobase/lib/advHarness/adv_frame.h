@@ -0,0 +1,50 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Anuncio crudo portable: mismo contenido que AdvRaw pero sin dependencias
+  de NimBLE/FreeRTOS, para grabar, reproducir y generar trafico tanto en el
+  gateway como en Linux.
+
+  Archivo de captura: [AdvCaptureHeader][AdvFrame ...] little-endian.
+*/
+
+static constexpr uint32_t ADV_CAPTURE_MAGIC = 0x43564441; // "ADVC"
+static constexpr uint16_t ADV_CAPTURE_VERSION = 1;
+
+#pragma pack(push, 1)
+struct AdvFrame
+{
+    uint32_t rxMs;
+    int8_t rssiRead;
+    int8_t rssiSend;
+    uint8_t addr[6];
+    uint16_t company;
+    uint8_t keyId;
+    uint8_t len;
+    uint8_t payload[16];
+};
+
+struct AdvCaptureHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t frameBytes;
+    uint32_t startMs;
+    uint32_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(AdvFrame) == 32, "AdvFrame debe ocupar 32 bytes");
+static_assert(sizeof(AdvCaptureHeader) == 16, "AdvCaptureHeader debe ocupar 16 bytes");
+
+inline AdvCaptureHeader advCaptureHeader(uint32_t startMs)
+{
+    AdvCaptureHeader h{};
+    h.magic = ADV_CAPTURE_MAGIC;
+    h.version = ADV_CAPTURE_VERSION;
+    h.frameBytes = sizeof(AdvFrame);
+    h.startMs = startMs;
+    return h;
+}
@@ -0,0 +1,65 @@
+#include "adv_replay.h"
+
+bool AdvReplayReader::begin(AdvByteSource *source)
+{
+    src = source;
+    frames = 0;
+
+    if (src == nullptr ||
+        src->readBytes(reinterpret_cast<uint8_t *>(&header), sizeof(header)) != sizeof(header))
+    {
+        return false;
+    }
+
+    return header.magic == ADV_CAPTURE_MAGIC &&
+           header.version == ADV_CAPTURE_VERSION &&
+           header.frameBytes == sizeof(AdvFrame);
+}
+
+bool AdvReplayReader::next(AdvFrame &out)
+{
+    if (src == nullptr) return false;
+
+    // Un frame cortado al final (captura interrumpida) se descarta
+    if (src->readBytes(reinterpret_cast<uint8_t *>(&out), sizeof(out)) != sizeof(out))
+    {
+        return false;
+    }
+
+    frames++;
+    return true;
+}
+
+void InjectPacer::begin(uint32_t speedX100)
+{
+    speed = speedX100;
+    started = false;
+}
+
+uint32_t InjectPacer::waitFor(uint32_t frameRxMs, uint32_t nowMs)
+{
+    if (speed == 0) return 0;
+
+    if (!started)
+    {
+        started = true;
+        baseFrameMs = frameRxMs;
+        baseNowMs = nowMs;
+        return 0;
+    }
+
+    uint64_t offset = static_cast<uint64_t>(frameRxMs - baseFrameMs) * 100 / speed;
+    uint32_t due = baseNowMs + static_cast<uint32_t>(offset);
+    int32_t wait = static_cast<int32_t>(due - nowMs);
+    return wait > 0 ? static_cast<uint32_t>(wait) : 0;
+}
+
+uint32_t InjectPacer::lateBy(uint32_t frameRxMs, uint32_t nowMs) const
+{
+    if (speed == 0 || !started) return 0;
+
+    uint64_t offset = static_cast<uint64_t>(frameRxMs - baseFrameMs) * 100 / speed;
+    uint32_t due = baseNowMs + static_cast<uint32_t>(offset);
+    int32_t late = static_cast<int32_t>(nowMs - due);
+    return late > 0 ? static_cast<uint32_t>(late) : 0;
+}
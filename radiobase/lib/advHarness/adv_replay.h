@@ -0,0 +1,47 @@
+#pragma once
+#include "adv_frame.h"
+
+// Origen de bytes de una captura (archivo de LittleFS, FILE* en Linux, memoria)
+class AdvByteSource
+{
+public:
+    virtual ~AdvByteSource() {}
+    virtual size_t readBytes(uint8_t *dst, size_t len) = 0;
+};
+
+class AdvReplayReader
+{
+public:
+    // false si la cabecera no es de una captura valida
+    bool begin(AdvByteSource *source);
+    bool next(AdvFrame &out);
+
+    uint32_t startMs() const { return header.startMs; }
+    uint32_t framesRead() const { return frames; }
+
+private:
+    AdvByteSource *src = nullptr;
+    AdvCaptureHeader header{};
+    uint32_t frames = 0;
+};
+
+/*
+  Ritmo de inyeccion. speedX100 = 100 reproduce a tiempo real, 1000 a diez
+  veces, 0 lo mas rapido posible. Los tiempos son de millis() y toleran el
+  desborde.
+*/
+class InjectPacer
+{
+public:
+    void begin(uint32_t speedX100);
+    // ms a esperar antes de entregar el frame con ese rxMs; 0 = ya
+    uint32_t waitFor(uint32_t frameRxMs, uint32_t nowMs);
+    // ms de atraso respecto del momento que le tocaba; 0 si llego a tiempo
+    uint32_t lateBy(uint32_t frameRxMs, uint32_t nowMs) const;
+
+private:
+    uint32_t speed = 100;
+    bool started = false;
+    uint32_t baseFrameMs = 0;
+    uint32_t baseNowMs = 0;
+};
@@ -0,0 +1,117 @@
+#include "fleet_generator.h"
+#include <string.h>
+
+uint32_t FleetGenerator::random()
+{
+    // xorshift32: barato y reproducible
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+int32_t FleetGenerator::randomRange(int32_t lo, int32_t hi)
+{
+    if (hi <= lo) return lo;
+    return lo + static_cast<int32_t>(random() % static_cast<uint32_t>(hi - lo + 1));
+}
+
+bool FleetGenerator::newReading(uint16_t index)
+{
+    Beacon &b = beacons[index];
+
+    int32_t tmp = b.tmpX100 + randomRange(-15, 15);
+    if (tmp < -3000) tmp = -3000;
+    if (tmp > 1500) tmp = 1500;
+    b.tmpX100 = static_cast<int16_t>(tmp);
+    b.cpuX100 = static_cast<int16_t>(b.tmpX100 + 3000 + randomRange(-50, 50));
+
+    // Cuerpo v1 con relleno PKCS7, igual que el firmware del beacon
+    uint8_t plain[16];
+    memset(plain, 16 - 9, sizeof(plain));
+    plain[0] = 1;
+    plain[1] = p.environmentId;
+    plain[2] = static_cast<uint8_t>(index);
+    plain[3] = 0;
+    plain[4] = static_cast<uint8_t>(b.tmpX100 & 0xFF);
+    plain[5] = static_cast<uint8_t>((b.tmpX100 >> 8) & 0xFF);
+    plain[6] = static_cast<uint8_t>(b.cpuX100 & 0xFF);
+    plain[7] = static_cast<uint8_t>((b.cpuX100 >> 8) & 0xFF);
+    plain[8] = static_cast<uint8_t>(b.batPct);
+
+    return encryptFn(p.key, plain, b.cipher, encryptCtx);
+}
+
+bool FleetGenerator::begin(const FleetParams &params, FleetEncryptFn encrypt, void *ctx)
+{
+    if (encrypt == nullptr || params.beacons == 0 || params.beacons > FLEET_MAX_BEACONS ||
+        params.periodMs == 0 || params.burstPackets == 0 || params.jitterMs >= params.periodMs / 2)
+    {
+        return false;
+    }
+
+    p = params;
+    encryptFn = encrypt;
+    encryptCtx = ctx;
+    rng = params.seed != 0 ? params.seed : 1;
+    frames = 0;
+
+    for (uint16_t i = 0; i < p.beacons; ++i)
+    {
+        Beacon &b = beacons[i];
+        b.burstStartMs = static_cast<uint32_t>(randomRange(0, static_cast<int32_t>(p.periodMs - 1)));
+        b.sent = 0;
+        b.tmpX100 = static_cast<int16_t>(randomRange(-2200, 800));
+        b.batPct = static_cast<int8_t>(randomRange(40, 100));
+        b.rssi = static_cast<int8_t>(randomRange(-90, -45));
+
+        if (!newReading(i)) return false;
+    }
+
+    return true;
+}
+
+bool FleetGenerator::next(AdvFrame &out)
+{
+    // Beacon con el proximo paquete; en empate gana el indice menor
+    uint16_t best = 0;
+    uint32_t bestMs = 0;
+    for (uint16_t i = 0; i < p.beacons; ++i)
+    {
+        const Beacon &b = beacons[i];
+        uint32_t t = b.burstStartMs + static_cast<uint32_t>(b.sent) * p.burstSpacingMs;
+        if (i == 0 || static_cast<int32_t>(t - bestMs) < 0)
+        {
+            best = i;
+            bestMs = t;
+        }
+    }
+
+    Beacon &b = beacons[best];
+
+    memset(&out, 0, sizeof(out));
+    out.rxMs = bestMs;
+    out.rssiRead = static_cast<int8_t>(b.rssi + randomRange(-3, 3));
+    out.rssiSend = 0;
+    out.addr[0] = 0xC0;
+    out.addr[1] = 0xF1;
+    out.addr[2] = 0xEE;
+    out.addr[3] = 0x70;
+    out.addr[4] = static_cast<uint8_t>(best >> 8);
+    out.addr[5] = static_cast<uint8_t>(best & 0xFF);
+    out.company = p.company;
+    out.keyId = p.keyId;
+    out.len = sizeof(out.payload);
+    memcpy(out.payload, b.cipher, sizeof(out.payload));
+    frames++;
+
+    if (++b.sent >= p.burstPackets)
+    {
+        b.sent = 0;
+        int32_t jitter = randomRange(-static_cast<int32_t>(p.jitterMs), static_cast<int32_t>(p.jitterMs));
+        b.burstStartMs += static_cast<uint32_t>(static_cast<int32_t>(p.periodMs) + jitter);
+        return newReading(best);
+    }
+
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include "adv_frame.h"
+
+/*
+  Generador determinista de una flota de beacons sinteticos.
+
+  Cada beacon despierta cada periodMs (+- jitterMs uniforme) con una fase
+  inicial aleatoria y anuncia burstPackets paquetes separados por
+  burstSpacingMs, igual que el firmware real. En cada despertar la
+  temperatura hace una caminata aleatoria. Los frames salen en orden de
+  rxMs; con la misma semilla la secuencia es identica en cualquier
+  plataforma.
+
+  El cifrado lo provee quien lo usa (mbedtls en el gateway, OpenSSL u otro
+  en Linux) para que la libreria no dependa de ninguna.
+*/
+
+static constexpr uint16_t FLEET_MAX_BEACONS = 256;
+
+// Clave de la flota del arnes; el gateway la registra solo mientras dura la inyeccion
+static constexpr uint8_t FLEET_HARNESS_KEY[16] = {
+    0x46, 0x4C, 0x45, 0x45, 0x54, 0x2D, 0x48, 0x41,
+    0x52, 0x4E, 0x45, 0x53, 0x53, 0x2D, 0x30, 0x31};
+
+typedef bool (*FleetEncryptFn)(const uint8_t key[16], const uint8_t in[16], uint8_t out[16], void *ctx);
+
+struct FleetParams
+{
+    uint16_t beacons = 16;
+    uint32_t periodMs = 10000;
+    uint32_t jitterMs = 200;
+    uint8_t burstPackets = 10;
+    uint16_t burstSpacingMs = 100;
+    uint32_t seed = 1;
+    uint8_t environmentId = 1;
+    uint16_t company = 0xF510;
+    uint8_t keyId = 0;
+    uint8_t key[16] = {};
+};
+
+class FleetGenerator
+{
+public:
+    bool begin(const FleetParams &params, FleetEncryptFn encrypt, void *ctx);
+    // Siempre hay un proximo frame; false solo si falla el cifrado
+    bool next(AdvFrame &out);
+
+    uint32_t framesGenerated() const { return frames; }
+
+private:
+    struct Beacon
+    {
+        uint32_t burstStartMs;
+        uint8_t sent;
+        int16_t tmpX100;
+        int16_t cpuX100;
+        int8_t batPct;
+        int8_t rssi;
+        uint8_t cipher[16];
+    };
+
+    uint32_t random();
+    int32_t randomRange(int32_t lo, int32_t hi);
+    bool newReading(uint16_t index);
+
+private:
+    FleetParams p;
+    FleetEncryptFn encryptFn = nullptr;
+    void *encryptCtx = nullptr;
+    Beacon beacons[FLEET_MAX_BEACONS];
+    uint32_t rng = 1;
+    uint32_t frames = 0;
+};
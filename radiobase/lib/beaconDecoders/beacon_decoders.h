@@ -0,0 +1,182 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Registro de decodificadores de beacon.
+
+  El anuncio se recorre como estructuras AD (len, tipo, datos). Del bloque
+  Manufacturer Specific Data (0xFF) salen el company ID y el bloque cifrado;
+  una vez descifrado, el primer byte es la version del cuerpo. Cada par
+  (company, version) tiene su entrada en BEACON_DECODERS con la funcion que
+  lo interpreta. La busqueda es constexpr sobre una tabla
+  fija y el llamado es directo por puntero, sin despacho virtual.
+
+  El MSD puede traer un key ID en claro antes del bloque cifrado:
+
+    [company 2][cifrado 16]            formato original, clave 0
+    [company 2][key id 1][cifrado 16]  con key ID
+
+  Para una nueva generacion de beacon: definir su struct empaquetado con
+  static_assert de layout, su funcion decodeBeaconVn y agregar la fila.
+*/
+
+static constexpr uint16_t BEACON_COMPANY_FRIOPACKING = 0xF510;
+
+static constexpr uint8_t BEACON_LEGACY_KEY_ID = 0;
+static constexpr size_t BEACON_CIPHER_LEN = 16;
+
+static constexpr uint8_t AD_TYPE_TX_POWER = 0x0A;
+static constexpr uint8_t AD_TYPE_MANUFACTURER = 0xFF;
+
+struct BeaconAdv
+{
+    uint16_t company;
+    const uint8_t *data; // MSD sin el company ID
+    uint8_t dataLen;
+    bool hasTxPower;
+    int8_t txPower;
+};
+
+// Campos comunes a todas las versiones de cuerpo
+struct BeaconFields
+{
+    uint8_t version_id;
+    uint8_t environment_id;
+    uint8_t device_id;
+    uint8_t flags;
+    int16_t tmp_x100;
+    int16_t cpu_x100;
+    int8_t bat_pct;
+};
+
+// Recorre las estructuras AD; false si el anuncio esta mal formado o no trae MSD
+inline bool beaconParseAdv(const uint8_t *p, size_t len, BeaconAdv &out)
+{
+    out.data = nullptr;
+    out.dataLen = 0;
+    out.hasTxPower = false;
+    out.txPower = 0;
+
+    size_t i = 0;
+    while (i < len)
+    {
+        uint8_t adLen = p[i];
+        if (adLen == 0) break;               // relleno al final del anuncio
+        if (i + 1 + adLen > len) return false; // estructura cortada
+
+        uint8_t type = p[i + 1];
+        const uint8_t *data = &p[i + 2];
+        uint8_t dataLen = adLen - 1;
+
+        if (type == AD_TYPE_TX_POWER && dataLen >= 1)
+        {
+            out.hasTxPower = true;
+            out.txPower = static_cast<int8_t>(data[0]);
+        }
+        else if (type == AD_TYPE_MANUFACTURER && dataLen >= 2 && out.data == nullptr)
+        {
+            out.company = static_cast<uint16_t>(data[0] | (data[1] << 8));
+            out.data = data + 2;
+            out.dataLen = dataLen - 2;
+        }
+
+        i += 1 + adLen;
+    }
+
+    return out.data != nullptr;
+}
+
+// Separa key ID y bloque cifrado del MSD
+inline bool beaconSplitCipher(const BeaconAdv &adv, uint8_t &keyId, const uint8_t *&cipher)
+{
+    if (adv.dataLen == BEACON_CIPHER_LEN)
+    {
+        keyId = BEACON_LEGACY_KEY_ID;
+        cipher = adv.data;
+        return true;
+    }
+
+    if (adv.dataLen == BEACON_CIPHER_LEN + 1)
+    {
+        keyId = adv.data[0];
+        cipher = adv.data + 1;
+        return true;
+    }
+
+    return false;
+}
+
+inline int16_t beaconReadI16(const uint8_t *p)
+{
+    return static_cast<int16_t>(p[0] | (p[1] << 8));
+}
+
+// ---- Version 1: cuerpo de 9 bytes, enteros little-endian ----
+
+#pragma pack(push, 1)
+struct BeaconBodyV1
+{
+    uint8_t version_id;
+    uint8_t environment_id;
+    uint8_t device_id;
+    uint8_t flags;
+    int16_t tmp_x100;
+    int16_t cpu_x100;
+    int8_t bat_pct;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(BeaconBodyV1) == 9, "BeaconBodyV1 debe ocupar 9 bytes");
+static_assert(offsetof(BeaconBodyV1, flags) == 3, "BeaconBodyV1.flags fuera de lugar");
+static_assert(offsetof(BeaconBodyV1, tmp_x100) == 4, "BeaconBodyV1.tmp_x100 fuera de lugar");
+static_assert(offsetof(BeaconBodyV1, cpu_x100) == 6, "BeaconBodyV1.cpu_x100 fuera de lugar");
+static_assert(offsetof(BeaconBodyV1, bat_pct) == 8, "BeaconBodyV1.bat_pct fuera de lugar");
+
+inline bool decodeBeaconV1(const uint8_t *plain, size_t len, BeaconFields &out)
+{
+    if (len < sizeof(BeaconBodyV1)) return false;
+
+    out.version_id = plain[offsetof(BeaconBodyV1, version_id)];
+    out.environment_id = plain[offsetof(BeaconBodyV1, environment_id)];
+    out.device_id = plain[offsetof(BeaconBodyV1, device_id)];
+    out.flags = plain[offsetof(BeaconBodyV1, flags)];
+    out.tmp_x100 = beaconReadI16(&plain[offsetof(BeaconBodyV1, tmp_x100)]);
+    out.cpu_x100 = beaconReadI16(&plain[offsetof(BeaconBodyV1, cpu_x100)]);
+    out.bat_pct = static_cast<int8_t>(plain[offsetof(BeaconBodyV1, bat_pct)]);
+    return true;
+}
+
+// ---- Tabla de decodificadores ----
+
+typedef bool (*BeaconDecodeFn)(const uint8_t *plain, size_t len, BeaconFields &out);
+
+struct BeaconDecoderEntry
+{
+    uint16_t company;
+    uint8_t version;
+    BeaconDecodeFn decode;
+};
+
+static constexpr BeaconDecoderEntry BEACON_DECODERS[] = {
+    {BEACON_COMPANY_FRIOPACKING, 1, decodeBeaconV1},
+};
+
+static constexpr size_t BEACON_DECODER_COUNT = sizeof(BEACON_DECODERS) / sizeof(BEACON_DECODERS[0]);
+
+constexpr const BeaconDecoderEntry *beaconFindDecoder(uint16_t company, uint8_t version, size_t i = 0)
+{
+    return i >= BEACON_DECODER_COUNT ? nullptr
+           : (BEACON_DECODERS[i].company == company && BEACON_DECODERS[i].version == version)
+               ? &BEACON_DECODERS[i]
+               : beaconFindDecoder(company, version, i + 1);
+}
+
+constexpr bool beaconCompanyKnown(uint16_t company, size_t i = 0)
+{
+    return i < BEACON_DECODER_COUNT &&
+           (BEACON_DECODERS[i].company == company || beaconCompanyKnown(company, i + 1));
+}
+
+static_assert(beaconFindDecoder(BEACON_COMPANY_FRIOPACKING, 1)->version == 1, "Falta el decodificador v1");
+static_assert(beaconCompanyKnown(BEACON_COMPANY_FRIOPACKING), "Company ID no registrado");
@@ -1,15 +1,30 @@
 #include "bleCallbacks.h"
 #include "ble_pipeline_stats.h"
+#include <beacon_decoders.h>
+#include <esp_timer.h>
 
 QueueHandle_t advQ = nullptr;
+QueueHandle_t volatile advCaptureQ = nullptr;
+volatile uint32_t advCaptureDropped = 0;
 NimBLEScan *scan = nullptr;
 static uint32_t lastAdvDropLogMs = 0;
 static constexpr uint32_t BLE_DROP_LOG_INTERVAL_MS = 5000;
 
+// Mide el tiempo de CPU del host por cada callback, en cualquier salida
+struct ScanCallbackTimer
+{
+    int64_t t0 = esp_timer_get_time();
+    ~ScanCallbackTimer()
+    {
+        bleStatsRecordScanCallback(static_cast<uint32_t>(esp_timer_get_time() - t0));
+    }
+};
+
 class ScanCallbacks : public NimBLEScanCallbacks
 {
     void onResult(const NimBLEAdvertisedDevice *advertisedDevice) override
     {
+        ScanCallbackTimer timer;
 
         // Data Envia
         // ADV: rssi=-36
@@ -20,22 +35,27 @@ class ScanCallbacks : public NimBLEScanCallbacks
         const uint8_t *p = advertisedDevice->getPayload().data();
         const size_t plen = advertisedDevice->getPayload().size();
 
-        // Formato esperado:
-        // 02 01 06 02 0A XX 13 FF F5 10 <data...>
-        if (plen < 10)
+        // Se recorren las estructuras AD en vez de asumir posiciones fijas
+        BeaconAdv adv;
+        if (!beaconParseAdv(p, plen, adv))
             return;
 
-        // filtro fijo por posiciones
-        if (p[7] != 0xFF)
+        if (!beaconCompanyKnown(adv.company))
             return;
-        if (p[8] != 0x10 || p[9] != 0xF5)
+
+        // El cuerpo cifrado es un bloque AES completo, con o sin key ID delante
+        uint8_t keyId = 0;
+        const uint8_t *cipher = nullptr;
+        if (!beaconSplitCipher(adv, keyId, cipher))
             return;
 
         AdvRaw m{};
 
         m.rssi_read = advertisedDevice->getRSSI();
-        m.rssi_send = (int8_t)p[5];
+        m.rssi_send = adv.hasTxPower ? adv.txPower : 0;
         m.rx_ms = millis();
+        m.company = adv.company;
+        m.key_id = keyId;
 
         NimBLEAddress a = advertisedDevice->getAddress();
         memcpy(m.addr, a.getVal(), 6);
@@ -43,13 +63,15 @@ class ScanCallbacks : public NimBLEScanCallbacks
         Serial.printf("BLE_SCAN MAC: %02X:%02X:%02X:%02X:%02X:%02X",
                       m.addr[0], m.addr[1], m.addr[2], m.addr[3], m.addr[4], m.addr[5]);
 */
-        const size_t data_start = 10;
-        size_t data_len = plen - data_start;
-        if (data_len > sizeof(m.payload))
-            data_len = sizeof(m.payload);
+        m.len = sizeof(m.payload);
+        memcpy(m.payload, cipher, sizeof(m.payload));
 
-        m.len = (uint8_t)data_len;
-        memcpy(m.payload, p + data_start, data_len);
+        // La captura nunca frena al escaneo: si su cola esta llena se pierde la copia
+        QueueHandle_t capture = advCaptureQ;
+        if (capture != nullptr && xQueueSend(capture, &m, 0) != pdTRUE)
+        {
+            advCaptureDropped++;
+        }
 
         BaseType_t ok = xQueueSend(advQ, &m, 0);
         if (ok != pdTRUE)
@@ -104,3 +126,81 @@ void ble_rx_init()
     scan->start(0, true, false);
     Serial.printf("BLE: Scan started");
 };
+
+bool ble_scan_configure(bool acceptListOnly, bool duplicateFilter)
+{
+    if (scan == nullptr)
+    {
+        return false;
+    }
+
+    // La politica de filtro solo se puede cambiar con el escaneo detenido
+    if (scan->isScanning())
+    {
+        scan->stop();
+    }
+
+    scan->setFilterPolicy(acceptListOnly ? BLE_HCI_SCAN_FILT_USE_WL : BLE_HCI_SCAN_FILT_NO_WL);
+    scan->setDuplicateFilter(duplicateFilter ? 1 : 0);
+
+    return scan->start(0, true, false);
+}
+
+bool ble_scan_set_duty(uint16_t intervalUnits, uint16_t windowUnits)
+{
+    if (scan == nullptr || windowUnits == 0 || windowUnits > intervalUnits)
+    {
+        return false;
+    }
+
+    // Los parametros se aplican al arrancar el escaneo
+    if (scan->isScanning())
+    {
+        scan->stop();
+    }
+
+    scan->setInterval(intervalUnits);
+    scan->setWindow(windowUnits);
+
+    return scan->start(0, true, false);
+}
+
+bool ble_scan_set_accept_list(const uint64_t *addrs, size_t count)
+{
+    if (scan == nullptr)
+    {
+        return false;
+    }
+
+    if (scan->isScanning())
+    {
+        scan->stop();
+    }
+
+    while (NimBLEDevice::getWhiteListCount() > 0)
+    {
+        NimBLEAddress a = NimBLEDevice::getWhiteListAddress(0);
+        if (!NimBLEDevice::whiteListRemove(a))
+        {
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        // addr se arma MSB primero desde getVal(); NimBLE espera LSB primero
+        uint8_t val[6];
+        for (int b = 0; b < 6; ++b)
+        {
+            val[b] = static_cast<uint8_t>((addrs[i] >> (8 * (5 - b))) & 0xFF);
+        }
+
+        // Los beacons nRF52 anuncian con direccion random static
+        if (!NimBLEDevice::whiteListAdd(NimBLEAddress(val, BLE_ADDR_RANDOM)))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
@@ -9,12 +9,26 @@ struct AdvRaw
     int8_t rssi_read;
     int8_t rssi_send;
     uint8_t addr[6];
+    uint16_t company;
+    uint8_t key_id;
     uint8_t len;
     uint8_t payload[16];
     uint32_t rx_ms;
 };
 
 extern QueueHandle_t advQ;
+// Copia de cada AdvRaw para captura; nullptr cuando no se esta grabando
+extern QueueHandle_t volatile advCaptureQ;
+extern volatile uint32_t advCaptureDropped;
 extern NimBLEScan* scan;
 
-void ble_rx_init();
\ No newline at end of file
+void ble_rx_init();
+
+// Reinicia el escaneo con la politica de filtro indicada. Reiniciar tambien
+// vacia la cache de duplicados del controlador.
+bool ble_scan_configure(bool acceptListOnly, bool duplicateFilter);
+// Cambia intervalo y ventana de escaneo (unidades de 0.625 ms) y reinicia
+// el escaneo con la politica de filtro vigente.
+bool ble_scan_set_duty(uint16_t intervalUnits, uint16_t windowUnits);
+// Reemplaza la accept list del controlador. Deja el escaneo detenido.
+bool ble_scan_set_accept_list(const uint64_t *addrs, size_t count);
\ No newline at end of file
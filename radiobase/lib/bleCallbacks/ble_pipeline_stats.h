@@ -7,6 +7,8 @@ struct BlePipelineStats
     uint32_t adv_received = 0;
     uint32_t adv_dropped = 0;
     uint32_t adv_decrypt_fail = 0;
+    uint32_t adv_unknown_version = 0;
+    uint32_t adv_unknown_key = 0;
 
     uint32_t data_enqueued = 0;
     uint32_t data_dropped = 0;
@@ -22,18 +24,25 @@ struct BlePipelineStats
     uint32_t max_adv_depth = 0;
     uint32_t max_data_depth = 0;
     uint32_t max_end_to_end_ms = 0;
+
+    uint32_t scan_callbacks = 0;
+    uint32_t scan_cpu_us = 0;
 };
 
 extern BlePipelineStats bleStats;
 
 void bleStatsReset();
+void bleStatsRestore(const BlePipelineStats &restored);
 BlePipelineStats bleStatsSnapshot();
 void bleStatsRecordAdvReceived(uint32_t depth);
 void bleStatsRecordAdvDropped(uint32_t depth);
 void bleStatsRecordAdvDecryptFail();
+void bleStatsRecordAdvUnknownVersion();
+void bleStatsRecordAdvUnknownKey();
 void bleStatsRecordDataEnqueued(uint32_t depth);
 void bleStatsRecordDataDropped(uint32_t depth);
 void bleStatsRecordProcessed(uint32_t endToEndMs);
 void bleStatsRecordMappedUpdate();
 void bleStatsRecordDirectUpdate();
 void bleStatsRecordRegistryUpdate(bool isNew);
+void bleStatsRecordScanCallback(uint32_t cpuUs);
@@ -1,20 +1,221 @@
 #include "crypto_lib.h"
 #include "mbedtls/aes.h"
+#include <time.h>
 
-mbedtls_aes_context aes_ctx;
+struct AesKeySlot
+{
+    bool used;
+    uint8_t id;
+    uint32_t retireAt;
+    uint32_t decrypted;
+    uint32_t rejected;
+    uint32_t failed;
+    mbedtls_aes_context ctx;
+};
+
+// Primero los de produccion, despues los reservados
+static AesKeySlot slots[AES_KEY_SLOTS_TOTAL];
+// slot + 1 por key ID; 0 = sin clave
+static uint8_t slotOfId[256];
+static uint32_t unknownKey = 0;
+static uint32_t keyBusy = 0;
+static SemaphoreHandle_t keyMutex = nullptr;
+
+static_assert(AES_KEY_SLOTS_TOTAL < 256, "slotOfId guarda el indice en un byte");
+
+// Antes de 2023 se asume reloj sin sincronizar
+static constexpr time_t CLOCK_MIN_VALID = 1672531200;
+
+static bool keyLock(TickType_t timeout = portMAX_DELAY)
+{
+    if (keyMutex == nullptr)
+    {
+        keyMutex = xSemaphoreCreateMutex();
+    }
+    return keyMutex != nullptr && xSemaphoreTake(keyMutex, timeout) == pdTRUE;
+}
+
+static void keyUnlock()
+{
+    xSemaphoreGive(keyMutex);
+}
+
+static bool isRetired(const AesKeySlot &s)
+{
+    if (s.retireAt == 0) return false;
+    time_t now = time(nullptr);
+    return now >= CLOCK_MIN_VALID && static_cast<uint32_t>(now) >= s.retireAt;
+}
+
+bool aes_key_set(uint8_t id, const uint8_t key[16], uint32_t retireAt)
+{
+    if (!keyLock()) return false;
+
+    int idx = slotOfId[id] - 1;
+    if (idx < 0)
+    {
+        bool reserved = id >= AES_RESERVED_KEY_ID_MIN;
+        int first = reserved ? AES_KEY_SLOTS : 0;
+        int last = reserved ? AES_KEY_SLOTS_TOTAL : AES_KEY_SLOTS;
+
+        for (int i = first; i < last; ++i)
+        {
+            if (!slots[i].used)
+            {
+                idx = i;
+                break;
+            }
+        }
+    }
+    else
+    {
+        mbedtls_aes_free(&slots[idx].ctx);
+    }
+
+    if (idx < 0)
+    {
+        keyUnlock();
+        return false;
+    }
+
+    AesKeySlot &s = slots[idx];
+    mbedtls_aes_init(&s.ctx);
+    bool ok = mbedtls_aes_setkey_dec(&s.ctx, key, 128) == 0;
+
+    s.used = ok;
+    s.id = id;
+    s.retireAt = retireAt;
+    s.decrypted = 0;
+    s.rejected = 0;
+    s.failed = 0;
+    slotOfId[id] = ok ? static_cast<uint8_t>(idx + 1) : 0;
+
+    if (!ok) mbedtls_aes_free(&s.ctx);
+
+    keyUnlock();
+    return ok;
+}
+
+bool aes_key_retire(uint8_t id, uint32_t retireAt)
+{
+    if (!keyLock()) return false;
+
+    int idx = slotOfId[id] - 1;
+    if (idx >= 0) slots[idx].retireAt = retireAt;
+
+    keyUnlock();
+    return idx >= 0;
+}
+
+bool aes_key_remove(uint8_t id)
+{
+    if (!keyLock()) return false;
+
+    int idx = slotOfId[id] - 1;
+    if (idx >= 0)
+    {
+        mbedtls_aes_free(&slots[idx].ctx);
+        slots[idx] = {};
+        slotOfId[id] = 0;
+    }
+
+    keyUnlock();
+    return idx >= 0;
+}
+
+AesKeyResult decrypt_block_key(uint8_t id, const uint8_t in[16], uint8_t out[16])
+{
+    if (!keyLock(AES_KEY_LOOKUP_WAIT))
+    {
+        keyBusy++;
+        return AesKeyResult::BUSY;
+    }
+
+    AesKeyResult result;
+    int idx = slotOfId[id] - 1;
 
-bool aes_init_key(const uint8_t key[16]){
-    mbedtls_aes_init(&aes_ctx);
-    mbedtls_aes_setkey_dec(&aes_ctx, key, 128);
-    return true;
+    if (idx < 0)
+    {
+        unknownKey++;
+        result = AesKeyResult::UNKNOWN_KEY;
+    }
+    else if (isRetired(slots[idx]))
+    {
+        result = AesKeyResult::RETIRED;
+    }
+    else if (mbedtls_aes_crypt_ecb(&slots[idx].ctx, MBEDTLS_AES_DECRYPT, in, out) == 0)
+    {
+        result = AesKeyResult::OK;
+    }
+    else
+    {
+        slots[idx].failed++;
+        result = AesKeyResult::ERROR;
+    }
+
+    keyUnlock();
+    return result;
 }
 
-bool decrypt_block(const uint8_t in[16], uint8_t out[16])
+// Con la tabla tomada por una rotacion el contador se pierde antes que esperar
+void aes_key_record(uint8_t id, bool ok)
 {
-    return mbedtls_aes_crypt_ecb(&aes_ctx, MBEDTLS_AES_DECRYPT, in, out) == 0;
+    if (!keyLock(AES_KEY_LOOKUP_WAIT)) return;
+
+    int idx = slotOfId[id] - 1;
+    if (idx >= 0)
+    {
+        if (ok)
+            slots[idx].decrypted++;
+        else
+            slots[idx].rejected++;
+    }
+
+    keyUnlock();
+}
+
+size_t aes_key_list(AesKeyInfo *out, size_t maxCount)
+{
+    if (!keyLock()) return 0;
+
+    size_t n = 0;
+    for (int i = 0; i < AES_KEY_SLOTS_TOTAL && n < maxCount; ++i)
+    {
+        if (!slots[i].used) continue;
+
+        AesKeyInfo &info = out[n++];
+        info.id = slots[i].id;
+        info.retireAt = slots[i].retireAt;
+        info.retired = isRetired(slots[i]);
+        info.decrypted = slots[i].decrypted;
+        info.rejected = slots[i].rejected;
+        info.failed = slots[i].failed;
+    }
+
+    keyUnlock();
+    return n;
+}
+
+uint32_t aes_unknown_key_count()
+{
+    return unknownKey;
+}
+
+uint32_t aes_key_busy_count()
+{
+    return keyBusy;
 }
 
 void aes_cleanup()
 {
-    mbedtls_aes_free(&aes_ctx);
-}
\ No newline at end of file
+    if (!keyLock()) return;
+
+    for (int i = 0; i < AES_KEY_SLOTS_TOTAL; ++i)
+    {
+        if (slots[i].used) mbedtls_aes_free(&slots[i].ctx);
+        slots[i] = {};
+    }
+    memset(slotOfId, 0, sizeof(slotOfId));
+
+    keyUnlock();
+}
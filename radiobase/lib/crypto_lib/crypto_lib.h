@@ -1,6 +1,67 @@
 #pragma once
 #include <Arduino.h>
 
-bool aes_init_key(const uint8_t key[16]);
-bool decrypt_block(const uint8_t in[16], uint8_t out[16]);
-void aes_cleanup();
\ No newline at end of file
+/*
+  Tabla de claves AES por key ID.
+
+  Cada clave se expande una sola vez en su contexto al registrarse; el
+  paquete trae el key ID en claro y el contexto se elige por indice, sin
+  probar claves. Durante una rotacion conviven la clave vieja (con fecha de
+  retiro) y la nueva.
+
+  Los key ID desde AES_RESERVED_KEY_ID_MIN (claves temporales del arnes y
+  del benchmark) usan slots propios y no ocupan los AES_KEY_SLOTS de
+  produccion.
+
+  El descifrado corre por cada anuncio: espera la tabla a lo sumo
+  AES_KEY_LOOKUP_WAIT y, si una rotacion la tiene tomada, devuelve BUSY
+  en vez de frenar la tarea de decodificacion.
+*/
+
+#ifndef AES_KEY_SLOTS
+#define AES_KEY_SLOTS 4
+#endif
+
+#ifndef AES_RESERVED_KEY_SLOTS
+#define AES_RESERVED_KEY_SLOTS 2
+#endif
+
+#define AES_RESERVED_KEY_ID_MIN 0xF0
+#define AES_KEY_SLOTS_TOTAL (AES_KEY_SLOTS + AES_RESERVED_KEY_SLOTS)
+
+#ifndef AES_KEY_LOOKUP_WAIT
+#define AES_KEY_LOOKUP_WAIT pdMS_TO_TICKS(2)
+#endif
+
+enum class AesKeyResult : uint8_t
+{
+    OK,
+    UNKNOWN_KEY,
+    RETIRED,
+    BUSY,
+    ERROR
+};
+
+struct AesKeyInfo
+{
+    uint8_t id;
+    uint32_t retireAt; // epoch (s), 0 = sin retiro
+    bool retired;
+    uint32_t decrypted;
+    uint32_t rejected; // descifrado sin decodificador para el cuerpo
+    uint32_t failed;   // error de mbedtls
+};
+
+// retireAt solo se aplica con el reloj sincronizado; sin hora la clave sigue valida
+bool aes_key_set(uint8_t id, const uint8_t key[16], uint32_t retireAt = 0);
+bool aes_key_retire(uint8_t id, uint32_t retireAt);
+bool aes_key_remove(uint8_t id);
+
+AesKeyResult decrypt_block_key(uint8_t id, const uint8_t in[16], uint8_t out[16]);
+// Resultado del cuerpo descifrado: un rechazo suele indicar clave equivocada
+void aes_key_record(uint8_t id, bool ok);
+
+size_t aes_key_list(AesKeyInfo *out, size_t maxCount);
+uint32_t aes_unknown_key_count();
+uint32_t aes_key_busy_count();
+void aes_cleanup();
@@ -0,0 +1,115 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+/*
+  Anillo de difusion sin locks: un productor, muchos lectores.
+
+  El productor nunca espera: escribe sobre la celda mas vieja aunque haya
+  lectores atrasados. Cada celda lleva un numero de secuencia (impar
+  mientras se escribe, par con el indice publicado), asi el lector detecta
+  si la celda fue pisada antes o durante la copia. Un lector al que le
+  dieron la vuelta salta hacia adelante, deja margen para no volver a
+  quedar atras al instante y cuenta los eventos perdidos.
+
+  Cada lector guarda su propio cursor; el anillo no sabe cuantos hay.
+  Solo un hilo puede publicar.
+*/
+
+enum class RingRead : uint8_t
+{
+    OK,
+    EMPTY
+};
+
+template <typename T, size_t N>
+class BroadcastRing
+{
+    static_assert(N >= 8 && (N & (N - 1)) == 0, "N debe ser potencia de 2");
+
+public:
+    void publish(const T &value)
+    {
+        uint32_t h = head.load(std::memory_order_relaxed);
+        Cell &c = cells[h & (N - 1)];
+
+        c.seq.store(h * 2 + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        c.value = value;
+        c.seq.store(h * 2 + 2, std::memory_order_release);
+        head.store(h + 1, std::memory_order_release);
+    }
+
+    // Indice del proximo evento a publicar
+    uint32_t headSeq() const
+    {
+        return head.load(std::memory_order_acquire);
+    }
+
+    // Indice del evento mas viejo que todavia se puede leer
+    uint32_t oldestSeq() const
+    {
+        uint32_t h = headSeq();
+        return h > N ? h - N : 0;
+    }
+
+    RingRead read(uint32_t &cursor, T &out, uint32_t &skipped) const
+    {
+        for (;;)
+        {
+            uint32_t h = head.load(std::memory_order_acquire);
+            if (cursor == h) return RingRead::EMPTY;
+
+            // Cursor adelantado (anillo reiniciado) o demasiado atras
+            if (static_cast<int32_t>(h - cursor) < 0 || (h - cursor) > N)
+            {
+                skipAhead(cursor, h, skipped);
+                continue;
+            }
+
+            const Cell &c = cells[cursor & (N - 1)];
+            uint32_t s1 = c.seq.load(std::memory_order_acquire);
+            if (s1 != cursor * 2 + 2)
+            {
+                skipAhead(cursor, head.load(std::memory_order_acquire), skipped);
+                continue;
+            }
+
+            T copy = c.value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (c.seq.load(std::memory_order_relaxed) != s1)
+            {
+                // Pisada mientras se copiaba
+                skipAhead(cursor, head.load(std::memory_order_acquire), skipped);
+                continue;
+            }
+
+            out = copy;
+            cursor++;
+            return RingRead::OK;
+        }
+    }
+
+private:
+    struct Cell
+    {
+        std::atomic<uint32_t> seq{0};
+        T value{};
+    };
+
+    // Margen de un octavo del anillo para no quedar pisado otra vez enseguida
+    static void skipAhead(uint32_t &cursor, uint32_t h, uint32_t &skipped)
+    {
+        uint32_t target = h > N ? h - N + N / 8 : 0;
+        if (static_cast<int32_t>(h - cursor) >= 0)
+        {
+            skipped += target - cursor;
+        }
+        cursor = target;
+    }
+
+private:
+    Cell cells[N];
+    std::atomic<uint32_t> head{0};
+};
@@ -0,0 +1,389 @@
+#include "gzip_stream.h"
+#include <string.h>
+
+static constexpr uint32_t MIN_MATCH = 3;
+static constexpr uint32_t MAX_MATCH = 258;
+static constexpr uint32_t MIN_LOOKAHEAD = MAX_MATCH + MIN_MATCH + 1;
+static constexpr uint16_t NIL = 0xFFFF;
+
+// Peor caso de salida por paso: un match son 31 bits; el cierre, EOB + bloque final + trailer
+static constexpr size_t OUT_RESERVE = 8;
+static constexpr size_t OUT_CLOSE = 24;
+
+static constexpr uint16_t SYM_END_OF_BLOCK = 256;
+
+static const uint32_t CRC_NIBBLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+static uint32_t crcUpdate(uint32_t crc, const uint8_t *p, size_t len)
+{
+    while (len--)
+    {
+        crc = (crc >> 4) ^ CRC_NIBBLE[(crc ^ *p) & 0x0F];
+        crc = (crc >> 4) ^ CRC_NIBBLE[(crc ^ (*p >> 4)) & 0x0F];
+        p++;
+    }
+    return crc;
+}
+
+// Codigos Huffman fijos (RFC 1951 3.2.6) ya invertidos para escribir LSB primero
+struct FixedCodes
+{
+    uint16_t code[288];
+    uint8_t len[288];
+
+    FixedCodes()
+    {
+        for (uint16_t sym = 0; sym < 288; ++sym)
+        {
+            uint16_t c;
+            uint8_t n;
+            if (sym < 144)
+            {
+                c = 0x30 + sym;
+                n = 8;
+            }
+            else if (sym < 256)
+            {
+                c = 0x190 + (sym - 144);
+                n = 9;
+            }
+            else if (sym < 280)
+            {
+                c = sym - 256;
+                n = 7;
+            }
+            else
+            {
+                c = 0xC0 + (sym - 280);
+                n = 8;
+            }
+
+            uint16_t r = 0;
+            for (uint8_t i = 0; i < n; ++i)
+            {
+                r = static_cast<uint16_t>((r << 1) | ((c >> i) & 1));
+            }
+            code[sym] = r;
+            len[sym] = n;
+        }
+    }
+};
+
+static const FixedCodes &fixedCodes()
+{
+    static const FixedCodes codes;
+    return codes;
+}
+
+static uint8_t reverse5(uint8_t v)
+{
+    return static_cast<uint8_t>(((v & 1) << 4) | ((v & 2) << 2) | (v & 4) | ((v & 8) >> 2) | ((v & 16) >> 4));
+}
+
+static uint8_t highBit(uint32_t v)
+{
+    return static_cast<uint8_t>(31 - __builtin_clz(v));
+}
+
+size_t GzipStream::workBytes(const GzipConfig &c)
+{
+    size_t w = static_cast<size_t>(1) << c.windowBits;
+    size_t h = static_cast<size_t>(1) << c.hashBits;
+    return 2 * w + h * sizeof(uint16_t) + w * sizeof(uint16_t) + c.outBytes;
+}
+
+bool GzipStream::begin(void *work, size_t bytes, const GzipConfig &c)
+{
+    // Con ventana de 2^15 la posicion 0xFFFF chocaria con NIL
+    if (c.windowBits < 9 || c.windowBits > 14) return false;
+    if (c.hashBits < 8 || c.hashBits > 15) return false;
+    if (c.outBytes < 64) return false;
+    if (work == nullptr || bytes < workBytes(c)) return false;
+
+    cfg = c;
+    wsize = 1UL << c.windowBits;
+    wmask = wsize - 1;
+    maxDist = wsize - MIN_LOOKAHEAD;
+
+    uint8_t *p = static_cast<uint8_t *>(work);
+    head = reinterpret_cast<uint16_t *>(p);
+    p += (static_cast<size_t>(1) << c.hashBits) * sizeof(uint16_t);
+    prev = reinterpret_cast<uint16_t *>(p);
+    p += wsize * sizeof(uint16_t);
+    win = p;
+    p += 2 * wsize;
+    out = p;
+
+    memset(head, 0xFF, (static_cast<size_t>(1) << c.hashBits) * sizeof(uint16_t));
+
+    strstart = 0;
+    lookahead = 0;
+    outStart = 0;
+    outEnd = 0;
+    bitBuf = 0;
+    bitCount = 0;
+    crc = 0xFFFFFFFFUL;
+    finished = false;
+    st = GzipStats{};
+
+    // Cabecera gzip sin nombre ni fecha: la salida solo depende de la entrada
+    static const uint8_t HEADER[10] = {0x1F, 0x8B, 0x08, 0x00, 0, 0, 0, 0, 0x00, 0xFF};
+    for (uint8_t b : HEADER) putByte(b);
+
+    // Bloque no final con Huffman fijo: dura hasta finish()
+    putBits(0, 1);
+    putBits(1, 2);
+    return true;
+}
+
+size_t GzipStream::outFree() const
+{
+    return cfg.outBytes - outEnd;
+}
+
+void GzipStream::compactOut()
+{
+    if (outStart == 0) return;
+    memmove(out, out + outStart, outEnd - outStart);
+    outEnd -= outStart;
+    outStart = 0;
+}
+
+void GzipStream::putByte(uint8_t b)
+{
+    out[outEnd++] = b;
+    st.outBytes++;
+}
+
+void GzipStream::putBits(uint32_t value, uint8_t n)
+{
+    bitBuf |= value << bitCount;
+    bitCount += n;
+    while (bitCount >= 8)
+    {
+        putByte(static_cast<uint8_t>(bitBuf));
+        bitBuf >>= 8;
+        bitCount -= 8;
+    }
+}
+
+void GzipStream::alignByte()
+{
+    if (bitCount > 0) putBits(0, 8 - bitCount);
+}
+
+void GzipStream::emitSymbol(uint16_t sym)
+{
+    const FixedCodes &fc = fixedCodes();
+    putBits(fc.code[sym], fc.len[sym]);
+}
+
+void GzipStream::emitLiteral(uint8_t c)
+{
+    emitSymbol(c);
+    st.literals++;
+}
+
+void GzipStream::emitMatch(uint32_t len, uint32_t dist)
+{
+    // Largo: 257..284 con 0..5 bits extra; 258 tiene su propio codigo
+    uint32_t l = len - MIN_MATCH;
+    if (len == MAX_MATCH)
+    {
+        emitSymbol(285);
+    }
+    else if (l < 8)
+    {
+        emitSymbol(static_cast<uint16_t>(257 + l));
+    }
+    else
+    {
+        uint8_t nb = highBit(l);
+        uint8_t extra = nb - 2;
+        emitSymbol(static_cast<uint16_t>(257 + 4 * (nb - 1) + ((l >> extra) & 3)));
+        putBits(l & ((1UL << extra) - 1), extra);
+    }
+
+    // Distancia: codigos de 5 bits con 0..13 bits extra
+    uint32_t d = dist - 1;
+    if (d < 4)
+    {
+        putBits(reverse5(static_cast<uint8_t>(d)), 5);
+    }
+    else
+    {
+        uint8_t nb = highBit(d);
+        uint8_t extra = nb - 1;
+        putBits(reverse5(static_cast<uint8_t>(2 * nb + ((d >> extra) & 1))), 5);
+        putBits(d & ((1UL << extra) - 1), extra);
+    }
+
+    st.matches++;
+}
+
+uint32_t GzipStream::hashAt(uint32_t pos) const
+{
+    uint32_t v = win[pos] | (static_cast<uint32_t>(win[pos + 1]) << 8) | (static_cast<uint32_t>(win[pos + 2]) << 16);
+    return static_cast<uint32_t>(v * 2654435761U) >> (32 - cfg.hashBits);
+}
+
+void GzipStream::insert(uint32_t pos)
+{
+    uint32_t h = hashAt(pos);
+    prev[pos & wmask] = head[h];
+    head[h] = static_cast<uint16_t>(pos);
+}
+
+uint32_t GzipStream::longestMatch(uint32_t pos, uint32_t &dist)
+{
+    uint32_t h = hashAt(pos);
+    uint32_t cand = head[h];
+    prev[pos & wmask] = head[h];
+    head[h] = static_cast<uint16_t>(pos);
+
+    uint32_t maxLen = lookahead < MAX_MATCH ? lookahead : MAX_MATCH;
+    uint32_t limit = pos > maxDist ? pos - maxDist : 0;
+    uint32_t best = MIN_MATCH - 1;
+    uint16_t chain = cfg.maxChain;
+
+    const uint8_t *b = win + pos;
+    while (cand != NIL && cand < pos && cand >= limit && chain-- > 0)
+    {
+        const uint8_t *a = win + cand;
+        if (a[best] == b[best] && a[0] == b[0] && a[1] == b[1])
+        {
+            uint32_t len = 2;
+            while (len < maxLen && a[len] == b[len]) len++;
+
+            if (len > best)
+            {
+                best = len;
+                dist = pos - cand;
+                if (len == maxLen) break;
+            }
+        }
+
+        uint32_t next = prev[cand & wmask];
+        if (next == NIL || next >= cand) break;
+        cand = next;
+    }
+
+    return best >= MIN_MATCH ? best : 0;
+}
+
+void GzipStream::slide()
+{
+    memcpy(win, win + wsize, wsize);
+    strstart -= wsize;
+
+    size_t hsize = static_cast<size_t>(1) << cfg.hashBits;
+    for (size_t i = 0; i < hsize; ++i)
+    {
+        uint16_t v = head[i];
+        head[i] = (v != NIL && v >= wsize) ? static_cast<uint16_t>(v - wsize) : NIL;
+    }
+    for (uint32_t i = 0; i < wsize; ++i)
+    {
+        uint16_t v = prev[i];
+        prev[i] = (v != NIL && v >= wsize) ? static_cast<uint16_t>(v - wsize) : NIL;
+    }
+}
+
+void GzipStream::process(bool flush)
+{
+    compactOut();
+
+    while (outFree() >= OUT_RESERVE && lookahead > 0)
+    {
+        // Sin flush se espera a tener un match maximo por delante
+        if (!flush && lookahead < MIN_LOOKAHEAD) break;
+
+        uint32_t dist = 0;
+        uint32_t len = (cfg.maxChain > 0 && lookahead >= MIN_MATCH) ? longestMatch(strstart, dist) : 0;
+
+        if (len > 0)
+        {
+            emitMatch(len, dist);
+            for (uint32_t i = 1; i < len && i + MIN_MATCH <= lookahead; ++i)
+            {
+                insert(strstart + i);
+            }
+            strstart += len;
+            lookahead -= len;
+        }
+        else
+        {
+            emitLiteral(win[strstart]);
+            strstart++;
+            lookahead--;
+        }
+    }
+}
+
+size_t GzipStream::write(const uint8_t *in, size_t len)
+{
+    if (finished) return 0;
+
+    size_t consumed = 0;
+    for (;;)
+    {
+        process(false);
+        if (consumed == len || outFree() < OUT_RESERVE) break;
+
+        if (strstart >= 2 * wsize - MIN_LOOKAHEAD) slide();
+
+        uint32_t room = 2 * wsize - strstart - lookahead;
+        if (room == 0) break;
+
+        size_t n = len - consumed;
+        if (n > room) n = room;
+
+        memcpy(win + strstart + lookahead, in + consumed, n);
+        crc = crcUpdate(crc, in + consumed, n);
+        lookahead += n;
+        consumed += n;
+        st.inBytes += n;
+    }
+
+    return consumed;
+}
+
+bool GzipStream::finish()
+{
+    if (finished) return true;
+
+    process(true);
+    if (lookahead > 0 || outFree() < OUT_CLOSE) return false;
+
+    emitSymbol(SYM_END_OF_BLOCK);
+    // Bloque final vacio: el primero no se pudo marcar como final
+    putBits(1, 1);
+    putBits(1, 2);
+    emitSymbol(SYM_END_OF_BLOCK);
+    alignByte();
+
+    uint32_t sum = crc ^ 0xFFFFFFFFUL;
+    for (uint8_t i = 0; i < 4; ++i) putByte(static_cast<uint8_t>(sum >> (8 * i)));
+    for (uint8_t i = 0; i < 4; ++i) putByte(static_cast<uint8_t>(st.inBytes >> (8 * i)));
+
+    finished = true;
+    return true;
+}
+
+size_t GzipStream::read(uint8_t *dst, size_t maxLen)
+{
+    size_t n = pending();
+    if (n > maxLen) n = maxLen;
+
+    memcpy(dst, out + outStart, n);
+    outStart += n;
+    if (outStart == outEnd)
+    {
+        outStart = 0;
+        outEnd = 0;
+    }
+    return n;
+}
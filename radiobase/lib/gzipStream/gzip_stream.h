@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Compresor gzip en streaming con memoria fija.
+
+  LZ77 con ventana de 2^windowBits bytes y cadenas de hash acotadas a
+  maxChain candidatos, codificado en un solo bloque deflate con Huffman
+  fijo (sin tablas por bloque: nada que armar ni guardar por respuesta).
+  Toda la memoria de trabajo la pasa quien lo usa en begin(); no toca el
+  heap. workBytes() dice cuanta hace falta para una configuracion.
+
+  write() consume entrada solo mientras haya lugar para la salida que
+  produce, asi el buffer de salida nunca crece: quien lo usa alterna
+  write() y read() hasta que finish() devuelve true y pending() es 0.
+*/
+
+struct GzipConfig
+{
+    uint8_t windowBits = 12; // 9..14
+    uint8_t hashBits = 12;   // 8..15
+    uint16_t maxChain = 16;  // candidatos por posicion; 0 = solo literales
+    uint16_t outBytes = 1024;
+};
+
+struct GzipStats
+{
+    uint32_t inBytes = 0;
+    uint32_t outBytes = 0;
+    uint32_t matches = 0;
+    uint32_t literals = 0;
+};
+
+class GzipStream
+{
+public:
+    static size_t workBytes(const GzipConfig &cfg);
+
+    // false si la configuracion no es valida o no alcanza la memoria
+    bool begin(void *work, size_t bytes, const GzipConfig &cfg);
+
+    // Bytes de entrada consumidos; puede ser menos que len si la salida esta llena
+    size_t write(const uint8_t *in, size_t len);
+    // Cierra el stream; true cuando ya genero todo (falta leerlo con read())
+    bool finish();
+
+    size_t read(uint8_t *out, size_t maxLen);
+    size_t pending() const { return outEnd - outStart; }
+    bool done() const { return finished && pending() == 0; }
+
+    const GzipStats &stats() const { return st; }
+
+private:
+    void process(bool flush);
+    void slide();
+    uint32_t hashAt(uint32_t pos) const;
+    uint32_t longestMatch(uint32_t pos, uint32_t &dist);
+    void insert(uint32_t pos);
+
+    void putBits(uint32_t value, uint8_t n);
+    void putByte(uint8_t b);
+    void alignByte();
+    void emitLiteral(uint8_t c);
+    void emitMatch(uint32_t len, uint32_t dist);
+    void emitSymbol(uint16_t sym);
+    size_t outFree() const;
+    void compactOut();
+
+private:
+    GzipConfig cfg;
+    uint32_t wsize = 0;
+    uint32_t wmask = 0;
+    uint32_t maxDist = 0;
+
+    uint8_t *win = nullptr;   // 2 * wsize
+    uint16_t *head = nullptr; // 1 << hashBits
+    uint16_t *prev = nullptr; // wsize
+    uint8_t *out = nullptr;   // cfg.outBytes
+
+    uint32_t strstart = 0;
+    uint32_t lookahead = 0;
+
+    size_t outStart = 0;
+    size_t outEnd = 0;
+    uint32_t bitBuf = 0;
+    uint8_t bitCount = 0;
+
+    uint32_t crc = 0;
+    bool finished = false;
+    GzipStats st;
+};
@@ -0,0 +1,330 @@
+#include "history_codec.h"
+#include <string.h>
+
+static constexpr size_t FRAME_FIXED_BYTES = 14 + 7;
+
+class BitWriter
+{
+public:
+    BitWriter(uint8_t *out, size_t cap) : buf(out), capBits(cap * 8)
+    {
+        memset(buf, 0, cap);
+    }
+
+    void put(uint32_t value, uint8_t bits)
+    {
+        for (int i = bits - 1; i >= 0; --i)
+        {
+            if (pos >= capBits)
+            {
+                overflow = true;
+                return;
+            }
+            if ((value >> i) & 1u)
+            {
+                buf[pos >> 3] |= static_cast<uint8_t>(0x80u >> (pos & 7));
+            }
+            pos++;
+        }
+    }
+
+    size_t bytes() const { return (pos + 7) / 8; }
+
+    bool overflow = false;
+
+private:
+    uint8_t *buf;
+    size_t capBits;
+    size_t pos = 0;
+};
+
+class BitReader
+{
+public:
+    BitReader(const uint8_t *in, size_t len) : buf(in), lenBits(len * 8) {}
+
+    uint32_t get(uint8_t bits)
+    {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < bits; ++i)
+        {
+            if (pos >= lenBits)
+            {
+                overflow = true;
+                return 0;
+            }
+            value = (value << 1) | ((buf[pos >> 3] >> (7 - (pos & 7))) & 1u);
+            pos++;
+        }
+        return value;
+    }
+
+    bool overflow = false;
+
+private:
+    const uint8_t *buf;
+    size_t lenBits;
+    size_t pos = 0;
+};
+
+static uint32_t zigzag(int32_t v)
+{
+    return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t z)
+{
+    return static_cast<int32_t>((z >> 1) ^ (~(z & 1) + 1));
+}
+
+// Delta-de-delta de timestamps: '0' | '10'+7 | '110'+9 | '1110'+12 | '1111'+32
+static void putTimestamp(BitWriter &w, int32_t dod)
+{
+    uint32_t z = zigzag(dod);
+    if (z == 0)
+        w.put(0b0, 1);
+    else if (z < (1u << 7))
+    {
+        w.put(0b10, 2);
+        w.put(z, 7);
+    }
+    else if (z < (1u << 9))
+    {
+        w.put(0b110, 3);
+        w.put(z, 9);
+    }
+    else if (z < (1u << 12))
+    {
+        w.put(0b1110, 4);
+        w.put(z, 12);
+    }
+    else
+    {
+        w.put(0b1111, 4);
+        w.put(z, 32);
+    }
+}
+
+static int32_t getTimestamp(BitReader &r)
+{
+    if (r.get(1) == 0) return 0;
+    if (r.get(1) == 0) return unzigzag(r.get(7));
+    if (r.get(1) == 0) return unzigzag(r.get(9));
+    if (r.get(1) == 0) return unzigzag(r.get(12));
+    return unzigzag(r.get(32));
+}
+
+// Delta de valores int16: '0' | '10'+6 | '110'+10 | '111'+17
+static void putDelta(BitWriter &w, int32_t delta)
+{
+    uint32_t z = zigzag(delta);
+    if (z == 0)
+        w.put(0b0, 1);
+    else if (z < (1u << 6))
+    {
+        w.put(0b10, 2);
+        w.put(z, 6);
+    }
+    else if (z < (1u << 10))
+    {
+        w.put(0b110, 3);
+        w.put(z, 10);
+    }
+    else
+    {
+        w.put(0b111, 3);
+        w.put(z, 17);
+    }
+}
+
+static int32_t getDelta(BitReader &r)
+{
+    if (r.get(1) == 0) return 0;
+    if (r.get(1) == 0) return unzigzag(r.get(6));
+    if (r.get(1) == 0) return unzigzag(r.get(10));
+    return unzigzag(r.get(17));
+}
+
+// XOR de bytes: '0' si no cambia, '1'+8 si cambia
+static void putXor(BitWriter &w, uint8_t prev, uint8_t cur)
+{
+    uint8_t x = prev ^ cur;
+    if (x == 0)
+        w.put(0, 1);
+    else
+    {
+        w.put(1, 1);
+        w.put(x, 8);
+    }
+}
+
+static uint8_t getXor(BitReader &r, uint8_t prev)
+{
+    if (r.get(1) == 0) return prev;
+    return prev ^ static_cast<uint8_t>(r.get(8));
+}
+
+static void putI32(uint8_t *p, int32_t v)
+{
+    uint32_t u = static_cast<uint32_t>(v);
+    p[0] = u & 0xFF;
+    p[1] = (u >> 8) & 0xFF;
+    p[2] = (u >> 16) & 0xFF;
+    p[3] = (u >> 24) & 0xFF;
+}
+
+static int32_t getI32(const uint8_t *p)
+{
+    return static_cast<int32_t>(p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24));
+}
+
+static void putI16(uint8_t *p, int16_t v)
+{
+    uint16_t u = static_cast<uint16_t>(v);
+    p[0] = u & 0xFF;
+    p[1] = (u >> 8) & 0xFF;
+}
+
+static int16_t getI16(const uint8_t *p)
+{
+    return static_cast<int16_t>(p[0] | (p[1] << 8));
+}
+
+static bool fitsOffset(uint64_t ts, uint64_t baseTs)
+{
+    int64_t off = static_cast<int64_t>(ts - baseTs);
+    return off >= INT32_MIN && off <= INT32_MAX;
+}
+
+size_t historyEncodeFrame(uint8_t slot, const HistorySample *samples, size_t count,
+                          uint64_t baseTs, uint64_t writeTs, uint8_t *out, size_t cap)
+{
+    if (samples == nullptr || count == 0 || count > HISTORY_FRAME_MAX_SAMPLES || cap < FRAME_FIXED_BYTES)
+    {
+        return 0;
+    }
+
+    const HistorySample &first = samples[0];
+    const HistorySample &last = samples[count - 1];
+
+    if (!fitsOffset(first.tsMs, baseTs) || !fitsOffset(last.tsMs, baseTs) || !fitsOffset(writeTs, baseTs))
+    {
+        return 0;
+    }
+
+    out[0] = slot;
+    out[1] = static_cast<uint8_t>(count);
+    putI32(&out[2], static_cast<int32_t>(writeTs - baseTs));
+    putI32(&out[6], static_cast<int32_t>(first.tsMs - baseTs));
+    putI32(&out[10], static_cast<int32_t>(last.tsMs - baseTs));
+    putI16(&out[14], first.tmpX100);
+    putI16(&out[16], first.cpuX100);
+    out[18] = static_cast<uint8_t>(first.batPct);
+    out[19] = first.flags;
+    out[20] = static_cast<uint8_t>(first.rssi);
+
+    BitWriter w(out + FRAME_FIXED_BYTES, cap - FRAME_FIXED_BYTES);
+
+    int64_t prevDelta = 0;
+    for (size_t i = 1; i < count; ++i)
+    {
+        int64_t delta = static_cast<int64_t>(samples[i].tsMs - samples[i - 1].tsMs);
+        int64_t dod = delta - prevDelta;
+        if (delta < 0 || dod < INT32_MIN || dod > INT32_MAX) return 0;
+        putTimestamp(w, static_cast<int32_t>(dod));
+        prevDelta = delta;
+    }
+
+    for (size_t i = 1; i < count; ++i)
+        putDelta(w, samples[i].tmpX100 - samples[i - 1].tmpX100);
+
+    for (size_t i = 1; i < count; ++i)
+        putDelta(w, samples[i].cpuX100 - samples[i - 1].cpuX100);
+
+    for (size_t i = 1; i < count; ++i)
+        putXor(w, static_cast<uint8_t>(samples[i - 1].batPct), static_cast<uint8_t>(samples[i].batPct));
+
+    for (size_t i = 1; i < count; ++i)
+        putXor(w, samples[i - 1].flags, samples[i].flags);
+
+    for (size_t i = 1; i < count; ++i)
+        putXor(w, static_cast<uint8_t>(samples[i - 1].rssi), static_cast<uint8_t>(samples[i].rssi));
+
+    if (w.overflow) return 0;
+    return FRAME_FIXED_BYTES + w.bytes();
+}
+
+bool historyDecodeFrameInfo(const uint8_t *in, size_t len, HistoryFrameInfo &info)
+{
+    if (in == nullptr || len < FRAME_FIXED_BYTES) return false;
+
+    info.slot = in[0];
+    info.count = in[1];
+    info.writeOff = getI32(&in[2]);
+    info.firstOff = getI32(&in[6]);
+    info.lastOff = getI32(&in[10]);
+
+    return info.count > 0 && info.count <= HISTORY_FRAME_MAX_SAMPLES && info.lastOff >= info.firstOff;
+}
+
+size_t historyDecodeFrame(const uint8_t *in, size_t len, uint64_t baseTs,
+                          HistorySample *out, size_t maxCount)
+{
+    HistoryFrameInfo info;
+    if (!historyDecodeFrameInfo(in, len, info) || maxCount < info.count) return 0;
+
+    size_t count = info.count;
+    out[0].tsMs = baseTs + info.firstOff;
+    out[0].tmpX100 = getI16(&in[14]);
+    out[0].cpuX100 = getI16(&in[16]);
+    out[0].batPct = static_cast<int8_t>(in[18]);
+    out[0].flags = in[19];
+    out[0].rssi = static_cast<int8_t>(in[20]);
+
+    BitReader r(in + FRAME_FIXED_BYTES, len - FRAME_FIXED_BYTES);
+
+    int64_t prevDelta = 0;
+    for (size_t i = 1; i < count; ++i)
+    {
+        int64_t delta = prevDelta + getTimestamp(r);
+        out[i].tsMs = out[i - 1].tsMs + delta;
+        prevDelta = delta;
+    }
+
+    for (size_t i = 1; i < count; ++i)
+        out[i].tmpX100 = static_cast<int16_t>(out[i - 1].tmpX100 + getDelta(r));
+
+    for (size_t i = 1; i < count; ++i)
+        out[i].cpuX100 = static_cast<int16_t>(out[i - 1].cpuX100 + getDelta(r));
+
+    for (size_t i = 1; i < count; ++i)
+        out[i].batPct = static_cast<int8_t>(getXor(r, static_cast<uint8_t>(out[i - 1].batPct)));
+
+    for (size_t i = 1; i < count; ++i)
+        out[i].flags = getXor(r, out[i - 1].flags);
+
+    for (size_t i = 1; i < count; ++i)
+        out[i].rssi = static_cast<int8_t>(getXor(r, static_cast<uint8_t>(out[i - 1].rssi)));
+
+    if (r.overflow) return 0;
+    return count;
+}
+
+uint32_t historyCrc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+    // CRC-32 (IEEE) por nibbles: tabla de 16 entradas, portable a host
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+        0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+        0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+        crc = (crc >> 4) ^ table[crc & 0x0F];
+    }
+    return ~crc;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Codificacion de un frame del log de historial.
+
+  Un frame agrupa hasta HISTORY_FRAME_MAX_SAMPLES muestras de un mismo slot.
+  La primera muestra va completa; el resto se guarda por columnas:
+  timestamps con delta-de-delta, tmp/cpu con delta y bat/flags/rssi con XOR
+  contra la muestra anterior. Los tiempos se guardan relativos a la base
+  del segmento que contiene el frame.
+*/
+
+static constexpr size_t HISTORY_FRAME_MAX_SAMPLES = 16;
+static constexpr size_t HISTORY_FRAME_MAX_PAYLOAD = 320;
+
+struct HistorySample
+{
+    uint64_t tsMs;
+    int16_t tmpX100;
+    int16_t cpuX100;
+    int8_t batPct;
+    uint8_t flags;
+    int8_t rssi;
+};
+
+struct HistoryFrameInfo
+{
+    uint8_t slot;
+    uint8_t count;
+    int32_t writeOff; // momento de escritura, relativo a la base del segmento
+    int32_t firstOff;
+    int32_t lastOff;
+};
+
+// Devuelve el largo del payload o 0 si no entra o el rango no es representable
+size_t historyEncodeFrame(uint8_t slot, const HistorySample *samples, size_t count,
+                          uint64_t baseTs, uint64_t writeTs, uint8_t *out, size_t cap);
+
+bool historyDecodeFrameInfo(const uint8_t *in, size_t len, HistoryFrameInfo &info);
+
+size_t historyDecodeFrame(const uint8_t *in, size_t len, uint64_t baseTs,
+                          HistorySample *out, size_t maxCount);
+
+uint32_t historyCrc32(uint32_t crc, const uint8_t *data, size_t len);
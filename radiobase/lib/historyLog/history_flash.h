@@ -0,0 +1,78 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+  Acceso a una region de flash NOR para el log de historial.
+
+  Escribir solo puede bajar bits (1 -> 0) y el borrado es por sector.
+  En el equipo se implementa sobre la particion "history"; en host se usa
+  RamHistoryFlash, que respeta la misma semantica.
+*/
+
+class HistoryFlash
+{
+public:
+    virtual ~HistoryFlash() = default;
+
+    virtual uint32_t size() const = 0;
+    virtual uint32_t sectorSize() const = 0;
+    virtual bool read(uint32_t addr, void *dst, size_t len) = 0;
+    virtual bool write(uint32_t addr, const void *src, size_t len) = 0;
+    virtual bool eraseSector(uint32_t addr) = 0;
+};
+
+// Imagen de flash en RAM para pruebas en host
+class RamHistoryFlash : public HistoryFlash
+{
+public:
+    RamHistoryFlash(uint8_t *buffer, uint32_t bytes, uint32_t sector = 4096)
+        : image(buffer), bytes(bytes), sector(sector)
+    {
+    }
+
+    uint32_t size() const override { return bytes; }
+    uint32_t sectorSize() const override { return sector; }
+
+    bool read(uint32_t addr, void *dst, size_t len) override
+    {
+        if (addr + len > bytes) return false;
+        memcpy(dst, image + addr, len);
+        return true;
+    }
+
+    bool write(uint32_t addr, const void *src, size_t len) override
+    {
+        if (addr + len > bytes) return false;
+
+        const uint8_t *in = static_cast<const uint8_t *>(src);
+        for (size_t i = 0; i < len; ++i)
+        {
+            // Corte de energia simulado: lo que excede el presupuesto no llega a flash
+            if (writeBudget == 0) return false;
+            if (writeBudget > 0) writeBudget--;
+            image[addr + i] &= in[i];
+        }
+        return true;
+    }
+
+    bool eraseSector(uint32_t addr) override
+    {
+        if ((addr % sector) != 0 || addr + sector > bytes) return false;
+        memset(image + addr, 0xFF, sector);
+        erases++;
+        return true;
+    }
+
+    // Limita los bytes que se escriben antes de "cortar la energia" (-1 = sin limite)
+    void failAfter(int32_t budget) { writeBudget = budget; }
+
+    uint32_t erases = 0;
+
+private:
+    uint8_t *image;
+    uint32_t bytes;
+    uint32_t sector;
+    int32_t writeBudget = -1;
+};
@@ -0,0 +1,483 @@
+#include "history_log.h"
+#include <stddef.h>
+
+static constexpr uint32_t SEGMENT_MAGIC = 0x48534547; // "HSEG"
+static constexpr uint16_t SEGMENT_VERSION = 1;
+static constexpr uint16_t FRAME_MAGIC = 0x4652;       // "RF"
+static constexpr uint32_t READ_FRAME_BUDGET = 32;
+
+// Un segmento no abarca mas de ~12 dias: los offsets de frame son int32 en ms
+static constexpr uint64_t SEGMENT_MAX_SPAN_MS = 1ull << 30;
+
+static uint32_t align4(uint32_t v)
+{
+    return (v + 3u) & ~3u;
+}
+
+static bool allErased(const uint8_t *p, size_t len)
+{
+    for (size_t i = 0; i < len; ++i)
+    {
+        if (p[i] != 0xFF) return false;
+    }
+    return true;
+}
+
+uint32_t HistoryLog::segmentAddr(int seg) const
+{
+    return static_cast<uint32_t>(seg) * segBytes;
+}
+
+uint32_t HistoryLog::dataStart() const
+{
+    return sizeof(SegmentHeader) + HISTORY_LOG_INDEX_ENTRIES * sizeof(IndexEntry);
+}
+
+uint32_t HistoryLog::segmentEnd(int seg) const
+{
+    return seg == head ? writeOffset : segBytes;
+}
+
+bool HistoryLog::readHeader(int seg, SegmentHeader &hdr)
+{
+    if (!flash->read(segmentAddr(seg), &hdr, sizeof(hdr))) return false;
+
+    if (hdr.magic != SEGMENT_MAGIC || hdr.version != SEGMENT_VERSION ||
+        hdr.headerBytes != sizeof(SegmentHeader) || hdr.segmentBytes != segBytes)
+    {
+        return false;
+    }
+
+    uint32_t crc = historyCrc32(0, reinterpret_cast<const uint8_t *>(&hdr), offsetof(SegmentHeader, crc));
+    return crc == hdr.crc;
+}
+
+HistoryLog::FrameRead HistoryLog::readFrame(int seg, uint32_t offset, uint16_t &len)
+{
+    if (offset + sizeof(FrameHeader) > segBytes) return FrameRead::END;
+
+    FrameHeader hdr;
+    if (!flash->read(segmentAddr(seg) + offset, &hdr, sizeof(hdr))) return FrameRead::TORN;
+
+    if (allErased(reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr))) return FrameRead::END;
+
+    if (hdr.magic != FRAME_MAGIC || hdr.len == 0 || hdr.len > HISTORY_FRAME_MAX_PAYLOAD ||
+        offset + sizeof(FrameHeader) + hdr.len > segBytes)
+    {
+        return FrameRead::TORN;
+    }
+
+    memcpy(scratch, &hdr, sizeof(hdr));
+    if (!flash->read(segmentAddr(seg) + offset + sizeof(hdr), scratch + sizeof(hdr), hdr.len)) return FrameRead::TORN;
+
+    len = hdr.len;
+
+    // El CRC cubre magic, largo y payload
+    uint32_t crc = historyCrc32(0, scratch, offsetof(FrameHeader, crc));
+    crc = historyCrc32(crc, scratch + sizeof(hdr), hdr.len);
+    return crc == hdr.crc ? FrameRead::OK : FrameRead::BAD_CRC;
+}
+
+bool HistoryLog::begin(HistoryFlash *flashDev, uint32_t segmentBytes, uint32_t maxLagMs)
+{
+    flash = flashDev;
+    segBytes = segmentBytes;
+    lagMs = maxLagMs;
+    head = -1;
+    nextSeq = 1;
+    st = {};
+
+    if (flash == nullptr || segBytes == 0 || (segBytes % flash->sectorSize()) != 0 ||
+        segBytes <= dataStart() + HISTORY_LOG_INDEX_ENTRIES)
+    {
+        return false;
+    }
+
+    segCount = flash->size() / segBytes;
+    if (segCount > HISTORY_LOG_MAX_SEGMENTS) segCount = HISTORY_LOG_MAX_SEGMENTS;
+    if (segCount < 2) return false;
+
+    for (size_t i = 0; i < segCount; ++i)
+    {
+        SegmentHeader hdr;
+        info[i] = {};
+        if (!readHeader(static_cast<int>(i), hdr)) continue;
+
+        info[i].valid = true;
+        info[i].seq = hdr.seq;
+        info[i].eraseCount = hdr.eraseCount;
+        info[i].baseTs = hdr.baseTs;
+
+        if (head < 0 || hdr.seq > info[head].seq)
+        {
+            head = static_cast<int>(i);
+        }
+    }
+
+    if (head >= 0)
+    {
+        nextSeq = info[head].seq + 1;
+        replayHead();
+    }
+
+    return true;
+}
+
+void HistoryLog::replayHead()
+{
+    uint32_t offset = dataStart();
+    uint64_t base = info[head].baseTs;
+    newestTs = base;
+
+    for (;;)
+    {
+        uint16_t len = 0;
+        FrameRead r = readFrame(head, offset, len);
+
+        if (r == FrameRead::END) break;
+
+        if (r == FrameRead::TORN)
+        {
+            // Cabecera ilegible: no se sabe donde sigue, el segmento se da por cerrado
+            st.tornFrames++;
+            offset = segBytes;
+            break;
+        }
+
+        offset += align4(sizeof(FrameHeader) + len);
+
+        if (r == FrameRead::BAD_CRC)
+        {
+            st.crcErrors++;
+            continue;
+        }
+
+        HistoryFrameInfo fi;
+        if (historyDecodeFrameInfo(scratch + sizeof(FrameHeader), len, fi))
+        {
+            st.replayFrames++;
+            uint64_t last = base + fi.lastOff;
+            uint64_t written = base + fi.writeOff;
+            if (last > newestTs) newestTs = last;
+            if (written > newestTs) newestTs = written;
+        }
+    }
+
+    writeOffset = offset;
+
+    indexCount = 0;
+    while (indexCount < HISTORY_LOG_INDEX_ENTRIES)
+    {
+        IndexEntry e;
+        uint32_t addr = segmentAddr(head) + sizeof(SegmentHeader) + indexCount * sizeof(IndexEntry);
+        if (!flash->read(addr, &e, sizeof(e)) || allErased(reinterpret_cast<const uint8_t *>(&e), sizeof(e))) break;
+        indexCount++;
+    }
+}
+
+bool HistoryLog::rotate(uint64_t nowTs)
+{
+    int start = head < 0 ? 0 : (head + 1) % static_cast<int>(segCount);
+
+    // Siempre se avanza en anillo: cada segmento se borra una vez por vuelta
+    for (size_t attempt = 0; attempt < segCount; ++attempt)
+    {
+        int seg = (start + static_cast<int>(attempt)) % static_cast<int>(segCount);
+        uint32_t erases = info[seg].valid ? info[seg].eraseCount : 0;
+        info[seg].valid = false;
+
+        bool ok = true;
+        for (uint32_t off = 0; off < segBytes && ok; off += flash->sectorSize())
+        {
+            ok = flash->eraseSector(segmentAddr(seg) + off);
+        }
+
+        SegmentHeader hdr{};
+        hdr.magic = SEGMENT_MAGIC;
+        hdr.version = SEGMENT_VERSION;
+        hdr.headerBytes = sizeof(SegmentHeader);
+        hdr.seq = nextSeq;
+        hdr.eraseCount = erases + 1;
+        hdr.baseTs = nowTs;
+        hdr.segmentBytes = segBytes;
+        hdr.crc = historyCrc32(0, reinterpret_cast<const uint8_t *>(&hdr), offsetof(SegmentHeader, crc));
+
+        if (!ok || !flash->write(segmentAddr(seg), &hdr, sizeof(hdr)))
+        {
+            st.writeErrors++;
+            continue;
+        }
+
+        info[seg].valid = true;
+        info[seg].seq = nextSeq++;
+        info[seg].eraseCount = hdr.eraseCount;
+        info[seg].baseTs = nowTs;
+
+        if (head >= 0) st.rotations++;
+        head = seg;
+        writeOffset = dataStart();
+        indexCount = 0;
+        return true;
+    }
+
+    return false;
+}
+
+bool HistoryLog::append(uint8_t slot, const HistorySample *samples, size_t count, uint64_t nowTs)
+{
+    if (flash == nullptr || samples == nullptr || count == 0) return false;
+
+    if (head < 0 || (nowTs - info[head].baseTs) > SEGMENT_MAX_SPAN_MS)
+    {
+        if (!rotate(nowTs)) return false;
+    }
+
+    uint8_t *payload = scratch + sizeof(FrameHeader);
+    size_t len = historyEncodeFrame(slot, samples, count, info[head].baseTs, nowTs, payload, HISTORY_FRAME_MAX_PAYLOAD);
+    uint32_t need = align4(sizeof(FrameHeader) + len);
+
+    if (len > 0 && writeOffset + need > segBytes)
+    {
+        if (!rotate(nowTs)) return false;
+        len = historyEncodeFrame(slot, samples, count, info[head].baseTs, nowTs, payload, HISTORY_FRAME_MAX_PAYLOAD);
+        need = align4(sizeof(FrameHeader) + len);
+    }
+
+    if (len == 0)
+    {
+        st.writeErrors++;
+        return false;
+    }
+
+    uint32_t stride = (segBytes - dataStart()) / HISTORY_LOG_INDEX_ENTRIES;
+    if (indexCount < HISTORY_LOG_INDEX_ENTRIES && writeOffset >= dataStart() + indexCount * stride)
+    {
+        IndexEntry e;
+        e.writeOff = static_cast<int32_t>(nowTs - info[head].baseTs);
+        e.frameOffset = writeOffset;
+        uint32_t addr = segmentAddr(head) + sizeof(SegmentHeader) + indexCount * sizeof(IndexEntry);
+        if (flash->write(addr, &e, sizeof(e))) indexCount++;
+    }
+
+    FrameHeader hdr;
+    hdr.magic = FRAME_MAGIC;
+    hdr.len = static_cast<uint16_t>(len);
+    memcpy(scratch, &hdr, sizeof(hdr));
+    uint32_t crc = historyCrc32(0, scratch, offsetof(FrameHeader, crc));
+    hdr.crc = historyCrc32(crc, payload, len);
+    memcpy(scratch, &hdr, sizeof(hdr));
+
+    bool ok = flash->write(segmentAddr(head) + writeOffset, scratch, sizeof(hdr) + len);
+
+    // Aun si fallo, el espacio puede estar a medio programar: no se reutiliza
+    writeOffset += need;
+
+    if (!ok)
+    {
+        st.writeErrors++;
+        return false;
+    }
+
+    st.framesWritten++;
+    st.bytesWritten += need;
+    if (samples[count - 1].tsMs > newestTs) newestTs = samples[count - 1].tsMs;
+    if (nowTs > newestTs) newestTs = nowTs;
+    return true;
+}
+
+int HistoryLog::nextSegment(uint32_t afterSeq) const
+{
+    int best = -1;
+    for (size_t i = 0; i < segCount; ++i)
+    {
+        if (!info[i].valid || info[i].seq <= afterSeq) continue;
+        if (best < 0 || info[i].seq < info[best].seq) best = static_cast<int>(i);
+    }
+    return best;
+}
+
+int HistoryLog::oldestSegment() const
+{
+    return nextSegment(0);
+}
+
+uint32_t HistoryLog::seekIndex(int seg, uint64_t fromTs)
+{
+    uint32_t start = dataStart();
+    if (fromTs <= info[seg].baseTs) return start;
+
+    uint64_t rel = fromTs - info[seg].baseTs;
+    uint32_t end = segmentEnd(seg);
+
+    // Frames anteriores a una entrada se escribieron antes de su writeOff
+    for (uint32_t i = 0; i < HISTORY_LOG_INDEX_ENTRIES; ++i)
+    {
+        IndexEntry e;
+        uint32_t addr = segmentAddr(seg) + sizeof(SegmentHeader) + i * sizeof(IndexEntry);
+        if (!flash->read(addr, &e, sizeof(e)) || allErased(reinterpret_cast<const uint8_t *>(&e), sizeof(e))) break;
+        if (e.frameOffset < start || e.frameOffset >= end || (e.frameOffset & 3u) != 0) break;
+        if (e.writeOff < 0 || static_cast<uint64_t>(e.writeOff) >= rel) break;
+        start = e.frameOffset;
+    }
+
+    return start;
+}
+
+bool HistoryLog::open(HistoryLogCursor &cur, uint8_t slot, uint64_t fromTs, uint64_t toTs, uint32_t stepMs) const
+{
+    if (toTs < fromTs) return false;
+
+    cur.slot = slot;
+    cur.fromTs = fromTs;
+    cur.toTs = toTs;
+    cur.stepMs = stepMs;
+    cur.nextBucketTs = fromTs;
+    cur.frameCount = 0;
+    cur.framePos = 0;
+    cur.lostSegments = 0;
+    cur.offset = 0;
+    cur.segment = -1;
+    cur.done = (head < 0);
+
+    if (cur.done) return true;
+
+    // Ultimo segmento con base <= fromTs; los anteriores se cerraron antes de fromTs
+    int seg = -1;
+    for (size_t i = 0; i < segCount; ++i)
+    {
+        if (!info[i].valid || info[i].baseTs > fromTs) continue;
+        if (seg < 0 || info[i].seq > info[seg].seq) seg = static_cast<int>(i);
+    }
+    if (seg < 0) seg = oldestSegment();
+
+    cur.segment = static_cast<int16_t>(seg);
+    cur.segmentSeq = info[seg].seq;
+    return true;
+}
+
+size_t HistoryLog::read(HistoryLogCursor &cur, HistorySample *out, size_t maxCount)
+{
+    if (cur.done || flash == nullptr || out == nullptr) return 0;
+
+    size_t n = 0;
+    uint32_t frames = 0;
+
+    while (n < maxCount)
+    {
+        if (cur.framePos < cur.frameCount)
+        {
+            const HistorySample &s = cur.frame[cur.framePos++];
+            if (s.tsMs < cur.fromTs) continue;
+            if (s.tsMs > cur.toTs)
+            {
+                cur.done = true;
+                break;
+            }
+            if (cur.stepMs > 0)
+            {
+                if (s.tsMs < cur.nextBucketTs) continue;
+                cur.nextBucketTs = cur.fromTs + ((s.tsMs - cur.fromTs) / cur.stepMs + 1) * cur.stepMs;
+            }
+            out[n++] = s;
+            continue;
+        }
+
+        if (frames >= READ_FRAME_BUDGET) break;
+
+        int seg = cur.segment;
+        if (seg < 0 || !info[seg].valid || info[seg].seq != cur.segmentSeq)
+        {
+            // El segmento se recicló mientras se leia: se sigue por el mas viejo
+            cur.lostSegments++;
+            int next = nextSegment(cur.segmentSeq);
+            if (next < 0)
+            {
+                cur.done = true;
+                break;
+            }
+            cur.segment = static_cast<int16_t>(next);
+            cur.segmentSeq = info[next].seq;
+            cur.offset = 0;
+            continue;
+        }
+
+        if (cur.offset == 0)
+        {
+            cur.offset = seekIndex(seg, cur.fromTs);
+        }
+
+        uint16_t len = 0;
+        FrameRead r = cur.offset >= segmentEnd(seg) ? FrameRead::END : readFrame(seg, cur.offset, len);
+
+        if (r == FrameRead::END || r == FrameRead::TORN)
+        {
+            int next = nextSegment(cur.segmentSeq);
+            if (next < 0 || (info[next].baseTs > lagMs && info[next].baseTs - lagMs > cur.toTs))
+            {
+                cur.done = true;
+                break;
+            }
+            cur.segment = static_cast<int16_t>(next);
+            cur.segmentSeq = info[next].seq;
+            cur.offset = 0;
+            continue;
+        }
+
+        cur.offset += align4(sizeof(FrameHeader) + len);
+        frames++;
+
+        if (r == FrameRead::BAD_CRC) continue;
+
+        const uint8_t *payload = scratch + sizeof(FrameHeader);
+        HistoryFrameInfo fi;
+        if (!historyDecodeFrameInfo(payload, len, fi) || fi.slot != cur.slot) continue;
+
+        uint64_t base = info[seg].baseTs;
+        if (base + fi.lastOff < cur.fromTs) continue;
+        if (base + fi.firstOff > cur.toTs)
+        {
+            // Los frames de un slot se escriben en orden: no hay nada mas en rango
+            cur.done = true;
+            break;
+        }
+
+        cur.frameCount = static_cast<uint8_t>(historyDecodeFrame(payload, len, base, cur.frame, HISTORY_FRAME_MAX_SAMPLES));
+        cur.framePos = 0;
+    }
+
+    return n;
+}
+
+bool HistoryLog::empty() const
+{
+    return head < 0;
+}
+
+uint64_t HistoryLog::lastTs() const
+{
+    if (head < 0) return 0;
+    return newestTs > info[head].baseTs ? newestTs : info[head].baseTs;
+}
+
+HistoryLogStats HistoryLog::stats() const
+{
+    HistoryLogStats s = st;
+    s.segments = static_cast<uint32_t>(segCount);
+    s.segmentsUsed = 0;
+    s.newestTs = lastTs();
+
+    bool first = true;
+    for (size_t i = 0; i < segCount; ++i)
+    {
+        if (!info[i].valid) continue;
+        s.segmentsUsed++;
+        if (first || info[i].eraseCount < s.eraseMin) s.eraseMin = info[i].eraseCount;
+        if (first || info[i].eraseCount > s.eraseMax) s.eraseMax = info[i].eraseCount;
+        first = false;
+    }
+
+    int oldest = oldestSegment();
+    s.oldestTs = oldest >= 0 ? info[oldest].baseTs : 0;
+    s.headSeq = head >= 0 ? info[head].seq : 0;
+    return s;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "history_flash.h"
+#include "history_codec.h"
+
+/*
+  Log de historial segmentado, solo-append, sobre una region de flash.
+
+  La region se divide en segmentos de tamano fijo que se usan en anillo:
+  al llenarse uno se borra el siguiente, asi todos los sectores se gastan
+  parejo. Cada segmento lleva:
+
+    [cabecera 32 B][indice disperso][frames ...]
+
+  La cabecera tiene secuencia, contador de borrados y el tiempo base del
+  segmento. Cada frame va con su propio CRC; un frame cortado se detecta
+  en el replay de arranque y se salta. El indice guarda cada tanto el
+  offset de un frame y su momento de escritura para buscar por tiempo sin
+  recorrer el segmento entero.
+
+  No toma locks: quien lo usa serializa el acceso.
+*/
+
+static constexpr size_t HISTORY_LOG_MAX_SEGMENTS = 128;
+static constexpr size_t HISTORY_LOG_INDEX_ENTRIES = 64;
+
+struct HistoryLogStats
+{
+    uint32_t segments = 0;
+    uint32_t segmentsUsed = 0;
+    uint32_t headSeq = 0;
+    uint32_t framesWritten = 0;
+    uint32_t bytesWritten = 0;
+    uint32_t replayFrames = 0;
+    uint32_t crcErrors = 0;
+    uint32_t tornFrames = 0;
+    uint32_t rotations = 0;
+    uint32_t writeErrors = 0;
+    uint32_t eraseMin = 0;
+    uint32_t eraseMax = 0;
+    uint64_t oldestTs = 0;
+    uint64_t newestTs = 0;
+};
+
+struct HistoryLogCursor
+{
+    uint8_t slot = 0;
+    uint64_t fromTs = 0;
+    uint64_t toTs = UINT64_MAX;
+    uint32_t stepMs = 0;       // 0 = todas; si no, la primera muestra de cada paso
+    uint64_t nextBucketTs = 0;
+
+    int16_t segment = -1;
+    uint32_t segmentSeq = 0;
+    uint32_t offset = 0;
+
+    HistorySample frame[HISTORY_FRAME_MAX_SAMPLES];
+    uint8_t frameCount = 0;
+    uint8_t framePos = 0;
+
+    uint32_t lostSegments = 0; // segmentos reciclados mientras se leian
+    bool done = true;
+};
+
+class HistoryLog
+{
+public:
+    // maxLagMs: antiguedad maxima de una muestra al momento de escribirse
+    bool begin(HistoryFlash *flash, uint32_t segmentBytes, uint32_t maxLagMs);
+
+    bool append(uint8_t slot, const HistorySample *samples, size_t count, uint64_t nowTs);
+
+    bool open(HistoryLogCursor &cur, uint8_t slot, uint64_t fromTs, uint64_t toTs, uint32_t stepMs = 0) const;
+    size_t read(HistoryLogCursor &cur, HistorySample *out, size_t maxCount);
+
+    bool empty() const;
+    uint64_t lastTs() const;
+    HistoryLogStats stats() const;
+
+private:
+#pragma pack(push, 1)
+    struct SegmentHeader
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t headerBytes;
+        uint32_t seq;
+        uint32_t eraseCount;
+        uint64_t baseTs;
+        uint32_t segmentBytes;
+        uint32_t crc;
+    };
+
+    struct IndexEntry
+    {
+        int32_t writeOff;
+        uint32_t frameOffset;
+    };
+
+    struct FrameHeader
+    {
+        uint16_t magic;
+        uint16_t len;
+        uint32_t crc;
+    };
+#pragma pack(pop)
+
+    struct SegmentInfo
+    {
+        bool valid;
+        uint32_t seq;
+        uint32_t eraseCount;
+        uint64_t baseTs;
+    };
+
+    enum class FrameRead : uint8_t
+    {
+        OK,
+        BAD_CRC,
+        END,
+        TORN
+    };
+
+    uint32_t segmentAddr(int seg) const;
+    uint32_t dataStart() const;
+    uint32_t segmentEnd(int seg) const;
+    bool readHeader(int seg, SegmentHeader &hdr);
+    FrameRead readFrame(int seg, uint32_t offset, uint16_t &len);
+    void replayHead();
+    bool rotate(uint64_t nowTs);
+    int nextSegment(uint32_t afterSeq) const;
+    int oldestSegment() const;
+    uint32_t seekIndex(int seg, uint64_t fromTs);
+
+private:
+    HistoryFlash *flash = nullptr;
+    uint32_t segBytes = 0;
+    uint32_t lagMs = 0;
+    size_t segCount = 0;
+    SegmentInfo info[HISTORY_LOG_MAX_SEGMENTS]{};
+
+    int head = -1;
+    uint32_t nextSeq = 1;
+    uint32_t writeOffset = 0;
+    uint32_t indexCount = 0;
+    uint64_t newestTs = 0;
+
+    HistoryLogStats st;
+    uint8_t scratch[sizeof(FrameHeader) + HISTORY_FRAME_MAX_PAYLOAD];
+};
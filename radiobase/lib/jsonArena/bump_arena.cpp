@@ -0,0 +1,107 @@
+#include "bump_arena.h"
+#include <string.h>
+
+void BumpArena::begin(uint8_t *mem, size_t bytes)
+{
+    // Bloques alineados a 8 desde el inicio del pool
+    size_t skew = (8 - (reinterpret_cast<uintptr_t>(mem) & 7)) & 7;
+    base = mem != nullptr && bytes > skew ? mem + skew : nullptr;
+    cap = base != nullptr ? (bytes - skew) & ~static_cast<size_t>(7) : 0;
+    top = 0;
+    lastBlock = SIZE_MAX;
+    requestPeak = 0;
+    st = BumpArenaStats();
+    st.capacity = static_cast<uint32_t>(cap);
+}
+
+void *BumpArena::allocate(size_t n)
+{
+    if (base == nullptr) return nullptr;
+
+    size_t need = HEADER + roundUp(n);
+    if (n > cap || need > cap - top)
+    {
+        st.exhausted++;
+        return nullptr;
+    }
+
+    uint32_t size = static_cast<uint32_t>(n);
+    memcpy(base + top, &size, sizeof(size));
+    lastBlock = top;
+    top += need;
+
+    st.allocs++;
+    st.live++;
+    st.used = static_cast<uint32_t>(top);
+    if (top > requestPeak) requestPeak = top;
+    if (top > st.peakUsed) st.peakUsed = static_cast<uint32_t>(top);
+
+    return base + lastBlock + HEADER;
+}
+
+void BumpArena::release(void *p)
+{
+    if (!owns(p)) return;
+
+    st.frees++;
+    if (st.live > 0) st.live--;
+
+    size_t block = static_cast<uint8_t *>(p) - base - HEADER;
+    if (st.live == 0)
+    {
+        // Sin bloques vivos: termino la peticion y la arena vuelve entera
+        top = 0;
+        lastBlock = SIZE_MAX;
+        st.resets++;
+        st.lastUsed = static_cast<uint32_t>(requestPeak);
+        requestPeak = 0;
+    }
+    else if (block == lastBlock)
+    {
+        top = block;
+        lastBlock = SIZE_MAX; // el anterior no se conoce; se sigue apilando
+    }
+
+    st.used = static_cast<uint32_t>(top);
+}
+
+void *BumpArena::resize(void *p, size_t n)
+{
+    if (!owns(p)) return nullptr;
+
+    size_t block = static_cast<uint8_t *>(p) - base - HEADER;
+    size_t old = blockSize(p);
+
+    if (block == lastBlock)
+    {
+        size_t need = HEADER + roundUp(n);
+        if (n > cap || need > cap - block) return nullptr;
+
+        top = block + need;
+        st.used = static_cast<uint32_t>(top);
+        if (top > requestPeak) requestPeak = top;
+        if (top > st.peakUsed) st.peakUsed = static_cast<uint32_t>(top);
+    }
+    else if (n > old)
+    {
+        return nullptr;
+    }
+
+    uint32_t size = static_cast<uint32_t>(n);
+    memcpy(base + block, &size, sizeof(size));
+    st.resizedInPlace++;
+    return p;
+}
+
+bool BumpArena::owns(const void *p) const
+{
+    const uint8_t *q = static_cast<const uint8_t *>(p);
+    return base != nullptr && q >= base + HEADER && q < base + cap;
+}
+
+size_t BumpArena::blockSize(const void *p) const
+{
+    uint32_t size = 0;
+    memcpy(&size, static_cast<const uint8_t *>(p) - HEADER, sizeof(size));
+    return size;
+}
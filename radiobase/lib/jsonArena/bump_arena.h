@@ -0,0 +1,59 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Arena de asignacion lineal sobre un bloque fijo.
+
+  Cada bloque lleva una cabecera de 8 bytes con su tamano. Liberar solo
+  recupera memoria si es el ultimo bloque; el resto queda hasta que no
+  hay bloques vivos y la arena vuelve entera al inicio. Asi la memoria de
+  una peticion se devuelve de una vez al destruirse su ultimo documento,
+  sin dejar huecos entre peticiones.
+
+  No toma locks: la usa una sola tarea.
+*/
+
+struct BumpArenaStats
+{
+    uint32_t capacity = 0;
+    uint32_t used = 0;
+    uint32_t live = 0;
+    uint32_t resets = 0;       // veces que volvio al inicio (una por peticion)
+    uint32_t allocs = 0;
+    uint32_t frees = 0;
+    uint32_t resizedInPlace = 0;
+    uint32_t exhausted = 0;    // pedidos que no entraron
+    uint32_t peakUsed = 0;     // maximo usado dentro de una peticion
+    uint32_t lastUsed = 0;     // maximo de la ultima peticion terminada
+};
+
+class BumpArena
+{
+public:
+    void begin(uint8_t *mem, size_t bytes);
+    bool ready() const { return base != nullptr; }
+
+    // nullptr si no entra
+    void *allocate(size_t n);
+    void release(void *p);
+    // Cambia el tamano sin mover; nullptr si no puede hacerlo en sitio
+    void *resize(void *p, size_t n);
+
+    bool owns(const void *p) const;
+    size_t blockSize(const void *p) const;
+
+    const BumpArenaStats &stats() const { return st; }
+
+private:
+    static constexpr size_t HEADER = 8;
+    static size_t roundUp(size_t n) { return (n + 7) & ~static_cast<size_t>(7); }
+
+private:
+    uint8_t *base = nullptr;
+    size_t cap = 0;
+    size_t top = 0;
+    size_t lastBlock = SIZE_MAX; // offset de la cabecera del ultimo bloque
+    size_t requestPeak = 0;
+    BumpArenaStats st;
+};
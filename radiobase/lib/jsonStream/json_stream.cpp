@@ -0,0 +1,76 @@
+#include "json_stream.h"
+#include <string.h>
+
+size_t JsonStream::drainSpill(uint8_t *buf, size_t maxLen)
+{
+    size_t n = spillLen - spillPos;
+    if (n > maxLen) n = maxLen;
+    memcpy(buf, spill + spillPos, n);
+    spillPos += n;
+    return n;
+}
+
+size_t JsonStream::fill(uint8_t *buf, size_t maxLen)
+{
+    size_t written = 0;
+
+    if (spillPos < spillLen)
+    {
+        written = drainSpill(buf, maxLen);
+        if (spillPos < spillLen) return written;
+    }
+
+    while (!done && written < maxLen)
+    {
+        w.target(reinterpret_cast<char *>(buf) + written, maxLen - written);
+        JsonWriter::Mark m = w.mark();
+        stalled = false;
+
+        if (!part(w, next))
+        {
+            done = true;
+            break;
+        }
+
+        if (stalled)
+        {
+            w.rollback(m);
+            break;
+        }
+
+        if (!w.overflow())
+        {
+            written += w.size();
+            next++;
+            continue;
+        }
+
+        w.rollback(m);
+        if (written > 0) break; // la parte sale entera en la proxima llamada
+
+        w.target(spill, sizeof(spill));
+        part(w, next);
+
+        if (stalled)
+        {
+            w.rollback(m);
+            break;
+        }
+
+        if (w.overflow())
+        {
+            // Ni en el desborde entra: se corta la respuesta en vez de omitir la parte
+            failed = true;
+            done = true;
+            break;
+        }
+
+        next++;
+        spillLen = w.size();
+        spillPos = 0;
+        written += drainSpill(buf + written, maxLen - written);
+        break;
+    }
+
+    return written;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "json_writer.h"
+
+/*
+  Respuesta por partes para respuestas chunked, en JSON, MessagePack o
+  CBOR segun setFormat().
+
+  Una subclase arma el documento como una serie de partes (cabecera, una
+  fila por elemento, cierre) y fill() las escribe directo en el buffer que
+  entrega el servidor. Una parte que no entra en lo que queda del buffer
+  se deshace y se repite en la siguiente llamada, por eso part() tiene que
+  poder llamarse dos veces con el mismo indice. Solo si una parte no entra
+  ni en un buffer vacio se arma en el buffer de desborde y se entrega en
+  pedazos.
+
+  Una parte que tampoco entra en el desborde corta la respuesta ahi: el
+  cliente recibe un documento incompleto, que no parsea, en lugar de uno
+  valido al que le falta una fila.
+
+  Una parte que todavia no tiene datos (un cursor que no avanzo) llama a
+  retry() sin escribir nada: fill() devuelve lo que lleva, waiting() queda
+  en true y la misma parte se pide en la proxima llamada.
+
+  La memoria por respuesta es la del objeto: no depende de cuantas filas
+  tenga el documento.
+*/
+
+static constexpr size_t JSON_STREAM_SPILL = 320;
+
+class JsonStream
+{
+public:
+    virtual ~JsonStream() {}
+
+    void setFormat(WireFormat f) { w.setFormat(f); }
+    WireFormat format() const { return w.format(); }
+
+    // Bytes escritos en buf; 0 cuando el documento esta completo o, con waiting(), sin datos todavia
+    size_t fill(uint8_t *buf, size_t maxLen);
+
+    uint32_t partsWritten() const { return next; }
+    bool aborted() const { return failed; }
+    bool waiting() const { return stalled; }
+
+protected:
+    // Escribe la parte indicada; false si ya no quedan partes (sin escribir nada).
+    // Los contenedores que cruzan partes se abren con su cantidad de elementos
+    virtual bool part(JsonWriter &w, uint32_t index) = 0;
+
+    // Desde part(): la parte no tiene datos todavia, se vuelve a pedir despues
+    void retry() { stalled = true; }
+
+private:
+    size_t drainSpill(uint8_t *buf, size_t maxLen);
+
+private:
+    JsonWriter w;
+    uint32_t next = 0;
+    bool failed = false;
+    bool done = false;
+    bool stalled = false;
+    char spill[JSON_STREAM_SPILL];
+    size_t spillLen = 0;
+    size_t spillPos = 0;
+};
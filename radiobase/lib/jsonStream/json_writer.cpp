@@ -0,0 +1,552 @@
+#include "json_writer.h"
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+// Cabeceras de MessagePack
+static constexpr uint8_t MP_NIL = 0xC0;
+static constexpr uint8_t MP_FALSE = 0xC2;
+static constexpr uint8_t MP_TRUE = 0xC3;
+static constexpr uint8_t MP_BIN8 = 0xC4;
+static constexpr uint8_t MP_FLOAT64 = 0xCB;
+static constexpr uint8_t MP_UINT8 = 0xCC;
+static constexpr uint8_t MP_INT8 = 0xD0;
+static constexpr uint8_t MP_STR8 = 0xD9;
+static constexpr uint8_t MP_STR16 = 0xDA;
+static constexpr uint8_t MP_ARRAY16 = 0xDC;
+static constexpr uint8_t MP_MAP16 = 0xDE;
+static constexpr uint8_t MP_FIXMAP = 0x80;
+static constexpr uint8_t MP_FIXARRAY = 0x90;
+static constexpr uint8_t MP_FIXSTR = 0xA0;
+
+// Tipos mayores y simples de CBOR
+static constexpr uint8_t CBOR_UINT = 0;
+static constexpr uint8_t CBOR_NINT = 1;
+static constexpr uint8_t CBOR_BYTES = 2;
+static constexpr uint8_t CBOR_TEXT = 3;
+static constexpr uint8_t CBOR_ARRAY = 4;
+static constexpr uint8_t CBOR_MAP = 5;
+static constexpr uint8_t CBOR_FALSE = 0xF4;
+static constexpr uint8_t CBOR_TRUE = 0xF5;
+static constexpr uint8_t CBOR_NULL = 0xF6;
+static constexpr uint8_t CBOR_FLOAT64 = 0xFB;
+
+void JsonWriter::target(char *b, size_t c)
+{
+    buf = b;
+    cap = b != nullptr ? c : SIZE_MAX;
+    pos = 0;
+    full = false;
+}
+
+JsonWriter::Mark JsonWriter::mark() const
+{
+    Mark m{pos, depth, filled, unsized, keyPending, {}};
+    memcpy(m.count, count, sizeof(count));
+    return m;
+}
+
+void JsonWriter::rollback(const Mark &m)
+{
+    pos = m.pos;
+    depth = m.depth;
+    filled = m.filled;
+    unsized = m.unsized;
+    keyPending = m.keyPending;
+    memcpy(count, m.count, sizeof(count));
+    full = false;
+}
+
+void JsonWriter::put(const void *s, size_t len)
+{
+    if (full || len > cap - pos)
+    {
+        full = true;
+        return;
+    }
+
+    if (buf != nullptr) memcpy(buf + pos, s, len);
+    pos += len;
+}
+
+void JsonWriter::putChar(char c)
+{
+    put(&c, 1);
+}
+
+void JsonWriter::putByte(uint8_t b)
+{
+    put(&b, 1);
+}
+
+void JsonWriter::putBig(uint64_t v, uint8_t bytes)
+{
+    uint8_t tmp[8];
+    for (uint8_t i = 0; i < bytes; ++i)
+    {
+        tmp[bytes - 1 - i] = static_cast<uint8_t>(v & 0xFF);
+        v >>= 8;
+    }
+    put(tmp, bytes);
+}
+
+void JsonWriter::putDecimal(uint64_t v)
+{
+    char tmp[20];
+    size_t n = 0;
+    do
+    {
+        tmp[sizeof(tmp) - 1 - n++] = static_cast<char>('0' + v % 10);
+        v /= 10;
+    } while (v != 0);
+
+    put(tmp + sizeof(tmp) - n, n);
+}
+
+void JsonWriter::putEscaped(const char *s, size_t len)
+{
+    putChar('"');
+    for (size_t i = 0; i < len && !full; ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(s[i]);
+        if (c == '"' || c == '\\')
+        {
+            char esc[2] = {'\\', static_cast<char>(c)};
+            put(esc, 2);
+        }
+        else if (c < 0x20)
+        {
+            char esc[6] = {'\\', 'u', '0', '0', HEX_DIGITS[c >> 4], HEX_DIGITS[c & 0x0F]};
+            put(esc, 6);
+        }
+        else
+        {
+            putChar(static_cast<char>(c));
+        }
+    }
+    putChar('"');
+}
+
+void JsonWriter::putCborHead(uint8_t major, uint64_t v)
+{
+    uint8_t m = static_cast<uint8_t>(major << 5);
+    if (v < 24)
+    {
+        putByte(m | static_cast<uint8_t>(v));
+    }
+    else if (v <= 0xFF)
+    {
+        putByte(m | 24);
+        putBig(v, 1);
+    }
+    else if (v <= 0xFFFF)
+    {
+        putByte(m | 25);
+        putBig(v, 2);
+    }
+    else if (v <= 0xFFFFFFFFULL)
+    {
+        putByte(m | 26);
+        putBig(v, 4);
+    }
+    else
+    {
+        putByte(m | 27);
+        putBig(v, 8);
+    }
+}
+
+void JsonWriter::putStr(const char *s, size_t len)
+{
+    switch (fmt)
+    {
+    case WireFormat::JSON:
+        putEscaped(s, len);
+        return;
+
+    case WireFormat::MSGPACK:
+        if (len < 32)
+        {
+            putByte(MP_FIXSTR | static_cast<uint8_t>(len));
+        }
+        else if (len <= 0xFF)
+        {
+            putByte(MP_STR8);
+            putBig(len, 1);
+        }
+        else
+        {
+            putByte(MP_STR16);
+            putBig(len, 2);
+        }
+        break;
+
+    case WireFormat::CBOR:
+        putCborHead(CBOR_TEXT, len);
+        break;
+    }
+
+    put(s, len);
+}
+
+void JsonWriter::separator()
+{
+    if (depth == 0) return;
+
+    uint32_t bit = 1UL << (depth - 1);
+    if ((filled & bit) && fmt == WireFormat::JSON) putChar(',');
+    filled |= bit;
+    count[depth - 1]++;
+}
+
+// Un valor dentro de un objeto ya se conto con su clave
+void JsonWriter::beforeValue()
+{
+    if (keyPending)
+    {
+        keyPending = false;
+        return;
+    }
+
+    separator();
+}
+
+void JsonWriter::key(const JsonKey &k)
+{
+    separator();
+    if (fmt == WireFormat::JSON)
+        put(k.text, k.len);
+    else
+        putStr(k.text + 1, k.len - 3);
+    keyPending = true;
+}
+
+void JsonWriter::key(const char *name)
+{
+    separator();
+    putStr(name, strlen(name));
+    if (fmt == WireFormat::JSON) putChar(':');
+    keyPending = true;
+}
+
+void JsonWriter::open(bool map, uint16_t n)
+{
+    beforeValue();
+
+    if (depth >= JSON_WRITER_MAX_DEPTH)
+    {
+        full = true; // anidamiento fuera de rango: se trata como overflow
+        return;
+    }
+
+    uint32_t bit = 1UL << depth;
+    headPos[depth] = pos;
+    count[depth] = 0;
+    filled &= ~bit;
+    unsized &= ~bit;
+
+    switch (fmt)
+    {
+    case WireFormat::JSON:
+        putChar(map ? '{' : '[');
+        break;
+
+    case WireFormat::MSGPACK:
+        if (n == JSON_UNSIZED)
+        {
+            unsized |= bit;
+            putByte(map ? MP_MAP16 : MP_ARRAY16);
+            putBig(0, 2);
+        }
+        else if (n < 16)
+        {
+            putByte((map ? MP_FIXMAP : MP_FIXARRAY) | static_cast<uint8_t>(n));
+        }
+        else
+        {
+            putByte(map ? MP_MAP16 : MP_ARRAY16);
+            putBig(n, 2);
+        }
+        break;
+
+    case WireFormat::CBOR:
+        if (n == JSON_UNSIZED)
+        {
+            unsized |= bit;
+            putByte(static_cast<uint8_t>(((map ? CBOR_MAP : CBOR_ARRAY) << 5) | 25));
+            putBig(0, 2);
+        }
+        else
+        {
+            putCborHead(map ? CBOR_MAP : CBOR_ARRAY, n);
+        }
+        break;
+    }
+
+    depth++;
+}
+
+void JsonWriter::close(bool map)
+{
+    if (depth == 0) return;
+    depth--;
+
+    if (fmt == WireFormat::JSON)
+    {
+        putChar(map ? '}' : ']');
+        return;
+    }
+
+    if (!(unsized & (1UL << depth)) || full) return;
+
+    // Cabecera reservada de 3 bytes: se completa y, si alcanza, se achica a 1
+    uint16_t n = count[depth];
+    size_t at = headPos[depth];
+    bool shrink = fmt == WireFormat::MSGPACK ? n < 16 : n < 24;
+
+    if (buf != nullptr)
+    {
+        uint8_t *h = reinterpret_cast<uint8_t *>(buf) + at;
+        if (shrink)
+        {
+            if (fmt == WireFormat::MSGPACK)
+                h[0] = (map ? MP_FIXMAP : MP_FIXARRAY) | static_cast<uint8_t>(n);
+            else
+                h[0] = static_cast<uint8_t>(((map ? CBOR_MAP : CBOR_ARRAY) << 5) | n);
+            memmove(h + 1, h + 3, pos - at - 3);
+        }
+        else
+        {
+            h[1] = static_cast<uint8_t>(n >> 8);
+            h[2] = static_cast<uint8_t>(n & 0xFF);
+        }
+    }
+
+    if (shrink) pos -= 2;
+}
+
+void JsonWriter::beginObject(uint16_t n)
+{
+    open(true, n);
+}
+
+void JsonWriter::beginObject(const JsonKey &k, uint16_t n)
+{
+    key(k);
+    open(true, n);
+}
+
+void JsonWriter::endObject()
+{
+    close(true);
+}
+
+void JsonWriter::beginArray(uint16_t n)
+{
+    open(false, n);
+}
+
+void JsonWriter::beginArray(const JsonKey &k, uint16_t n)
+{
+    key(k);
+    open(false, n);
+}
+
+void JsonWriter::endArray()
+{
+    close(false);
+}
+
+void JsonWriter::valueNull()
+{
+    beforeValue();
+    if (fmt == WireFormat::JSON)
+        put("null", 4);
+    else
+        putByte(fmt == WireFormat::MSGPACK ? MP_NIL : CBOR_NULL);
+}
+
+void JsonWriter::valueBool(bool value)
+{
+    beforeValue();
+    switch (fmt)
+    {
+    case WireFormat::JSON:
+        if (value)
+            put("true", 4);
+        else
+            put("false", 5);
+        break;
+    case WireFormat::MSGPACK:
+        putByte(value ? MP_TRUE : MP_FALSE);
+        break;
+    case WireFormat::CBOR:
+        putByte(value ? CBOR_TRUE : CBOR_FALSE);
+        break;
+    }
+}
+
+void JsonWriter::valueUint(uint64_t value)
+{
+    beforeValue();
+    switch (fmt)
+    {
+    case WireFormat::JSON:
+        putDecimal(value);
+        break;
+
+    case WireFormat::MSGPACK:
+        if (value < 0x80)
+        {
+            putByte(static_cast<uint8_t>(value));
+        }
+        else
+        {
+            // uint8/16/32/64 son 0xCC..0xCF
+            uint8_t bytes = value <= 0xFF ? 1 : value <= 0xFFFF ? 2 : value <= 0xFFFFFFFFULL ? 4 : 8;
+            uint8_t tag = bytes == 1 ? 0 : bytes == 2 ? 1 : bytes == 4 ? 2 : 3;
+            putByte(MP_UINT8 + tag);
+            putBig(value, bytes);
+        }
+        break;
+
+    case WireFormat::CBOR:
+        putCborHead(CBOR_UINT, value);
+        break;
+    }
+}
+
+void JsonWriter::valueInt(int64_t value)
+{
+    if (value >= 0)
+    {
+        valueUint(static_cast<uint64_t>(value));
+        return;
+    }
+
+    beforeValue();
+    switch (fmt)
+    {
+    case WireFormat::JSON:
+        putChar('-');
+        putDecimal(static_cast<uint64_t>(-(value + 1)) + 1);
+        break;
+
+    case WireFormat::MSGPACK:
+        if (value >= -32)
+        {
+            putByte(static_cast<uint8_t>(value));
+        }
+        else
+        {
+            // int8/16/32/64 son 0xD0..0xD3
+            uint8_t bytes = value >= INT8_MIN ? 1 : value >= INT16_MIN ? 2 : value >= INT32_MIN ? 4 : 8;
+            uint8_t tag = bytes == 1 ? 0 : bytes == 2 ? 1 : bytes == 4 ? 2 : 3;
+            putByte(MP_INT8 + tag);
+            putBig(static_cast<uint64_t>(value), bytes);
+        }
+        break;
+
+    case WireFormat::CBOR:
+        putCborHead(CBOR_NINT, static_cast<uint64_t>(-(value + 1)));
+        break;
+    }
+}
+
+void JsonWriter::valueDouble(double value)
+{
+    if (fmt == WireFormat::JSON && !isfinite(value))
+    {
+        valueNull();
+        return;
+    }
+
+    beforeValue();
+    if (fmt == WireFormat::JSON)
+    {
+        char tmp[24];
+        int n = snprintf(tmp, sizeof(tmp), "%.9g", value);
+        if (n > 0) put(tmp, static_cast<size_t>(n) < sizeof(tmp) ? n : sizeof(tmp) - 1);
+        return;
+    }
+
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    putByte(fmt == WireFormat::MSGPACK ? MP_FLOAT64 : CBOR_FLOAT64);
+    putBig(bits, 8);
+}
+
+void JsonWriter::valueStr(const char *value)
+{
+    beforeValue();
+    if (value == nullptr) value = "";
+    putStr(value, strlen(value));
+}
+
+void JsonWriter::valueHex48(uint64_t value)
+{
+    beforeValue();
+
+    if (fmt == WireFormat::JSON)
+    {
+        char tmp[14];
+        tmp[0] = '"';
+        for (int i = 0; i < 12; ++i)
+        {
+            tmp[12 - i] = HEX_DIGITS[value & 0x0F];
+            value >>= 4;
+        }
+        tmp[13] = '"';
+        put(tmp, sizeof(tmp));
+        return;
+    }
+
+    if (fmt == WireFormat::MSGPACK)
+    {
+        putByte(MP_BIN8);
+        putByte(6);
+    }
+    else
+    {
+        putCborHead(CBOR_BYTES, 6);
+    }
+    putBig(value, 6);
+}
+
+void JsonWriter::fieldBool(const JsonKey &k, bool value)
+{
+    key(k);
+    valueBool(value);
+}
+
+void JsonWriter::fieldInt(const JsonKey &k, int32_t value)
+{
+    key(k);
+    valueInt(value);
+}
+
+void JsonWriter::fieldUint(const JsonKey &k, uint32_t value)
+{
+    key(k);
+    valueUint(value);
+}
+
+void JsonWriter::fieldU64(const JsonKey &k, uint64_t value)
+{
+    key(k);
+    valueUint(value);
+}
+
+void JsonWriter::fieldStr(const JsonKey &k, const char *value)
+{
+    key(k);
+    valueStr(value);
+}
+
+void JsonWriter::fieldHex48(const JsonKey &k, uint64_t value)
+{
+    key(k);
+    valueHex48(value);
+}
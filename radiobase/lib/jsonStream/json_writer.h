@@ -0,0 +1,120 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Escritor de respuestas sobre un buffer fijo, sin heap. Escribe JSON,
+  MessagePack o CBOR con la misma secuencia de llamadas.
+
+  Las claves son constantes de compilacion con comillas y ':' ya puestas
+  (JSON_KEY), asi escribir un campo es copiar bytes y formatear el valor
+  en un buffer local. En los formatos binarios las direcciones BLE salen
+  como binario de 6 bytes y los enteros en su forma mas corta.
+
+  MessagePack y CBOR llevan la cantidad de elementos en la cabecera de
+  cada mapa o lista. Un contenedor abierto sin cantidad reserva una
+  cabecera de 16 bits que se completa (y se achica) al cerrarlo, por eso
+  tiene que abrirse y cerrarse dentro del mismo buffer. Los que quedan
+  abiertos entre llamadas (el sobre de la respuesta) se abren con su
+  cantidad.
+
+  Si algo no entra el escritor queda en overflow y ignora lo que sigue;
+  con mark()/rollback() quien lo usa descarta lo escrito desde un punto y
+  lo reintenta en otro buffer sin perder el estado de anidamiento.
+*/
+
+struct JsonKey
+{
+    const char *text; // "\"clave\":"
+    uint8_t len;
+};
+
+#define JSON_KEY(name) JsonKey{"\"" name "\":", static_cast<uint8_t>(sizeof("\"" name "\":") - 1)}
+
+enum class WireFormat : uint8_t
+{
+    JSON = 0,
+    MSGPACK = 1,
+    CBOR = 2,
+};
+
+static constexpr uint8_t JSON_WRITER_MAX_DEPTH = 16;
+static constexpr uint16_t JSON_UNSIZED = 0xFFFF;
+
+class JsonWriter
+{
+public:
+    struct Mark
+    {
+        size_t pos;
+        uint8_t depth;
+        uint32_t filled;
+        uint32_t unsized;
+        bool keyPending;
+        uint16_t count[JSON_WRITER_MAX_DEPTH]; // cantidades a patchear al cerrar
+    };
+
+    void setFormat(WireFormat f) { fmt = f; }
+    WireFormat format() const { return fmt; }
+
+    // Cambia el destino conservando el anidamiento. Con buf nullptr solo cuenta bytes
+    void target(char *buf, size_t cap);
+    size_t size() const { return pos; }
+    bool overflow() const { return full; }
+
+    Mark mark() const;
+    void rollback(const Mark &m);
+
+    void beginObject(uint16_t count = JSON_UNSIZED);
+    void beginObject(const JsonKey &key, uint16_t count = JSON_UNSIZED);
+    void endObject();
+    void beginArray(uint16_t count = JSON_UNSIZED);
+    void beginArray(const JsonKey &key, uint16_t count = JSON_UNSIZED);
+    void endArray();
+
+    void key(const JsonKey &key);
+    void key(const char *name);
+
+    void valueNull();
+    void valueBool(bool value);
+    void valueInt(int64_t value);
+    void valueUint(uint64_t value);
+    void valueDouble(double value);
+    void valueStr(const char *value);
+    // Direccion BLE de 48 bits: 12 digitos hex en JSON, 6 bytes en binario
+    void valueHex48(uint64_t value);
+
+    void fieldBool(const JsonKey &k, bool value);
+    void fieldInt(const JsonKey &k, int32_t value);
+    void fieldUint(const JsonKey &k, uint32_t value);
+    void fieldU64(const JsonKey &k, uint64_t value);
+    void fieldStr(const JsonKey &k, const char *value);
+    void fieldHex48(const JsonKey &k, uint64_t value);
+
+private:
+    void separator();
+    void beforeValue();
+    void put(const void *s, size_t len);
+    void putChar(char c);
+    void putByte(uint8_t b);
+    void putBig(uint64_t v, uint8_t bytes);
+    void putDecimal(uint64_t v);
+    void putEscaped(const char *s, size_t len);
+    void putStr(const char *s, size_t len);
+    void putCborHead(uint8_t major, uint64_t v);
+    void open(bool map, uint16_t count);
+    void close(bool map);
+
+private:
+    WireFormat fmt = WireFormat::JSON;
+    char *buf = nullptr;
+    size_t cap = 0;
+    size_t pos = 0;
+    bool full = false;
+    bool keyPending = false;
+    uint8_t depth = 0;
+    uint32_t filled = 0; // bit d: el contenedor de nivel d ya tiene elementos
+    uint16_t count[JSON_WRITER_MAX_DEPTH]{};
+    size_t headPos[JSON_WRITER_MAX_DEPTH]{};
+    uint32_t unsized = 0; // bit d: cabecera reservada que se completa al cerrar
+};
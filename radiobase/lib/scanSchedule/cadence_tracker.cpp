@@ -0,0 +1,214 @@
+#include "cadence_tracker.h"
+#include <string.h>
+
+// Diferencia con signo entre tiempos de millis(), valida con desborde
+static inline int32_t msDiff(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b);
+}
+
+void CadenceTracker::begin(const CadenceParams &params)
+{
+    p = params;
+    reset();
+}
+
+void CadenceTracker::reset()
+{
+    memset(slots, 0, sizeof(slots));
+    stats[0] = CadenceCatch{};
+    stats[1] = CadenceCatch{};
+}
+
+void CadenceTracker::forget(uint8_t slot)
+{
+    if (slot >= CADENCE_MAX_SLOTS) return;
+    memset(&slots[slot], 0, sizeof(Slot));
+}
+
+uint32_t CadenceTracker::guardOf(const Slot &s) const
+{
+    // Cuatro veces la dispersion cubre la deriva del reloj del beacon
+    uint32_t guard = s.jitterMs * 4;
+    return guard < p.guardMinMs ? p.guardMinMs : guard;
+}
+
+void CadenceTracker::relearn(Slot &s, uint32_t gapMs)
+{
+    s.confident = false;
+    s.samples = 1;
+    s.misses = 0;
+    s.periodMs = gapMs;
+    s.jitterMs = 0;
+}
+
+void CadenceTracker::learn(Slot &s, uint32_t gapMs)
+{
+    if (gapMs < p.minPeriodMs || gapMs > p.maxPeriodMs)
+    {
+        s.confident = false;
+        s.samples = 0;
+        s.periodMs = 0;
+        return;
+    }
+
+    if (s.samples == 0 || s.periodMs == 0)
+    {
+        relearn(s, gapMs);
+        return;
+    }
+
+    // Un intervalo multiplo del periodo son rafagas perdidas
+    uint32_t k = (gapMs + s.periodMs / 2) / s.periodMs;
+    if (k == 0) k = 1;
+
+    uint32_t single = gapMs / k;
+    uint32_t dev = single > s.periodMs ? single - s.periodMs : s.periodMs - single;
+
+    // Fuera de tolerancia: el beacon cambio de ritmo
+    uint32_t tol = s.periodMs / 8;
+    if (tol < p.guardMinMs) tol = p.guardMinMs;
+    if (dev > tol)
+    {
+        relearn(s, gapMs);
+        return;
+    }
+
+    s.periodMs = static_cast<uint32_t>((static_cast<uint64_t>(s.periodMs) * 3 + single) / 4);
+    s.jitterMs = (s.jitterMs * 3 + dev) / 4;
+    if (s.samples < 255) s.samples++;
+
+    if (!s.confident && s.samples >= p.minSamples)
+    {
+        s.confident = true;
+        s.misses = 0;
+    }
+}
+
+void CadenceTracker::observe(uint8_t slot, uint32_t nowMs)
+{
+    if (slot >= CADENCE_MAX_SLOTS) return;
+    Slot &s = slots[slot];
+
+    if (!s.known)
+    {
+        s.known = true;
+        s.burstStartMs = nowMs;
+        s.lastPacketMs = nowMs;
+        return;
+    }
+
+    // Resto de la misma rafaga
+    if (msDiff(nowMs, s.lastPacketMs) < static_cast<int32_t>(p.burstGapMs))
+    {
+        s.lastPacketMs = nowMs;
+        return;
+    }
+
+    if (s.confident)
+    {
+        uint32_t guard = guardOf(s);
+        int32_t early = msDiff(s.dueMs, nowMs);
+        int32_t late = msDiff(nowMs, s.dueMs);
+        if (early <= static_cast<int32_t>(guard) && late <= static_cast<int32_t>(guard + p.burstMs))
+        {
+            stats[static_cast<uint8_t>(current)].caught++;
+        }
+    }
+
+    uint32_t gap = nowMs - s.burstStartMs;
+    s.burstStartMs = nowMs;
+    s.lastPacketMs = nowMs;
+    s.misses = 0;
+
+    learn(s, gap);
+    s.dueMs = nowMs + s.periodMs;
+}
+
+void CadenceTracker::tick(uint32_t nowMs)
+{
+    for (size_t i = 0; i < CADENCE_MAX_SLOTS; ++i)
+    {
+        Slot &s = slots[i];
+        if (!s.confident) continue;
+
+        uint32_t close = guardOf(s) + p.burstMs;
+        while (s.confident && msDiff(nowMs, s.dueMs) > static_cast<int32_t>(close))
+        {
+            stats[static_cast<uint8_t>(current)].missed++;
+            s.dueMs += s.periodMs;
+
+            if (++s.misses >= p.maxMisses)
+            {
+                // Demasiadas ausencias: la prediccion ya no sirve
+                s.confident = false;
+                s.samples = 0;
+            }
+        }
+    }
+}
+
+bool CadenceTracker::confident(uint8_t slot) const
+{
+    return slot < CADENCE_MAX_SLOTS && slots[slot].confident;
+}
+
+bool CadenceTracker::nextWindow(uint8_t slot, uint32_t &openMs, uint32_t &closeMs) const
+{
+    if (!confident(slot)) return false;
+
+    const Slot &s = slots[slot];
+    uint32_t guard = guardOf(s);
+    openMs = s.dueMs - guard;
+    closeMs = s.dueMs + guard + p.burstMs;
+    return true;
+}
+
+bool CadenceTracker::windowSoon(uint32_t slotMask, uint32_t nowMs, uint32_t leadMs) const
+{
+    for (size_t i = 0; i < CADENCE_MAX_SLOTS; ++i)
+    {
+        if ((slotMask & (1UL << i)) == 0) continue;
+
+        uint32_t openMs;
+        uint32_t closeMs;
+        if (!nextWindow(static_cast<uint8_t>(i), openMs, closeMs)) continue;
+
+        if (msDiff(openMs, nowMs) <= static_cast<int32_t>(leadMs) && msDiff(closeMs, nowMs) > 0)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CadenceTracker::allConfident(uint32_t slotMask) const
+{
+    for (size_t i = 0; i < CADENCE_MAX_SLOTS; ++i)
+    {
+        if ((slotMask & (1UL << i)) != 0 && !slots[i].confident) return false;
+    }
+    return true;
+}
+
+CadenceSlotInfo CadenceTracker::info(uint8_t slot) const
+{
+    CadenceSlotInfo out;
+    if (slot >= CADENCE_MAX_SLOTS) return out;
+
+    const Slot &s = slots[slot];
+    out.known = s.known;
+    out.confident = s.confident;
+    out.periodMs = s.periodMs;
+    out.jitterMs = s.jitterMs;
+    out.nextDueMs = s.dueMs;
+    out.samples = s.samples;
+    out.misses = s.misses;
+    return out;
+}
+
+CadenceCatch CadenceTracker::catchStats(CadencePolicy policy) const
+{
+    return stats[static_cast<uint8_t>(policy)];
+}
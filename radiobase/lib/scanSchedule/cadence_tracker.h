@@ -0,0 +1,108 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Aprendizaje del ritmo de despertar de cada beacon.
+
+  El beacon despierta cada cierto periodo y anuncia durante una rafaga
+  corta. Del primer paquete de cada rafaga se estima el periodo (promedio
+  movil de los intervalos) y su dispersion; un intervalo que es multiplo
+  del periodo se toma como rafagas perdidas, no como cambio de ritmo. Con
+  suficientes muestras estables el slot queda "confiable" y se puede
+  predecir su proxima ventana de llegada.
+
+  Las ventanas vencidas sin llegada cuentan como perdidas y las llegadas
+  dentro de ventana como atrapadas, separadas por la politica de escaneo
+  activa en ese momento para comparar contra la linea base.
+
+  Logica pura sobre tiempos en ms (tolera el desborde de millis()); no
+  toma locks: quien lo usa serializa el acceso.
+*/
+
+static constexpr size_t CADENCE_MAX_SLOTS = 32;
+
+struct CadenceParams
+{
+    uint32_t burstGapMs = 2000;  // paquetes mas cercanos son la misma rafaga
+    uint32_t burstMs = 1000;     // duracion de la rafaga del beacon
+    uint32_t guardMinMs = 300;   // margen minimo a cada lado de la prediccion
+    uint32_t minPeriodMs = 3000;
+    uint32_t maxPeriodMs = 3600000;
+    uint8_t minSamples = 3;      // intervalos estables antes de confiar
+    uint8_t maxMisses = 3;       // perdidas seguidas para volver a aprender
+};
+
+enum class CadencePolicy : uint8_t
+{
+    FIXED = 0,    // ciclo fijo de linea base
+    ADAPTIVE = 1, // ventana abierta solo alrededor de llegadas esperadas
+};
+
+struct CadenceCatch
+{
+    uint32_t caught = 0;
+    uint32_t missed = 0;
+};
+
+struct CadenceSlotInfo
+{
+    bool known = false;
+    bool confident = false;
+    uint32_t periodMs = 0;
+    uint32_t jitterMs = 0;
+    uint32_t nextDueMs = 0;
+    uint8_t samples = 0;
+    uint8_t misses = 0;
+};
+
+class CadenceTracker
+{
+public:
+    void begin(const CadenceParams &params);
+    void reset();
+    void forget(uint8_t slot);
+
+    // Paquete recibido del slot; cuenta solo el inicio de cada rafaga
+    void observe(uint8_t slot, uint32_t nowMs);
+    // Vence ventanas sin llegada; llamar periodicamente
+    void tick(uint32_t nowMs);
+
+    void setPolicy(CadencePolicy policy) { current = policy; }
+
+    bool confident(uint8_t slot) const;
+    // Ventana [open, close) de la proxima llegada esperada
+    bool nextWindow(uint8_t slot, uint32_t &openMs, uint32_t &closeMs) const;
+
+    // true si algun slot de la mascara tiene ventana abierta dentro de leadMs
+    bool windowSoon(uint32_t slotMask, uint32_t nowMs, uint32_t leadMs) const;
+    // true si todos los slots de la mascara son confiables
+    bool allConfident(uint32_t slotMask) const;
+
+    CadenceSlotInfo info(uint8_t slot) const;
+    CadenceCatch catchStats(CadencePolicy policy) const;
+
+private:
+    struct Slot
+    {
+        bool known;
+        bool confident;
+        uint8_t samples;
+        uint8_t misses;
+        uint32_t burstStartMs;
+        uint32_t lastPacketMs;
+        uint32_t periodMs;
+        uint32_t jitterMs;
+        uint32_t dueMs;
+    };
+
+    uint32_t guardOf(const Slot &s) const;
+    void learn(Slot &s, uint32_t gapMs);
+    void relearn(Slot &s, uint32_t gapMs);
+
+private:
+    CadenceParams p;
+    Slot slots[CADENCE_MAX_SLOTS]{};
+    CadenceCatch stats[2];
+    CadencePolicy current = CadencePolicy::FIXED;
+};
@@ -0,0 +1,182 @@
+# Genera include/web_assets_data.h a partir de data/ (salida de web-gw).
+#
+# Cada archivo queda como arreglo constante en flash con su variante gzip
+# y, si hay compresor o un .br de Vite al lado, Brotli. Las entradas van
+# ordenadas por ruta para que el firmware busque por biseccion; el ETag es
+# fuerte y distinto por codificacion.
+#
+# Corre como extra_script "pre:" de PlatformIO o suelto:
+#   python scripts/embed_assets.py [data_dir] [salida.h]
+
+import gzip
+import hashlib
+import os
+import sys
+
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".js": "application/javascript",
+    ".mjs": "application/javascript",
+    ".css": "text/css",
+    ".svg": "image/svg+xml",
+    ".json": "application/json",
+    ".webmanifest": "application/manifest+json",
+    ".ico": "image/x-icon",
+    ".png": "image/png",
+    ".jpg": "image/jpeg",
+    ".woff2": "font/woff2",
+    ".txt": "text/plain; charset=utf-8",
+}
+
+# Variantes que Vite deja junto al original; se regeneran o se toman aparte
+SKIP_SUFFIXES = (".gz", ".br")
+
+try:
+    import brotli
+except ImportError:
+    brotli = None
+
+
+def content_type(path):
+    return CONTENT_TYPES.get(os.path.splitext(path)[1].lower(), "application/octet-stream")
+
+
+def gzip_bytes(raw):
+    # mtime fijo: misma entrada, misma salida y mismo firmware
+    return gzip.compress(raw, compresslevel=9, mtime=0)
+
+
+def brotli_bytes(raw, src):
+    if brotli is not None:
+        return brotli.compress(raw, quality=11)
+
+    pre = src + ".br"
+    if os.path.isfile(pre):
+        with open(pre, "rb") as f:
+            return f.read()
+
+    return None
+
+
+def collect(data_dir):
+    assets = []
+    for root, _, files in os.walk(data_dir):
+        for name in files:
+            if name.endswith(SKIP_SUFFIXES):
+                continue
+
+            src = os.path.join(root, name)
+            url = "/" + os.path.relpath(src, data_dir).replace(os.sep, "/")
+            with open(src, "rb") as f:
+                raw = f.read()
+
+            gz = gzip_bytes(raw)
+            br = brotli_bytes(raw, src)
+
+            # Una variante que no achica no vale el espacio en flash
+            assets.append({
+                "url": url,
+                "raw": raw,
+                "gz": gz if len(gz) < len(raw) else None,
+                "br": br if br is not None and len(br) < len(raw) else None,
+                "hash": hashlib.sha256(raw).hexdigest()[:16],
+            })
+
+    # Orden por bytes, el mismo que strcmp en el firmware
+    assets.sort(key=lambda a: a["url"].encode("utf-8"))
+    return assets
+
+
+def c_string(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"') + '"'
+
+
+def c_array(name, data):
+    lines = ["static const uint8_t %s[] = {" % name]
+    for i in range(0, len(data), 20):
+        lines.append("    " + ",".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+    lines.append("};")
+    return "\n".join(lines)
+
+
+def variant(name, data, etag):
+    if data is None:
+        return "{nullptr, 0, nullptr}"
+    return "{%s, %d, %s}" % (name, len(data), c_string('"' + etag + '"'))
+
+
+def render(assets):
+    out = [
+        "// Generado por scripts/embed_assets.py desde data/. No editar.",
+        "#pragma once",
+        "",
+    ]
+
+    for i, a in enumerate(assets):
+        out.append("// %s" % a["url"])
+        out.append(c_array("WEB_ASSET_%d_ID" % i, a["raw"]))
+        if a["gz"] is not None:
+            out.append(c_array("WEB_ASSET_%d_GZ" % i, a["gz"]))
+        if a["br"] is not None:
+            out.append(c_array("WEB_ASSET_%d_BR" % i, a["br"]))
+        out.append("")
+
+    out.append("static constexpr WebAsset WEB_ASSETS[] = {")
+    for i, a in enumerate(assets):
+        out.append("    {%s, %s, %s," % (
+            c_string(a["url"]),
+            c_string(content_type(a["url"])),
+            "true" if a["url"].startswith("/assets/") else "false"))
+        out.append("     %s," % variant("WEB_ASSET_%d_ID" % i, a["raw"], a["hash"]))
+        out.append("     %s," % variant("WEB_ASSET_%d_GZ" % i, a["gz"], a["hash"] + "-gz"))
+        out.append("     %s}," % variant("WEB_ASSET_%d_BR" % i, a["br"], a["hash"] + "-br"))
+    out.append("};")
+    out.append("")
+    out.append("static constexpr size_t WEB_ASSET_COUNT = %d;" % len(assets))
+    out.append("")
+    return "\n".join(out)
+
+
+def generate(data_dir, out_path):
+    if not os.path.isdir(data_dir):
+        raise SystemExit("embed_assets: no existe %s" % data_dir)
+
+    assets = collect(data_dir)
+    if not assets:
+        raise SystemExit("embed_assets: %s esta vacio; compilar web-gw primero" % data_dir)
+
+    text = render(assets)
+
+    # Solo se reescribe si cambia, para no recompilar en cada build
+    if os.path.isfile(out_path):
+        with open(out_path, "r") as f:
+            if f.read() == text:
+                return assets
+
+    os.makedirs(os.path.dirname(os.path.abspath(out_path)), exist_ok=True)
+    with open(out_path, "w") as f:
+        f.write(text)
+
+    raw = sum(len(a["raw"]) for a in assets)
+    gz = sum(len(a["gz"]) for a in assets if a["gz"] is not None)
+    br = sum(len(a["br"]) for a in assets if a["br"] is not None)
+    print("embed_assets: %d archivos, %d B + gzip %d B + br %d B" % (len(assets), raw, gz, br))
+    if not any(a["br"] is not None for a in assets):
+        print("embed_assets: sin variantes Brotli (falta el modulo brotli o los .br de Vite)")
+
+    return assets
+
+
+try:
+    Import("env")  # noqa: F821 (definido por SCons)
+except NameError:
+    env = None
+
+if env is not None:
+    project = env["PROJECT_DIR"]
+    generate(os.path.join(project, "data"), os.path.join(project, "include", "web_assets_data.h"))
+elif __name__ == "__main__":
+    here = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    data = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "data")
+    dest = sys.argv[2] if len(sys.argv) > 2 else os.path.join(here, "include", "web_assets_data.h")
+    generate(data, dest)
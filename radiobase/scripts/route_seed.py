@@ -0,0 +1,74 @@
+# Busca una semilla para API_ROUTE_SEED en src/api/api_routes.h.
+#
+# Lee las filas {HTTP_X, "/ruta", ...} de la tabla y prueba semillas hasta que
+# cada metodo + ruta cae en un bucket distinto, con el mismo hash que
+# apiRouteBucket(). Si ninguna sirve, subir API_ROUTE_BUCKET_BITS.
+#
+#   python scripts/route_seed.py [api_routes.h]
+
+import os
+import re
+import sys
+
+# Valores de WebRequestMethod en AsyncWebServer
+METHODS = {
+    "HTTP_GET": 0x01,
+    "HTTP_POST": 0x02,
+    "HTTP_DELETE": 0x04,
+    "HTTP_PUT": 0x08,
+    "HTTP_PATCH": 0x10,
+    "HTTP_HEAD": 0x20,
+    "HTTP_OPTIONS": 0x40,
+}
+
+ROW = re.compile(r'\{\s*(HTTP_[A-Z]+)\s*,\s*"([^"]+)"\s*(?:,[^}]*)?\}')
+BITS = re.compile(r"#define\s+API_ROUTE_BUCKET_BITS\s+(\d+)")
+
+MASK = 0xFFFFFFFF
+MAX_SEEDS = 1 << 24
+
+
+def routes(text):
+    return [(METHODS[m], p.encode("utf-8")) for m, p in ROW.findall(text)]
+
+
+def bucket(seed, method, path, bits):
+    h = (((2166136261 ^ seed) ^ method) * 16777619) & MASK
+    for c in path:
+        h = ((h ^ c) * 16777619) & MASK
+    return h >> (32 - bits)
+
+
+def search(rows, bits):
+    for seed in range(1, MAX_SEEDS):
+        used = set()
+        for method, path in rows:
+            b = bucket(seed, method, path, bits)
+            if b in used:
+                break
+            used.add(b)
+        else:
+            return seed
+    return None
+
+
+def main():
+    here = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    src = sys.argv[1] if len(sys.argv) > 1 else os.path.join(here, "src", "api", "api_routes.h")
+    with open(src, "r") as f:
+        text = f.read()
+
+    rows = routes(text)
+    bits = int(BITS.search(text).group(1))
+    if len(set(rows)) != len(rows):
+        raise SystemExit("route_seed: hay filas repetidas en %s" % src)
+
+    seed = search(rows, bits)
+    if seed is None:
+        raise SystemExit("route_seed: sin semilla para %d rutas en %d buckets" % (len(rows), 1 << bits))
+
+    print("%d rutas, %d buckets: #define API_ROUTE_SEED %dUL" % (len(rows), 1 << bits, seed))
+
+
+if __name__ == "__main__":
+    main()
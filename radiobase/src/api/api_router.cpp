@@ -0,0 +1,240 @@
+#include "api_router.h"
+#include <string.h>
+#include "json_arena.h"
+#include "responseJson.h"
+
+ApiRouter apiRouter;
+
+static constexpr uint8_t NO_ROUTE = 0xFF;
+
+ApiRouter::ApiRouter()
+{
+    memset(buckets, NO_ROUTE, sizeof(buckets));
+    for (size_t i = 0; i < API_ROUTE_COUNT; ++i)
+    {
+        buckets[apiRouteBucket(API_ROUTES[i].method, API_ROUTES[i].path)] = static_cast<uint8_t>(i);
+    }
+    st.routes = API_ROUTE_COUNT;
+    st.unbound = API_ROUTE_COUNT;
+}
+
+int ApiRouter::find(WebRequestMethodComposite method, const char *path) const
+{
+    uint8_t i = buckets[apiRouteBucket(method, path)];
+    if (i == NO_ROUTE) return -1;
+
+    const ApiRouteDef &def = API_ROUTES[i];
+    return def.method == method && strcmp(def.path, path) == 0 ? i : -1;
+}
+
+int ApiRouter::bind(const char *path, WebRequestMethodComposite method)
+{
+    int i = find(method, path);
+    if (i < 0)
+    {
+        Serial.printf("ApiRouter: %s no esta en API_ROUTES\n", path);
+        return -1;
+    }
+
+    Route &r = routes[i];
+    if (r.onRequest == nullptr && r.onBody == nullptr) st.unbound--;
+    return i;
+}
+
+bool ApiRouter::on(const char *path, WebRequestMethodComposite method, ApiHandler handler)
+{
+    int i = bind(path, method);
+    if (i < 0) return false;
+
+    routes[i].onRequest = handler;
+    routes[i].onBody = nullptr;
+    return true;
+}
+
+bool ApiRouter::on(const char *path, WebRequestMethodComposite method, ApiBodyHandler handler)
+{
+    int i = find(method, path);
+    if (i >= 0 && API_ROUTES[i].maxBody == 0)
+    {
+        Serial.printf("ApiRouter: %s no tiene limite de cuerpo en API_ROUTES\n", path);
+        return false;
+    }
+
+    i = bind(path, method);
+    if (i < 0) return false;
+
+    routes[i].onRequest = nullptr;
+    routes[i].onBody = handler;
+    return true;
+}
+
+bool ApiRouter::canHandle(AsyncWebServerRequest *request)
+{
+    if (!request->url().startsWith("/api/")) return false;
+
+    // Los handlers leen Accept, Accept-Encoding e If-None-Match
+    request->addInterestingHeader("ANY");
+    return true;
+}
+
+void ApiRouter::account(Route &route, uint32_t startUs)
+{
+    uint32_t us = micros() - startUs;
+    route.stats.hits++;
+    route.stats.totalUs += us;
+    if (us > route.stats.maxUs) route.stats.maxUs = us;
+}
+
+void ApiRouter::miss(AsyncWebServerRequest *request)
+{
+    const char *path = request->url().c_str();
+    for (size_t i = 0; i < API_ROUTE_COUNT; ++i)
+    {
+        if (strcmp(API_ROUTES[i].path, path) == 0)
+        {
+            st.methodNotAllowed++;
+            sendError(request, 405, "method_not_allowed");
+            return;
+        }
+    }
+
+    st.notFound++;
+    sendError(request, 404, "not_found");
+}
+
+void ApiRouter::handleRequest(AsyncWebServerRequest *request)
+{
+    int i = find(request->method(), request->url().c_str());
+    if (i < 0)
+    {
+        miss(request);
+        return;
+    }
+
+    Route &r = routes[i];
+    if (r.onBody != nullptr)
+    {
+        // Con cuerpo la respuesta ya salio desde handleBody
+        if (request->contentLength() > 0) return;
+
+        st.missingBody++;
+        sendError(request, 400, "missing_body");
+        return;
+    }
+
+    if (r.onRequest == nullptr)
+    {
+        sendError(request, 501, "not_implemented");
+        return;
+    }
+
+    uint32_t start = micros();
+    r.onRequest(request);
+    account(r, start);
+}
+
+void ApiRouter::dispatch(Route &route, AsyncWebServerRequest *request, uint8_t *data, size_t len)
+{
+    uint32_t start = micros();
+    route.onBody(request, data, len);
+    account(route, start);
+}
+
+ApiRouter::PendingBody *ApiRouter::pendingFor(AsyncWebServerRequest *request)
+{
+    for (PendingBody &p : pending)
+    {
+        if (p.request == request) return &p;
+    }
+    return nullptr;
+}
+
+ApiRouter::PendingBody *ApiRouter::startPending(AsyncWebServerRequest *request, size_t total)
+{
+    PendingBody *slot = pendingFor(nullptr);
+    if (slot == nullptr) return nullptr;
+
+    // Misma arena que los JsonDocument del handler: se libera al despachar
+    slot->data = static_cast<uint8_t *>(requestAllocator()->allocate(total));
+    if (slot->data == nullptr) return nullptr;
+
+    slot->request = request;
+    slot->received = 0;
+    slot->total = total;
+
+    // Si el cliente se cae antes del ultimo trozo el cuerpo no se despacha
+    request->onDisconnect([this, request]()
+    {
+        PendingBody *p = pendingFor(request);
+        if (p == nullptr) return;
+        st.aborted++;
+        dropPending(*p);
+    });
+    return slot;
+}
+
+void ApiRouter::dropPending(PendingBody &p)
+{
+    requestAllocator()->deallocate(p.data);
+    p = PendingBody();
+}
+
+void ApiRouter::handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+{
+    int i = find(request->method(), request->url().c_str());
+    if (i < 0 || routes[i].onBody == nullptr) return;
+    Route &r = routes[i];
+
+    if (index == 0)
+    {
+        if (total > API_ROUTES[i].maxBody)
+        {
+            st.tooLarge++;
+            sendError(request, 413, "body_too_large");
+            return;
+        }
+
+        if (len == total)
+        {
+            dispatch(r, request, data, len);
+            return;
+        }
+
+        if (startPending(request, total) == nullptr)
+        {
+            st.noMemory++;
+            sendError(request, 503, "body_busy");
+            return;
+        }
+    }
+
+    // Sin entrada: el primer trozo ya se rechazo
+    PendingBody *p = pendingFor(request);
+    if (p == nullptr) return;
+
+    if (index != p->received || len > p->total - p->received)
+    {
+        dropPending(*p);
+        sendError(request, 400, "body_out_of_order");
+        return;
+    }
+
+    memcpy(p->data + index, data, len);
+    p->received += len;
+    if (p->received < p->total) return;
+
+    st.assembled++;
+    dispatch(r, request, p->data, p->total);
+    dropPending(*p);
+}
+
+ApiRouterStats ApiRouter::stats() const
+{
+    ApiRouterStats out = st;
+    out.pending = 0;
+    for (const PendingBody &p : pending)
+    {
+        if (p.request != nullptr) out.pending++;
+    }
+    return out;
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <Arduino.h>
+#include <AsyncWebServer_ESP32_SC_W5500.h>
+#include "api_routes.h"
+
+/*
+  Despachador unico de /api.
+
+  Un solo handler en el servidor atiende las rutas que empiezan con
+  /api/: busca metodo + ruta en API_ROUTES por hash y llama al handler
+  atado a esa fila. Una ruta que no esta responde 404, y 405 si existe
+  con otro metodo.
+
+  Los handlers con cuerpo reciben el cuerpo entero en una llamada. Si
+  llega en un solo trozo se pasa tal cual; si no, se junta en la arena
+  de JSON hasta completar el total y recien ahi se despacha. El total
+  se compara con el limite de la fila antes de reservar (413), y hay a
+  lo sumo API_BODY_MAX_PENDING cuerpos a medio llegar (503 si no hay
+  lugar). Por ruta cuenta llamadas y tiempo dentro del handler (la
+  respuesta por partes sale despues y no entra).
+
+  Todo corre en la tarea de AsyncTCP: no toma locks.
+*/
+
+typedef void (*ApiHandler)(AsyncWebServerRequest *request);
+typedef void (*ApiBodyHandler)(AsyncWebServerRequest *request, uint8_t *data, size_t len);
+
+struct ApiRouteStats
+{
+    uint32_t hits = 0;
+    uint32_t totalUs = 0;
+    uint32_t maxUs = 0;
+};
+
+struct ApiRouterStats
+{
+    uint32_t routes = 0;
+    uint32_t unbound = 0;          // filas sin handler
+    uint32_t notFound = 0;
+    uint32_t methodNotAllowed = 0;
+    uint32_t missingBody = 0;
+    uint32_t assembled = 0;        // cuerpos juntados de varios trozos
+    uint32_t tooLarge = 0;
+    uint32_t noMemory = 0;         // sin lugar o sin arena para juntar
+    uint32_t aborted = 0;          // cliente caido a mitad del cuerpo
+    uint32_t pending = 0;
+};
+
+class ApiRouter : public AsyncWebHandler
+{
+public:
+    ApiRouter();
+
+    // false si metodo + ruta no esta en API_ROUTES
+    bool on(const char *path, WebRequestMethodComposite method, ApiHandler handler);
+    bool on(const char *path, WebRequestMethodComposite method, ApiBodyHandler handler);
+
+    bool canHandle(AsyncWebServerRequest *request) override;
+    void handleRequest(AsyncWebServerRequest *request) override;
+    void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) override;
+    bool isRequestHandlerTrivial() override { return false; }
+
+    ApiRouterStats stats() const;
+    const ApiRouteStats &routeStats(size_t route) const { return routes[route].stats; }
+
+private:
+    struct Route
+    {
+        ApiHandler onRequest = nullptr;
+        ApiBodyHandler onBody = nullptr;
+        ApiRouteStats stats;
+    };
+
+    struct PendingBody
+    {
+        AsyncWebServerRequest *request = nullptr;
+        uint8_t *data = nullptr;
+        size_t received = 0;
+        size_t total = 0;
+    };
+
+    int find(WebRequestMethodComposite method, const char *path) const;
+    int bind(const char *path, WebRequestMethodComposite method);
+    void account(Route &route, uint32_t startUs);
+    void miss(AsyncWebServerRequest *request);
+    void dispatch(Route &route, AsyncWebServerRequest *request, uint8_t *data, size_t len);
+    PendingBody *pendingFor(AsyncWebServerRequest *request);
+    PendingBody *startPending(AsyncWebServerRequest *request, size_t total);
+    void dropPending(PendingBody &p);
+
+private:
+    uint8_t buckets[API_ROUTE_BUCKETS];
+    Route routes[API_ROUTE_COUNT];
+    PendingBody pending[API_BODY_MAX_PENDING];
+    ApiRouterStats st;
+};
+
+extern ApiRouter apiRouter;
@@ -0,0 +1,132 @@
+#pragma once
+#include <AsyncWebServer_ESP32_SC_W5500.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+/*
+  Tabla de rutas de /api.
+
+  Cada metodo + ruta que atiende ApiRouter figura aca; los handlers se
+  atan en los register*Routes. El hash de cada fila cae en un bucket
+  distinto (se comprueba al compilar), asi el despacho es un hash y un
+  strcmp. Si una fila nueva choca, correr scripts/route_seed.py y poner
+  la semilla que imprime en API_ROUTE_SEED.
+
+  La tercera columna es el cuerpo mas grande que acepta la ruta; uno
+  mayor se rechaza con 413 antes de reservar nada. Va en todas las
+  filas, 0 en las que no leen cuerpo.
+*/
+
+struct ApiRouteDef
+{
+    WebRequestMethodComposite method;
+    const char *path;
+    uint16_t maxBody; // 0: la ruta no lee cuerpo
+};
+
+static constexpr ApiRouteDef API_ROUTES[] = {
+    {HTTP_GET, "/api/system/status", 0},
+    {HTTP_GET, "/api/network/status", 0},
+    {HTTP_GET, "/api/device/info", 0},
+    {HTTP_GET, "/api/ble/stats", 0},
+    {HTTP_POST, "/api/ble/stats/reset", 0},
+
+    {HTTP_POST, "/api/login", API_BODY_MAX},
+    {HTTP_POST, "/api/change-password", API_BODY_MAX},
+
+    // /api/feature queda como alias de lectura
+    {HTTP_GET, "/api/feature", 0},
+    {HTTP_GET, "/api/features", 0},
+    {HTTP_POST, "/api/features", API_BODY_MAX},
+    {HTTP_PATCH, "/api/features", API_BODY_MAX},
+
+    // /api/network/config queda como alias de lectura
+    {HTTP_GET, "/api/network", 0},
+    {HTTP_GET, "/api/network/config", 0},
+    {HTTP_POST, "/api/network/ethernet", API_BODY_MAX},
+    {HTTP_PATCH, "/api/network/ethernet", API_BODY_MAX},
+    {HTTP_POST, "/api/network/ap", API_BODY_MAX},
+    {HTTP_PATCH, "/api/network/ap", API_BODY_MAX},
+    {HTTP_POST, "/api/network/sta", API_BODY_MAX},
+    {HTTP_PATCH, "/api/network/sta", API_BODY_MAX},
+
+    {HTTP_GET, "/api/map", 0},
+    {HTTP_POST, "/api/map", API_BODY_MAX},
+    {HTTP_DELETE, "/api/map", 0},
+    {HTTP_POST, "/api/map/bulk", API_BODY_MAX_BULK},
+    {HTTP_GET, "/api/slots", 0},
+    {HTTP_GET, "/api/beacons", 0},
+    {HTTP_GET, "/api/bootstrap", 0},
+
+    {HTTP_GET, "/api/gzip", 0},
+    {HTTP_POST, "/api/gzip/bench", 0},
+
+    {HTTP_GET, "/api/alarms", 0},
+    {HTTP_GET, "/api/alarms/rules", 0},
+    {HTTP_POST, "/api/alarms/rules", API_BODY_MAX_BULK},
+    {HTTP_GET, "/api/zones", 0},
+    {HTTP_GET, "/api/zones/config", 0},
+    {HTTP_POST, "/api/zones/config", API_BODY_MAX_BULK},
+
+    {HTTP_GET, "/api/history", 0},
+    {HTTP_GET, "/api/history/stats", 0},
+    {HTTP_GET, "/api/rollups", 0},
+    {HTTP_GET, "/api/rollups/daily", 0},
+
+    {HTTP_GET, "/api/keys", 0},
+    {HTTP_POST, "/api/keys", API_BODY_MAX},
+    {HTTP_POST, "/api/keys/retire", API_BODY_MAX},
+    {HTTP_POST, "/api/keys/remove", API_BODY_MAX},
+
+    {HTTP_GET, "/api/pipeline", 0},
+    {HTTP_POST, "/api/pipeline", API_BODY_MAX},
+    {HTTP_GET, "/api/pipeline/bench", 0},
+    {HTTP_POST, "/api/pipeline/bench", API_BODY_MAX},
+
+    {HTTP_GET, "/api/events", 0},
+    {HTTP_GET, "/api/events/stats", 0},
+    {HTTP_GET, "/api/events/ws", 0},
+
+    {HTTP_GET, "/api/harness", 0},
+    {HTTP_POST, "/api/harness/capture", API_BODY_MAX},
+    {HTTP_POST, "/api/harness/capture/stop", 0},
+    {HTTP_POST, "/api/harness/inject", API_BODY_MAX},
+    {HTTP_POST, "/api/harness/inject/stop", 0},
+
+    {HTTP_GET, "/api/router", 0},
+};
+
+static constexpr size_t API_ROUTE_COUNT = sizeof(API_ROUTES) / sizeof(API_ROUTES[0]);
+
+#define API_ROUTE_BUCKET_BITS 8
+#define API_ROUTE_SEED        451UL
+
+static constexpr size_t API_ROUTE_BUCKETS = 1U << API_ROUTE_BUCKET_BITS;
+
+// FNV-1a del metodo y la ruta; los bits altos eligen el bucket
+constexpr uint32_t apiRouteHashStep(const char *s, uint32_t h)
+{
+    return *s == '\0' ? h : apiRouteHashStep(s + 1, (h ^ static_cast<uint8_t>(*s)) * 16777619U);
+}
+
+constexpr uint32_t apiRouteBucket(WebRequestMethodComposite method, const char *path)
+{
+    return apiRouteHashStep(path, ((2166136261U ^ static_cast<uint32_t>(API_ROUTE_SEED)) ^ method) * 16777619U) >>
+           (32 - API_ROUTE_BUCKET_BITS);
+}
+
+constexpr bool apiRouteApart(size_t i, size_t j)
+{
+    return j >= API_ROUTE_COUNT ||
+           (apiRouteBucket(API_ROUTES[i].method, API_ROUTES[i].path) != apiRouteBucket(API_ROUTES[j].method, API_ROUTES[j].path) &&
+            apiRouteApart(i, j + 1));
+}
+
+constexpr bool apiRoutesPerfect(size_t i = 0)
+{
+    return i >= API_ROUTE_COUNT || (apiRouteApart(i, i + 1) && apiRoutesPerfect(i + 1));
+}
+
+static_assert(API_ROUTE_COUNT < 0xFF, "el indice de ruta se guarda en un byte");
+static_assert(apiRoutesPerfect(), "dos rutas caen en el mismo bucket: correr scripts/route_seed.py");
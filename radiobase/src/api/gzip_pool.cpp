@@ -0,0 +1,115 @@
+#include "gzip_pool.h"
+#include <esp32-hal-psram.h>
+
+GzipPool gzipPool;
+
+GzipConfig GzipPool::config()
+{
+    GzipConfig c;
+    c.windowBits = GZIP_WINDOW_BITS;
+    c.hashBits = GZIP_HASH_BITS;
+    c.maxChain = GZIP_MAX_CHAIN;
+    c.outBytes = GZIP_OUT_BYTES;
+    return c;
+}
+
+bool GzipPool::begin()
+{
+    if (ready()) return true;
+
+    workBytes = GzipStream::workBytes(config());
+    size_t slotBytes = workBytes + GZIP_STAGE_BYTES;
+
+    uint8_t *pool = static_cast<uint8_t *>(ps_malloc(slotBytes * GZIP_POOL_SLOTS));
+    if (pool == nullptr)
+    {
+        Serial.println("GzipPool: Sin PSRAM, las respuestas salen sin comprimir");
+        return false;
+    }
+
+    for (uint8_t i = 0; i < GZIP_POOL_SLOTS; ++i)
+    {
+        slots[i].work = pool + i * slotBytes;
+        slots[i].stage = slots[i].work + workBytes;
+    }
+
+    slotCount = GZIP_POOL_SLOTS;
+    st.slots = slotCount;
+    st.slotBytes = slotBytes;
+    return true;
+}
+
+GzipStream *GzipPool::acquire(uint8_t *&stage)
+{
+    Slot *slot = nullptr;
+
+    portENTER_CRITICAL(&mux);
+    for (uint8_t i = 0; i < slotCount; ++i)
+    {
+        if (!slots[i].busy)
+        {
+            slot = &slots[i];
+            slot->busy = true;
+            st.inUse++;
+            if (st.inUse > st.peakInUse) st.peakInUse = st.inUse;
+            break;
+        }
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (slot == nullptr) return nullptr;
+
+    if (!slot->gz.begin(slot->work, workBytes, config()))
+    {
+        release(&slot->gz, 0);
+        return nullptr;
+    }
+
+    stage = slot->stage;
+    return &slot->gz;
+}
+
+void GzipPool::release(GzipStream *gz, uint32_t cpuUs)
+{
+    const GzipStats &gs = gz->stats();
+
+    portENTER_CRITICAL(&mux);
+    for (uint8_t i = 0; i < slotCount; ++i)
+    {
+        if (&slots[i].gz != gz || !slots[i].busy) continue;
+
+        slots[i].busy = false;
+        st.inUse--;
+        if (gs.inBytes > 0)
+        {
+            st.compressed++;
+            st.rawBytes += gs.inBytes;
+            st.gzipBytes += gs.outBytes;
+            st.cpuUs += cpuUs;
+        }
+        break;
+    }
+    portEXIT_CRITICAL(&mux);
+}
+
+void GzipPool::noteSmall()
+{
+    portENTER_CRITICAL(&mux);
+    st.skippedSmall++;
+    portEXIT_CRITICAL(&mux);
+}
+
+void GzipPool::noteBusy()
+{
+    portENTER_CRITICAL(&mux);
+    st.skippedBusy++;
+    portEXIT_CRITICAL(&mux);
+}
+
+GzipPoolStats GzipPool::stats() const
+{
+    portENTER_CRITICAL(&mux);
+    GzipPoolStats out = st;
+    portEXIT_CRITICAL(&mux);
+    return out;
+}
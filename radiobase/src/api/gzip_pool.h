@@ -0,0 +1,63 @@
+#pragma once
+#include <Arduino.h>
+#include <gzip_stream.h>
+#include "config.h"
+
+/*
+  Compresores gzip para las respuestas dinamicas.
+
+  GZIP_POOL_SLOTS compresores con su memoria de trabajo y un buffer de
+  entrada, todo reservado una vez en PSRAM: una respuesta toma un slot
+  mientras dura y lo devuelve al destruirse. Si no hay slot libre la
+  respuesta sale sin comprimir, asi la memoria nunca pasa del presupuesto.
+*/
+
+struct GzipPoolStats
+{
+    uint32_t slots = 0;
+    uint32_t slotBytes = 0;   // trabajo + buffer de entrada por slot
+    uint32_t inUse = 0;
+    uint32_t peakInUse = 0;
+    uint32_t compressed = 0;
+    uint32_t skippedSmall = 0; // cuerpo menor a GZIP_MIN_BYTES
+    uint32_t skippedBusy = 0;  // sin slot libre
+    uint32_t rawBytes = 0;
+    uint32_t gzipBytes = 0;
+    uint32_t cpuUs = 0;        // tiempo dentro del compresor
+};
+
+class GzipPool
+{
+public:
+    bool begin();
+    bool ready() const { return slotCount > 0; }
+
+    static GzipConfig config();
+
+    // nullptr si no hay slot libre; stage queda con GZIP_STAGE_BYTES para la entrada
+    GzipStream *acquire(uint8_t *&stage);
+    void release(GzipStream *gz, uint32_t cpuUs);
+
+    void noteSmall();
+    void noteBusy();
+
+    GzipPoolStats stats() const;
+
+private:
+    struct Slot
+    {
+        GzipStream gz;
+        uint8_t *work = nullptr;
+        uint8_t *stage = nullptr;
+        bool busy = false;
+    };
+
+private:
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    Slot slots[GZIP_POOL_SLOTS];
+    uint8_t slotCount = 0;
+    size_t workBytes = 0;
+    GzipPoolStats st;
+};
+
+extern GzipPool gzipPool;
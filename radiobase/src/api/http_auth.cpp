@@ -1,21 +1,21 @@
 #include "http_auth.h"
 #include <ArduinoJson.h>
 #include "core/appState.h"
+#include "responseJson.h"
 
-void registerAuthRoutes(AsyncWebServer &server)
+void registerAuthRoutes(ApiRouter &router)
 {
     // LOGIN
-    server.on("/api/login", HTTP_POST,
-        [](AsyncWebServerRequest *request) {},
-        nullptr,
-        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+    router.on("/api/login", HTTP_POST,
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
         {
-            JsonDocument doc;
-            DeserializationError err = deserializeJson(doc, data, len);
+            static const JsonFilter filter(R"({"username":true,"password":true})");
+            JsonDocument doc(requestAllocator());
+            DeserializationError err = parseBody(doc, data, len, filter);
 
             if (err)
             {
-                JsonDocument res;
+                JsonDocument res(requestAllocator());
                 res["ok"] = false;
                 res["error"] = "invalid_json";
 
@@ -30,7 +30,7 @@ void registerAuthRoutes(AsyncWebServer &server)
 
             if (username.isEmpty() || password.isEmpty())
             {
-                JsonDocument res;
+                JsonDocument res(requestAllocator());
                 res["ok"] = false;
                 res["error"] = "missing_fields";
 
@@ -44,7 +44,7 @@ void registerAuthRoutes(AsyncWebServer &server)
 
             if (user != nullptr && user->username == username && user->password_hash == password)
             {
-                JsonDocument res;
+                JsonDocument res(requestAllocator());
                 res["ok"] = true;
                 res["user"] = user->username;
                 res["role"] = static_cast<int>(user->role);
@@ -55,7 +55,7 @@ void registerAuthRoutes(AsyncWebServer &server)
                 return;
             }
 
-            JsonDocument res;
+            JsonDocument res(requestAllocator());
             res["ok"] = false;
             res["error"] = "invalid_credentials";
 
@@ -66,17 +66,16 @@ void registerAuthRoutes(AsyncWebServer &server)
     );
 
     // CAMBIO DE CONTRASEÑA
-    server.on("/api/change-password", HTTP_POST,
-        [](AsyncWebServerRequest *request) {},
-        nullptr,
-        [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total)
+    router.on("/api/change-password", HTTP_POST,
+        [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
         {
-            JsonDocument doc;
-            DeserializationError err = deserializeJson(doc, data, len);
+            static const JsonFilter filter(R"({"usuario":true,"oldPassword":true,"newPassword":true})");
+            JsonDocument doc(requestAllocator());
+            DeserializationError err = parseBody(doc, data, len, filter);
 
             if (err)
             {
-                JsonDocument res;
+                JsonDocument res(requestAllocator());
                 res["success"] = false;
                 res["message"] = "JSON inválido";
 
@@ -92,7 +91,7 @@ void registerAuthRoutes(AsyncWebServer &server)
 
             if (usuario.isEmpty() || oldPassword.isEmpty() || newPassword.isEmpty())
             {
-                JsonDocument res;
+                JsonDocument res(requestAllocator());
                 res["success"] = false;
                 res["message"] = "missing_fields";
 
@@ -106,7 +105,7 @@ void registerAuthRoutes(AsyncWebServer &server)
 
             if (user == nullptr)
             {
-                JsonDocument res;
+                JsonDocument res(requestAllocator());
                 res["success"] = false;
                 res["message"] = "user_not_found";
 
@@ -118,7 +117,7 @@ void registerAuthRoutes(AsyncWebServer &server)
 
             if (user->password_hash != oldPassword)
             {
-                JsonDocument res;
+                JsonDocument res(requestAllocator());
                 res["success"] = false;
                 res["message"] = "incorrect_current_password";
 
@@ -134,7 +133,7 @@ void registerAuthRoutes(AsyncWebServer &server)
             // Guardar cambios en memoria persistente
             Config.saveUsers(users);   // <-- ajusta esto a tu función real
 
-            JsonDocument res;
+            JsonDocument res(requestAllocator());
             res["success"] = true;
             res["message"] = "updated_password";
 
@@ -1,4 +1,4 @@
 #pragma once
-#include <AsyncWebServer_ESP32_SC_W5500.h>
+#include "api_router.h"
 
-void registerAuthRoutes(AsyncWebServer& server);
\ No newline at end of file
+void registerAuthRoutes(ApiRouter &router);
\ No newline at end of file
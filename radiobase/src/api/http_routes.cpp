@@ -1,28 +1,66 @@
 #include "http_routes.h"
 #include <WiFi.h>
+#include <memory>
+#include <esp32-hal-psram.h>
 #include <AsyncWebServer_ESP32_SC_W5500.h>
 #include "responseJson.h"
+#include "ws_push.h"
 #include "core/appState.h"
 
-static void fillNetworkStatus(JsonDocument &doc)
+// Estado de red leido una vez por pedido; lo comparten las respuestas JSON y el bootstrap
+struct NetworkStatus
 {
-    JsonObject featuresObj = doc["features"].to<JsonObject>();
-    featuresObj["ethernet_enable"] = feature.ethernetEnable;
-    featuresObj["wifi_ap_enable"] = feature.wifiApEnable;
-    featuresObj["wifi_sta_enable"] = feature.wifiStaEnable;
+    FeatureConfig features;
+    int wifiMode;
+    int staStatus;
+    bool staConnected;
+    IPAddress staIp;
+    IPAddress apIp;
+    uint8_t apClients;
+    IPAddress ethIp;
+    bool ethLinkUp;
+};
+
+static NetworkStatus readNetworkStatus()
+{
+    NetworkStatus s;
+    s.features = feature;
+    s.wifiMode = static_cast<int>(WiFi.getMode());
+    s.staStatus = static_cast<int>(WiFi.status());
+    s.staConnected = s.staStatus == WL_CONNECTED;
+    s.staIp = WiFi.localIP();
+    s.apIp = WiFi.softAPIP();
+    s.apClients = WiFi.softAPgetStationNum();
+    s.ethIp = ETH.localIP();
+    s.ethLinkUp = ETH.linkUp();
+    return s;
+}
 
-    JsonObject wifi = doc["wifi"].to<JsonObject>();
-    wifi["mode"] = static_cast<int>(WiFi.getMode());
-    wifi["sta_status"] = static_cast<int>(WiFi.status());
-    wifi["sta_connected"] = WiFi.status() == WL_CONNECTED;
-    wifi["sta_ip"] = WiFi.localIP().toString();
-    wifi["ap_ip"] = WiFi.softAPIP().toString();
-    wifi["ap_clients"] = WiFi.softAPgetStationNum();
+static void fillFeatures(JsonObject obj, const FeatureConfig &f)
+{
+    obj["ethernet_enable"] = f.ethernetEnable;
+    obj["wifi_ap_enable"] = f.wifiApEnable;
+    obj["wifi_sta_enable"] = f.wifiStaEnable;
+    obj["ble_filter_enable"] = f.bleFilterEnable;
+    obj["ble_schedule_enable"] = f.bleScheduleEnable;
+}
 
-    JsonObject eth = doc["ethernet"].to<JsonObject>();
-    eth["enabled"] = feature.ethernetEnable;
-    eth["ip"] = ETH.localIP().toString();
-    eth["link_up"] = ETH.linkUp();
+static void fillNetworkStatus(JsonObject obj, const NetworkStatus &s)
+{
+    fillFeatures(obj["features"].to<JsonObject>(), s.features);
+
+    JsonObject wifi = obj["wifi"].to<JsonObject>();
+    wifi["mode"] = s.wifiMode;
+    wifi["sta_status"] = s.staStatus;
+    wifi["sta_connected"] = s.staConnected;
+    wifi["sta_ip"] = s.staIp.toString();
+    wifi["ap_ip"] = s.apIp.toString();
+    wifi["ap_clients"] = s.apClients;
+
+    JsonObject eth = obj["ethernet"].to<JsonObject>();
+    eth["enabled"] = s.features.ethernetEnable;
+    eth["ip"] = s.ethIp.toString();
+    eth["link_up"] = s.ethLinkUp;
 }
 
 static void fillNetworkConfig(JsonDocument &doc, bool includeSecrets = true)
@@ -49,14 +87,12 @@ static void sendApplyResult(
     bool applied,
     const char *message)
 {
-    JsonDocument doc;
+    JsonDocument doc(requestAllocator());
     JsonObject data = createResponse(doc, applied, message);
     data["applied"] = applied;
     data["requires_reboot"] = false;
 
-    JsonDocument statusDoc;
-    fillNetworkStatus(statusDoc);
-    data["status"] = statusDoc.as<JsonVariantConst>();
+    fillNetworkStatus(data["status"].to<JsonObject>(), readNetworkStatus());
 
     sendJson(request, applied ? 200 : 500, doc);
 }
@@ -80,19 +116,17 @@ static void markNetworkApplySuccess()
 
 static void sendFeatureConfig(AsyncWebServerRequest *request)
 {
-    JsonDocument doc;
+    JsonDocument doc(requestAllocator());
     JsonObject data = createResponse(doc, true);
-    JsonObject features = data["features"].to<JsonObject>();
-    features["ethernet_enable"] = feature.ethernetEnable;
-    features["wifi_ap_enable"] = feature.wifiApEnable;
-    features["wifi_sta_enable"] = feature.wifiStaEnable;
+    fillFeatures(data["features"].to<JsonObject>(), feature);
     sendJson(request, 200, doc);
 }
 
 static void handleFeatureUpdate(AsyncWebServerRequest *request, uint8_t *payload, size_t len)
 {
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, payload, len);
+    static const JsonFilter filter(R"({"ethernet_enable":true,"wifi_ap_enable":true,"wifi_sta_enable":true,"ble_filter_enable":true,"ble_schedule_enable":true})");
+    JsonDocument doc(requestAllocator());
+    DeserializationError err = parseBody(doc, payload, len, filter);
 
     if (err)
     {
@@ -111,24 +145,41 @@ static void handleFeatureUpdate(AsyncWebServerRequest *request, uint8_t *payload
     if (!doc["wifi_sta_enable"].isNull())
         cfg.wifiStaEnable = doc["wifi_sta_enable"].as<bool>();
 
-    if (!applyNetworkConfig(network, cfg))
+    // applyNetworkConfig apaga y levanta las interfaces: solo si cambio algo que las toca
+    bool netChanged = cfg.ethernetEnable != feature.ethernetEnable || cfg.wifiApEnable != feature.wifiApEnable ||
+                      cfg.wifiStaEnable != feature.wifiStaEnable;
+
+    if (netChanged)
     {
-        markNetworkApplyFailure("feature_apply_failed");
-        sendApplyResult(request, false, "No se pudo aplicar la configuracion de features");
-        return;
+        if (!applyNetworkConfig(network, cfg))
+        {
+            markNetworkApplyFailure("feature_apply_failed");
+            sendApplyResult(request, false, "No se pudo aplicar la configuracion de features");
+            return;
+        }
+        markNetworkApplySuccess();
     }
 
+    // Filtro y agenda BLE son del escaneo: se guardan y se aplican sin tocar la red
+    if (!doc["ble_filter_enable"].isNull())
+        cfg.bleFilterEnable = doc["ble_filter_enable"].as<bool>();
+
+    if (!doc["ble_schedule_enable"].isNull())
+        cfg.bleScheduleEnable = doc["ble_schedule_enable"].as<bool>();
+
     feature = cfg;
-    markNetworkApplySuccess();
     Config.saveFeatures(feature);
+    scanControl.setFilterEnabled(feature.bleFilterEnable);
+    scanControl.setScheduleEnabled(feature.bleScheduleEnable);
 
     sendApplyResult(request, true, "Configuracion de features actualizada");
 }
 
 static void handleEthernetUpdate(AsyncWebServerRequest *request, uint8_t *payload, size_t len)
 {
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, payload, len);
+    static const JsonFilter filter(R"({"net":true})");
+    JsonDocument doc(requestAllocator());
+    DeserializationError err = parseBody(doc, payload, len, filter);
 
     if (err)
     {
@@ -171,8 +222,9 @@ static void handleEthernetUpdate(AsyncWebServerRequest *request, uint8_t *payloa
 
 static void handleApUpdate(AsyncWebServerRequest *request, uint8_t *payload, size_t len)
 {
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, payload, len);
+    static const JsonFilter filter(R"({"ssid":true,"password":true,"channel":true,"hidden":true,"max_clients":true,"net":true})");
+    JsonDocument doc(requestAllocator());
+    DeserializationError err = parseBody(doc, payload, len, filter);
 
     if (err)
     {
@@ -246,8 +298,9 @@ static void handleApUpdate(AsyncWebServerRequest *request, uint8_t *payload, siz
 
 static void handleStaUpdate(AsyncWebServerRequest *request, uint8_t *payload, size_t len)
 {
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, payload, len);
+    static const JsonFilter filter(R"({"ssid":true,"password":true,"net":true})");
+    JsonDocument doc(requestAllocator());
+    DeserializationError err = parseBody(doc, payload, len, filter);
 
     if (err)
     {
@@ -300,11 +353,11 @@ static void handleStaUpdate(AsyncWebServerRequest *request, uint8_t *payload, si
     sendApplyResult(request, true, "Configuracion STA actualizada");
 }
 
-void registerHttpRoutes(AsyncWebServer &server)
+void registerHttpRoutes(ApiRouter &router)
 {
-    server.on("/api/system/status", HTTP_GET, [](AsyncWebServerRequest *request)
+    router.on("/api/system/status", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-        JsonDocument doc;
+        JsonDocument doc(requestAllocator());
         JsonObject data = createResponse(doc, true);
 
         data["ready"] = bootStatus.ready;
@@ -330,26 +383,79 @@ void registerHttpRoutes(AsyncWebServer &server)
         boot["ble_ready"] = bootStatus.bleReady;
         boot["boot_completed_ms"] = bootStatus.bootCompletedMs;
         boot["last_error"] = bootStatus.lastError;
+        boot["checkpoint_restored"] = bootStatus.checkpointRestored;
+
+        CheckpointInfo ckpt = checkpoint.info();
+        JsonObject ckptObj = data["checkpoint"].to<JsonObject>();
+        ckptObj["boot_count"] = ckpt.bootCount;
+        ckptObj["restored_from"] = ckpt.source;
+        ckptObj["restored_seq"] = ckpt.restoredSeq;
+        ckptObj["restored_uptime_ms"] = ckpt.restoredUptimeMs;
+        ckptObj["seq"] = ckpt.seq;
+        ckptObj["rtc_writes"] = ckpt.rtcWrites;
+        ckptObj["fs_writes"] = ckpt.fsWrites;
+        ckptObj["fs_errors"] = ckpt.fsErrors;
+        ckptObj["skipped"] = ckpt.skipped;
+        ckptObj["last_rtc_ms"] = ckpt.lastRtcMs;
+        ckptObj["last_fs_ms"] = ckpt.lastFsMs;
+        ckptObj["last_capture_us"] = ckpt.lastCaptureUs;
 
         JsonObject runtime = data["runtime"].to<JsonObject>();
+        runtime["pipeline"] = advertising.config().fused ? "fused" : "split";
         runtime["data_queue_ready"] = dataQ != nullptr;
         runtime["adv_task_ready"] = advTaskHandle != nullptr;
         runtime["beacon_logic_task_ready"] = beaconLogicTaskHandle != nullptr;
 
-        JsonDocument networkDoc;
-        fillNetworkStatus(networkDoc);
-        data["network"] = networkDoc.as<JsonVariantConst>();
+        fillNetworkStatus(data["network"].to<JsonObject>(), readNetworkStatus());
+
+        RadioBudgetStatus radio = radioBudget.status();
+        JsonObject radioObj = data["radio"].to<JsonObject>();
+        radioObj["priority"] = RadioBudget::priorityName(radio.priority);
+        radioObj["reason"] = radio.reason;
+        radioObj["eth_uplink"] = radio.ethUplink;
+        radioObj["decisions"] = radio.decisions;
+        radioObj["last_change_ms"] = radio.lastChangeMs;
+        radioObj["wifi_airtime_permille"] = radio.wifiAirtimePermille;
+        radioObj["ble_airtime_permille"] = radio.bleAirtimePermille;
+        radioObj["ble_loss_permille"] = radio.bleLossPermille;
+        radioObj["scan_window_cap"] = radio.scanWindowCap;
+
+        JsonObject ifaces = radioObj["ifaces"].to<JsonObject>();
+        for (uint8_t k = 0; k < NETIF_KIND_COUNT; ++k)
+        {
+            const RadioIfaceLoad &l = radio.iface[k];
+            JsonObject ifObj = ifaces[RadioBudget::ifaceName(static_cast<NetifKind>(k))].to<JsonObject>();
+            ifObj["hooked"] = l.hooked;
+            ifObj["rx_bytes_per_s"] = l.rxBytesPerSec;
+            ifObj["tx_bytes_per_s"] = l.txBytesPerSec;
+            ifObj["frames_per_s"] = l.framesPerSec;
+            ifObj["phy_rate_kbps"] = l.phyRateKbps;
+            ifObj["airtime_permille"] = l.airtimePermille;
+        }
+
+        // Esta misma respuesta todavia ocupa la arena: used muestra su tamano
+        JsonArenaStats js = jsonArena.stats();
+        JsonObject arenaObj = data["json_arena"].to<JsonObject>();
+        arenaObj["capacity"] = js.arena.capacity;
+        arenaObj["used"] = js.arena.used;
+        arenaObj["live_blocks"] = js.arena.live;
+        arenaObj["requests"] = js.arena.resets;
+        arenaObj["allocs"] = js.arena.allocs;
+        arenaObj["resized_in_place"] = js.arena.resizedInPlace;
+        arenaObj["peak_used"] = js.arena.peakUsed;
+        arenaObj["last_request_used"] = js.arena.lastUsed;
+        arenaObj["exhausted"] = js.arena.exhausted;
+        arenaObj["heap_fallbacks"] = js.heapFallbacks;
+        arenaObj["foreign_task"] = js.foreignTask;
 
         sendJson(request, 200, doc); });
 
-    server.on("/api/network/status", HTTP_GET, [](AsyncWebServerRequest *request)
+    router.on("/api/network/status", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-        JsonDocument doc;
+        JsonDocument doc(requestAllocator());
         JsonObject data = createResponse(doc, true);
 
-        JsonDocument statusDoc;
-        fillNetworkStatus(statusDoc);
-        data.set(statusDoc.as<JsonVariantConst>());
+        fillNetworkStatus(data, readNetworkStatus());
         JsonObject device = data["device"].to<JsonObject>();
         device["name"] = sys.name;
         device["version"] = sys.version;
@@ -360,24 +466,26 @@ void registerHttpRoutes(AsyncWebServer &server)
 
         sendJson(request, 200, doc); });
 
-    server.on("/api/device/info", HTTP_GET, [](AsyncWebServerRequest *request)
+    router.on("/api/device/info", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-        JsonDocument doc;
+        JsonDocument doc(requestAllocator());
         JsonObject data = createResponse(doc, true);
         data["device"] = "gateway";
         sendJson(request, 200, doc); });
 
-    server.on("/api/ble/stats", HTTP_GET, [](AsyncWebServerRequest *request)
+    router.on("/api/ble/stats", HTTP_GET, [](AsyncWebServerRequest *request)
               {
         BlePipelineStats stats = advertising.stats();
 
-        JsonDocument doc;
+        JsonDocument doc(requestAllocator());
         JsonObject data = createResponse(doc, true);
         JsonObject ble = data["ble"].to<JsonObject>();
 
         ble["adv_received"] = stats.adv_received;
         ble["adv_dropped"] = stats.adv_dropped;
         ble["adv_decrypt_fail"] = stats.adv_decrypt_fail;
+        ble["adv_unknown_version"] = stats.adv_unknown_version;
+        ble["adv_unknown_key"] = stats.adv_unknown_key;
         ble["data_enqueued"] = stats.data_enqueued;
         ble["data_dropped"] = stats.data_dropped;
         ble["data_processed"] = stats.data_processed;
@@ -390,89 +498,361 @@ void registerHttpRoutes(AsyncWebServer &server)
         ble["max_adv_depth"] = stats.max_adv_depth;
         ble["max_data_depth"] = stats.max_data_depth;
         ble["max_end_to_end_ms"] = stats.max_end_to_end_ms;
+        ble["scan_callbacks"] = stats.scan_callbacks;
+        ble["scan_cpu_us"] = stats.scan_cpu_us;
+
+        ScanControlStats scanStats = scanControl.stats();
+        JsonObject scanObj = data["scan"].to<JsonObject>();
+        scanObj["filter_enable"] = scanStats.filterEnabled;
+        scanObj["mode"] = ScanControl::modeName(scanStats.mode);
+        scanObj["accept_list_size"] = scanStats.acceptListSize;
+        scanObj["accept_list_errors"] = scanStats.acceptListErrors;
+        scanObj["discovery_windows"] = scanStats.discoveryWindows;
+
+        JsonObject loadObj = scanObj["load"].to<JsonObject>();
+        for (uint8_t m = 0; m < 3; ++m)
+        {
+            JsonObject modeObj = loadObj[ScanControl::modeName(static_cast<ScanMode>(m))].to<JsonObject>();
+            modeObj["cpu_us_per_s"] = scanStats.load[m].cpuUsPerSec;
+            modeObj["callbacks_per_s"] = scanStats.load[m].callbacksPerSec;
+            modeObj["seconds"] = scanStats.load[m].seconds;
+        }
+
+        JsonObject schedObj = scanObj["schedule"].to<JsonObject>();
+        schedObj["enable"] = scanStats.scheduleEnabled;
+        schedObj["duty"] = ScanControl::dutyName(scanStats.duty);
+        schedObj["duty_changes"] = scanStats.dutyChanges;
+        schedObj["duty_permille"] = scanStats.dutyPermille;
+        schedObj["baseline_permille"] = static_cast<uint32_t>(SCAN_WINDOW_BASE_UNITS * 1000 / SCAN_INTERVAL_UNITS);
+        schedObj["tracked_slots"] = scanStats.trackedSlots;
+        schedObj["confident_slots"] = scanStats.confidentSlots;
+        schedObj["window_units"] = scanStats.windowUnits;
+        schedObj["window_cap_units"] = scanStats.windowCapUnits;
+
+        // Tasa de captura de llegadas esperadas: ciclo fijo contra planificado
+        JsonObject fixedObj = schedObj["fixed"].to<JsonObject>();
+        fixedObj["caught"] = scanStats.catchFixed.caught;
+        fixedObj["missed"] = scanStats.catchFixed.missed;
+        JsonObject adaptObj = schedObj["adaptive"].to<JsonObject>();
+        adaptObj["caught"] = scanStats.catchAdaptive.caught;
+        adaptObj["missed"] = scanStats.catchAdaptive.missed;
 
         sendJson(request, 200, doc); });
 
-    server.on("/api/ble/stats/reset", HTTP_POST, [](AsyncWebServerRequest *request)
+    router.on("/api/ble/stats/reset", HTTP_POST, [](AsyncWebServerRequest *request)
               {
         advertising.resetStats();
         sendSuccess(request, "BLE stats reiniciadas"); });
 }
 
-void registerFeatureRoutes(AsyncWebServer &server)
+void registerFeatureRoutes(ApiRouter &router)
 {
-    server.on("/api/feature", HTTP_GET, sendFeatureConfig);
-    server.on("/api/features", HTTP_GET, sendFeatureConfig);
+    router.on("/api/feature", HTTP_GET, sendFeatureConfig);
+    router.on("/api/features", HTTP_GET, sendFeatureConfig);
 
-    server.on("/api/features", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/features", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleFeatureUpdate(request, data, len); });
 
-    server.on("/api/features", HTTP_PATCH, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/features", HTTP_PATCH, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleFeatureUpdate(request, data, len); });
 }
 
-void registerNetworkRoutes(AsyncWebServer &server)
+void registerNetworkRoutes(ApiRouter &router)
 {
     auto sendNetworkConfig = [](AsyncWebServerRequest *request)
               {
-        JsonDocument doc;
+        JsonDocument doc(requestAllocator());
         JsonObject data = createResponse(doc, true);
-        JsonDocument configDoc;
+        JsonDocument configDoc(requestAllocator());
         fillNetworkConfig(configDoc);
         data.set(configDoc.as<JsonVariantConst>());
         sendJson(request, 200, doc); 
     };
     
 
-    server.on("/api/network", HTTP_GET, sendNetworkConfig);
-    server.on("/api/network/config", HTTP_GET, sendNetworkConfig);
+    router.on("/api/network", HTTP_GET, sendNetworkConfig);
+    router.on("/api/network/config", HTTP_GET, sendNetworkConfig);
 
-    server.on("/api/network/ethernet", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/network/ethernet", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleEthernetUpdate(request, data, len); });
-    server.on("/api/network/ethernet", HTTP_PATCH, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/network/ethernet", HTTP_PATCH, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleEthernetUpdate(request, data, len); });
 
-    server.on("/api/network/ap", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/network/ap", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleApUpdate(request, data, len); });
-    server.on("/api/network/ap", HTTP_PATCH, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/network/ap", HTTP_PATCH, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleApUpdate(request, data, len); });
 
-    server.on("/api/network/sta", HTTP_POST, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/network/sta", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleStaUpdate(request, data, len); });
-    server.on("/api/network/sta", HTTP_PATCH, [](AsyncWebServerRequest *request) {}, nullptr, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/network/sta", HTTP_PATCH, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               { handleStaUpdate(request, data, len); });
 }
 
-void registerBeaconRoutes(AsyncWebServer &server)
+// Claves de las respuestas por partes
+static constexpr JsonKey JK_SUCCESS = JSON_KEY("success");
+static constexpr JsonKey JK_DATA = JSON_KEY("data");
+static constexpr JsonKey JK_MAP = JSON_KEY("map");
+static constexpr JsonKey JK_SLOTS = JSON_KEY("slots");
+static constexpr JsonKey JK_ITEMS = JSON_KEY("items");
+static constexpr JsonKey JK_INDEX = JSON_KEY("index");
+static constexpr JsonKey JK_ENABLED = JSON_KEY("enabled");
+static constexpr JsonKey JK_USED = JSON_KEY("used");
+static constexpr JsonKey JK_IS_NEW = JSON_KEY("is_new");
+static constexpr JsonKey JK_ADDR = JSON_KEY("addr");
+static constexpr JsonKey JK_SLOT = JSON_KEY("slot");
+static constexpr JsonKey JK_LAST = JSON_KEY("last");
+static constexpr JsonKey JK_FIRST_SEEN_MS = JSON_KEY("first_seen_ms");
+static constexpr JsonKey JK_LAST_SEEN_MS = JSON_KEY("last_seen_ms");
+static constexpr JsonKey JK_SEEN_COUNT = JSON_KEY("seen_count");
+static constexpr JsonKey JK_ALARM = JSON_KEY("alarm");
+static constexpr JsonKey JK_STALE = JSON_KEY("stale");
+static constexpr JsonKey JK_RESTORED_AGE_MS = JSON_KEY("restored_age_ms");
+static constexpr JsonKey JK_ENVIRONMENT_ID = JSON_KEY("environment_id");
+static constexpr JsonKey JK_DEVICE_ID = JSON_KEY("device_id");
+static constexpr JsonKey JK_RSSI = JSON_KEY("rssi");
+static constexpr JsonKey JK_MAX = JSON_KEY("max");
+static constexpr JsonKey JK_NEW_COUNT = JSON_KEY("new_count");
+
+static constexpr JsonKey JK_GEN = JSON_KEY("gen");
+static constexpr JsonKey JK_FULL = JSON_KEY("full");
+
+// Lista con generaciones: select() fija juntas las filas a emitir y la
+// generacion que les corresponde; part() recorre solo esas filas
+struct GenerationStream : public JsonStream
 {
-    server.on("/api/map", HTTP_GET, [](AsyncWebServerRequest *request)
-              {
-    JsonDocument doc;
-    JsonObject data = createResponse(doc, true);
-    JsonArray arr = data["map"].to<JsonArray>();
+    uint32_t gen = 0;
+    bool full = true;
+    uint64_t rows = 0;
+
+    virtual void select(uint32_t since) = 0;
+
+    bool listed(int i) const { return (rows & (1ULL << i)) != 0; }
+};
+
+// {"success":true,"data":{"gen":N,"full":b,"<lista>":[ ; tail cuenta los campos de data despues de la lista
+static void streamOpen(JsonWriter &w, const GenerationStream &s, uint16_t tail, const JsonKey &list)
+{
+    w.beginObject(2);
+    w.fieldBool(JK_SUCCESS, true);
+    w.beginObject(JK_DATA, 3 + tail);
+    w.fieldUint(JK_GEN, s.gen);
+    w.fieldBool(JK_FULL, s.full);
+    w.beginArray(list, static_cast<uint16_t>(__builtin_popcountll(s.rows)));
+}
+
+static void streamClose(JsonWriter &w)
+{
+    w.endObject();
+    w.endObject();
+}
+
+static void writeMapRow(JsonWriter &w, int i, const BeaconMapEntry &e)
+{
+    w.beginObject();
+    w.fieldInt(JK_INDEX, i);
+    w.fieldBool(JK_ENABLED, e.enabled);
+    w.fieldHex48(JK_ADDR, e.addr);
+    w.fieldUint(JK_SLOT, e.slot);
+    w.endObject();
+}
 
-    if (slotManager.lockMap())
+static void writeSlotRow(JsonWriter &w, int i, const SlotState &s, bool alarm)
+{
+    w.beginObject();
+    w.fieldInt(JK_INDEX, i);
+    w.fieldBool(JK_USED, s.used);
+    w.fieldHex48(JK_ADDR, s.addr);
+    w.fieldUint(JK_LAST_SEEN_MS, s.last_seen_ms);
+    w.fieldBool(JK_ALARM, alarm);
+    w.fieldBool(JK_STALE, s.restored);
+    if (s.restored)
     {
-        BeaconMapEntry *map = slotManager.getMap();
+        w.fieldUint(JK_RESTORED_AGE_MS, s.restored_age_ms);
+    }
 
-        for (int i = 0; i < MAX_SLOTS; ++i)
+    w.beginObject(JK_LAST);
+    w.fieldUint(JK_ENVIRONMENT_ID, s.last.environment_id);
+    w.fieldUint(JK_DEVICE_ID, s.last.device_id);
+    w.endObject();
+    w.endObject();
+}
+
+static void writeBeaconRow(JsonWriter &w, int i, const DiscoveredBeacon &b)
+{
+    w.beginObject();
+    w.fieldInt(JK_INDEX, i);
+    w.fieldBool(JK_USED, b.used);
+    w.fieldBool(JK_IS_NEW, b.isNew);
+    w.fieldHex48(JK_ADDR, b.addr);
+    w.fieldUint(JK_ENVIRONMENT_ID, b.environment_id);
+    w.fieldUint(JK_DEVICE_ID, b.device_id);
+    w.fieldInt(JK_RSSI, b.rssi);
+    w.fieldUint(JK_FIRST_SEEN_MS, b.first_seen_ms);
+    w.fieldUint(JK_LAST_SEEN_MS, b.last_seen_ms);
+    w.fieldUint(JK_SEEN_COUNT, b.seen_count);
+    w.fieldBool(JK_STALE, b.restored);
+    w.endObject();
+}
+
+// Cada fila se copia con el lock tomado solo para esa fila. Una fila
+// seleccionada sale siempre: en binario la cantidad ya esta en la cabecera
+struct MapJsonStream : public GenerationStream
+{
+    void select(uint32_t since) override
+    {
+        rows = slotManager.changedMap(since, full, gen);
+    }
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == 0)
         {
-            JsonObject obj = arr.add<JsonObject>();
-            obj["index"] = i;
-            obj["enabled"] = map[i].enabled;
-            obj["addr"] = uint64ToHex(map[i].addr);
-            obj["slot"] = map[i].slot;
+            streamOpen(w, *this, 0, JK_MAP);
+            return true;
+        }
+
+        if (index <= MAX_SLOTS)
+        {
+            int i = static_cast<int>(index - 1);
+            if (!listed(i)) return true;
+
+            BeaconMapEntry e{};
+            if (slotManager.lockMap())
+            {
+                e = slotManager.getMap()[i];
+                slotManager.unlockMap();
+            }
+
+            writeMapRow(w, i, e);
+            return true;
+        }
+
+        if (index == MAX_SLOTS + 1)
+        {
+            w.endArray();
+            streamClose(w);
+            return true;
+        }
+
+        return false;
+    }
+};
+
+struct SlotsJsonStream : public GenerationStream
+{
+    void select(uint32_t since) override
+    {
+        rows = slotManager.changedSlots(since, full, gen);
+    }
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == 0)
+        {
+            streamOpen(w, *this, 0, JK_SLOTS);
+            return true;
+        }
+
+        if (index <= MAX_SLOTS)
+        {
+            int i = static_cast<int>(index - 1);
+            if (!listed(i)) return true;
+
+            SlotState s{};
+            if (slotManager.lockSlots())
+            {
+                s = slotManager.getSlots()[i];
+                slotManager.unlockSlots();
+            }
+
+            writeSlotRow(w, i, s, alarmEngine.isSlotInAlarm(i));
+            return true;
+        }
+
+        if (index == MAX_SLOTS + 1)
+        {
+            w.endArray();
+            streamClose(w);
+            return true;
+        }
+
+        return false;
+    }
+};
+
+struct BeaconsJsonStream : public GenerationStream
+{
+    void select(uint32_t since) override
+    {
+        rows = beaconRegistry.changedMask(since, full, gen);
+    }
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == 0)
+        {
+            streamOpen(w, *this, 2, JK_ITEMS);
+            return true;
+        }
+
+        if (index <= MAX_DISCOVERED_BEACONS)
+        {
+            int i = static_cast<int>(index - 1);
+            if (!listed(i)) return true;
+
+            DiscoveredBeacon b;
+            beaconRegistry.get(i, b);
+
+            writeBeaconRow(w, i, b);
+            return true;
+        }
+
+        if (index == MAX_DISCOVERED_BEACONS + 1)
+        {
+            w.endArray();
+            w.fieldUint(JK_MAX, MAX_DISCOVERED_BEACONS);
+            w.fieldInt(JK_NEW_COUNT, beaconRegistry.countNew());
+            streamClose(w);
+            return true;
         }
 
-        slotManager.unlockMap();
+        return false;
+    }
+};
+
+// ?since=<gen> devuelve solo lo que cambio; If-None-Match con la misma
+// generacion responde 304 sin armar nada
+static void sendGenerationStream(AsyncWebServerRequest *request, std::shared_ptr<GenerationStream> stream)
+{
+    uint32_t since = 0;
+    stream->full = !request->hasParam("since");
+    if (!stream->full)
+    {
+        since = static_cast<uint32_t>(strtoul(request->getParam("since")->value().c_str(), nullptr, 10));
     }
 
-    sendJson(request, 200, doc); });
+    stream->select(since);
+
+    char etag[24];
+    snprintf(etag, sizeof(etag), "\"%lx.%u\"",
+             static_cast<unsigned long>(stream->gen),
+             static_cast<unsigned>(requestFormat(request)));
+
+    if (sendIfNotModified(request, etag)) return;
+    sendJsonStream(request, 200, stream, etag);
+}
+
+void registerBeaconRoutes(ApiRouter &router)
+{
+    router.on("/api/map", HTTP_GET, [](AsyncWebServerRequest *request)
+              { sendGenerationStream(request, std::make_shared<MapJsonStream>()); });
 
-    server.on("/api/map", HTTP_POST, [](AsyncWebServerRequest *request) {}, NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t, size_t)
+    router.on("/api/map", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
               {
-    JsonDocument doc;
-    DeserializationError err = deserializeJson(doc, data, len);
+    static const JsonFilter filter(R"({"index":true,"enabled":true,"addr":true,"slot":true})");
+    JsonDocument doc(requestAllocator());
+    DeserializationError err = parseBody(doc, data, len, filter);
 
     if (err)
     {
@@ -499,9 +879,72 @@ void registerBeaconRoutes(AsyncWebServer &server)
         return;
     }
 
+    scanControl.notifyMapChanged();
+
     sendSuccess(request, "Mapa actualizado"); });
 
-    server.on("/api/map", HTTP_DELETE, [](AsyncWebServerRequest *request)
+    router.on("/api/map/bulk", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+    // El lote se aplica completo o no se aplica
+    static const JsonFilter filter(R"({"entries":[{"index":true,"slot":true,"addr":true,"enabled":true}]})");
+    JsonDocument doc(requestAllocator());
+    DeserializationError err = parseBody(doc, data, len, filter);
+
+    if (err)
+    {
+        sendError(request, 400, "invalid_json");
+        return;
+    }
+
+    JsonArray entries = doc["entries"].as<JsonArray>();
+    if (entries.isNull() || entries.size() == 0 || entries.size() > MAX_SLOTS)
+    {
+        sendError(request, 400, "invalid_entries");
+        return;
+    }
+
+    MapEntryUpdate updates[MAX_SLOTS]{};
+    size_t count = 0;
+
+    for (JsonObject e : entries)
+    {
+        int idx = e["index"] | -1;
+        int slot = e["slot"] | -1;
+        String addrStr = e["addr"] | "";
+
+        if (idx < 0 || idx >= MAX_SLOTS || slot < 0 || slot >= MAX_SLOTS)
+        {
+            sendError(request, 400, "invalid_index_or_slot");
+            return;
+        }
+
+        updates[count].index = static_cast<uint8_t>(idx);
+        updates[count].slot = static_cast<uint8_t>(slot);
+        updates[count].enabled = e["enabled"] | false;
+        updates[count].addr = hexToUint64(addrStr);
+        count++;
+    }
+
+    const char *invalid = SlotManager::checkMapEntries(updates, count);
+    if (invalid != nullptr)
+    {
+        sendError(request, 400, invalid);
+        return;
+    }
+
+    if (!slotManager.applyMapEntries(updates, count))
+    {
+        sendError(request, 500, "save_failed");
+        return;
+    }
+
+    scanControl.notifyMapChanged();
+
+    JsonDocument res(requestAllocator());
+    res["applied"] = count;
+    sendData(request, 200, res, "Mapa actualizado"); });
+
+    router.on("/api/map", HTTP_DELETE, [](AsyncWebServerRequest *request)
               {
     if (!slotManager.clearMap())
     {
@@ -509,68 +952,1645 @@ void registerBeaconRoutes(AsyncWebServer &server)
         return;
     }
 
+    scanControl.notifyMapChanged();
+
     sendSuccess(request, "Mapa limpiado"); });
 
-    server.on("/api/slots", HTTP_GET, [](AsyncWebServerRequest *request)
-              {
-    JsonDocument doc;
-    JsonObject data = createResponse(doc, true);
-    JsonArray arr = data["slots"].to<JsonArray>();
+    router.on("/api/slots", HTTP_GET, [](AsyncWebServerRequest *request)
+              { sendGenerationStream(request, std::make_shared<SlotsJsonStream>()); });
+
+    router.on("/api/beacons", HTTP_GET, [](AsyncWebServerRequest *request)
+              { sendGenerationStream(request, std::make_shared<BeaconsJsonStream>()); });
+}
+
+static constexpr JsonKey JK_SYSTEM = JSON_KEY("system");
+static constexpr JsonKey JK_READY = JSON_KEY("ready");
+static constexpr JsonKey JK_HEALTH = JSON_KEY("health");
+static constexpr JsonKey JK_UPTIME_MS = JSON_KEY("uptime_ms");
+static constexpr JsonKey JK_HEAP_FREE = JSON_KEY("heap_free");
+static constexpr JsonKey JK_HEAP_MIN_FREE = JSON_KEY("heap_min_free");
+static constexpr JsonKey JK_LAST_ERROR = JSON_KEY("last_error");
+static constexpr JsonKey JK_CHECKPOINT_RESTORED = JSON_KEY("checkpoint_restored");
+static constexpr JsonKey JK_DEVICE = JSON_KEY("device");
+static constexpr JsonKey JK_NAME = JSON_KEY("name");
+static constexpr JsonKey JK_VERSION = JSON_KEY("version");
+static constexpr JsonKey JK_AMBIENTE = JSON_KEY("ambiente");
+static constexpr JsonKey JK_FIRST_LAUNCH = JSON_KEY("first_launch");
+static constexpr JsonKey JK_NETWORK = JSON_KEY("network");
+static constexpr JsonKey JK_WIFI = JSON_KEY("wifi");
+static constexpr JsonKey JK_MODE = JSON_KEY("mode");
+static constexpr JsonKey JK_STA_STATUS = JSON_KEY("sta_status");
+static constexpr JsonKey JK_STA_CONNECTED = JSON_KEY("sta_connected");
+static constexpr JsonKey JK_STA_IP = JSON_KEY("sta_ip");
+static constexpr JsonKey JK_AP_IP = JSON_KEY("ap_ip");
+static constexpr JsonKey JK_AP_CLIENTS = JSON_KEY("ap_clients");
+static constexpr JsonKey JK_ETHERNET = JSON_KEY("ethernet");
+static constexpr JsonKey JK_IP = JSON_KEY("ip");
+static constexpr JsonKey JK_LINK_UP = JSON_KEY("link_up");
+static constexpr JsonKey JK_FEATURES = JSON_KEY("features");
+static constexpr JsonKey JK_ETHERNET_ENABLE = JSON_KEY("ethernet_enable");
+static constexpr JsonKey JK_WIFI_AP_ENABLE = JSON_KEY("wifi_ap_enable");
+static constexpr JsonKey JK_WIFI_STA_ENABLE = JSON_KEY("wifi_sta_enable");
+static constexpr JsonKey JK_BLE_FILTER_ENABLE = JSON_KEY("ble_filter_enable");
+static constexpr JsonKey JK_BLE_SCHEDULE_ENABLE = JSON_KEY("ble_schedule_enable");
+static constexpr JsonKey JK_BEACONS = JSON_KEY("beacons");
+
+static void writeIp(JsonWriter &w, const JsonKey &k, const IPAddress &ip)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+    w.fieldStr(k, text);
+}
 
-    if (slotManager.lockSlots())
+// Primera carga del dashboard: estado, red, features y las tres listas con
+// sus generaciones en una sola respuesta. Todo se copia al abrir el pedido
+// y cada lista con un solo lock. La generacion se lee antes que los datos:
+// lo copiado es igual o mas nuevo, asi un ?since=gen posterior no pierde
+// ningun cambio (a lo sumo repite alguno)
+struct BootstrapJsonStream : public JsonStream
+{
+    static constexpr uint32_t P_SYSTEM = 0;
+    static constexpr uint32_t P_DEVICE = 1;
+    static constexpr uint32_t P_NETWORK = 2;
+    static constexpr uint32_t P_FEATURES = 3;
+    static constexpr uint32_t P_MAP_OPEN = 4;
+    static constexpr uint32_t P_SLOTS_OPEN = P_MAP_OPEN + 1 + MAX_SLOTS;
+    static constexpr uint32_t P_BEACONS_OPEN = P_SLOTS_OPEN + 1 + MAX_SLOTS;
+    static constexpr uint32_t P_CLOSE = P_BEACONS_OPEN + 1 + MAX_DISCOVERED_BEACONS;
+
+    bool ready = false;
+    bool checkpointRestored = false;
+    uint32_t uptimeMs = 0;
+    uint32_t heapFree = 0;
+    uint32_t heapMinFree = 0;
+    String lastError;
+    String deviceName;
+    uint16_t version = 0;
+    uint16_t ambiente = 0;
+    bool firstLaunch = false;
+    NetworkStatus net{};
+
+    uint32_t mapGen = 0;
+    uint32_t slotsGen = 0;
+    uint32_t beaconsGen = 0;
+    uint32_t mapRows = 0;
+    uint32_t slotRows = 0;
+    uint64_t beaconRows = 0;
+    uint32_t alarmMask = 0;
+    int newCount = 0;
+
+    BeaconMapEntry map[MAX_SLOTS]{};
+    SlotState slots[MAX_SLOTS]{};
+    DiscoveredBeacon beacons[MAX_DISCOVERED_BEACONS];
+
+    void capture()
     {
-        SlotState *slots = slotManager.getSlots();
+        ready = bootStatus.ready;
+        checkpointRestored = bootStatus.checkpointRestored;
+        uptimeMs = millis();
+        heapFree = ESP.getFreeHeap();
+        heapMinFree = ESP.getMinFreeHeap();
+        lastError = bootStatus.lastError;
+        deviceName = sys.name;
+        version = sys.version;
+        ambiente = sys.ambiente;
+        firstLaunch = sys.firstLaunch;
+        net = readNetworkStatus();
+
+        bool full = true;
+        mapRows = slotManager.changedMap(0, full, mapGen);
+        if (slotManager.lockMap())
+        {
+            memcpy(map, slotManager.getMap(), sizeof(map));
+            slotManager.unlockMap();
+        }
 
+        full = true;
+        slotRows = slotManager.changedSlots(0, full, slotsGen);
+        if (slotManager.lockSlots())
+        {
+            memcpy(slots, slotManager.getSlots(), sizeof(slots));
+            slotManager.unlockSlots();
+        }
         for (int i = 0; i < MAX_SLOTS; ++i)
         {
-            JsonObject obj = arr.add<JsonObject>();
-            obj["index"] = i;
-            obj["used"] = slots[i].used;
-            obj["addr"] = obj["addr"] = addrToHex(slots[i].addr);;
-            obj["last_seen_ms"] = slots[i].last_seen_ms;
+            if (alarmEngine.isSlotInAlarm(i)) alarmMask |= 1UL << i;
+        }
+
+        full = true;
+        beaconRows = beaconRegistry.changedMask(0, full, beaconsGen);
+        beaconRegistry.snapshot(beacons, MAX_DISCOVERED_BEACONS);
+        newCount = beaconRegistry.countNew();
+    }
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == P_SYSTEM)
+        {
+            w.beginObject(2);
+            w.fieldBool(JK_SUCCESS, true);
+            w.beginObject(JK_DATA, 8);
+
+            w.beginObject(JK_SYSTEM, 7);
+            w.fieldBool(JK_READY, ready);
+            w.fieldStr(JK_HEALTH, ready ? "ok" : "degraded");
+            w.fieldUint(JK_UPTIME_MS, uptimeMs);
+            w.fieldUint(JK_HEAP_FREE, heapFree);
+            w.fieldUint(JK_HEAP_MIN_FREE, heapMinFree);
+            w.fieldStr(JK_LAST_ERROR, lastError.c_str());
+            w.fieldBool(JK_CHECKPOINT_RESTORED, checkpointRestored);
+            w.endObject();
+            return true;
+        }
+
+        if (index == P_DEVICE)
+        {
+            w.beginObject(JK_DEVICE, 4);
+            w.fieldStr(JK_NAME, deviceName.c_str());
+            w.fieldUint(JK_VERSION, version);
+            w.fieldUint(JK_AMBIENTE, ambiente);
+            w.fieldBool(JK_FIRST_LAUNCH, firstLaunch);
+            w.endObject();
+            return true;
+        }
+
+        if (index == P_NETWORK)
+        {
+            w.beginObject(JK_NETWORK, 2);
+            w.beginObject(JK_WIFI, 6);
+            w.fieldInt(JK_MODE, net.wifiMode);
+            w.fieldInt(JK_STA_STATUS, net.staStatus);
+            w.fieldBool(JK_STA_CONNECTED, net.staConnected);
+            writeIp(w, JK_STA_IP, net.staIp);
+            writeIp(w, JK_AP_IP, net.apIp);
+            w.fieldUint(JK_AP_CLIENTS, net.apClients);
+            w.endObject();
+
+            w.beginObject(JK_ETHERNET, 3);
+            w.fieldBool(JK_ENABLED, net.features.ethernetEnable);
+            writeIp(w, JK_IP, net.ethIp);
+            w.fieldBool(JK_LINK_UP, net.ethLinkUp);
+            w.endObject();
+            w.endObject();
+            return true;
+        }
+
+        if (index == P_FEATURES)
+        {
+            w.beginObject(JK_FEATURES, 5);
+            w.fieldBool(JK_ETHERNET_ENABLE, net.features.ethernetEnable);
+            w.fieldBool(JK_WIFI_AP_ENABLE, net.features.wifiApEnable);
+            w.fieldBool(JK_WIFI_STA_ENABLE, net.features.wifiStaEnable);
+            w.fieldBool(JK_BLE_FILTER_ENABLE, net.features.bleFilterEnable);
+            w.fieldBool(JK_BLE_SCHEDULE_ENABLE, net.features.bleScheduleEnable);
+            w.endObject();
+            return true;
+        }
+
+        if (index == P_MAP_OPEN)
+        {
+            w.beginObject(JK_GEN, 3);
+            w.fieldUint(JK_MAP, mapGen);
+            w.fieldUint(JK_SLOTS, slotsGen);
+            w.fieldUint(JK_BEACONS, beaconsGen);
+            w.endObject();
+            w.beginArray(JK_MAP, static_cast<uint16_t>(__builtin_popcount(mapRows)));
+            return true;
+        }
+
+        if (index < P_SLOTS_OPEN)
+        {
+            int i = static_cast<int>(index - P_MAP_OPEN - 1);
+            if (mapRows & (1UL << i)) writeMapRow(w, i, map[i]);
+            return true;
+        }
+
+        if (index == P_SLOTS_OPEN)
+        {
+            w.endArray();
+            w.beginArray(JK_SLOTS, static_cast<uint16_t>(__builtin_popcount(slotRows)));
+            return true;
+        }
+
+        if (index < P_BEACONS_OPEN)
+        {
+            int i = static_cast<int>(index - P_SLOTS_OPEN - 1);
+            if (slotRows & (1UL << i)) writeSlotRow(w, i, slots[i], (alarmMask & (1UL << i)) != 0);
+            return true;
+        }
+
+        if (index == P_BEACONS_OPEN)
+        {
+            w.endArray();
+            w.beginObject(JK_BEACONS, 3);
+            w.beginArray(JK_ITEMS, static_cast<uint16_t>(__builtin_popcountll(beaconRows)));
+            return true;
+        }
+
+        if (index < P_CLOSE)
+        {
+            int i = static_cast<int>(index - P_BEACONS_OPEN - 1);
+            if (beaconRows & (1ULL << i)) writeBeaconRow(w, i, beacons[i]);
+            return true;
+        }
 
-            JsonObject last = obj["last"].to<JsonObject>();
-            last["environment_id"] = slots[i].last.environment_id;
-            last["device_id"] = slots[i].last.device_id;
+        if (index == P_CLOSE)
+        {
+            w.endArray();
+            w.fieldUint(JK_MAX, MAX_DISCOVERED_BEACONS);
+            w.fieldInt(JK_NEW_COUNT, newCount);
+            w.endObject();
+            streamClose(w);
+            return true;
         }
 
-        slotManager.unlockSlots();
+        return false;
+    }
+};
+
+void registerBootstrapRoutes(ApiRouter &router)
+{
+    router.on("/api/bootstrap", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        std::shared_ptr<BootstrapJsonStream> stream = std::make_shared<BootstrapJsonStream>();
+        stream->capture();
+        sendJsonStream(request, 200, stream); });
+}
+
+// Cuerpo de una respuesta real para medir el compresor
+static std::shared_ptr<JsonStream> gzipBenchSource(const String &name)
+{
+    if (name == "bootstrap")
+    {
+        std::shared_ptr<BootstrapJsonStream> stream = std::make_shared<BootstrapJsonStream>();
+        stream->capture();
+        return stream;
     }
 
-    sendJson(request, 200, doc); });
+    std::shared_ptr<GenerationStream> stream;
+    if (name == "slots")
+        stream = std::make_shared<SlotsJsonStream>();
+    else if (name == "beacons")
+        stream = std::make_shared<BeaconsJsonStream>();
+    else if (name == "map")
+        stream = std::make_shared<MapJsonStream>();
+    else
+        return nullptr;
+
+    stream->full = true;
+    stream->select(0);
+    return stream;
+}
 
-    server.on("/api/beacons", HTTP_GET, [](AsyncWebServerRequest *request)
+struct GzipBenchCase
+{
+    uint8_t windowBits;
+    uint8_t hashBits;
+    uint16_t maxChain;
+};
+
+static const GzipBenchCase GZIP_BENCH_CASES[] = {
+    {12, 12, 0},
+    {12, 12, 4},
+    {12, 12, 16},
+    {12, 12, 64},
+    {10, 10, 16},
+    {14, 14, 16},
+};
+
+void registerGzipRoutes(ApiRouter &router)
+{
+    router.on("/api/gzip", HTTP_GET, [](AsyncWebServerRequest *request)
               {
-        JsonDocument doc;
+        GzipPoolStats gs = gzipPool.stats();
+
+        JsonDocument doc(requestAllocator());
         JsonObject data = createResponse(doc, true);
-        JsonArray arr = data["items"].to<JsonArray>();
-        DiscoveredBeacon snapshot[MAX_DISCOVERED_BEACONS]{};
 
-        if (!beaconRegistry.snapshot(snapshot, MAX_DISCOVERED_BEACONS))
+        JsonObject cfg = data["config"].to<JsonObject>();
+        cfg["window_bits"] = GZIP_WINDOW_BITS;
+        cfg["hash_bits"] = GZIP_HASH_BITS;
+        cfg["max_chain"] = GZIP_MAX_CHAIN;
+        cfg["min_bytes"] = GZIP_MIN_BYTES;
+        cfg["slots"] = gs.slots;
+        cfg["slot_bytes"] = gs.slotBytes;
+
+        data["in_use"] = gs.inUse;
+        data["peak_in_use"] = gs.peakInUse;
+        data["compressed"] = gs.compressed;
+        data["skipped_small"] = gs.skippedSmall;
+        data["skipped_busy"] = gs.skippedBusy;
+        data["raw_bytes"] = gs.rawBytes;
+        data["gzip_bytes"] = gs.gzipBytes;
+        data["ratio_permille"] = gs.rawBytes > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(gs.gzipBytes) * 1000ULL / gs.rawBytes) : 0;
+        data["cpu_us"] = gs.cpuUs;
+        data["us_per_kb"] = gs.rawBytes > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(gs.cpuUs) * 1024ULL / gs.rawBytes) : 0;
+
+        sendJson(request, 200, doc); });
+
+    // Comprime el cuerpo de ?source=slots|beacons|map|bootstrap con varias
+    // configuraciones. Corre en la tarea de AsyncTCP: la red espera mientras mide
+    router.on("/api/gzip/bench", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+        String name = request->hasParam("source") ? request->getParam("source")->value() : String("slots");
+        std::shared_ptr<JsonStream> stream = gzipBenchSource(name);
+        if (!stream)
+        {
+            sendError(request, 400, "invalid_source");
+            return;
+        }
+
+        GzipConfig big;
+        big.windowBits = 14;
+        big.hashBits = 14;
+        big.outBytes = GZIP_OUT_BYTES;
+        size_t workBytes = GzipStream::workBytes(big);
+
+        std::unique_ptr<uint8_t, void (*)(void *)> raw(static_cast<uint8_t *>(ps_malloc(GZIP_BENCH_BYTES)), free);
+        std::unique_ptr<uint8_t, void (*)(void *)> work(static_cast<uint8_t *>(ps_malloc(workBytes)), free);
+        if (!raw || !work)
         {
-            sendError(request, 500, "beacon_snapshot_failed");
+            sendError(request, 503, "no_memory");
             return;
         }
 
-        for (int i = 0; i < MAX_DISCOVERED_BEACONS; ++i)
+        stream->setFormat(WireFormat::JSON);
+        uint32_t start = micros();
+        size_t rawLen = 0;
+        while (rawLen < GZIP_BENCH_BYTES)
         {
-            if (!snapshot[i].used) continue;
+            size_t n = stream->fill(raw.get() + rawLen, GZIP_BENCH_BYTES - rawLen);
+            if (n == 0) break;
+            rawLen += n;
+        }
+        uint32_t renderUs = micros() - start;
 
-            JsonObject obj = arr.add<JsonObject>();
-            obj["index"] = i;
-            obj["used"] = snapshot[i].used;
-            obj["is_new"] = snapshot[i].isNew;
-            obj["addr"] = addrToHex(snapshot[i].addr);
-            obj["environment_id"] = snapshot[i].environment_id;
-            obj["device_id"] = snapshot[i].device_id;
-            obj["rssi"] = snapshot[i].rssi;
-            obj["first_seen_ms"] = snapshot[i].first_seen_ms;
-            obj["last_seen_ms"] = snapshot[i].last_seen_ms;
-            obj["seen_count"] = snapshot[i].seen_count;
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["source"] = name;
+        data["raw_bytes"] = rawLen;
+        data["truncated"] = rawLen == GZIP_BENCH_BYTES;
+        data["render_us"] = renderUs;
+
+        JsonArray runs = data["runs"].to<JsonArray>();
+        for (const GzipBenchCase &c : GZIP_BENCH_CASES)
+        {
+            GzipConfig cfg;
+            cfg.windowBits = c.windowBits;
+            cfg.hashBits = c.hashBits;
+            cfg.maxChain = c.maxChain;
+            cfg.outBytes = GZIP_OUT_BYTES;
+
+            GzipStream gz;
+            if (!gz.begin(work.get(), workBytes, cfg)) continue;
+
+            // Entrada en trozos de un segmento TCP, como llega desde sendChunked
+            uint8_t out[256];
+            size_t pos = 0;
+            start = micros();
+            while (pos < rawLen)
+            {
+                size_t n = rawLen - pos;
+                if (n > 1436) n = 1436;
+                pos += gz.write(raw.get() + pos, n);
+                while (gz.pending() > 0) gz.read(out, sizeof(out));
+            }
+            while (!gz.done())
+            {
+                gz.finish();
+                gz.read(out, sizeof(out));
+            }
+            uint32_t us = micros() - start;
+
+            const GzipStats &st = gz.stats();
+            JsonObject run = runs.add<JsonObject>();
+            run["window_bits"] = c.windowBits;
+            run["hash_bits"] = c.hashBits;
+            run["max_chain"] = c.maxChain;
+            run["gzip_bytes"] = st.outBytes;
+            run["ratio_permille"] = rawLen > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(st.outBytes) * 1000ULL / rawLen) : 0;
+            run["matches"] = st.matches;
+            run["literals"] = st.literals;
+            run["us"] = us;
+            run["us_per_kb"] = rawLen > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(us) * 1024ULL / rawLen) : 0;
+        }
+
+        sendJson(request, 200, doc); });
+}
+
+static const char *methodName(WebRequestMethodComposite method)
+{
+    switch (method)
+    {
+    case HTTP_GET:
+        return "GET";
+    case HTTP_POST:
+        return "POST";
+    case HTTP_DELETE:
+        return "DELETE";
+    case HTTP_PUT:
+        return "PUT";
+    case HTTP_PATCH:
+        return "PATCH";
+    default:
+        return "OTHER";
+    }
+}
+
+void registerRouterRoutes(ApiRouter &router)
+{
+    router.on("/api/router", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        ApiRouterStats rs = apiRouter.stats();
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["buckets"] = API_ROUTE_BUCKETS;
+        data["routes"] = rs.routes;
+        data["unbound"] = rs.unbound;
+        data["not_found"] = rs.notFound;
+        data["method_not_allowed"] = rs.methodNotAllowed;
+        data["missing_body"] = rs.missingBody;
+        data["body_assembled"] = rs.assembled;
+        data["body_too_large"] = rs.tooLarge;
+        data["body_no_memory"] = rs.noMemory;
+        data["body_aborted"] = rs.aborted;
+        data["body_pending"] = rs.pending;
+
+        // Tiempo dentro del handler; una respuesta por partes termina despues
+        JsonArray list = data["table"].to<JsonArray>();
+        for (size_t i = 0; i < API_ROUTE_COUNT; ++i)
+        {
+            const ApiRouteStats &st = apiRouter.routeStats(i);
+            JsonObject row = list.add<JsonObject>();
+            row["method"] = methodName(API_ROUTES[i].method);
+            row["path"] = API_ROUTES[i].path;
+            row["hits"] = st.hits;
+            row["avg_us"] = st.hits > 0 ? st.totalUs / st.hits : 0;
+            row["max_us"] = st.maxUs;
         }
 
-        data["max"] = MAX_DISCOVERED_BEACONS;
-        data["new_count"] = beaconRegistry.countNew();
+        sendJson(request, 200, doc); });
+}
+
+void registerAlarmRoutes(ApiRouter &router)
+{
+    router.on("/api/alarms", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        static AlarmStatusEntry entries[MAX_SLOTS * ALARM_MAX_RULES_PER_SLOT];
+        size_t count = alarmEngine.snapshot(entries, MAX_SLOTS * ALARM_MAX_RULES_PER_SLOT);
+        uint32_t now = millis();
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["active_count"] = alarmEngine.activeCount();
+        JsonArray arr = data["alarms"].to<JsonArray>();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const AlarmStatusEntry &e = entries[i];
+            if (!e.state.active && !e.state.pending) continue;
+
+            JsonObject obj = arr.add<JsonObject>();
+            obj["slot"] = e.slot;
+            obj["rule_id"] = e.rule.id;
+            obj["type"] = AlarmEngine::opName(e.rule.op);
+            obj["active"] = e.state.active;
+            obj["pending"] = e.state.pending;
+            obj["since_ms"] = e.state.active ? e.state.activeSinceMs : e.state.pendingSinceMs;
+            obj["age_ms"] = now - (e.state.active ? e.state.activeSinceMs : e.state.pendingSinceMs);
+            obj["value_x100"] = e.state.lastValueX100;
+        }
 
         sendJson(request, 200, doc); });
-}  
+
+    router.on("/api/alarms/rules", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        JsonDocument rulesDoc(requestAllocator());
+        alarmEngine.readRules(rulesDoc);
+        sendData(request, 200, rulesDoc); });
+
+    router.on("/api/alarms/rules", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"rules":[{"id":true,"slot":true,"type":true,"delay_s":true,"flag":true,"value_x100":true,"hyst_x100":true}]})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        String error;
+        if (!alarmEngine.saveRules(doc, error))
+        {
+            sendError(request, 400, error);
+            return;
+        }
+
+        slotManager.touchSlots();
+        sendSuccess(request, "Reglas de alarma actualizadas"); });
+}
+
+static constexpr JsonKey JK_GENERATION = JSON_KEY("generation");
+static constexpr JsonKey JK_ZONES = JSON_KEY("zones");
+static constexpr JsonKey JK_MEMBERS = JSON_KEY("members");
+static constexpr JsonKey JK_ONLINE = JSON_KEY("online");
+static constexpr JsonKey JK_OFFLINE = JSON_KEY("offline");
+static constexpr JsonKey JK_COUNT = JSON_KEY("count");
+static constexpr JsonKey JK_MIN_X100 = JSON_KEY("min_x100");
+static constexpr JsonKey JK_MAX_X100 = JSON_KEY("max_x100");
+static constexpr JsonKey JK_MEAN_X100 = JSON_KEY("mean_x100");
+
+// Agregados copiados de una vez con su generacion; una parte por zona
+struct ZonesJsonStream : public JsonStream
+{
+    ZoneSummary zones[MAX_ZONES];
+    size_t count = 0;
+    uint32_t generation = 0;
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == 0)
+        {
+            w.beginObject(2);
+            w.fieldBool(JK_SUCCESS, true);
+            w.beginObject(JK_DATA, 2);
+            w.fieldUint(JK_GENERATION, generation);
+            w.beginArray(JK_ZONES, static_cast<uint16_t>(count));
+            return true;
+        }
+
+        if (index <= count)
+        {
+            uint32_t zi = index - 1;
+            const ZoneSummary &z = zones[zi];
+
+            w.beginObject(10);
+            w.fieldUint(JK_INDEX, zi);
+            w.fieldStr(JK_NAME, z.name);
+            w.beginArray(JK_MEMBERS, static_cast<uint16_t>(__builtin_popcount(z.members)));
+            for (int slot = 0; slot < MAX_SLOTS; ++slot)
+            {
+                if (z.members & (1UL << slot)) w.valueInt(slot);
+            }
+            w.endArray();
+            w.fieldUint(JK_ONLINE, z.onlineCount);
+            w.fieldUint(JK_OFFLINE, z.offlineCount);
+            w.fieldUint(JK_ALARM, z.alarmCount);
+            w.fieldUint(JK_COUNT, z.valueCount);
+            if (z.valueCount > 0)
+            {
+                w.fieldInt(JK_MIN_X100, z.minX100);
+                w.fieldInt(JK_MAX_X100, z.maxX100);
+                w.fieldInt(JK_MEAN_X100, z.meanX100);
+            }
+            else
+            {
+                w.key(JK_MIN_X100);
+                w.valueNull();
+                w.key(JK_MAX_X100);
+                w.valueNull();
+                w.key(JK_MEAN_X100);
+                w.valueNull();
+            }
+            w.endObject();
+            return true;
+        }
+
+        if (index == count + 1)
+        {
+            w.endArray();
+            streamClose(w);
+            return true;
+        }
+
+        return false;
+    }
+};
+
+void registerZoneRoutes(ApiRouter &router)
+{
+    router.on("/api/zones", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        std::shared_ptr<ZonesJsonStream> stream = std::make_shared<ZonesJsonStream>();
+        stream->count = zoneAggregator.snapshot(stream->zones, MAX_ZONES, millis(), &stream->generation);
+
+        // Misma generacion y mismo formato: el cliente ya tiene la respuesta
+        char etag[24];
+        snprintf(etag, sizeof(etag), "\"%lx.%u\"",
+                 static_cast<unsigned long>(stream->generation),
+                 static_cast<unsigned>(requestFormat(request)));
+
+        if (sendIfNotModified(request, etag)) return;
+        sendJsonStream(request, 200, stream, etag); });
+
+    router.on("/api/zones/config", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        JsonDocument zonesDoc(requestAllocator());
+        zoneAggregator.readZones(zonesDoc);
+        sendData(request, 200, zonesDoc); });
+
+    router.on("/api/zones/config", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"zones":[{"name":true,"slots":true}]})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        String error;
+        if (!zoneAggregator.saveZones(doc, error))
+        {
+            sendError(request, 400, error);
+            return;
+        }
+
+        sendSuccess(request, "Zonas actualizadas"); });
+}
+
+
+// Cursor de historial de una respuesta: sobrevive entre llamadas al filler
+struct HistorySource
+{
+    static constexpr size_t BATCH = 16;
+
+    bool archive = false;
+    HistoryCursor ring;
+    HistoryLogCursor log;
+    uint8_t slot = 0;
+    uint64_t fromTs = 0;
+    uint64_t toTs = 0;
+    uint32_t stepMs = 0;
+
+    HistorySample batch[BATCH];
+    size_t batchCount = 0;
+    size_t batchPos = 0;
+
+    bool done() const { return archive ? log.done : ring.done; }
+    uint32_t skipped() const { return archive ? log.lostSegments : ring.skipped; }
+};
+
+enum class HistoryNext : uint8_t
+{
+    READY,
+    STALLED,
+    END
+};
+
+static size_t refillHistory(HistorySource &s)
+{
+    if (s.archive)
+    {
+        return historyStore.read(s.log, s.batch, HistorySource::BATCH);
+    }
+
+    HistoryRecord recs[HistorySource::BATCH];
+    size_t n = slotHistory.read(s.ring, recs, HistorySource::BATCH);
+    for (size_t i = 0; i < n; ++i)
+    {
+        s.batch[i].tsMs = recs[i].ts_ms;
+        s.batch[i].tmpX100 = recs[i].tmp_x100;
+        s.batch[i].cpuX100 = recs[i].cpu_x100;
+        s.batch[i].batPct = recs[i].bat_pct;
+        s.batch[i].flags = recs[i].flags;
+        s.batch[i].rssi = recs[i].rssi;
+    }
+    return n;
+}
+
+// Deja la siguiente muestra en batch[batchPos] sin consumirla
+static HistoryNext peekHistory(HistorySource &s)
+{
+    // Un cursor puede devolver 0 sin terminar (presupuesto de recorrido o log ocupado)
+    for (int attempt = 0; s.batchPos >= s.batchCount && !s.done(); ++attempt)
+    {
+        if (attempt == 8) return HistoryNext::STALLED;
+        s.batchCount = refillHistory(s);
+        s.batchPos = 0;
+    }
+
+    return s.batchPos < s.batchCount ? HistoryNext::READY : HistoryNext::END;
+}
+
+// msgpack y cbor necesitan la cantidad antes de la lista: se recorre una
+// copia del cursor. false si el cursor no avanza (log ocupado)
+static bool countHistory(const HistorySource &s, uint32_t &total)
+{
+    std::unique_ptr<HistorySource> c(new (std::nothrow) HistorySource(s));
+    if (!c) return false;
+
+    total = 0;
+    int idle = 0;
+    while (!c->done() && total < JSON_UNSIZED)
+    {
+        size_t n = refillHistory(*c);
+        if (n > 0)
+        {
+            total += n;
+            idle = 0;
+        }
+        else if (++idle == 8)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+struct HistoryCsvStream : public HistorySource
+{
+    char line[64];
+    size_t lineLen = 0;
+    size_t linePos = 0;
+    bool headerDone = false;
+};
+
+// Prepara la siguiente linea del CSV
+static HistoryNext nextHistoryLine(HistoryCsvStream &s)
+{
+    s.lineLen = 0;
+    s.linePos = 0;
+
+    if (!s.headerDone)
+    {
+        s.headerDone = true;
+        s.lineLen = snprintf(s.line, sizeof(s.line), "ts_ms,tmp_x100,cpu_x100,bat_pct,flags,rssi\n");
+        return HistoryNext::READY;
+    }
+
+    HistoryNext next = peekHistory(s);
+    if (next != HistoryNext::READY) return next;
+
+    const HistorySample &r = s.batch[s.batchPos++];
+    s.lineLen = snprintf(s.line, sizeof(s.line), "%llu,%d,%d,%d,%u,%d\n",
+                         static_cast<unsigned long long>(r.tsMs), r.tmpX100, r.cpuX100, r.batPct, r.flags, r.rssi);
+    return HistoryNext::READY;
+}
+
+static constexpr JsonKey JK_SOURCE = JSON_KEY("source");
+static constexpr JsonKey JK_FROM = JSON_KEY("from");
+static constexpr JsonKey JK_TO = JSON_KEY("to");
+static constexpr JsonKey JK_STEP = JSON_KEY("step");
+static constexpr JsonKey JK_RECORDS = JSON_KEY("records");
+static constexpr JsonKey JK_SKIPPED = JSON_KEY("skipped");
+static constexpr JsonKey JK_TS_MS = JSON_KEY("ts_ms");
+static constexpr JsonKey JK_TMP_X100 = JSON_KEY("tmp_x100");
+static constexpr JsonKey JK_CPU_X100 = JSON_KEY("cpu_x100");
+static constexpr JsonKey JK_BAT_PCT = JSON_KEY("bat_pct");
+static constexpr JsonKey JK_FLAGS = JSON_KEY("flags");
+
+// Una parte por muestra. La muestra se consume recien cuando se pide la
+// parte siguiente: una parte que desborda se vuelve a pedir con el mismo
+// indice y tiene que salir igual. En binario total viene de countHistory;
+// si el anillo pisa muestras en el medio, la lista se completa con null
+struct HistoryJsonStream : public JsonStream
+{
+    HistorySource src;
+    uint16_t total = JSON_UNSIZED;
+    uint32_t records = 0;
+    uint32_t current = 0;
+    bool holding = false;
+    bool holdingSample = false;
+    bool closed = false;
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == 0)
+        {
+            w.beginObject(2);
+            w.fieldBool(JK_SUCCESS, true);
+            w.beginObject(JK_DATA, 7);
+            w.fieldStr(JK_SOURCE, src.archive ? "flash" : "ram");
+            w.fieldUint(JK_SLOT, src.slot);
+            w.fieldU64(JK_FROM, src.fromTs);
+            w.fieldU64(JK_TO, src.toTs);
+            w.fieldUint(JK_STEP, src.stepMs);
+            w.beginArray(JK_RECORDS, total);
+            return true;
+        }
+
+        if (index != current)
+        {
+            if (closed) return false;
+            if (holding) records++;
+            if (holdingSample) src.batchPos++;
+            holding = false;
+            holdingSample = false;
+            current = index;
+        }
+
+        bool sized = total != JSON_UNSIZED;
+        HistoryNext next = !sized || records < total ? peekHistory(src) : HistoryNext::END;
+        if (next == HistoryNext::STALLED)
+        {
+            retry();
+            return true;
+        }
+
+        if (next == HistoryNext::READY)
+        {
+            const HistorySample &r = src.batch[src.batchPos];
+            w.beginObject(6);
+            w.fieldU64(JK_TS_MS, r.tsMs);
+            w.fieldInt(JK_TMP_X100, r.tmpX100);
+            w.fieldInt(JK_CPU_X100, r.cpuX100);
+            w.fieldInt(JK_BAT_PCT, r.batPct);
+            w.fieldUint(JK_FLAGS, r.flags);
+            w.fieldInt(JK_RSSI, r.rssi);
+            w.endObject();
+            holding = true;
+            holdingSample = true;
+            return true;
+        }
+
+        if (sized && records < total)
+        {
+            w.valueNull();
+            holding = true;
+            return true;
+        }
+
+        w.endArray();
+        w.fieldUint(JK_SKIPPED, src.skipped());
+        streamClose(w);
+        closed = true;
+        return true;
+    }
+};
+
+static uint64_t historyParam(AsyncWebServerRequest *request, const char *name, uint64_t def)
+{
+    if (!request->hasParam(name)) return def;
+    return strtoull(request->getParam(name)->value().c_str(), nullptr, 10);
+}
+
+void registerHistoryRoutes(ApiRouter &router)
+{
+    router.on("/api/history", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        if (!request->hasParam("slot"))
+        {
+            sendError(request, 400, "missing_slot");
+            return;
+        }
+
+        String format = request->hasParam("format") ? request->getParam("format")->value() : String("json");
+        String source = request->hasParam("source") ? request->getParam("source")->value() : String("ram");
+
+        if (format != "json" && format != "csv")
+        {
+            sendError(request, 400, "invalid_format");
+            return;
+        }
+
+        if (source != "ram" && source != "flash")
+        {
+            sendError(request, 400, "invalid_source");
+            return;
+        }
+
+        std::shared_ptr<HistoryCsvStream> csv;
+        std::shared_ptr<HistoryJsonStream> json;
+        if (format == "csv")
+        {
+            csv = std::make_shared<HistoryCsvStream>();
+        }
+        else
+        {
+            json = std::make_shared<HistoryJsonStream>();
+        }
+
+        HistorySource &s = csv ? static_cast<HistorySource &>(*csv) : json->src;
+        int slot = request->getParam("slot")->value().toInt();
+
+        s.archive = (source == "flash");
+        s.slot = static_cast<uint8_t>(slot);
+
+        bool opened = false;
+        if (s.archive)
+        {
+            // En flash los tiempos son del reloj del log (ver /api/history/stats)
+            if (!historyStore.ready())
+            {
+                sendError(request, 503, "history_unavailable");
+                return;
+            }
+
+            s.fromTs = historyParam(request, "from", 0);
+            s.toTs = historyParam(request, "to", historyStore.nowTs());
+            s.stepMs = static_cast<uint32_t>(historyParam(request, "step", 0));
+            opened = historyStore.open(s.log, slot, s.fromTs, s.toTs, s.stepMs);
+        }
+        else
+        {
+            if (!slotHistory.ready())
+            {
+                sendError(request, 503, "history_unavailable");
+                return;
+            }
+
+            // Sin from: todo lo que el anillo puede ordenar antes de to
+            s.toTs = historyParam(request, "to", millis());
+            s.fromTs = historyParam(request, "from", static_cast<uint32_t>(s.toTs) - INT32_MAX);
+            s.stepMs = static_cast<uint32_t>(historyParam(request, "step", 0));
+            opened = s.toTs <= UINT32_MAX && s.fromTs <= UINT32_MAX &&
+                     slotHistory.open(s.ring, slot, static_cast<uint32_t>(s.fromTs), static_cast<uint32_t>(s.toTs), s.stepMs);
+        }
+
+        if (!opened)
+        {
+            sendError(request, 400, "invalid_range_or_slot");
+            return;
+        }
+
+        if (json)
+        {
+            if (requestFormat(request) != WireFormat::JSON)
+            {
+                uint32_t total = 0;
+                if (!countHistory(s, total))
+                {
+                    sendError(request, 503, "history_busy");
+                    return;
+                }
+                if (total >= JSON_UNSIZED)
+                {
+                    sendError(request, 400, "range_too_large");
+                    return;
+                }
+                json->total = static_cast<uint16_t>(total);
+            }
+
+            sendJsonStream(request, 200, json);
+            return;
+        }
+
+        sendChunked(
+            request, 200, "text/csv",
+            [csv](uint8_t *buffer, size_t maxLen) -> size_t
+            {
+                HistoryCsvStream &s = *csv;
+                size_t written = 0;
+
+                while (written < maxLen)
+                {
+                    if (s.linePos >= s.lineLen)
+                    {
+                        HistoryNext next = nextHistoryLine(s);
+                        if (next == HistoryNext::END) break;
+                        if (next == HistoryNext::STALLED)
+                        {
+                            // Devolver 0 cerraria la respuesta: se pide reintentar
+                            if (written == 0) return RESPONSE_TRY_AGAIN;
+                            break;
+                        }
+                    }
+
+                    // Una linea que no entra se termina en la siguiente llamada
+                    size_t n = s.lineLen - s.linePos;
+                    if (n > maxLen - written) n = maxLen - written;
+                    memcpy(buffer + written, s.line + s.linePos, n);
+                    s.linePos += n;
+                    written += n;
+                }
+
+                return written;
+            }); });
+
+    router.on("/api/history/stats", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+
+        JsonObject ram = data["ram"].to<JsonObject>();
+        ram["ready"] = slotHistory.ready();
+        ram["depth"] = HISTORY_DEPTH;
+        ram["bytes"] = slotHistory.capacityBytes();
+
+        JsonObject flash = data["flash"].to<JsonObject>();
+        flash["ready"] = historyStore.ready();
+        if (historyStore.ready())
+        {
+            HistoryLogStats st = historyStore.stats();
+            flash["now_ts"] = historyStore.nowTs();
+            flash["oldest_ts"] = st.oldestTs;
+            flash["newest_ts"] = st.newestTs;
+            flash["segments"] = st.segments;
+            flash["segments_used"] = st.segmentsUsed;
+            flash["head_seq"] = st.headSeq;
+            flash["frames_written"] = st.framesWritten;
+            flash["bytes_written"] = st.bytesWritten;
+            flash["replay_frames"] = st.replayFrames;
+            flash["crc_errors"] = st.crcErrors;
+            flash["torn_frames"] = st.tornFrames;
+            flash["rotations"] = st.rotations;
+            flash["write_errors"] = st.writeErrors;
+            flash["erase_min"] = st.eraseMin;
+            flash["erase_max"] = st.eraseMax;
+        }
+
+        sendJson(request, 200, doc); });
+}
+
+static void rollupToJson(JsonObject obj, const RollupBucket &b)
+{
+    obj["start"] = b.start;
+    obj["count"] = b.count;
+    if (b.count == 0) return;
+
+    obj["min_x100"] = b.minX100;
+    obj["max_x100"] = b.maxX100;
+    obj["mean_x100"] = static_cast<int32_t>(b.sumX100 / static_cast<int64_t>(b.count));
+    obj["oor_minutes"] = b.oorMinutes;
+}
+
+void registerRollupRoutes(ApiRouter &router)
+{
+    router.on("/api/rollups", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        if (!request->hasParam("slot"))
+        {
+            sendError(request, 400, "missing_slot");
+            return;
+        }
+
+        int slot = request->getParam("slot")->value().toInt();
+        static SlotRollup copy;
+        RollupBucket hourNow{};
+        RollupBucket dayNow{};
+
+        if (!slotRollups.snapshot(slot, copy, hourNow, dayNow))
+        {
+            sendError(request, 400, "invalid_slot");
+            return;
+        }
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["slot"] = slot;
+        data["clock_synced"] = SlotRollups::clockSynced();
+        rollupToJson(data["hour"].to<JsonObject>(), hourNow);
+        rollupToJson(data["day"].to<JsonObject>(), dayNow);
+
+        // Mas reciente primero
+        JsonArray hours = data["hours"].to<JsonArray>();
+        for (uint8_t i = 0; i < copy.hourCount; ++i)
+        {
+            uint8_t idx = (copy.hourHead + ROLLUP_HOURS - 1 - i) % ROLLUP_HOURS;
+            rollupToJson(hours.add<JsonObject>(), copy.hours[idx]);
+        }
+
+        JsonArray days = data["days"].to<JsonArray>();
+        for (uint8_t i = 0; i < copy.dayCount; ++i)
+        {
+            uint8_t idx = (copy.dayHead + ROLLUP_DAYS - 1 - i) % ROLLUP_DAYS;
+            rollupToJson(days.add<JsonObject>(), copy.days[idx]);
+        }
+
+        sendJson(request, 200, doc); });
+
+    router.on("/api/rollups/daily", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        int daysAgo = request->hasParam("days_ago") ? request->getParam("days_ago")->value().toInt() : 0;
+        uint32_t start = 0;
+
+        if (daysAgo < 0 || daysAgo >= ROLLUP_DAYS)
+        {
+            sendError(request, 400, "invalid_days_ago");
+            return;
+        }
+
+        if (!slotRollups.dayStart(daysAgo, start))
+        {
+            sendError(request, 503, "clock_not_synced");
+            return;
+        }
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["day_start"] = start;
+        JsonArray arr = data["slots"].to<JsonArray>();
+        static SlotRollup copy;
+
+        for (int slot = 0; slot < MAX_SLOTS; ++slot)
+        {
+            RollupBucket hourNow{};
+            RollupBucket dayNow{};
+            if (!slotRollups.snapshot(slot, copy, hourNow, dayNow)) continue;
+
+            const RollupBucket *found = (dayNow.count > 0 && dayNow.start == start) ? &dayNow : nullptr;
+            for (uint8_t i = 0; found == nullptr && i < copy.dayCount; ++i)
+            {
+                uint8_t idx = (copy.dayHead + ROLLUP_DAYS - 1 - i) % ROLLUP_DAYS;
+                if (copy.days[idx].start == start) found = &copy.days[idx];
+            }
+
+            if (found == nullptr) continue;
+
+            JsonObject obj = arr.add<JsonObject>();
+            obj["slot"] = slot;
+            rollupToJson(obj, *found);
+        }
+
+        sendJson(request, 200, doc); });
+}
+
+// Fecha de retiro relativa: requiere reloj sincronizado
+static bool keyRetireAt(JsonVariantConst seconds, uint32_t &retireAt, String &error)
+{
+    retireAt = 0;
+    if (seconds.isNull()) return true;
+
+    if (!SlotRollups::clockSynced())
+    {
+        error = "clock_not_synced";
+        return false;
+    }
+
+    long s = seconds.as<long>();
+    if (s < 0)
+    {
+        error = "invalid_retire_in_s";
+        return false;
+    }
+
+    retireAt = static_cast<uint32_t>(time(nullptr)) + static_cast<uint32_t>(s);
+    return true;
+}
+
+void registerKeyRoutes(ApiRouter &router)
+{
+    // Nunca se devuelve material de clave, solo IDs y contadores
+    router.on("/api/keys", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        AesKeyInfo keys[AES_KEY_SLOTS_TOTAL];
+        size_t count = aes_key_list(keys, AES_KEY_SLOTS_TOTAL);
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["clock_synced"] = SlotRollups::clockSynced();
+        data["unknown_key"] = aes_unknown_key_count();
+        data["busy"] = aes_key_busy_count();
+        JsonArray arr = data["keys"].to<JsonArray>();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            JsonObject obj = arr.add<JsonObject>();
+            obj["id"] = keys[i].id;
+            obj["retire_at"] = keys[i].retireAt;
+            obj["retired"] = keys[i].retired;
+            obj["decrypted"] = keys[i].decrypted;
+            obj["rejected"] = keys[i].rejected;
+            obj["failed"] = keys[i].failed;
+        }
+
+        sendJson(request, 200, doc); });
+
+    router.on("/api/keys", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"id":true,"key":true,"retire_in_s":true})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        int id = doc["id"] | -1;
+        if (id < 0 || id > 255)
+        {
+            sendError(request, 400, "invalid_id");
+            return;
+        }
+
+        String error;
+        uint32_t retireAt = 0;
+        if (!keyRetireAt(doc["retire_in_s"], retireAt, error) ||
+            !keyStore.setKey(static_cast<uint8_t>(id), doc["key"] | "", retireAt, error))
+        {
+            sendError(request, 400, error);
+            return;
+        }
+
+        sendSuccess(request, "Clave actualizada"); });
+
+    router.on("/api/keys/retire", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"id":true,"in_s":true})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        int id = doc["id"] | -1;
+        if (id < 0 || id > 255 || doc["in_s"].isNull())
+        {
+            sendError(request, 400, "invalid_id");
+            return;
+        }
+
+        String error;
+        uint32_t retireAt = 0;
+        if (!keyRetireAt(doc["in_s"], retireAt, error) ||
+            !keyStore.retireKey(static_cast<uint8_t>(id), retireAt, error))
+        {
+            sendError(request, 400, error);
+            return;
+        }
+
+        sendSuccess(request, "Retiro de clave programado"); });
+
+    router.on("/api/keys/remove", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"id":true})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        int id = doc["id"] | -1;
+        String error;
+        if (id < 0 || id > 255 || !keyStore.removeKey(static_cast<uint8_t>(id), error))
+        {
+            sendError(request, 400, error.isEmpty() ? String("invalid_id") : error);
+            return;
+        }
+
+        sendSuccess(request, "Clave eliminada"); });
+}
+
+static void pipelineToJson(JsonObject obj, const PipelineConfig &cfg)
+{
+    obj["fused"] = cfg.fused;
+    obj["decode_priority"] = cfg.decodePriority;
+    obj["decode_core"] = cfg.decodeCore;
+    obj["decode_stack"] = cfg.decodeStack;
+    obj["logic_priority"] = cfg.logicPriority;
+    obj["logic_core"] = cfg.logicCore;
+    obj["logic_stack"] = cfg.logicStack;
+}
+
+static bool pipelineField(JsonDocument &doc, const char *key, uint32_t minV, uint32_t maxV, uint32_t &value)
+{
+    if (doc[key].isNull()) return true;
+
+    long v = doc[key].as<long>();
+    if (v < static_cast<long>(minV) || v > static_cast<long>(maxV)) return false;
+
+    value = static_cast<uint32_t>(v);
+    return true;
+}
+
+void registerPipelineRoutes(ApiRouter &router)
+{
+    router.on("/api/pipeline", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        pipelineToJson(data["active"].to<JsonObject>(), advertising.config());
+        pipelineToJson(data["saved"].to<JsonObject>(), Config.loadPipeline());
+        sendJson(request, 200, doc); });
+
+    router.on("/api/pipeline", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"fused":true,"decode_priority":true,"decode_core":true,"decode_stack":true,"logic_priority":true,"logic_core":true,"logic_stack":true})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        PipelineConfig cfg = Config.loadPipeline();
+        uint32_t dPrio = cfg.decodePriority, dCore = cfg.decodeCore, dStack = cfg.decodeStack;
+        uint32_t lPrio = cfg.logicPriority, lCore = cfg.logicCore, lStack = cfg.logicStack;
+
+        // Prioridad 1 es la de las tareas de fondo; por encima de 5 compite con el stack de red
+        if (!pipelineField(doc, "decode_priority", 1, 5, dPrio) ||
+            !pipelineField(doc, "decode_core", 0, 1, dCore) ||
+            !pipelineField(doc, "decode_stack", 2048, 16384, dStack) ||
+            !pipelineField(doc, "logic_priority", 1, 5, lPrio) ||
+            !pipelineField(doc, "logic_core", 0, 1, lCore) ||
+            !pipelineField(doc, "logic_stack", 2048, 16384, lStack))
+        {
+            sendError(request, 400, "invalid_pipeline");
+            return;
+        }
+
+        if (!doc["fused"].isNull())
+            cfg.fused = doc["fused"].as<bool>();
+
+        cfg.decodePriority = static_cast<uint8_t>(dPrio);
+        cfg.decodeCore = static_cast<uint8_t>(dCore);
+        cfg.decodeStack = static_cast<uint16_t>(dStack);
+        cfg.logicPriority = static_cast<uint8_t>(lPrio);
+        cfg.logicCore = static_cast<uint8_t>(lCore);
+        cfg.logicStack = static_cast<uint16_t>(lStack);
+        Config.savePipeline(cfg);
+
+        sendSuccess(request, "Pipeline guardado, se aplica al reiniciar"); });
+
+    router.on("/api/pipeline/bench", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        PipelineBenchStatus bench = pipelineBench.status();
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["running"] = bench.running;
+        data["done"] = bench.done;
+        data["error"] = bench.error;
+        data["packets"] = bench.packets;
+        data["finished_ms"] = bench.finishedMs;
+
+        JsonArray runs = data["runs"].to<JsonArray>();
+        for (const PipelineBenchRun &r : bench.runs)
+        {
+            if (!bench.done) break;
+
+            JsonObject obj = runs.add<JsonObject>();
+            obj["topology"] = r.fused ? "fused" : "split";
+            obj["delivered"] = r.delivered;
+            obj["elapsed_us"] = r.elapsedUs;
+            obj["per_sec"] = r.perSec;
+            obj["lat_avg_us"] = r.latAvgUs;
+            obj["lat_p99_us"] = r.latP99Us;
+            obj["lat_max_us"] = r.latMaxUs;
+        }
+
+        sendJson(request, 200, doc); });
+
+    router.on("/api/pipeline/bench", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"packets":true})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        String error;
+        if (!pipelineBench.start(doc["packets"] | 2000, error))
+        {
+            sendError(request, 409, error);
+            return;
+        }
+
+        sendSuccess(request, "Benchmark iniciado"); });
+}
+
+void registerEventRoutes(ApiRouter &router)
+{
+    // Consumidor HTTP del bus: el cliente guarda el cursor entre llamadas
+    router.on("/api/events", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        uint32_t cursor = request->hasParam("cursor")
+                              ? static_cast<uint32_t>(strtoul(request->getParam("cursor")->value().c_str(), nullptr, 10))
+                              : appEvents.head();
+        int maxCount = request->hasParam("max") ? request->getParam("max")->value().toInt() : 64;
+        if (maxCount < 1 || maxCount > 256) maxCount = 64;
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        JsonArray arr = data["events"].to<JsonArray>();
+
+        uint32_t skipped = 0;
+        AppEvent ev;
+        for (int i = 0; i < maxCount; ++i)
+        {
+            if (appEvents.readAt(cursor, ev, skipped) != RingRead::OK) break;
+
+            JsonObject obj = arr.add<JsonObject>();
+            obj["seq"] = cursor - 1;
+            obj["type"] = AppEvents::typeName(ev.type);
+            obj["ms"] = ev.ms;
+            if (ev.slot != 0xFF) obj["slot"] = ev.slot;
+            if (ev.type == AppEventType::SLOT_OFFLINE) continue;
+
+            obj["addr"] = addrToHex(ev.addr);
+            obj["device_id"] = ev.deviceId;
+            obj["environment_id"] = ev.environmentId;
+            obj["flags"] = ev.flags;
+            obj["tmp_x100"] = ev.tmpX100;
+            obj["cpu_x100"] = ev.cpuX100;
+            obj["bat_pct"] = ev.batPct;
+            obj["rssi"] = ev.rssi;
+        }
+
+        data["cursor"] = cursor;
+        data["skipped"] = skipped;
+        sendJson(request, 200, doc); });
+
+    router.on("/api/events/stats", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        AppEventStats stats = appEvents.stats();
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["head"] = stats.head;
+        data["oldest"] = stats.oldest;
+        data["ring_len"] = APP_EVENT_RING_LEN;
+
+        JsonArray subs = data["subscribers"].to<JsonArray>();
+        for (uint32_t i = 0; i < stats.subscribers; ++i)
+        {
+            JsonObject obj = subs.add<JsonObject>();
+            obj["name"] = stats.subs[i].name;
+            obj["delivered"] = stats.subs[i].delivered;
+            obj["skipped"] = stats.subs[i].skipped;
+            obj["lag"] = stats.subs[i].lag;
+        }
+
+        sendJson(request, 200, doc); });
+
+    router.on("/api/events/ws", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        WsPushStats stats = wsPush.stats();
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+        data["tick_ms"] = WS_PUSH_TICK_MS;
+        data["ticks"] = stats.ticks;
+        data["events"] = stats.events;
+        data["coalesced"] = stats.coalesced;
+        data["frames"] = stats.frames;
+        data["bytes"] = stats.bytes;
+        data["frames_per_sec"] = stats.framesPerSec;
+        data["bytes_per_sec"] = stats.bytesPerSec;
+        data["rejected"] = stats.rejected;
+        data["max_clients"] = WS_PUSH_MAX_CLIENTS;
+        data["frame_max"] = WS_PUSH_FRAME_MAX;
+        data["client_state_bytes"] = stats.clientStateBytes;
+
+        JsonArray clients = data["clients"].to<JsonArray>();
+        for (uint32_t i = 0; i < stats.clients; ++i)
+        {
+            const WsPushClientStats &c = stats.client[i];
+            JsonObject obj = clients.add<JsonObject>();
+            obj["id"] = c.id;
+            obj["filter"] = c.filter;
+            obj["owed"] = c.owed;
+            obj["format"] = c.format == WireFormat::JSON ? "json" : c.format == WireFormat::MSGPACK ? "msgpack" : "cbor";
+            obj["frames"] = c.frames;
+            obj["bytes"] = c.bytes;
+            obj["rows"] = c.rows;
+            obj["deferred"] = c.deferred;
+            obj["last_frame_bytes"] = c.lastFrameBytes;
+            obj["max_frame_bytes"] = c.maxFrameBytes;
+        }
+
+        sendJson(request, 200, doc); });
+}
+
+static bool harnessField(JsonDocument &doc, const char *key, uint32_t minValue, uint32_t maxValue, uint32_t &value)
+{
+    if (doc[key].isNull()) return true;
+    if (!doc[key].is<uint32_t>()) return false;
+
+    uint32_t v = doc[key].as<uint32_t>();
+    if (v < minValue || v > maxValue) return false;
+
+    value = v;
+    return true;
+}
+
+void registerHarnessRoutes(ApiRouter &router)
+{
+    router.on("/api/harness", HTTP_GET, [](AsyncWebServerRequest *request)
+              {
+        HarnessStatus h = advHarness.status();
+
+        JsonDocument doc(requestAllocator());
+        JsonObject data = createResponse(doc, true);
+
+        JsonObject capture = data["capture"].to<JsonObject>();
+        capture["running"] = h.capturing;
+        capture["path"] = h.capturePath;
+        capture["frames"] = h.captured;
+        capture["dropped"] = h.captureDropped;
+        capture["errors"] = h.captureErrors;
+
+        JsonObject inject = data["inject"].to<JsonObject>();
+        inject["running"] = h.injecting;
+        inject["source"] = h.source == InjectSource::FILE ? "file" : "fleet";
+        inject["frames"] = h.injected;
+        inject["dropped"] = h.injectDropped;
+        inject["late_max_ms"] = h.lateMaxMs;
+        inject["error"] = h.lastError;
+
+        sendJson(request, 200, doc); });
+
+    router.on("/api/harness/capture", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"max_frames":true,"path":true})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        uint32_t maxFrames = HARNESS_CAPTURE_MAX_FRAMES;
+        if (!harnessField(doc, "max_frames", 1, HARNESS_CAPTURE_MAX_FRAMES, maxFrames))
+        {
+            sendError(request, 400, "invalid_max_frames");
+            return;
+        }
+
+        String error;
+        if (!advHarness.startCapture(doc["path"] | HARNESS_CAPTURE_PATH, maxFrames, error))
+        {
+            sendError(request, error == "capture_running" ? 409 : 400, error);
+            return;
+        }
+
+        sendSuccess(request, "Captura iniciada"); });
+
+    router.on("/api/harness/capture/stop", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+        advHarness.stopCapture();
+        sendSuccess(request, "Captura detenida"); });
+
+    router.on("/api/harness/inject", HTTP_POST, [](AsyncWebServerRequest *request, uint8_t *data, size_t len)
+              {
+        static const JsonFilter filter(R"({"source":true,"path":true,"speed_x100":true,"frames":true,"beacons":true,"period_ms":true,"jitter_ms":true,"burst":true,"burst_spacing_ms":true,"seed":true})");
+        JsonDocument doc(requestAllocator());
+        DeserializationError err = parseBody(doc, data, len, filter);
+
+        if (err)
+        {
+            sendError(request, 400, "invalid_json");
+            return;
+        }
+
+        InjectRequest req;
+        String source = doc["source"] | "fleet";
+        if (source == "file")
+            req.source = InjectSource::FILE;
+        else if (source != "fleet")
+        {
+            sendError(request, 400, "invalid_source");
+            return;
+        }
+
+        req.path = doc["path"] | HARNESS_CAPTURE_PATH;
+
+        uint32_t beacons = req.fleet.beacons, burst = req.fleet.burstPackets;
+        uint32_t spacing = req.fleet.burstSpacingMs, seed = req.fleet.seed;
+
+        // speed_x100: 100 tiempo real, 0 lo mas rapido posible
+        if (!harnessField(doc, "speed_x100", 0, 100000, req.speedX100) ||
+            !harnessField(doc, "frames", 0, UINT32_MAX, req.maxFrames) ||
+            !harnessField(doc, "beacons", 1, FLEET_MAX_BEACONS, beacons) ||
+            !harnessField(doc, "period_ms", 100, 3600000, req.fleet.periodMs) ||
+            !harnessField(doc, "jitter_ms", 0, 600000, req.fleet.jitterMs) ||
+            !harnessField(doc, "burst", 1, 50, burst) ||
+            !harnessField(doc, "burst_spacing_ms", 1, 1000, spacing) ||
+            !harnessField(doc, "seed", 0, UINT32_MAX, seed) ||
+            req.fleet.jitterMs >= req.fleet.periodMs / 2)
+        {
+            sendError(request, 400, "invalid_inject");
+            return;
+        }
+
+        req.fleet.beacons = static_cast<uint16_t>(beacons);
+        req.fleet.burstPackets = static_cast<uint8_t>(burst);
+        req.fleet.burstSpacingMs = static_cast<uint16_t>(spacing);
+        req.fleet.seed = seed;
+
+        String error;
+        if (!advHarness.startInject(req, error))
+        {
+            sendError(request, error == "inject_running" ? 409 : 400, error);
+            return;
+        }
+
+        sendSuccess(request, "Inyeccion iniciada"); });
+
+    router.on("/api/harness/inject/stop", HTTP_POST, [](AsyncWebServerRequest *request)
+              {
+        advHarness.stopInject();
+        sendSuccess(request, "Inyeccion detenida"); });
+}
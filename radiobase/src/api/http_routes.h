@@ -1,7 +1,18 @@
 #pragma once
-#include <AsyncWebServer_ESP32_SC_W5500.h>
+#include "api_router.h"
 
-void registerHttpRoutes(AsyncWebServer &server);
-void registerNetworkRoutes(AsyncWebServer &server);
-void registerBeaconRoutes(AsyncWebServer &server);
-void registerFeatureRoutes(AsyncWebServer &server);
\ No newline at end of file
+void registerHttpRoutes(ApiRouter &router);
+void registerNetworkRoutes(ApiRouter &router);
+void registerBeaconRoutes(ApiRouter &router);
+void registerFeatureRoutes(ApiRouter &router);
+void registerAlarmRoutes(ApiRouter &router);
+void registerZoneRoutes(ApiRouter &router);
+void registerHistoryRoutes(ApiRouter &router);
+void registerRollupRoutes(ApiRouter &router);
+void registerKeyRoutes(ApiRouter &router);
+void registerPipelineRoutes(ApiRouter &router);
+void registerEventRoutes(ApiRouter &router);
+void registerHarnessRoutes(ApiRouter &router);
+void registerBootstrapRoutes(ApiRouter &router);
+void registerGzipRoutes(ApiRouter &router);
+void registerRouterRoutes(ApiRouter &router);
\ No newline at end of file
@@ -0,0 +1,75 @@
+#include "json_arena.h"
+#include <esp32-hal-psram.h>
+
+JsonArena jsonArena;
+
+bool JsonArena::begin()
+{
+    if (arena.ready()) return true;
+
+    uint8_t *pool = static_cast<uint8_t *>(ps_malloc(JSON_ARENA_BYTES));
+    if (pool == nullptr)
+    {
+        Serial.println("JsonArena: Sin PSRAM, los documentos van al heap");
+        return false;
+    }
+
+    arena.begin(pool, JSON_ARENA_BYTES);
+    return true;
+}
+
+bool JsonArena::inOwnerTask()
+{
+    TaskHandle_t me = xTaskGetCurrentTaskHandle();
+    if (owner == nullptr) owner = me;
+    if (owner == me) return true;
+
+    foreignTask++;
+    return false;
+}
+
+void *JsonArena::allocate(size_t size)
+{
+    if (arena.ready() && inOwnerTask())
+    {
+        void *p = arena.allocate(size);
+        if (p != nullptr) return p;
+        heapFallbacks++;
+    }
+
+    return malloc(size);
+}
+
+void JsonArena::deallocate(void *ptr)
+{
+    if (arena.owns(ptr))
+        arena.release(ptr);
+    else
+        free(ptr);
+}
+
+void *JsonArena::reallocate(void *ptr, size_t newSize)
+{
+    if (!arena.owns(ptr)) return realloc(ptr, newSize);
+
+    void *p = arena.resize(ptr, newSize);
+    if (p != nullptr) return p;
+
+    // Crece y no es el ultimo bloque: se copia a uno nuevo
+    p = allocate(newSize);
+    if (p == nullptr) return nullptr;
+
+    size_t old = arena.blockSize(ptr);
+    memcpy(p, ptr, old < newSize ? old : newSize);
+    arena.release(ptr);
+    return p;
+}
+
+JsonArenaStats JsonArena::stats() const
+{
+    JsonArenaStats s;
+    s.arena = arena.stats();
+    s.heapFallbacks = heapFallbacks;
+    s.foreignTask = foreignTask;
+    return s;
+}
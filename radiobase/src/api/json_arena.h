@@ -0,0 +1,53 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <bump_arena.h>
+#include "config.h"
+
+/*
+  Asignador de ArduinoJson para los documentos de las peticiones HTTP.
+
+  Los documentos de un handler se apilan en una arena de PSRAM y la
+  arena vuelve al inicio cuando se destruye el ultimo, asi los JsonDocument
+  de cada peticion no fragmentan el heap general. Los handlers corren en
+  una sola tarea (la de AsyncTCP): la arena queda atada a la primera tarea
+  que la usa y cualquier otra, o un pedido que no entra, va al heap.
+*/
+
+struct JsonArenaStats
+{
+    BumpArenaStats arena;
+    uint32_t heapFallbacks = 0;
+    uint32_t foreignTask = 0;
+};
+
+class JsonArena : public ArduinoJson::Allocator
+{
+public:
+    bool begin();
+
+    void *allocate(size_t size) override;
+    void deallocate(void *ptr) override;
+    void *reallocate(void *ptr, size_t newSize) override;
+
+    JsonArenaStats stats() const;
+
+private:
+    bool inOwnerTask();
+
+private:
+    BumpArena arena;
+    TaskHandle_t owner = nullptr;
+    uint32_t heapFallbacks = 0;
+    uint32_t foreignTask = 0;
+};
+
+extern JsonArena jsonArena;
+
+// Asignador para los JsonDocument de un handler
+inline ArduinoJson::Allocator *requestAllocator()
+{
+    return &jsonArena;
+}
@@ -0,0 +1,17 @@
+#include "json_filter.h"
+#include <Arduino.h>
+
+JsonFilter::JsonFilter(const char *fields)
+{
+    // Texto fijo del handler: un error aca es un bug, no una peticion mala
+    if (deserializeJson(doc, fields))
+    {
+        Serial.printf("JsonFilter: filtro invalido %s\n", fields);
+        doc.clear();
+    }
+}
+
+DeserializationError parseBody(JsonDocument &doc, const uint8_t *data, size_t len, const JsonFilter &filter)
+{
+    return deserializeJson(doc, data, len, DeserializationOption::Filter(filter.fields()));
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <ArduinoJson.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Campos que un handler lee de su cuerpo, en JSON: {"ssid":true,"net":true}.
+// Se arma una vez (static) y el resto del cuerpo no llega al documento.
+class JsonFilter
+{
+public:
+    explicit JsonFilter(const char *fields);
+    JsonVariantConst fields() const { return doc.as<JsonVariantConst>(); }
+
+private:
+    JsonDocument doc;
+};
+
+// Parsea el cuerpo de una peticion guardando solo los campos del filtro
+DeserializationError parseBody(JsonDocument &doc, const uint8_t *data, size_t len, const JsonFilter &filter);
@@ -1,12 +1,352 @@
 #include "responseJson.h"
 #include <ArduinoJson.h>
+#include <ctype.h>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include "core/appState.h"
 
+WireFormat requestFormat(AsyncWebServerRequest *request)
+{
+    if (!request->hasHeader("Accept")) return WireFormat::JSON;
+
+    const String &accept = request->getHeader("Accept")->value();
+    if (accept.indexOf("application/msgpack") >= 0 || accept.indexOf("application/x-msgpack") >= 0)
+        return WireFormat::MSGPACK;
+    if (accept.indexOf("application/cbor") >= 0)
+        return WireFormat::CBOR;
+    return WireFormat::JSON;
+}
+
+const char *formatContentType(WireFormat f)
+{
+    switch (f)
+    {
+    case WireFormat::MSGPACK:
+        return "application/msgpack";
+    case WireFormat::CBOR:
+        return "application/cbor";
+    default:
+        return "application/json";
+    }
+}
+
+// Una direccion de 12 digitos hex sale como 6 bytes, igual que fieldHex48
+static bool hexAddr(const char *key, JsonVariantConst v, uint64_t &out)
+{
+    if (key == nullptr || strcmp(key, "addr") != 0 || !v.is<const char *>()) return false;
+
+    const char *s = v.as<const char *>();
+    if (strlen(s) != 12) return false;
+    for (int i = 0; i < 12; ++i)
+    {
+        if (!isxdigit(static_cast<unsigned char>(s[i]))) return false;
+    }
+
+    out = strtoull(s, nullptr, 16);
+    return true;
+}
+
+// Recorre el documento con el mismo escritor que las respuestas por partes
+static void writeVariant(JsonWriter &w, JsonVariantConst v, const char *key = nullptr)
+{
+    uint64_t addr;
+
+    if (v.is<JsonObjectConst>())
+    {
+        JsonObjectConst obj = v.as<JsonObjectConst>();
+        w.beginObject(static_cast<uint16_t>(obj.size()));
+        for (JsonPairConst kv : obj)
+        {
+            w.key(kv.key().c_str());
+            writeVariant(w, kv.value(), kv.key().c_str());
+        }
+        w.endObject();
+    }
+    else if (v.is<JsonArrayConst>())
+    {
+        JsonArrayConst arr = v.as<JsonArrayConst>();
+        w.beginArray(static_cast<uint16_t>(arr.size()));
+        for (JsonVariantConst item : arr)
+        {
+            writeVariant(w, item);
+        }
+        w.endArray();
+    }
+    else if (hexAddr(key, v, addr))
+        w.valueHex48(addr);
+    else if (v.is<bool>())
+        w.valueBool(v.as<bool>());
+    else if (v.is<int64_t>())
+        w.valueInt(v.as<int64_t>());
+    else if (v.is<uint64_t>())
+        w.valueUint(v.as<uint64_t>());
+    else if (v.is<double>())
+        w.valueDouble(v.as<double>());
+    else if (v.is<const char *>())
+        w.valueStr(v.as<const char *>());
+    else
+        w.valueNull();
+}
+
 void sendJson(AsyncWebServerRequest *request, int code, JsonDocument &doc)
 {
-    String out;
-    serializeJson(doc, out);
-    request->send(code, "application/json", out);
+    WireFormat f = requestFormat(request);
+    if (f == WireFormat::JSON)
+    {
+        String out;
+        serializeJson(doc, out);
+        AsyncWebServerResponse *response = request->beginResponse(code, "application/json", out);
+        response->addHeader("Vary", "Accept");
+        request->send(response);
+        return;
+    }
+
+    // Primera pasada solo cuenta bytes; la segunda escribe en un buffer justo
+    JsonWriter w;
+    w.setFormat(f);
+    w.target(nullptr, 0);
+    writeVariant(w, doc.as<JsonVariantConst>());
+    size_t len = w.size();
+
+    std::unique_ptr<char[]> out(new (std::nothrow) char[len]);
+    if (!out)
+    {
+        request->send(503);
+        return;
+    }
+
+    w.target(out.get(), len);
+    writeVariant(w, doc.as<JsonVariantConst>());
+
+    AsyncResponseStream *response = request->beginResponseStream(formatContentType(f), len);
+    response->setCode(code);
+    response->addHeader("Vary", "Accept");
+    response->write(reinterpret_cast<const uint8_t *>(out.get()), w.size());
+    request->send(response);
+}
+
+bool sendIfNotModified(AsyncWebServerRequest *request, const char *etag)
+{
+    if (!request->hasHeader("If-None-Match")) return false;
+
+    const String &match = request->getHeader("If-None-Match")->value();
+    if (match != "*" && match.indexOf(etag) < 0) return false;
+
+    AsyncWebServerResponse *response = request->beginResponse(304);
+    response->addHeader("ETag", etag);
+    response->addHeader("Cache-Control", "no-cache");
+    response->addHeader("Vary", "Accept, Accept-Encoding");
+    request->send(response);
+    return true;
+}
+
+bool acceptsEncoding(const char *header, const char *coding)
+{
+    size_t n = strlen(coding);
+    const char *p = header;
+
+    while (*p != '\0')
+    {
+        while (*p == ' ' || *p == ',') p++;
+
+        const char *name = p;
+        while (*p != '\0' && *p != ',' && *p != ';' && *p != ' ') p++;
+        bool match = static_cast<size_t>(p - name) == n && strncasecmp(name, coding, n) == 0;
+
+        float q = 1.0f;
+        while (*p != '\0' && *p != ',')
+        {
+            if (*p == 'q' && p[1] == '=') q = strtof(p + 2, nullptr);
+            p++;
+        }
+
+        if (match) return q > 0.0f;
+    }
+
+    return false;
+}
+
+static_assert(GZIP_STAGE_BYTES >= GZIP_MIN_BYTES, "el umbral de gzip se junta en el buffer de entrada");
+
+// Cuerpo comprimido por partes; el compresor vuelve al pool al destruirse la respuesta
+class GzipBody
+{
+public:
+    GzipBody(GzipStream *gz, uint8_t *stage, size_t staged, bool ended, BodyFiller source)
+        : gz(gz), stage(stage), stageLen(staged), ended(ended), source(source)
+    {
+    }
+
+    ~GzipBody()
+    {
+        gzipPool.release(gz, cpuUs);
+    }
+
+    size_t fill(uint8_t *buffer, size_t maxLen)
+    {
+        size_t written = 0;
+        uint32_t start = micros();
+
+        while (written < maxLen && !gz->done())
+        {
+            if (gz->pending() > 0)
+            {
+                written += gz->read(buffer + written, maxLen - written);
+            }
+            else if (stagePos < stageLen)
+            {
+                stagePos += gz->write(stage + stagePos, stageLen - stagePos);
+            }
+            else if (ended)
+            {
+                gz->finish();
+            }
+            else
+            {
+                size_t n = source(stage, GZIP_STAGE_BYTES);
+                if (n == RESPONSE_TRY_AGAIN)
+                {
+                    if (written == 0)
+                    {
+                        cpuUs += micros() - start;
+                        return RESPONSE_TRY_AGAIN;
+                    }
+                    break;
+                }
+
+                ended = n == 0;
+                stagePos = 0;
+                stageLen = n;
+            }
+        }
+
+        cpuUs += micros() - start;
+        return written;
+    }
+
+private:
+    GzipStream *gz;
+    uint8_t *stage;
+    size_t stagePos = 0;
+    size_t stageLen;
+    bool ended;
+    BodyFiller source;
+    uint32_t cpuUs = 0;
+};
+
+// Junta hasta GZIP_MIN_BYTES para decidir si vale comprimir
+static size_t prefill(BodyFiller &fill, uint8_t *stage, bool &ended)
+{
+    size_t len = 0;
+    ended = false;
+
+    while (len < GZIP_MIN_BYTES)
+    {
+        size_t n = fill(stage + len, GZIP_STAGE_BYTES - len);
+        if (n == RESPONSE_TRY_AGAIN) break;
+        if (n == 0)
+        {
+            ended = true;
+            break;
+        }
+        len += n;
+    }
+
+    return len;
+}
+
+static void addBodyHeaders(AsyncWebServerResponse *response, const char *etag, bool gzip, const char *vary)
+{
+    response->addHeader("Vary", vary);
+    if (etag != nullptr)
+    {
+        // Sin cache propia: el cliente revalida siempre con If-None-Match.
+        // Comprimido es el mismo contenido en otros bytes: la ETag pasa a debil
+        response->addHeader("ETag", gzip ? String("W/") + etag : String(etag));
+        response->addHeader("Cache-Control", "no-cache");
+    }
+}
+
+void sendChunked(AsyncWebServerRequest *request, int code, const char *contentType, BodyFiller fill,
+                 const char *etag, const char *vary)
+{
+    bool wantsGzip = request->hasHeader("Accept-Encoding") &&
+                     acceptsEncoding(request->getHeader("Accept-Encoding")->value().c_str(), "gzip");
+
+    uint8_t *stage = nullptr;
+    GzipStream *gz = wantsGzip ? gzipPool.acquire(stage) : nullptr;
+    if (wantsGzip && gz == nullptr) gzipPool.noteBusy();
+
+    if (gz != nullptr)
+    {
+        bool ended = false;
+        size_t staged = prefill(fill, stage, ended);
+
+        if (ended && staged < GZIP_MIN_BYTES)
+        {
+            // Chico: no paga la cabecera gzip ni el tiempo de CPU
+            AsyncResponseStream *response = request->beginResponseStream(contentType, staged);
+            response->setCode(code);
+            response->write(stage, staged);
+            gzipPool.release(gz, 0);
+            gzipPool.noteSmall();
+
+            addBodyHeaders(response, etag, false, vary);
+            request->send(response);
+            return;
+        }
+
+        std::shared_ptr<GzipBody> body = std::make_shared<GzipBody>(gz, stage, staged, ended, fill);
+        AsyncWebServerResponse *response = request->beginChunkedResponse(
+            contentType,
+            [body](uint8_t *buffer, size_t maxLen, size_t) -> size_t
+            {
+                // Devolver 0 cerraria la respuesta: sin espacio se pide reintentar
+                if (maxLen == 0) return RESPONSE_TRY_AGAIN;
+                return body->fill(buffer, maxLen);
+            });
+
+        response->setCode(code);
+        response->addHeader("Content-Encoding", "gzip");
+        addBodyHeaders(response, etag, true, vary);
+        request->send(response);
+        return;
+    }
+
+    AsyncWebServerResponse *response = request->beginChunkedResponse(
+        contentType,
+        [fill](uint8_t *buffer, size_t maxLen, size_t) -> size_t
+        {
+            if (maxLen == 0) return RESPONSE_TRY_AGAIN;
+            return fill(buffer, maxLen);
+        });
+
+    response->setCode(code);
+    addBodyHeaders(response, etag, false, vary);
+    request->send(response);
+}
+
+void sendJsonStream(AsyncWebServerRequest *request, int code, std::shared_ptr<JsonStream> stream, const char *etag)
+{
+    stream->setFormat(requestFormat(request));
+
+    sendChunked(
+        request, code, formatContentType(stream->format()),
+        [stream](uint8_t *buffer, size_t maxLen) -> size_t
+        {
+            size_t n = stream->fill(buffer, maxLen);
+            // Devolver 0 cerraria la respuesta: se pide reintentar
+            if (n == 0 && stream->waiting()) return RESPONSE_TRY_AGAIN;
+            if (n == 0 && stream->aborted())
+            {
+                Serial.printf("JsonStream: la parte %u no entra en %u bytes, respuesta cortada\n",
+                              static_cast<unsigned>(stream->partsWritten()), static_cast<unsigned>(JSON_STREAM_SPILL));
+            }
+            return n;
+        },
+        etag, "Accept, Accept-Encoding");
 }
 
 JsonObject createResponse(JsonDocument &doc, bool success, const String &message)
@@ -22,7 +362,7 @@ JsonObject createResponse(JsonDocument &doc, bool success, const String &message
 
 void sendData(AsyncWebServerRequest *request, int code, JsonDocument &doc, const String &message)
 {
-    JsonDocument outDoc;
+    JsonDocument outDoc(requestAllocator());
     JsonObject data = createResponse(outDoc, code >= 200 && code < 300, message);
     data.set(doc.as<JsonVariantConst>());
     sendJson(request, code, outDoc);
@@ -91,7 +431,7 @@ bool jsonToIpSettings(JsonObject obj, IpSettings &net, String &error)
 
 void sendError(AsyncWebServerRequest *request, int code, const String &message)
 {
-    JsonDocument doc;
+    JsonDocument doc(requestAllocator());
     doc["success"] = false;
     doc["message"] = message;
     JsonObject error = doc["error"].to<JsonObject>();
@@ -101,7 +441,7 @@ void sendError(AsyncWebServerRequest *request, int code, const String &message)
 
 void sendSuccess(AsyncWebServerRequest *request, const String &message)
 {
-    JsonDocument doc;
+    JsonDocument doc(requestAllocator());
     doc["success"] = true;
     doc["message"] = message;
     doc["data"].to<JsonObject>();
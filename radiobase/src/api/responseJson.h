@@ -1,7 +1,15 @@
 #pragma once
+#include <functional>
+#include <memory>
 #include <ArduinoJson.h>
 #include <AsyncWebServer_ESP32_SC_W5500.h>
+#include <json_stream.h>
 #include "core/networkConfig.h"
+#include "json_filter.h"
+
+// Formato pedido por el cliente en Accept; JSON si no pide MessagePack ni CBOR
+WireFormat requestFormat(AsyncWebServerRequest *request);
+const char *formatContentType(WireFormat f);
 
 bool parseIpField(JsonVariant src, IPAddress &out);
 void sendJson(AsyncWebServerRequest *request, int code, JsonDocument &doc);
@@ -11,6 +19,19 @@ void sendError(AsyncWebServerRequest *request, int code, const String &message);
 void sendSuccess(AsyncWebServerRequest *request, const String &message);
 JsonObject createResponse(JsonDocument &doc, bool success, const String &message = "");
 void sendData(AsyncWebServerRequest *request, int code, JsonDocument &doc, const String &message = "");
+// true si la codificacion figura en Accept-Encoding y no viene con q=0
+bool acceptsEncoding(const char *header, const char *coding);
+
+// Llena buffer con el cuerpo; 0 al terminar, RESPONSE_TRY_AGAIN si todavia no hay datos
+typedef std::function<size_t(uint8_t *buffer, size_t maxLen)> BodyFiller;
+// Respuesta chunked; sale con gzip si el cliente lo acepta, el cuerpo pasa
+// GZIP_MIN_BYTES y hay un compresor libre
+void sendChunked(AsyncWebServerRequest *request, int code, const char *contentType, BodyFiller fill,
+                 const char *etag = nullptr, const char *vary = "Accept-Encoding");
+// Respuesta chunked escrita por partes directo en el buffer de envio
+void sendJsonStream(AsyncWebServerRequest *request, int code, std::shared_ptr<JsonStream> stream, const char *etag = nullptr);
+// Responde 304 si If-None-Match ya tiene esta version
+bool sendIfNotModified(AsyncWebServerRequest *request, const char *etag);
 
 
 String uint64ToHex(uint64_t value);
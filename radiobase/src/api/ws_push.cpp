@@ -0,0 +1,434 @@
+#include "ws_push.h"
+#include <ArduinoJson.h>
+#include "json_arena.h"
+#include "services/web_service.h"
+
+WsPush wsPush;
+
+static constexpr uint32_t ALL_SLOTS = MAX_SLOTS >= 32 ? 0xFFFFFFFFUL : ((1UL << MAX_SLOTS) - 1);
+
+// Cabecera de un frame de servidor de hasta 64 KB
+static constexpr size_t WS_HEADER_MAX = 4;
+// Lugar que queda para cerrar la lista y el objeto del frame
+static constexpr size_t FRAME_TAIL = 8;
+
+static constexpr JsonKey K_TYPE = JSON_KEY("type");
+static constexpr JsonKey K_SEQ = JSON_KEY("seq");
+static constexpr JsonKey K_SLOTS = JSON_KEY("slots");
+static constexpr JsonKey K_SLOT = JSON_KEY("slot");
+static constexpr JsonKey K_ONLINE = JSON_KEY("online");
+static constexpr JsonKey K_AGE_MS = JSON_KEY("age_ms");
+static constexpr JsonKey K_ADDR = JSON_KEY("addr");
+static constexpr JsonKey K_DEVICE_ID = JSON_KEY("device_id");
+static constexpr JsonKey K_ENVIRONMENT_ID = JSON_KEY("environment_id");
+static constexpr JsonKey K_FLAGS = JSON_KEY("flags");
+static constexpr JsonKey K_TMP = JSON_KEY("tmp_x100");
+static constexpr JsonKey K_CPU = JSON_KEY("cpu_x100");
+static constexpr JsonKey K_BAT = JSON_KEY("bat_pct");
+static constexpr JsonKey K_RSSI = JSON_KEY("rssi");
+
+static const char *formatName(WireFormat format)
+{
+    switch (format)
+    {
+    case WireFormat::MSGPACK:
+        return "msgpack";
+    case WireFormat::CBOR:
+        return "cbor";
+    default:
+        return "json";
+    }
+}
+
+static bool parseFormat(const char *name, WireFormat &out)
+{
+    if (strcmp(name, "json") == 0)
+        out = WireFormat::JSON;
+    else if (strcmp(name, "msgpack") == 0)
+        out = WireFormat::MSGPACK;
+    else if (strcmp(name, "cbor") == 0)
+        out = WireFormat::CBOR;
+    else
+        return false;
+    return true;
+}
+
+static String wsError(const char *error)
+{
+    return String("{\"type\":\"error\",\"error\":\"") + error + "\"}";
+}
+
+static void writeRow(JsonWriter &w, int slot, const AppEvent &ev, uint32_t nowMs)
+{
+    w.beginObject();
+    w.fieldUint(K_SLOT, slot);
+
+    bool online = ev.type != AppEventType::SLOT_OFFLINE;
+    w.fieldBool(K_ONLINE, online);
+    w.fieldUint(K_AGE_MS, nowMs - ev.ms);
+
+    if (online)
+    {
+        w.fieldHex48(K_ADDR, ev.addr);
+        w.fieldUint(K_DEVICE_ID, ev.deviceId);
+        w.fieldUint(K_ENVIRONMENT_ID, ev.environmentId);
+        w.fieldUint(K_FLAGS, ev.flags);
+        w.fieldInt(K_TMP, ev.tmpX100);
+        w.fieldInt(K_CPU, ev.cpuX100);
+        w.fieldInt(K_BAT, ev.batPct);
+        w.fieldInt(K_RSSI, ev.rssi);
+    }
+
+    w.endObject();
+}
+
+void WsPush::begin(AsyncWebSocket &server)
+{
+    ws = &server;
+    if (sendLock == nullptr)
+    {
+        sendLock = xSemaphoreCreateMutex();
+    }
+    if (subId < 0)
+    {
+        subId = appEvents.subscribe("ws");
+    }
+    st.clientStateBytes = sizeof(Client);
+}
+
+bool WsPush::lockSend()
+{
+    return sendLock != nullptr && xSemaphoreTake(sendLock, portMAX_DELAY) == pdTRUE;
+}
+
+void WsPush::unlockSend()
+{
+    xSemaphoreGive(sendLock);
+}
+
+void WsPush::reply(AsyncWebSocketClient *client, const String &out)
+{
+    // El loop puede estar mandando un frame al mismo cliente
+    if (!lockSend()) return;
+    client->text(out);
+    unlockSend();
+}
+
+int WsPush::findLocked(uint32_t id) const
+{
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; ++i)
+    {
+        if (clients[i].id == id) return i;
+    }
+    return -1;
+}
+
+void WsPush::onConnect(AsyncWebSocketClient *client)
+{
+    portENTER_CRITICAL(&mux);
+    int i = findLocked(0);
+    if (i >= 0)
+    {
+        clients[i] = Client{};
+        clients[i].id = client->id();
+        clients[i].conn = client;
+        clients[i].format = WireFormat::JSON;
+        clientCount++;
+    }
+    else
+    {
+        st.rejected++;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (i < 0)
+    {
+        // 1013: volver a intentar mas tarde
+        client->close(1013);
+        return;
+    }
+
+    webService.wake();
+}
+
+void WsPush::onDisconnect(AsyncWebSocketClient *client)
+{
+    // Espera un envio en curso del loop; despues el puntero ya no esta en la tabla
+    bool locked = lockSend();
+
+    portENTER_CRITICAL(&mux);
+    int i = findLocked(client->id());
+    if (i >= 0)
+    {
+        clients[i].id = 0;
+        clients[i].conn = nullptr;
+        clientCount--;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (locked) unlockSend();
+}
+
+void WsPush::onMessage(AsyncWebSocketClient *client, const uint8_t *data, size_t len)
+{
+    JsonDocument doc(requestAllocator());
+    if (deserializeJson(doc, reinterpret_cast<const char *>(data), len))
+    {
+        reply(client, wsError("invalid_json"));
+        return;
+    }
+
+    uint32_t filter = 0;
+    JsonVariant sub = doc["subscribe"];
+    if (doc["unsubscribe"] | false)
+    {
+        filter = 0;
+    }
+    else if (sub.is<const char *>() && strcmp(sub.as<const char *>(), "all") == 0)
+    {
+        filter = ALL_SLOTS;
+    }
+    else if (sub.is<JsonArray>())
+    {
+        for (JsonVariant v : sub.as<JsonArray>())
+        {
+            if (!v.is<int>() || v.as<int>() < 0 || v.as<int>() >= MAX_SLOTS)
+            {
+                reply(client, wsError("invalid_slot"));
+                return;
+            }
+            filter |= 1UL << v.as<int>();
+        }
+    }
+    else
+    {
+        reply(client, wsError("invalid_subscribe"));
+        return;
+    }
+
+    WireFormat format = WireFormat::JSON;
+    if (!parseFormat(doc["format"] | "json", format))
+    {
+        reply(client, wsError("invalid_format"));
+        return;
+    }
+
+    portENTER_CRITICAL(&mux);
+    int i = findLocked(client->id());
+    if (i >= 0)
+    {
+        Client &c = clients[i];
+
+        // Slots nuevos (o todos si cambia el formato) salen con su ultimo estado
+        uint32_t fresh = c.format != format ? filter : (filter & ~c.filter);
+        c.owed = (c.owed | (fresh & known)) & filter;
+        c.filter = filter;
+        c.format = format;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (i < 0)
+    {
+        reply(client, wsError("not_registered"));
+        return;
+    }
+
+    String out;
+    JsonDocument ack(requestAllocator());
+    ack["type"] = filter != 0 ? "subscribed" : "unsubscribed";
+    ack["format"] = formatName(format);
+    JsonArray slots = ack["slots"].to<JsonArray>();
+    for (int slot = 0; slot < MAX_SLOTS; ++slot)
+    {
+        if (filter & (1UL << slot)) slots.add(slot);
+    }
+    serializeJson(ack, out);
+    reply(client, out);
+
+    webService.wake();
+}
+
+void WsPush::drainEvents()
+{
+    AppEvent ev;
+    while (appEvents.poll(subId, ev) == RingRead::OK)
+    {
+        if (ev.type == AppEventType::REGISTRY_NEW || ev.slot >= MAX_SLOTS) continue;
+
+        uint32_t bit = 1UL << ev.slot;
+        st.events++;
+        if (dirty & bit) st.coalesced++;
+
+        last[ev.slot] = ev;
+        dirty |= bit;
+        known |= bit;
+    }
+}
+
+size_t WsPush::buildFrame(WireFormat format, uint32_t owed, uint32_t nowMs, uint32_t &sent)
+{
+    JsonWriter w;
+    w.setFormat(format);
+    w.target(frame, sizeof(frame));
+
+    w.beginObject(3);
+    w.fieldStr(K_TYPE, "slots");
+    w.fieldUint(K_SEQ, seq);
+    w.beginArray(K_SLOTS);
+
+    sent = 0;
+    for (int slot = 0; slot < MAX_SLOTS; ++slot)
+    {
+        uint32_t bit = 1UL << slot;
+        if (!(owed & bit)) continue;
+
+        // Lo que no entra queda para el frame siguiente
+        JsonWriter::Mark m = w.mark();
+        writeRow(w, slot, last[slot], nowMs);
+        if (w.overflow() || w.size() > sizeof(frame) - FRAME_TAIL)
+        {
+            w.rollback(m);
+            break;
+        }
+        sent |= bit;
+    }
+
+    w.endArray();
+    w.endObject();
+    return sent != 0 && !w.overflow() ? w.size() : 0;
+}
+
+void WsPush::flushClient(int index, uint32_t nowMs)
+{
+    portENTER_CRITICAL(&mux);
+    uint32_t id = clients[index].id;
+    uint32_t owed = clients[index].owed;
+    portEXIT_CRITICAL(&mux);
+
+    if (id == 0 || owed == 0) return;
+
+    // Con el lock tomado el cliente no se puede liberar: onDisconnect espera
+    if (!lockSend()) return;
+
+    portENTER_CRITICAL(&mux);
+    AsyncWebSocketClient *client = clients[index].id == id ? clients[index].conn : nullptr;
+    owed = clients[index].owed;
+    WireFormat format = clients[index].format;
+    portEXIT_CRITICAL(&mux);
+
+    while (client != nullptr && client->status() == WS_CONNECTED && owed != 0)
+    {
+        uint32_t sent = 0;
+        size_t len = buildFrame(format, owed, nowMs, sent);
+        if (len == 0) break;
+
+        // Solo sale si entra entero en la ventana TCP; si no, los slots quedan debidos
+        AsyncClient *tcp = client->client();
+        bool room = client->canSend() && tcp != nullptr && tcp->space() >= len + WS_HEADER_MAX;
+
+        if (room)
+        {
+            if (format == WireFormat::JSON)
+                client->text(frame, len);
+            else
+                client->binary(frame, len);
+
+            seq++;
+            owed &= ~sent;
+            st.frames++;
+            st.bytes += len;
+        }
+
+        portENTER_CRITICAL(&mux);
+        Client &c = clients[index];
+        if (room)
+        {
+            c.owed &= ~sent;
+            c.frames++;
+            c.bytes += len;
+            c.rows += __builtin_popcount(sent);
+            c.lastFrameBytes = static_cast<uint16_t>(len);
+            if (c.lastFrameBytes > c.maxFrameBytes) c.maxFrameBytes = c.lastFrameBytes;
+        }
+        else
+        {
+            c.deferred++;
+        }
+        portEXIT_CRITICAL(&mux);
+
+        if (!room) break;
+    }
+
+    unlockSend();
+}
+
+void WsPush::tick(uint32_t nowMs)
+{
+    if (ws == nullptr) return;
+
+    drainEvents();
+    if ((nowMs - lastTickMs) < WS_PUSH_TICK_MS) return;
+
+    lastTickMs = nowMs;
+    st.ticks++;
+
+    portENTER_CRITICAL(&mux);
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; ++i)
+    {
+        if (clients[i].id != 0) clients[i].owed |= dirty & clients[i].filter;
+    }
+    portEXIT_CRITICAL(&mux);
+    dirty = 0;
+
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; ++i)
+    {
+        flushClient(i, nowMs);
+    }
+
+    uint32_t elapsed = nowMs - rateStartMs;
+    if (elapsed >= 1000)
+    {
+        st.framesPerSec = (st.frames - rateFrames) * 1000UL / elapsed;
+        st.bytesPerSec = static_cast<uint32_t>((static_cast<uint64_t>(st.bytes - rateBytes) * 1000ULL) / elapsed);
+        rateStartMs = nowMs;
+        rateFrames = st.frames;
+        rateBytes = st.bytes;
+    }
+}
+
+uint32_t WsPush::waitMs() const
+{
+    if (clientCount == 0) return WEB_LOOP_IDLE_MS;
+
+    uint32_t elapsed = millis() - lastTickMs;
+    return elapsed >= WS_PUSH_TICK_MS ? 0 : WS_PUSH_TICK_MS - elapsed;
+}
+
+WsPushStats WsPush::stats() const
+{
+    WsPushStats out = st;
+
+    portENTER_CRITICAL(&mux);
+    uint32_t n = 0;
+    for (int i = 0; i < WS_PUSH_MAX_CLIENTS; ++i)
+    {
+        const Client &c = clients[i];
+        if (c.id == 0) continue;
+
+        WsPushClientStats &o = out.client[n++];
+        o.id = c.id;
+        o.filter = c.filter;
+        o.owed = c.owed;
+        o.format = c.format;
+        o.frames = c.frames;
+        o.bytes = c.bytes;
+        o.rows = c.rows;
+        o.deferred = c.deferred;
+        o.lastFrameBytes = c.lastFrameBytes;
+        o.maxFrameBytes = c.maxFrameBytes;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    out.clients = n;
+    return out;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <Arduino.h>
+#include <AsyncWebServer_ESP32_SC_W5500.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <json_writer.h>
+#include "core/app_events.h"
+#include "config.h"
+
+/*
+  Envio en vivo de slots por /ws.
+
+  Lee el bus de eventos como suscriptor "ws" y guarda el ultimo estado de
+  cada slot. Cada WS_PUSH_TICK_MS junta los slots que cambiaron y los
+  manda a los clientes que los filtraron: una rafaga de lecturas del mismo
+  slot sale como una sola fila con el valor mas nuevo.
+
+  El cliente se suscribe con un mensaje de texto:
+
+    {"subscribe":"all"|[0,3,7], "format":"json"|"msgpack"|"cbor"}
+    {"unsubscribe":true}
+
+  Cada cliente solo debe una mascara de slots pendientes. Un frame sale
+  cuando entra entero en la ventana TCP del cliente; si no, los slots
+  quedan debidos y en el tick siguiente se manda su estado mas nuevo. Asi
+  un cliente lento no acumula mensajes: a lo sumo un frame de
+  WS_PUSH_FRAME_MAX bytes por cliente queda en el heap.
+
+  Los eventos de conexion y los mensajes llegan desde la tarea de AsyncTCP;
+  tick() corre en el loop del WebService. El loop no busca clientes en la
+  lista del servidor, que AsyncTCP modifica y libera al desconectarse: usa
+  el puntero que guardo onConnect y solo con sendLock tomado. onDisconnect
+  corre dentro del cierre del cliente y toma el mismo lock antes de borrar
+  el puntero, asi el cierre espera a que termine un envio en curso.
+*/
+
+static_assert(MAX_SLOTS <= 32, "ws_push usa mascaras de 32 bits por slot");
+
+struct WsPushClientStats
+{
+    uint32_t id = 0;
+    uint32_t filter = 0;
+    uint32_t owed = 0;
+    WireFormat format = WireFormat::JSON;
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    uint32_t rows = 0;
+    uint32_t deferred = 0; // ticks sin lugar en la ventana TCP
+    uint16_t lastFrameBytes = 0;
+    uint16_t maxFrameBytes = 0;
+};
+
+struct WsPushStats
+{
+    uint32_t ticks = 0;
+    uint32_t events = 0;
+    uint32_t coalesced = 0; // lecturas pisadas por otra del mismo slot en el tick
+    uint32_t frames = 0;
+    uint32_t bytes = 0;
+    uint32_t framesPerSec = 0;
+    uint32_t bytesPerSec = 0;
+    uint32_t rejected = 0;  // conexiones sin lugar en la tabla
+    uint32_t clientStateBytes = 0;
+    uint32_t clients = 0;
+    WsPushClientStats client[WS_PUSH_MAX_CLIENTS];
+};
+
+class WsPush
+{
+public:
+    void begin(AsyncWebSocket &ws);
+
+    // Desde la tarea de AsyncTCP
+    void onConnect(AsyncWebSocketClient *client);
+    void onDisconnect(AsyncWebSocketClient *client);
+    void onMessage(AsyncWebSocketClient *client, const uint8_t *data, size_t len);
+
+    // Desde el loop del WebService
+    void tick(uint32_t nowMs);
+    uint32_t waitMs() const;
+
+    WsPushStats stats() const;
+
+private:
+    struct Client
+    {
+        uint32_t id;      // 0: libre
+        AsyncWebSocketClient *conn; // valido mientras id != 0; se usa con sendLock
+        uint32_t filter;
+        uint32_t owed;
+        WireFormat format;
+        uint32_t frames;
+        uint32_t bytes;
+        uint32_t rows;
+        uint32_t deferred;
+        uint16_t lastFrameBytes;
+        uint16_t maxFrameBytes;
+    };
+
+    bool lockSend();
+    void unlockSend();
+    void reply(AsyncWebSocketClient *client, const String &out);
+    int findLocked(uint32_t id) const;
+    void drainEvents();
+    size_t buildFrame(WireFormat format, uint32_t owed, uint32_t nowMs, uint32_t &sent);
+    void flushClient(int index, uint32_t nowMs);
+
+private:
+    AsyncWebSocket *ws = nullptr;
+    int subId = -1;
+
+    // Envios a los clientes, desde cualquiera de las dos tareas
+    SemaphoreHandle_t sendLock = nullptr;
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    Client clients[WS_PUSH_MAX_CLIENTS]{};
+    uint8_t clientCount = 0;
+
+    // Solo el loop del WebService
+    AppEvent last[MAX_SLOTS]{};
+    uint32_t known = 0;   // slots con algun estado
+    uint32_t dirty = 0;   // cambiados desde el ultimo tick
+    uint32_t lastTickMs = 0;
+    uint32_t seq = 0;
+    char frame[WS_PUSH_FRAME_MAX];
+
+    WsPushStats st;
+    uint32_t rateStartMs = 0;
+    uint32_t rateFrames = 0;
+    uint32_t rateBytes = 0;
+};
+
+extern WsPush wsPush;
@@ -1,4 +1,6 @@
 #include "ws_routes.h"
+#include "ws_push.h"
+#include "services/web_service.h"
 
 static AsyncWebSocket *g_ws = nullptr;
 
@@ -13,14 +15,22 @@ static void onWsEvent(
     if (type == WS_EVT_CONNECT)
     {
         Serial.printf("WS cliente conectado: %u\n", client->id());
+        wsPush.onConnect(client);
     }
     else if (type == WS_EVT_DISCONNECT)
     {
         Serial.printf("WS cliente desconectado: %u\n", client->id());
+        wsPush.onDisconnect(client);
+        webService.wake();
     }
     else if (type == WS_EVT_DATA)
     {
-        Serial.printf("WS data de cliente: %u\n", client->id());
+        // Solo mensajes de texto completos en un frame: las suscripciones son cortas
+        AwsFrameInfo *info = static_cast<AwsFrameInfo *>(arg);
+        if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT)
+        {
+            wsPush.onMessage(client, data, len);
+        }
     }
 }
 
@@ -28,6 +38,7 @@ void registerWsRoutes(AsyncWebSocket &ws)
 {
     g_ws = &ws;
     ws.onEvent(onWsEvent);
+    wsPush.begin(ws);
 }
 
 void wsBroadcastText(const char *msg)
@@ -0,0 +1,456 @@
+#include "alarm_rules.h"
+#include <LittleFS.h>
+#include <new>
+#include "driver/storage_fs.h"
+
+AlarmEngine alarmEngine;
+
+static_assert(MAX_SLOTS <= 32, "slotActiveMask usa un bit por slot");
+static_assert(ALARM_MAX_DELAY_S <= INT32_MAX / 1000, "el retardo en ms se compara contra una resta de millis()");
+
+static constexpr uint8_t FLAG_I2C_FAIL = 1 << 0;
+static constexpr uint8_t FLAG_BAT_LOW = 1 << 1;
+static constexpr uint8_t FLAG_TMP_FAIL = 1 << 2;
+
+static bool parseOp(const char *type, AlarmOp &op)
+{
+    if (strcmp(type, "tmp_above") == 0)
+    {
+        op = AlarmOp::TMP_ABOVE;
+        return true;
+    }
+
+    if (strcmp(type, "tmp_below") == 0)
+    {
+        op = AlarmOp::TMP_BELOW;
+        return true;
+    }
+
+    if (strcmp(type, "flag") == 0)
+    {
+        op = AlarmOp::FLAG_SET;
+        return true;
+    }
+
+    return false;
+}
+
+static uint8_t parseFlagMask(const char *flag)
+{
+    if (strcmp(flag, "i2c_fail") == 0) return FLAG_I2C_FAIL;
+    if (strcmp(flag, "bat_low") == 0) return FLAG_BAT_LOW;
+    if (strcmp(flag, "tmp_fail") == 0) return FLAG_TMP_FAIL;
+    return 0;
+}
+
+const char *AlarmEngine::opName(AlarmOp op)
+{
+    switch (op)
+    {
+    case AlarmOp::TMP_ABOVE:
+        return "tmp_above";
+    case AlarmOp::TMP_BELOW:
+        return "tmp_below";
+    case AlarmOp::FLAG_SET:
+        return "flag";
+    }
+    return "unknown";
+}
+
+bool AlarmEngine::lock(TickType_t timeout) const
+{
+    if (mutex == nullptr) return false;
+    return xSemaphoreTake(mutex, timeout) == pdTRUE;
+}
+
+void AlarmEngine::unlock() const
+{
+    if (mutex) xSemaphoreGive(mutex);
+}
+
+bool AlarmEngine::begin()
+{
+    if (mutex == nullptr)
+    {
+        mutex = xSemaphoreCreateMutex();
+    }
+
+    if (mutex == nullptr) return false;
+
+    // Sin archivo de reglas no hay alarmas, no es un error de arranque
+    loadRules();
+    return true;
+}
+
+bool AlarmEngine::compile(JsonDocument &doc, SlotAlarmTable *out, String &error) const
+{
+    JsonArray rules = doc["rules"].as<JsonArray>();
+    if (rules.isNull())
+    {
+        error = "missing_rules";
+        return false;
+    }
+
+    if (rules.size() > ALARM_MAX_RULES)
+    {
+        error = "too_many_rules";
+        return false;
+    }
+
+    for (int s = 0; s < MAX_SLOTS; ++s)
+    {
+        out[s] = {};
+    }
+
+    // El id identifica la regla en el estado que sobrevive a un guardado
+    uint32_t seenIds[256 / 32] = {};
+
+    for (JsonObject r : rules)
+    {
+        CompiledAlarmRule rule{};
+        int id = r["id"] | -1;
+        int slot = r["slot"] | -1;
+        const char *type = r["type"] | "";
+
+        if (id < 0 || id > 255)
+        {
+            error = "invalid_rule_id";
+            return false;
+        }
+
+        if (slot < -1 || slot >= MAX_SLOTS)
+        {
+            error = "invalid_rule_slot";
+            return false;
+        }
+
+        if (!parseOp(type, rule.op))
+        {
+            error = "invalid_rule_type";
+            return false;
+        }
+
+        if (seenIds[id / 32] & (1UL << (id % 32)))
+        {
+            error = "invalid_rule";
+            return false;
+        }
+        seenIds[id / 32] |= 1UL << (id % 32);
+
+        int64_t delayS = r["delay_s"] | static_cast<int64_t>(0);
+        if (delayS < 0 || delayS > ALARM_MAX_DELAY_S)
+        {
+            error = "invalid_rule_delay";
+            return false;
+        }
+
+        rule.id = static_cast<uint8_t>(id);
+        rule.delayMs = static_cast<uint32_t>(delayS) * 1000UL;
+
+        if (rule.op == AlarmOp::FLAG_SET)
+        {
+            rule.flagMask = parseFlagMask(r["flag"] | "");
+            if (rule.flagMask == 0)
+            {
+                error = "invalid_rule_flag";
+                return false;
+            }
+        }
+        else
+        {
+            if (r["value_x100"].isNull())
+            {
+                error = "missing_rule_value";
+                return false;
+            }
+
+            int value = r["value_x100"].as<int>();
+            int hyst = r["hyst_x100"] | 0;
+            if (hyst < 0) hyst = -hyst;
+
+            rule.setX100 = static_cast<int16_t>(constrain(value, -32768, 32767));
+            int clear = rule.op == AlarmOp::TMP_ABOVE ? value - hyst : value + hyst;
+            rule.clearX100 = static_cast<int16_t>(constrain(clear, -32768, 32767));
+        }
+
+        int first = slot < 0 ? 0 : slot;
+        int last = slot < 0 ? MAX_SLOTS - 1 : slot;
+
+        for (int s = first; s <= last; ++s)
+        {
+            if (out[s].count >= ALARM_MAX_RULES_PER_SLOT)
+            {
+                error = "too_many_rules_per_slot";
+                return false;
+            }
+
+            out[s].rules[out[s].count++] = rule;
+        }
+    }
+
+    return true;
+}
+
+bool AlarmEngine::loadRules()
+{
+    if (!LittleFS.exists(RULES_FILE))
+    {
+        return false;
+    }
+
+    File f = LittleFS.open(RULES_FILE, "r");
+    if (!f)
+    {
+        return false;
+    }
+
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+
+    if (err)
+    {
+        Serial.println("AlarmEngine: reglas corruptas");
+        return false;
+    }
+
+    // Se compila fuera del lock; solo el intercambio de tablas lo toma
+    SlotAlarmTable *compiled = new (std::nothrow) SlotAlarmTable[MAX_SLOTS];
+    if (compiled == nullptr)
+    {
+        return false;
+    }
+
+    String error;
+    if (!compile(doc, compiled, error))
+    {
+        Serial.printf("AlarmEngine: reglas invalidas (%s)\n", error.c_str());
+        delete[] compiled;
+        return false;
+    }
+
+    if (!lock())
+    {
+        delete[] compiled;
+        return false;
+    }
+
+    // Conserva el estado de las reglas que siguen existiendo
+    for (int s = 0; s < MAX_SLOTS; ++s)
+    {
+        for (int i = 0; i < compiled[s].count; ++i)
+        {
+            for (int j = 0; j < tables[s].count; ++j)
+            {
+                if (tables[s].rules[j].id == compiled[s].rules[i].id &&
+                    tables[s].rules[j].op == compiled[s].rules[i].op)
+                {
+                    compiled[s].state[i] = tables[s].state[j];
+                    break;
+                }
+            }
+        }
+    }
+
+    memcpy(tables, compiled, sizeof(tables));
+
+    slotActiveMask = 0;
+    for (int s = 0; s < MAX_SLOTS; ++s)
+    {
+        for (int i = 0; i < tables[s].count; ++i)
+        {
+            if (tables[s].state[i].active) slotActiveMask |= (1UL << s);
+        }
+    }
+
+    unlock();
+    delete[] compiled;
+    return true;
+}
+
+bool AlarmEngine::saveRules(JsonDocument &doc, String &error)
+{
+    SlotAlarmTable *check = new (std::nothrow) SlotAlarmTable[MAX_SLOTS];
+    if (check == nullptr)
+    {
+        error = "no_memory";
+        return false;
+    }
+
+    bool valid = compile(doc, check, error);
+    delete[] check;
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    if (!ensureConfigDir())
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    File f = LittleFS.open(RULES_FILE_TMP, "w");
+    if (!f)
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    JsonDocument stored;
+    stored["rules"] = doc["rules"];
+    size_t written = serializeJson(stored, f);
+    f.close();
+
+    if (!commitFile(RULES_FILE_TMP, RULES_FILE, written == measureJson(stored)))
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    if (!loadRules())
+    {
+        error = "load_failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool AlarmEngine::readRules(JsonDocument &doc) const
+{
+    File f = LittleFS.exists(RULES_FILE) ? LittleFS.open(RULES_FILE, "r") : File();
+    if (!f)
+    {
+        doc["rules"].to<JsonArray>();
+        return false;
+    }
+
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+
+    if (err)
+    {
+        doc.clear();
+        doc["rules"].to<JsonArray>();
+        return false;
+    }
+
+    return true;
+}
+
+void AlarmEngine::evaluate(int slot, const BeaconDecoded &read, uint32_t nowMs)
+{
+    if (slot < 0 || slot >= MAX_SLOTS) return;
+    if (!lock()) return;
+
+    SlotAlarmTable &table = tables[slot];
+    // Con i2c_fail o tmp_fail el tmp_x100 no es una lectura
+    bool tmpValid = (read.flags & (FLAG_I2C_FAIL | FLAG_TMP_FAIL)) == 0;
+    bool anyActive = false;
+
+    for (uint8_t i = 0; i < table.count; ++i)
+    {
+        const CompiledAlarmRule &rule = table.rules[i];
+        AlarmRuleState &st = table.state[i];
+        bool cond = false;
+
+        switch (rule.op)
+        {
+        case AlarmOp::TMP_ABOVE:
+            if (!tmpValid)
+            {
+                anyActive |= st.active;
+                continue;
+            }
+            st.lastValueX100 = read.tmp_x100;
+            cond = st.active ? read.tmp_x100 > rule.clearX100 : read.tmp_x100 > rule.setX100;
+            break;
+
+        case AlarmOp::TMP_BELOW:
+            if (!tmpValid)
+            {
+                anyActive |= st.active;
+                continue;
+            }
+            st.lastValueX100 = read.tmp_x100;
+            cond = st.active ? read.tmp_x100 < rule.clearX100 : read.tmp_x100 < rule.setX100;
+            break;
+
+        case AlarmOp::FLAG_SET:
+            st.lastValueX100 = read.flags;
+            cond = (read.flags & rule.flagMask) != 0;
+            break;
+        }
+
+        if (st.active)
+        {
+            if (!cond)
+            {
+                st.active = false;
+                st.pending = false;
+            }
+        }
+        else if (cond)
+        {
+            if (!st.pending)
+            {
+                st.pending = true;
+                st.pendingSinceMs = nowMs;
+            }
+
+            if ((nowMs - st.pendingSinceMs) >= rule.delayMs)
+            {
+                st.active = true;
+                st.pending = false;
+                st.activeSinceMs = nowMs;
+            }
+        }
+        else
+        {
+            st.pending = false;
+        }
+
+        anyActive |= st.active;
+    }
+
+    if (anyActive)
+        slotActiveMask |= (1UL << slot);
+    else
+        slotActiveMask &= ~(1UL << slot);
+
+    unlock();
+}
+
+bool AlarmEngine::isSlotInAlarm(int slot) const
+{
+    if (slot < 0 || slot >= MAX_SLOTS) return false;
+    return (slotActiveMask & (1UL << slot)) != 0;
+}
+
+uint32_t AlarmEngine::activeCount() const
+{
+    return static_cast<uint32_t>(__builtin_popcount(slotActiveMask));
+}
+
+size_t AlarmEngine::snapshot(AlarmStatusEntry *out, size_t maxCount) const
+{
+    if (out == nullptr) return 0;
+    if (!lock()) return 0;
+
+    size_t n = 0;
+    for (int s = 0; s < MAX_SLOTS && n < maxCount; ++s)
+    {
+        for (uint8_t i = 0; i < tables[s].count && n < maxCount; ++i)
+        {
+            out[n].slot = static_cast<uint8_t>(s);
+            out[n].rule = tables[s].rules[i];
+            out[n].state = tables[s].state[i];
+            n++;
+        }
+    }
+
+    unlock();
+    return n;
+}
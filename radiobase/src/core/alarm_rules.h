@@ -0,0 +1,93 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "driver/ble_types.h"
+#include "config.h"
+
+/*
+  Reglas de alarma definidas por el operador.
+
+  Se guardan en LittleFS como JSON (/config/alarm_rules.json) y al cargar
+  se compilan a una tabla de predicados por slot. La evaluacion en
+  beaconLogicTask recorre como maximo ALARM_MAX_RULES_PER_SLOT entradas,
+  sin importar cuantas reglas haya en total.
+
+  {"rules":[
+    {"id":1,"slot":-1,"type":"tmp_above","value_x100":800,"hyst_x100":50,"delay_s":300},
+    {"id":2,"slot":3,"type":"flag","flag":"bat_low"}
+  ]}
+*/
+
+enum class AlarmOp : uint8_t
+{
+    TMP_ABOVE = 1,
+    TMP_BELOW = 2,
+    FLAG_SET = 3,
+};
+
+struct CompiledAlarmRule
+{
+    uint8_t id;
+    AlarmOp op;
+    uint8_t flagMask;
+    int16_t setX100;   // umbral de disparo
+    int16_t clearX100; // umbral de liberacion (histeresis aplicada)
+    uint32_t delayMs;  // la condicion debe sostenerse este tiempo
+};
+
+struct AlarmRuleState
+{
+    bool active;
+    bool pending;
+    uint32_t pendingSinceMs;
+    uint32_t activeSinceMs;
+    int16_t lastValueX100;
+};
+
+struct SlotAlarmTable
+{
+    uint8_t count;
+    CompiledAlarmRule rules[ALARM_MAX_RULES_PER_SLOT];
+    AlarmRuleState state[ALARM_MAX_RULES_PER_SLOT];
+};
+
+struct AlarmStatusEntry
+{
+    uint8_t slot;
+    CompiledAlarmRule rule;
+    AlarmRuleState state;
+};
+
+class AlarmEngine
+{
+public:
+    bool begin();
+    bool loadRules();
+    bool saveRules(JsonDocument &doc, String &error);
+    bool readRules(JsonDocument &doc) const;
+
+    void evaluate(int slot, const BeaconDecoded &read, uint32_t nowMs);
+
+    bool isSlotInAlarm(int slot) const;
+    uint32_t activeCount() const;
+    size_t snapshot(AlarmStatusEntry *out, size_t maxCount) const;
+
+    static const char *opName(AlarmOp op);
+
+private:
+    static constexpr const char *RULES_FILE = "/config/alarm_rules.json";
+    static constexpr const char *RULES_FILE_TMP = "/config/alarm_rules.tmp";
+
+    bool compile(JsonDocument &doc, SlotAlarmTable *out, String &error) const;
+    bool lock(TickType_t timeout = portMAX_DELAY) const;
+    void unlock() const;
+
+private:
+    mutable SemaphoreHandle_t mutex = nullptr;
+    SlotAlarmTable tables[MAX_SLOTS]{};
+    uint32_t slotActiveMask = 0;
+};
+
+extern AlarmEngine alarmEngine;
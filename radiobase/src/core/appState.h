@@ -7,6 +7,20 @@
 #include "driver/ble_types.h"
 #include "driver/slot_manager.h"
 #include "driver/beacon_registry.h"
+#include "driver/scan_control.h"
+#include "driver/pipeline_bench.h"
+#include "driver/adv_harness.h"
+#include "core/alarm_rules.h"
+#include "core/zone_aggregator.h"
+#include "core/checkpoint.h"
+#include "core/slot_history.h"
+#include "core/history_store.h"
+#include "core/slot_rollups.h"
+#include "core/key_store.h"
+#include "core/radio_budget.h"
+#include "core/app_events.h"
+#include "api/json_arena.h"
+#include "api/gzip_pool.h"
 
 extern StorageNVS storage;
 extern SystemConfig sys;
@@ -24,6 +38,7 @@ struct BootStatus
     bool networkApplied = false;
     bool webReady = false;
     bool bleReady = false;
+    bool checkpointRestored = false;
     bool ready = false;
     uint32_t bootCompletedMs = 0;
     String lastError;
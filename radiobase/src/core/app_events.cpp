@@ -0,0 +1,154 @@
+#include "app_events.h"
+
+AppEvents appEvents;
+
+static constexpr uint8_t NO_SLOT = 0xFF;
+
+const char *AppEvents::typeName(AppEventType type)
+{
+    switch (type)
+    {
+    case AppEventType::SLOT_UPDATE:
+        return "slot_update";
+    case AppEventType::REGISTRY_NEW:
+        return "registry_new";
+    case AppEventType::SLOT_OFFLINE:
+        return "slot_offline";
+    }
+    return "unknown";
+}
+
+static void fillFromRead(AppEvent &ev, const BeaconDecoded &read)
+{
+    ev.flags = read.flags;
+    ev.batPct = read.bat_pct;
+    ev.tmpX100 = read.tmp_x100;
+    ev.cpuX100 = read.cpu_x100;
+    ev.rssi = read.rssi_read;
+    ev.deviceId = read.device_id;
+    ev.environmentId = read.environment_id;
+    ev.addr = read.addr;
+}
+
+void AppEvents::publish(const AppEvent &ev)
+{
+    ring.publish(ev);
+}
+
+void AppEvents::publishSlotUpdate(int slot, const BeaconDecoded &read, uint32_t nowMs)
+{
+    if (slot < 0 || slot >= MAX_SLOTS) return;
+
+    lastSeenMs[slot] = nowMs;
+    online[slot] = true;
+
+    AppEvent ev{};
+    ev.ms = nowMs;
+    ev.type = AppEventType::SLOT_UPDATE;
+    ev.slot = static_cast<uint8_t>(slot);
+    fillFromRead(ev, read);
+    publish(ev);
+}
+
+void AppEvents::publishRegistryNew(const BeaconDecoded &read, uint32_t nowMs)
+{
+    AppEvent ev{};
+    ev.ms = nowMs;
+    ev.type = AppEventType::REGISTRY_NEW;
+    ev.slot = NO_SLOT;
+    fillFromRead(ev, read);
+    publish(ev);
+}
+
+void AppEvents::sweepOffline(uint32_t nowMs)
+{
+    if ((nowMs - lastSweepMs) < APP_EVENT_SWEEP_MS) return;
+    lastSweepMs = nowMs;
+
+    for (int slot = 0; slot < MAX_SLOTS; ++slot)
+    {
+        if (!online[slot] || (nowMs - lastSeenMs[slot]) < SLOT_OFFLINE_MS) continue;
+
+        online[slot] = false;
+
+        AppEvent ev{};
+        ev.ms = nowMs;
+        ev.type = AppEventType::SLOT_OFFLINE;
+        ev.slot = static_cast<uint8_t>(slot);
+        publish(ev);
+    }
+}
+
+int AppEvents::subscribe(const char *name)
+{
+    portENTER_CRITICAL(&subMux);
+    int id = -1;
+    if (subCount < APP_EVENT_MAX_SUBSCRIBERS)
+    {
+        id = subCount++;
+        subs[id].name = name;
+        subs[id].cursor = ring.headSeq();
+        subs[id].delivered = 0;
+        subs[id].skipped = 0;
+    }
+    portEXIT_CRITICAL(&subMux);
+    return id;
+}
+
+RingRead AppEvents::poll(int id, AppEvent &out)
+{
+    portENTER_CRITICAL(&subMux);
+    bool valid = id >= 0 && id < subCount;
+    uint32_t cursor = valid ? subs[id].cursor : 0;
+    portEXIT_CRITICAL(&subMux);
+
+    if (!valid) return RingRead::EMPTY;
+
+    // La copia del evento va fuera de la seccion critica; solo esta tarea mueve el cursor
+    uint32_t skipped = 0;
+    RingRead r = ring.read(cursor, out, skipped);
+
+    portENTER_CRITICAL(&subMux);
+    Subscriber &s = subs[id];
+    s.cursor = cursor;
+    s.skipped += skipped;
+    if (r == RingRead::OK) s.delivered++;
+    portEXIT_CRITICAL(&subMux);
+    return r;
+}
+
+RingRead AppEvents::readAt(uint32_t &cursor, AppEvent &out, uint32_t &skipped) const
+{
+    return ring.read(cursor, out, skipped);
+}
+
+uint32_t AppEvents::head() const
+{
+    return ring.headSeq();
+}
+
+uint32_t AppEvents::oldest() const
+{
+    return ring.oldestSeq();
+}
+
+AppEventStats AppEvents::stats() const
+{
+    AppEventStats out;
+
+    // head se lee despues de fijar los cursores: el lag nunca da negativo
+    portENTER_CRITICAL(&subMux);
+    out.head = ring.headSeq();
+    out.oldest = ring.oldestSeq();
+    out.subscribers = subCount;
+    for (uint8_t i = 0; i < subCount; ++i)
+    {
+        out.subs[i].name = subs[i].name;
+        out.subs[i].delivered = subs[i].delivered;
+        out.subs[i].skipped = subs[i].skipped;
+        out.subs[i].lag = out.head - subs[i].cursor;
+    }
+    portEXIT_CRITICAL(&subMux);
+
+    return out;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <Arduino.h>
+#include <broadcast_ring.h>
+#include "driver/ble_types.h"
+#include "config.h"
+
+/*
+  Bus de eventos de la aplicacion.
+
+  El pipeline BLE (unico productor) publica actualizaciones de slot,
+  beacons nuevos en el registro y slots que pasan a offline en un anillo
+  de difusion. Cada consumidor lee a su ritmo con su propio cursor: uno
+  suscrito por nombre (WebSocket, MQTT, ...) o uno externo que trae el
+  cliente HTTP. Un consumidor lento no frena al pipeline; salta adelante
+  y los eventos perdidos quedan contados.
+*/
+
+enum class AppEventType : uint8_t
+{
+    SLOT_UPDATE = 1,
+    REGISTRY_NEW = 2,
+    SLOT_OFFLINE = 3,
+};
+
+struct AppEvent
+{
+    uint32_t ms;
+    AppEventType type;
+    uint8_t slot;    // 0xFF si no aplica
+    uint8_t flags;
+    int8_t batPct;
+    int16_t tmpX100;
+    int16_t cpuX100;
+    int8_t rssi;
+    uint8_t deviceId;
+    uint8_t environmentId;
+    uint8_t reserved;
+    uint64_t addr;
+};
+
+static_assert(sizeof(AppEvent) == 24, "AppEvent debe ocupar 24 bytes");
+
+struct AppEventSubscriberInfo
+{
+    const char *name = nullptr;
+    uint32_t delivered = 0;
+    uint32_t skipped = 0;
+    uint32_t lag = 0;
+};
+
+struct AppEventStats
+{
+    uint32_t head = 0;
+    uint32_t oldest = 0;
+    uint32_t subscribers = 0;
+    AppEventSubscriberInfo subs[APP_EVENT_MAX_SUBSCRIBERS];
+};
+
+class AppEvents
+{
+public:
+    // Productor: solo la tarea de logica del pipeline BLE
+    void publishSlotUpdate(int slot, const BeaconDecoded &read, uint32_t nowMs);
+    void publishRegistryNew(const BeaconDecoded &read, uint32_t nowMs);
+    // Publica SLOT_OFFLINE para slots sin lecturas en SLOT_OFFLINE_MS
+    void sweepOffline(uint32_t nowMs);
+
+    // Consumidor suscrito; cada id lo lee una sola tarea. -1 si no hay lugar
+    int subscribe(const char *name);
+    RingRead poll(int id, AppEvent &out);
+
+    // Consumidor con cursor propio (p. ej. HTTP)
+    RingRead readAt(uint32_t &cursor, AppEvent &out, uint32_t &skipped) const;
+    uint32_t head() const;
+    uint32_t oldest() const;
+
+    AppEventStats stats() const;
+    static const char *typeName(AppEventType type);
+
+private:
+    struct Subscriber
+    {
+        const char *name;
+        uint32_t cursor;
+        uint32_t delivered;
+        uint32_t skipped;
+    };
+
+    void publish(const AppEvent &ev);
+
+private:
+    BroadcastRing<AppEvent, APP_EVENT_RING_LEN> ring;
+    // Protege la tabla de suscriptores y sus contadores frente a stats()
+    mutable portMUX_TYPE subMux = portMUX_INITIALIZER_UNLOCKED;
+    Subscriber subs[APP_EVENT_MAX_SUBSCRIBERS]{};
+    uint8_t subCount = 0;
+
+    // Estado del productor
+    uint32_t lastSeenMs[MAX_SLOTS]{};
+    bool online[MAX_SLOTS]{};
+    uint32_t lastSweepMs = 0;
+};
+
+extern AppEvents appEvents;
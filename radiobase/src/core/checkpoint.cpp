@@ -0,0 +1,255 @@
+#include "checkpoint.h"
+#include <LittleFS.h>
+#include <stddef.h>
+#include <esp_attr.h>
+#include <esp_rom_crc.h>
+#include <esp_timer.h>
+#include "core/appState.h"
+#include "driver/storage_fs.h"
+
+CheckpointService checkpoint;
+
+static constexpr uint32_t CHECKPOINT_MAGIC = 0x434B5054; // "CKPT"
+static constexpr uint16_t CHECKPOINT_VERSION = 1;
+static constexpr uint32_t BOOT_MAGIC = 0x424F4F54;       // "BOOT"
+
+RTC_NOINIT_ATTR static uint8_t rtcImage[sizeof(SlotState) * MAX_SLOTS +
+                                        sizeof(DiscoveredBeacon) * MAX_DISCOVERED_BEACONS +
+                                        sizeof(BlePipelineStats) + 64] __attribute__((aligned(8)));
+RTC_NOINIT_ATTR static uint32_t rtcBootMagic;
+RTC_NOINIT_ATTR static uint32_t rtcBootCount;
+
+// Imagen de trabajo: fuera del stack de la tarea
+static uint8_t workImage[sizeof(rtcImage)] __attribute__((aligned(8)));
+
+bool CheckpointService::isValid(const Image &img)
+{
+    if (img.magic != CHECKPOINT_MAGIC || img.version != CHECKPOINT_VERSION || img.size != sizeof(Image))
+    {
+        return false;
+    }
+
+    uint32_t crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&img), offsetof(Image, crc));
+    return crc == img.crc;
+}
+
+void CheckpointService::seal(Image &img)
+{
+    img.magic = CHECKPOINT_MAGIC;
+    img.version = CHECKPOINT_VERSION;
+    img.size = sizeof(Image);
+    img.crc = esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(&img), offsetof(Image, crc));
+}
+
+bool CheckpointService::readFile(Image &img) const
+{
+    if (!LittleFS.exists(CHECKPOINT_FILE))
+    {
+        return false;
+    }
+
+    File f = LittleFS.open(CHECKPOINT_FILE, "rb");
+    if (!f)
+    {
+        return false;
+    }
+
+    size_t readBytes = f.readBytes(reinterpret_cast<char *>(&img), sizeof(Image));
+    f.close();
+
+    return readBytes == sizeof(Image) && isValid(img);
+}
+
+bool CheckpointService::writeFile(const Image &img)
+{
+    if (!ensureConfigDir())
+    {
+        return false;
+    }
+
+    File f = LittleFS.open(CHECKPOINT_FILE_TMP, "wb");
+    if (!f)
+    {
+        return false;
+    }
+
+    size_t written = f.write(reinterpret_cast<const uint8_t *>(&img), sizeof(Image));
+    f.close();
+
+    return commitFile(CHECKPOINT_FILE_TMP, CHECKPOINT_FILE, written == sizeof(Image));
+}
+
+void CheckpointService::apply(const Image &img)
+{
+    slotManager.restoreSlots(img.slots, img.capturedMs);
+    beaconRegistry.restore(img.registry, MAX_DISCOVERED_BEACONS);
+    bleStatsRestore(img.stats);
+}
+
+bool CheckpointService::restore()
+{
+    static_assert(sizeof(Image) <= sizeof(rtcImage), "rtcImage demasiado chico");
+
+    if (rtcBootMagic != BOOT_MAGIC)
+    {
+        rtcBootMagic = BOOT_MAGIC;
+        rtcBootCount = 0;
+    }
+    rtcBootCount++;
+
+    const Image &rtc = *reinterpret_cast<const Image *>(rtcImage);
+    Image &fs = *reinterpret_cast<Image *>(workImage);
+
+    bool rtcOk = isValid(rtc);
+    bool fsOk = readFile(fs);
+
+    const Image *best = nullptr;
+    const char *source = "none";
+
+    if (rtcOk && (!fsOk || rtc.seq >= fs.seq))
+    {
+        best = &rtc;
+        source = "rtc";
+    }
+    else if (fsOk)
+    {
+        best = &fs;
+        source = "fs";
+    }
+
+    portENTER_CRITICAL(&infoMux);
+    stats.bootCount = rtcBootCount;
+    stats.source = source;
+    if (best)
+    {
+        stats.restoredSeq = best->seq;
+        stats.restoredUptimeMs = best->capturedMs;
+        nextSeq = best->seq + 1;
+    }
+    portEXIT_CRITICAL(&infoMux);
+
+    if (best == nullptr)
+    {
+        return false;
+    }
+
+    apply(*best);
+    Serial.printf("Checkpoint: restaurado desde %s (seq=%lu)\n", source, static_cast<unsigned long>(best->seq));
+    return true;
+}
+
+bool CheckpointService::capture(Image &img)
+{
+    // Nunca se espera por el mutex de slots: si esta ocupado se salta la ronda
+    if (!slotManager.snapshotSlots(img.slots, 0))
+    {
+        return false;
+    }
+
+    if (!beaconRegistry.snapshot(img.registry, MAX_DISCOVERED_BEACONS))
+    {
+        return false;
+    }
+
+    img.stats = bleStatsSnapshot();
+    img.capturedMs = millis();
+    img.seq = nextSeq++;
+    seal(img);
+    return true;
+}
+
+void CheckpointService::record(bool rtc, bool fs, bool fsOk, uint32_t captureUs)
+{
+    uint32_t now = millis();
+
+    portENTER_CRITICAL(&infoMux);
+    stats.seq = nextSeq - 1;
+    stats.lastCaptureUs = captureUs;
+    if (rtc)
+    {
+        stats.rtcWrites++;
+        stats.lastRtcMs = now;
+    }
+    if (fs)
+    {
+        if (fsOk)
+        {
+            stats.fsWrites++;
+            stats.lastFsMs = now;
+        }
+        else
+        {
+            stats.fsErrors++;
+        }
+    }
+    portEXIT_CRITICAL(&infoMux);
+}
+
+CheckpointInfo CheckpointService::info() const
+{
+    portENTER_CRITICAL(&infoMux);
+    CheckpointInfo snapshot = stats;
+    portEXIT_CRITICAL(&infoMux);
+    return snapshot;
+}
+
+bool CheckpointService::begin()
+{
+    if (taskHandle != nullptr)
+    {
+        return true;
+    }
+
+    // Prioridad baja y en el core 0: no compite con las tareas de ingesta
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        checkpointTask,
+        "checkpointTask",
+        4096,
+        this,
+        1,
+        &taskHandle,
+        0);
+
+    if (ok != pdPASS)
+    {
+        Serial.println("CheckpointService: No se pudo iniciar checkpointTask");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void CheckpointService::checkpointTask(void *pvParameters)
+{
+    CheckpointService *self = static_cast<CheckpointService *>(pvParameters);
+    Image &img = *reinterpret_cast<Image *>(workImage);
+    uint32_t lastFsMs = millis();
+
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(CHECKPOINT_RTC_INTERVAL_MS));
+
+        int64_t t0 = esp_timer_get_time();
+        if (!self->capture(img))
+        {
+            portENTER_CRITICAL(&self->infoMux);
+            self->stats.skipped++;
+            portEXIT_CRITICAL(&self->infoMux);
+            continue;
+        }
+
+        memcpy(rtcImage, &img, sizeof(Image));
+        uint32_t captureUs = static_cast<uint32_t>(esp_timer_get_time() - t0);
+
+        bool fsDue = (millis() - lastFsMs) >= CHECKPOINT_FS_INTERVAL_MS;
+        bool fsOk = false;
+        if (fsDue)
+        {
+            lastFsMs = millis();
+            fsOk = self->writeFile(img);
+        }
+
+        self->record(true, fsDue, fsOk, captureUs);
+    }
+}
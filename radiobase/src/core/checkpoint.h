@@ -0,0 +1,77 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <ble_pipeline_stats.h>
+#include "driver/ble_types.h"
+#include "driver/beacon_registry.h"
+#include "config.h"
+
+/*
+  Checkpoint de arranque en caliente.
+
+  Cada CHECKPOINT_RTC_INTERVAL_MS se copia el estado de slots, registro y
+  estadisticas a memoria RTC no inicializada (sobrevive a reset por
+  software o watchdog). Cada CHECKPOINT_FS_INTERVAL_MS se guarda ademas en
+  LittleFS para el caso de corte de energia. Ambos van validados por CRC;
+  en setup() se restaura la copia valida mas reciente.
+*/
+
+struct CheckpointInfo
+{
+    const char *source = "none";
+    uint32_t bootCount = 0;
+    uint32_t restoredSeq = 0;
+    uint32_t restoredUptimeMs = 0; // uptime del arranque anterior al capturar
+    uint32_t seq = 0;
+    uint32_t rtcWrites = 0;
+    uint32_t fsWrites = 0;
+    uint32_t fsErrors = 0;
+    uint32_t skipped = 0;
+    uint32_t lastRtcMs = 0;
+    uint32_t lastFsMs = 0;
+    uint32_t lastCaptureUs = 0;
+};
+
+class CheckpointService
+{
+public:
+    bool restore();
+    bool begin();
+    CheckpointInfo info() const;
+
+    static void checkpointTask(void *pvParameters);
+
+private:
+    struct Image
+    {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        uint32_t seq;
+        uint32_t capturedMs;
+        SlotState slots[MAX_SLOTS];
+        DiscoveredBeacon registry[MAX_DISCOVERED_BEACONS];
+        BlePipelineStats stats;
+        uint32_t crc;
+    };
+
+    static constexpr const char *CHECKPOINT_FILE = "/config/checkpoint.bin";
+    static constexpr const char *CHECKPOINT_FILE_TMP = "/config/checkpoint.tmp";
+
+    static bool isValid(const Image &img);
+    static void seal(Image &img);
+    bool capture(Image &img);
+    bool writeFile(const Image &img);
+    bool readFile(Image &img) const;
+    void apply(const Image &img);
+    void record(bool rtc, bool fs, bool fsOk, uint32_t captureUs);
+
+private:
+    TaskHandle_t taskHandle = nullptr;
+    mutable portMUX_TYPE infoMux = portMUX_INITIALIZER_UNLOCKED;
+    CheckpointInfo stats;
+    uint32_t nextSeq = 1;
+};
+
+extern CheckpointService checkpoint;
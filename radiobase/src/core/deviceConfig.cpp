@@ -53,6 +53,8 @@ FeatureConfig DeviceConfig::loadFeatures()
     storage->readBool("feat.eth", cfg.ethernetEnable, true);
     storage->readBool("feat.ap", cfg.wifiApEnable, true);
     storage->readBool("feat.sta", cfg.wifiStaEnable, false);
+    storage->readBool("feat.blefilt", cfg.bleFilterEnable, false);
+    storage->readBool("feat.blesched", cfg.bleScheduleEnable, false);
 
     return cfg;
 }
@@ -67,6 +69,8 @@ FeatureConfig DeviceConfig::saveFeatures(const FeatureConfig &in)
     storage->writeBool("feat.eth", in.ethernetEnable);
     storage->writeBool("feat.ap", in.wifiApEnable);
     storage->writeBool("feat.sta", in.wifiStaEnable);
+    storage->writeBool("feat.blefilt", in.bleFilterEnable);
+    storage->writeBool("feat.blesched", in.bleScheduleEnable);
 
     return in;
 }
@@ -137,6 +141,56 @@ UserConfig DeviceConfig::saveUsers(const UserConfig &in)
     return in;
 }
 
+PipelineConfig DeviceConfig::loadPipeline()
+{
+    PipelineConfig cfg;
+    cfg.fused = PIPELINE_FUSED_DEFAULT;
+    cfg.decodePriority = PIPELINE_DECODE_PRIORITY;
+    cfg.decodeCore = PIPELINE_DECODE_CORE;
+    cfg.decodeStack = PIPELINE_DECODE_STACK;
+    cfg.logicPriority = PIPELINE_LOGIC_PRIORITY;
+    cfg.logicCore = PIPELINE_LOGIC_CORE;
+    cfg.logicStack = PIPELINE_LOGIC_STACK;
+
+    if (storage == nullptr)
+    {
+        return cfg;
+    }
+
+    uint16_t v = 0;
+    storage->readBool("pipe.fused", cfg.fused, PIPELINE_FUSED_DEFAULT);
+    storage->readUShort("pipe.dprio", v, PIPELINE_DECODE_PRIORITY);
+    cfg.decodePriority = static_cast<uint8_t>(v);
+    storage->readUShort("pipe.dcore", v, PIPELINE_DECODE_CORE);
+    cfg.decodeCore = static_cast<uint8_t>(v);
+    storage->readUShort("pipe.dstack", cfg.decodeStack, PIPELINE_DECODE_STACK);
+    storage->readUShort("pipe.lprio", v, PIPELINE_LOGIC_PRIORITY);
+    cfg.logicPriority = static_cast<uint8_t>(v);
+    storage->readUShort("pipe.lcore", v, PIPELINE_LOGIC_CORE);
+    cfg.logicCore = static_cast<uint8_t>(v);
+    storage->readUShort("pipe.lstack", cfg.logicStack, PIPELINE_LOGIC_STACK);
+
+    return cfg;
+}
+
+PipelineConfig DeviceConfig::savePipeline(const PipelineConfig &in)
+{
+    if (storage == nullptr)
+    {
+        return in;
+    }
+
+    storage->writeBool("pipe.fused", in.fused);
+    storage->writeUShort("pipe.dprio", in.decodePriority);
+    storage->writeUShort("pipe.dcore", in.decodeCore);
+    storage->writeUShort("pipe.dstack", in.decodeStack);
+    storage->writeUShort("pipe.lprio", in.logicPriority);
+    storage->writeUShort("pipe.lcore", in.logicCore);
+    storage->writeUShort("pipe.lstack", in.logicStack);
+
+    return in;
+}
+
 NetworkConfig DeviceConfig::loadNetwork()
 {
     NetworkConfig cfg;
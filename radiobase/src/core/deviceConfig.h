@@ -16,6 +16,19 @@ struct FeatureConfig {
     bool ethernetEnable;
     bool wifiApEnable;
     bool wifiStaEnable;
+    bool bleFilterEnable;
+    bool bleScheduleEnable;
+};
+
+// Topologia del pipeline BLE; se aplica al arrancar
+struct PipelineConfig {
+    bool fused;
+    uint8_t decodePriority;
+    uint8_t decodeCore;
+    uint16_t decodeStack;
+    uint8_t logicPriority;
+    uint8_t logicCore;
+    uint16_t logicStack;
 };
 
 class DeviceConfig {
@@ -32,6 +45,9 @@ public:
     NetworkConfig loadNetwork();
     NetworkConfig saveNetwork(const NetworkConfig& in);
 
+    PipelineConfig loadPipeline();
+    PipelineConfig savePipeline(const PipelineConfig& in);
+
     UserConfig loadUsers();
     UserConfig saveUsers(const UserConfig& in);
     UserEntry* loadRole(UserConfig& cfg,const String& role);
@@ -0,0 +1,180 @@
+#include "history_store.h"
+#include "core/slot_history.h"
+
+HistoryStore historyStore;
+
+// Antiguedad maxima de una muestra al escribirse: acota la busqueda por segmento
+static constexpr uint32_t HISTORY_LOG_MAX_LAG_MS = HISTORY_LOG_FLUSH_MS + 2 * HISTORY_LOG_TICK_MS;
+
+bool HistoryStore::lock(TickType_t timeout) const
+{
+    return mutex != nullptr && xSemaphoreTake(mutex, timeout) == pdTRUE;
+}
+
+void HistoryStore::unlock() const
+{
+    xSemaphoreGive(mutex);
+}
+
+bool HistoryStore::begin()
+{
+    if (taskHandle != nullptr)
+    {
+        return true;
+    }
+
+    if (mutex == nullptr)
+    {
+        mutex = xSemaphoreCreateMutex();
+    }
+
+    if (mutex == nullptr || !partition.begin(HISTORY_LOG_PARTITION))
+    {
+        return false;
+    }
+
+    // Replay del log: ubica el segmento activo y descarta frames cortados
+    if (!log.begin(&partition, HISTORY_LOG_SEGMENT_BYTES, HISTORY_LOG_MAX_LAG_MS))
+    {
+        Serial.println("HistoryStore: Particion de historial invalida");
+        return false;
+    }
+
+    timeBase = log.empty() ? 0 : log.lastTs() + 1;
+
+    uint32_t now = millis();
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        nextDueMs[i] = now;
+    }
+
+    HistoryLogStats s = log.stats();
+    Serial.printf("HistoryStore: %lu/%lu segmentos, %lu frames en replay, %lu cortados\n",
+                  static_cast<unsigned long>(s.segmentsUsed),
+                  static_cast<unsigned long>(s.segments),
+                  static_cast<unsigned long>(s.replayFrames),
+                  static_cast<unsigned long>(s.tornFrames + s.crcErrors));
+
+    BaseType_t created = xTaskCreatePinnedToCore(
+        historyStoreTask,
+        "historyStoreTask",
+        4096,
+        this,
+        1,
+        &taskHandle,
+        0);
+
+    if (created != pdPASS)
+    {
+        Serial.println("HistoryStore: No se pudo iniciar historyStoreTask");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    ok = true;
+    return true;
+}
+
+bool HistoryStore::ready() const
+{
+    return ok;
+}
+
+uint64_t HistoryStore::nowTs() const
+{
+    return timeBase + millis();
+}
+
+bool HistoryStore::open(HistoryLogCursor &cur, int slot, uint64_t fromTs, uint64_t toTs, uint32_t stepMs)
+{
+    if (!ok || slot < 0 || slot >= MAX_SLOTS) return false;
+    if (!lock(pdMS_TO_TICKS(200))) return false;
+
+    bool opened = log.open(cur, static_cast<uint8_t>(slot), fromTs, toTs, stepMs);
+    unlock();
+    return opened;
+}
+
+size_t HistoryStore::read(HistoryLogCursor &cur, HistorySample *out, size_t maxCount)
+{
+    if (!ok || cur.done) return 0;
+    if (!lock(pdMS_TO_TICKS(200))) return 0;
+
+    size_t n = log.read(cur, out, maxCount);
+    unlock();
+    return n;
+}
+
+HistoryLogStats HistoryStore::stats()
+{
+    HistoryLogStats s;
+    if (!ok || !lock(pdMS_TO_TICKS(200))) return s;
+
+    s = log.stats();
+    unlock();
+    return s;
+}
+
+void HistoryStore::flushSlot(int slot)
+{
+    if (pendingCount[slot] == 0) return;
+
+    if (lock())
+    {
+        log.append(static_cast<uint8_t>(slot), pending[slot], pendingCount[slot], nowTs());
+        unlock();
+    }
+
+    // Si la escritura falla el lote se descarta: el log registra el error
+    pendingCount[slot] = 0;
+}
+
+void HistoryStore::collect(uint32_t nowMs)
+{
+    uint64_t now = nowTs();
+
+    for (int slot = 0; slot < MAX_SLOTS; ++slot)
+    {
+        // Una muestra por periodo: la primera del anillo desde nextDueMs
+        for (;;)
+        {
+            HistoryCursor cur;
+            HistoryRecord rec;
+
+            if (!slotHistory.open(cur, slot, nextDueMs[slot], nowMs, 0)) break;
+            if (slotHistory.read(cur, &rec, 1) == 0) break;
+
+            HistorySample &s = pending[slot][pendingCount[slot]++];
+            s.tsMs = timeBase + rec.ts_ms;
+            s.tmpX100 = rec.tmp_x100;
+            s.cpuX100 = rec.cpu_x100;
+            s.batPct = rec.bat_pct;
+            s.flags = rec.flags;
+            s.rssi = rec.rssi;
+            nextDueMs[slot] = rec.ts_ms + HISTORY_LOG_PERIOD_MS;
+
+            if (pendingCount[slot] == HISTORY_FRAME_MAX_SAMPLES)
+            {
+                flushSlot(slot);
+            }
+        }
+
+        if (pendingCount[slot] > 0 && (now - pending[slot][0].tsMs) >= HISTORY_LOG_FLUSH_MS)
+        {
+            flushSlot(slot);
+        }
+    }
+}
+
+void HistoryStore::historyStoreTask(void *pvParameters)
+{
+    HistoryStore *self = static_cast<HistoryStore *>(pvParameters);
+
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(HISTORY_LOG_TICK_MS));
+
+        if (!slotHistory.ready()) continue;
+        self->collect(millis());
+    }
+}
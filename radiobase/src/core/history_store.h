@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <history_log.h>
+#include "driver/storage_partition.h"
+#include "config.h"
+
+/*
+  Historial persistente en la particion "history".
+
+  Una tarea de baja prioridad toma del anillo en PSRAM una muestra por slot
+  cada HISTORY_LOG_PERIOD_MS, las agrupa por slot y las escribe como frames
+  comprimidos en el log (ver lib/historyLog). Un lote se escribe al llenarse
+  o cuando su muestra mas vieja supera HISTORY_LOG_FLUSH_MS, que es lo
+  maximo que se pierde ante un corte de energia.
+
+  Los tiempos del log son ms monotonicos entre arranques: al arrancar se
+  continua desde el ultimo tiempo escrito, sin contar el tiempo apagado.
+*/
+
+class HistoryStore
+{
+public:
+    bool begin();
+    bool ready() const;
+
+    uint64_t nowTs() const;
+
+    bool open(HistoryLogCursor &cur, int slot, uint64_t fromTs, uint64_t toTs, uint32_t stepMs);
+    size_t read(HistoryLogCursor &cur, HistorySample *out, size_t maxCount);
+    HistoryLogStats stats();
+
+    static void historyStoreTask(void *pvParameters);
+
+private:
+    void collect(uint32_t nowMs);
+    void flushSlot(int slot);
+    bool lock(TickType_t timeout = portMAX_DELAY) const;
+    void unlock() const;
+
+private:
+    StoragePartition partition;
+    HistoryLog log;
+    mutable SemaphoreHandle_t mutex = nullptr;
+    TaskHandle_t taskHandle = nullptr;
+    bool ok = false;
+    uint64_t timeBase = 0;
+
+    uint32_t nextDueMs[MAX_SLOTS]{};
+    uint8_t pendingCount[MAX_SLOTS]{};
+    HistorySample pending[MAX_SLOTS][HISTORY_FRAME_MAX_SAMPLES]{};
+};
+
+extern HistoryStore historyStore;
@@ -0,0 +1,283 @@
+#include "key_store.h"
+
+KeyStore keyStore;
+
+// Clave de fabrica, la misma que trae el firmware del beacon
+static const uint8_t DEFAULT_KEY[16] = {
+    0xA3, 0x7F, 0x1C, 0xD9, 0x88, 0x4E, 0x21, 0xB6,
+    0x59, 0x02, 0xEF, 0xC4, 0x6A, 0x90, 0x13, 0xDD};
+
+static const char *DEFAULT_KEY_HEX = "A37F1CD9884E21B65902EFC46A9013DD";
+
+bool KeyStore::lock()
+{
+    return mutex != nullptr && xSemaphoreTake(mutex, portMAX_DELAY) == pdTRUE;
+}
+
+void KeyStore::unlock()
+{
+    xSemaphoreGive(mutex);
+}
+
+bool KeyStore::parseHex(const String &hex, uint8_t out[16])
+{
+    if (hex.length() != 32)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < 16; ++i)
+    {
+        char pair[3] = {hex[i * 2], hex[i * 2 + 1], 0};
+        if (!isxdigit(static_cast<unsigned char>(pair[0])) || !isxdigit(static_cast<unsigned char>(pair[1])))
+        {
+            return false;
+        }
+        out[i] = static_cast<uint8_t>(strtoul(pair, nullptr, 16));
+    }
+
+    return true;
+}
+
+bool KeyStore::hasId(uint8_t id) const
+{
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        if (ids[i] == id) return true;
+    }
+    return false;
+}
+
+bool KeyStore::install(uint8_t id, const uint8_t key[16], uint32_t retireAt)
+{
+    if (!aes_key_set(id, key, retireAt))
+    {
+        Serial.printf("KeyStore: No se pudo instalar la clave %u\n", id);
+        return false;
+    }
+
+    if (!hasId(id))
+    {
+        ids[count++] = id;
+    }
+    return true;
+}
+
+bool KeyStore::persist(uint8_t id, const String &hex, uint32_t retireAt)
+{
+    char key[16];
+
+    snprintf(key, sizeof(key), "key.%u", id);
+    if (!storage->writeString(key, hex)) return false;
+
+    snprintf(key, sizeof(key), "keyr.%u", id);
+    return storage->writeUInt(key, retireAt);
+}
+
+bool KeyStore::saveIds()
+{
+    String list;
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        if (i > 0) list += ",";
+        list += String(ids[i]);
+    }
+
+    // NVS no guarda cadenas vacias: sin claves se borra la lista
+    if (list.isEmpty())
+    {
+        return storage->remove("keys.ids");
+    }
+    return storage->writeString("keys.ids", list);
+}
+
+bool KeyStore::begin(StorageNVS *nvs)
+{
+    if (mutex == nullptr)
+    {
+        mutex = xSemaphoreCreateMutex();
+    }
+    if (!lock()) return false;
+
+    storage = nvs;
+    count = 0;
+
+    String list;
+    if (storage == nullptr || !storage->readString("keys.ids", list))
+    {
+        bool ok = install(0, DEFAULT_KEY, 0) && install(BEACON_KEY_ID_DEFAULT, DEFAULT_KEY, 0);
+        if (ok && storage != nullptr)
+        {
+            ok = persist(0, DEFAULT_KEY_HEX, 0) && persist(BEACON_KEY_ID_DEFAULT, DEFAULT_KEY_HEX, 0) && saveIds();
+        }
+        unlock();
+        return ok;
+    }
+
+    int start = 0;
+    while (start < static_cast<int>(list.length()))
+    {
+        int comma = list.indexOf(',', start);
+        if (comma < 0) comma = list.length();
+
+        long id = list.substring(start, comma).toInt();
+        start = comma + 1;
+        if (id < 0 || id >= AES_RESERVED_KEY_ID_MIN || count >= AES_KEY_SLOTS) continue;
+
+        char key[16];
+        String hex;
+        uint32_t retireAt = 0;
+        uint8_t bytes[16];
+
+        snprintf(key, sizeof(key), "key.%ld", id);
+        if (!storage->readString(key, hex) || !parseHex(hex, bytes))
+        {
+            Serial.printf("KeyStore: Clave %ld invalida en NVS\n", id);
+            continue;
+        }
+
+        snprintf(key, sizeof(key), "keyr.%ld", id);
+        storage->readUInt(key, retireAt, 0);
+
+        install(static_cast<uint8_t>(id), bytes, retireAt);
+    }
+
+    bool ok = count > 0;
+    unlock();
+    return ok;
+}
+
+bool KeyStore::setKey(uint8_t id, const String &hex, uint32_t retireAt, String &error)
+{
+    if (!lock())
+    {
+        error = "not_ready";
+        return false;
+    }
+
+    bool ok = setKeyLocked(id, hex, retireAt, error);
+    unlock();
+    return ok;
+}
+
+bool KeyStore::retireKey(uint8_t id, uint32_t retireAt, String &error)
+{
+    if (!lock())
+    {
+        error = "not_ready";
+        return false;
+    }
+
+    bool ok = retireKeyLocked(id, retireAt, error);
+    unlock();
+    return ok;
+}
+
+bool KeyStore::removeKey(uint8_t id, String &error)
+{
+    if (!lock())
+    {
+        error = "not_ready";
+        return false;
+    }
+
+    bool ok = removeKeyLocked(id, error);
+    unlock();
+    return ok;
+}
+
+bool KeyStore::setKeyLocked(uint8_t id, const String &hex, uint32_t retireAt, String &error)
+{
+    if (id >= AES_RESERVED_KEY_ID_MIN)
+    {
+        error = "reserved_id";
+        return false;
+    }
+
+    uint8_t bytes[16];
+    if (!parseHex(hex, bytes))
+    {
+        error = "invalid_key";
+        return false;
+    }
+
+    if (!hasId(id) && count >= AES_KEY_SLOTS)
+    {
+        error = "key_table_full";
+        return false;
+    }
+
+    if (!install(id, bytes, retireAt))
+    {
+        error = "key_install_failed";
+        return false;
+    }
+
+    if (!persist(id, hex, retireAt) || !saveIds())
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool KeyStore::retireKeyLocked(uint8_t id, uint32_t retireAt, String &error)
+{
+    if (!hasId(id) || !aes_key_retire(id, retireAt))
+    {
+        error = "unknown_key";
+        return false;
+    }
+
+    char key[16];
+    snprintf(key, sizeof(key), "keyr.%u", id);
+    if (!storage->writeUInt(key, retireAt))
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool KeyStore::removeKeyLocked(uint8_t id, String &error)
+{
+    if (!hasId(id))
+    {
+        error = "unknown_key";
+        return false;
+    }
+
+    // Sin ninguna clave el arranque volveria a instalar la de fabrica
+    if (count == 1)
+    {
+        error = "last_key";
+        return false;
+    }
+
+    aes_key_remove(id);
+
+    for (uint8_t i = 0; i < count; ++i)
+    {
+        if (ids[i] == id)
+        {
+            ids[i] = ids[--count];
+            break;
+        }
+    }
+
+    char key[16];
+    snprintf(key, sizeof(key), "key.%u", id);
+    storage->remove(key);
+    snprintf(key, sizeof(key), "keyr.%u", id);
+    storage->remove(key);
+
+    if (!saveIds())
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    return true;
+}
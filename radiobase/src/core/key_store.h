@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include <crypto_lib.h>
+#include "driver/storage_nvs.h"
+#include "config.h"
+
+/*
+  Claves de descifrado de beacons persistidas en NVS.
+
+  Cada clave se guarda por key ID ("key.<id>" en hex, "keyr.<id>" con la
+  fecha de retiro) y se instala en la tabla de crypto_lib al arrancar. Sin
+  claves guardadas se instala la clave de fabrica como ID 0 (beacons sin
+  key ID) y como BEACON_KEY_ID_DEFAULT. Los IDs desde
+  AES_RESERVED_KEY_ID_MIN son del arnes y del benchmark y no se aceptan.
+
+  Las claves quedan en claro en NVS: la particion no esta cifrada (el
+  cifrado de NVS pide flash encryption y una particion nvs_keys que este
+  firmware no usa), asi que cualquiera con acceso a la flash las lee.
+
+  La lista de IDs y su copia en NVS se protegen con un mutex propio: las
+  rutas HTTP las leen y modifican fuera de la tarea que llamo a begin().
+*/
+
+class KeyStore
+{
+public:
+    bool begin(StorageNVS *storage);
+
+    bool setKey(uint8_t id, const String &hex, uint32_t retireAt, String &error);
+    bool retireKey(uint8_t id, uint32_t retireAt, String &error);
+    bool removeKey(uint8_t id, String &error);
+
+private:
+    bool lock();
+    void unlock();
+    bool setKeyLocked(uint8_t id, const String &hex, uint32_t retireAt, String &error);
+    bool retireKeyLocked(uint8_t id, uint32_t retireAt, String &error);
+    bool removeKeyLocked(uint8_t id, String &error);
+    bool install(uint8_t id, const uint8_t key[16], uint32_t retireAt);
+    bool persist(uint8_t id, const String &hex, uint32_t retireAt);
+    bool saveIds();
+    bool hasId(uint8_t id) const;
+    static bool parseHex(const String &hex, uint8_t out[16]);
+
+private:
+    StorageNVS *storage = nullptr;
+    SemaphoreHandle_t mutex = nullptr;
+    uint8_t ids[AES_KEY_SLOTS]{};
+    uint8_t count = 0;
+};
+
+extern KeyStore keyStore;
@@ -0,0 +1,284 @@
+#include "radio_budget.h"
+#include <WiFi.h>
+#include <AsyncWebServer_ESP32_SC_W5500.h>
+#include <esp_coexist.h>
+#include <esp_wifi.h>
+#include "core/appState.h"
+
+RadioBudget radioBudget;
+
+// Costo fijo por trama en el aire: preambulo, DIFS/SIFS y ACK
+static constexpr uint32_t FRAME_OVERHEAD_US = 100;
+
+// Tasa PHY tipica segun RSSI; sin estacion asociada se asume la mas baja
+static uint32_t phyRateForRssi(int rssi)
+{
+    if (rssi == 0) return 6000;
+    if (rssi >= -60) return 54000;
+    if (rssi >= -70) return 24000;
+    if (rssi >= -80) return 12000;
+    return 6000;
+}
+
+static int apAverageRssi()
+{
+    wifi_sta_list_t list;
+    if (esp_wifi_ap_get_sta_list(&list) != ESP_OK || list.num == 0) return 0;
+
+    int sum = 0;
+    for (int i = 0; i < list.num; ++i)
+    {
+        sum += list.sta[i].rssi;
+    }
+    return sum / list.num;
+}
+
+const char *RadioBudget::priorityName(RadioPriority p)
+{
+    switch (p)
+    {
+    case RadioPriority::BLE_FIRST:
+        return "ble_first";
+    case RadioPriority::BALANCED:
+        return "balanced";
+    case RadioPriority::WIFI_FIRST:
+        return "wifi_first";
+    }
+    return "unknown";
+}
+
+const char *RadioBudget::ifaceName(NetifKind kind)
+{
+    switch (kind)
+    {
+    case NetifKind::AP:
+        return "ap";
+    case NetifKind::STA:
+        return "sta";
+    case NetifKind::ETH:
+        return "eth";
+    }
+    return "unknown";
+}
+
+bool RadioBudget::begin()
+{
+    if (taskHandle != nullptr)
+    {
+        return true;
+    }
+
+    netifTrafficHook();
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        radioBudgetTask,
+        "radioBudgetTask",
+        4096,
+        this,
+        1,
+        &taskHandle,
+        0);
+
+    if (ok != pdPASS)
+    {
+        Serial.println("RadioBudget: No se pudo iniciar radioBudgetTask");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+RadioBudgetStatus RadioBudget::status() const
+{
+    portENTER_CRITICAL(&mux);
+    RadioBudgetStatus snapshot = st;
+    portEXIT_CRITICAL(&mux);
+    return snapshot;
+}
+
+void RadioBudget::sampleIfaces(uint32_t elapsedMs)
+{
+    RadioIfaceLoad loads[NETIF_KIND_COUNT];
+    int staRssi = WiFi.status() == WL_CONNECTED ? WiFi.RSSI() : 0;
+    int apRssi = (WiFi.getMode() & WIFI_MODE_AP) ? apAverageRssi() : 0;
+
+    for (uint8_t k = 0; k < NETIF_KIND_COUNT; ++k)
+    {
+        NetifKind kind = static_cast<NetifKind>(k);
+        NetifTraffic now = netifTrafficSnapshot(kind);
+        NetifTraffic &prev = lastTraffic[k];
+
+        uint32_t rxBytes = now.rxBytes - prev.rxBytes;
+        uint32_t txBytes = now.txBytes - prev.txBytes;
+        uint32_t frames = (now.rxFrames - prev.rxFrames) + (now.txFrames - prev.txFrames);
+        prev = now;
+
+        RadioIfaceLoad &l = loads[k];
+        l.hooked = now.hooked;
+        l.rxBytesPerSec = static_cast<uint32_t>(static_cast<uint64_t>(rxBytes) * 1000 / elapsedMs);
+        l.txBytesPerSec = static_cast<uint32_t>(static_cast<uint64_t>(txBytes) * 1000 / elapsedMs);
+        l.framesPerSec = static_cast<uint32_t>(static_cast<uint64_t>(frames) * 1000 / elapsedMs);
+
+        // Ethernet no comparte la radio
+        if (kind == NetifKind::ETH) continue;
+
+        l.phyRateKbps = phyRateForRssi(kind == NetifKind::AP ? apRssi : staRssi);
+        uint64_t airUs = static_cast<uint64_t>(frames) * FRAME_OVERHEAD_US +
+                         static_cast<uint64_t>(rxBytes + txBytes) * 8000 / l.phyRateKbps;
+        uint64_t permille = airUs / elapsedMs; // us por ms = permil
+        l.airtimePermille = permille > 1000 ? 1000 : static_cast<uint32_t>(permille);
+    }
+
+    portENTER_CRITICAL(&mux);
+    for (uint8_t k = 0; k < NETIF_KIND_COUNT; ++k)
+    {
+        st.iface[k] = loads[k];
+    }
+    uint32_t wifi = loads[static_cast<uint8_t>(NetifKind::AP)].airtimePermille +
+                    loads[static_cast<uint8_t>(NetifKind::STA)].airtimePermille;
+    st.wifiAirtimePermille = wifi > 1000 ? 1000 : wifi;
+    portEXIT_CRITICAL(&mux);
+}
+
+uint32_t RadioBudget::sampleBleLoss()
+{
+    ScanControlStats scan = scanControl.stats();
+    uint32_t caught = scan.catchFixed.caught + scan.catchAdaptive.caught;
+    uint32_t missed = scan.catchFixed.missed + scan.catchAdaptive.missed;
+    uint32_t dCaught = caught - lastCaught;
+    uint32_t dMissed = missed - lastMissed;
+    lastCaught = caught;
+    lastMissed = missed;
+
+    BlePipelineStats ble = bleStatsSnapshot();
+    uint32_t dReceived = ble.adv_received - lastAdvReceived;
+    uint32_t dDropped = ble.adv_dropped - lastAdvDropped;
+    lastAdvReceived = ble.adv_received;
+    lastAdvDropped = ble.adv_dropped;
+
+    // La peor de las dos: rafagas esperadas perdidas o descartes en la cola
+    uint32_t missLoss = (dCaught + dMissed) > 0 ? dMissed * 1000 / (dCaught + dMissed) : 0;
+    uint32_t dropLoss = (dReceived + dDropped) > 0 ? dDropped * 1000 / (dReceived + dDropped) : 0;
+    uint32_t loss = missLoss > dropLoss ? missLoss : dropLoss;
+
+    portENTER_CRITICAL(&mux);
+    st.bleLossPermille = loss;
+    st.bleAirtimePermille = scan.windowUnits * 1000 / SCAN_INTERVAL_UNITS;
+    portEXIT_CRITICAL(&mux);
+
+    return loss;
+}
+
+void RadioBudget::apply(RadioPriority next, const char *reason, uint32_t nowMs)
+{
+    portENTER_CRITICAL(&mux);
+    RadioPriority current = st.priority;
+    st.reason = reason;
+    portEXIT_CRITICAL(&mux);
+
+    if (applied && next == current) return;
+
+    esp_coex_prefer_t pref = ESP_COEX_PREFER_BALANCE;
+    uint16_t cap = SCAN_WINDOW_BASE_UNITS;
+
+    switch (next)
+    {
+    case RadioPriority::BLE_FIRST:
+        pref = ESP_COEX_PREFER_BT;
+        cap = SCAN_WINDOW_WIDE_UNITS;
+        break;
+    case RadioPriority::BALANCED:
+        break;
+    case RadioPriority::WIFI_FIRST:
+        pref = ESP_COEX_PREFER_WIFI;
+        cap = RADIO_WIFI_SCAN_WINDOW_UNITS;
+        break;
+    }
+
+    if (esp_coex_preference_set(pref) != ESP_OK)
+    {
+        Serial.println("RadioBudget: No se pudo fijar la preferencia de coexistencia");
+    }
+    scanControl.setWindowCap(cap);
+    applied = true;
+
+    portENTER_CRITICAL(&mux);
+    st.priority = next;
+    st.scanWindowCap = cap;
+    st.decisions++;
+    st.lastChangeMs = nowMs;
+    portEXIT_CRITICAL(&mux);
+
+    Serial.printf("RadioBudget: %s (%s)\n", priorityName(next), reason);
+}
+
+void RadioBudget::decide(uint32_t nowMs)
+{
+    uint32_t bleLoss = sampleBleLoss();
+    bool ethUplink = feature.ethernetEnable && ETH.linkUp() && ETH.localIP() != IPAddress(0, 0, 0, 0);
+
+    portENTER_CRITICAL(&mux);
+    st.ethUplink = ethUplink;
+    uint32_t wifiAir = st.wifiAirtimePermille;
+    portEXIT_CRITICAL(&mux);
+
+    if (ethUplink)
+    {
+        wifiFirstTicks = 0;
+        apply(RadioPriority::BLE_FIRST, "eth_uplink", nowMs);
+        return;
+    }
+
+    if (bleLoss >= RADIO_BLE_LOSS_HIGH_PERMILLE)
+    {
+        wifiFirstTicks = 0;
+        apply(RadioPriority::BLE_FIRST, "ble_loss", nowMs);
+        return;
+    }
+
+    if (wifiAir < RADIO_WIFI_IDLE_PERMILLE)
+    {
+        wifiFirstTicks = 0;
+        apply(RadioPriority::BLE_FIRST, "wifi_idle", nowMs);
+        return;
+    }
+
+    if (wifiAir >= RADIO_WIFI_BUSY_PERMILLE && bleLoss <= RADIO_BLE_LOSS_LOW_PERMILLE)
+    {
+        if (wifiFirstTicks < RADIO_BUDGET_HOLD_TICKS) wifiFirstTicks++;
+        if (wifiFirstTicks >= RADIO_BUDGET_HOLD_TICKS)
+        {
+            apply(RadioPriority::WIFI_FIRST, "wifi_busy", nowMs);
+            return;
+        }
+    }
+    else
+    {
+        wifiFirstTicks = 0;
+    }
+
+    apply(RadioPriority::BALANCED, "shared", nowMs);
+}
+
+void RadioBudget::radioBudgetTask(void *pvParameters)
+{
+    RadioBudget *self = static_cast<RadioBudget *>(pvParameters);
+    self->lastSampleMs = millis();
+
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(RADIO_BUDGET_TICK_MS));
+
+        // La red puede haberse reconfigurado y recreado sus netif
+        netifTrafficHook();
+
+        uint32_t now = millis();
+        uint32_t elapsed = now - self->lastSampleMs;
+        self->lastSampleMs = now;
+        if (elapsed == 0) continue;
+
+        self->sampleIfaces(elapsed);
+        self->decide(now);
+    }
+}
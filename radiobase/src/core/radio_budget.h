@@ -0,0 +1,89 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "driver/netif_traffic.h"
+#include "config.h"
+
+/*
+  Reparto de la radio 2.4 GHz entre WiFi (AP/STA) y el escaneo BLE.
+
+  Cada RADIO_BUDGET_TICK_MS se mide el trafico de AP y STA, se estima el
+  tiempo de aire que ocupa y se compara con la perdida de BLE (llegadas
+  esperadas perdidas y descartes de la cola). Con eso se elige:
+
+    BLE_FIRST   coexistencia preferida BT, ventana de escaneo sin tope.
+                Si Ethernet lleva el uplink, si WiFi esta ocioso o si BLE
+                esta perdiendo paquetes.
+    BALANCED    coexistencia balanceada, ventana de linea base.
+    WIFI_FIRST  coexistencia preferida WiFi, ventana reducida. Solo con
+                WiFi cargado y BLE sin perdidas durante un tiempo.
+
+  Hacia BLE se cambia de inmediato; hacia WiFi solo despues de
+  RADIO_BUDGET_HOLD_TICKS ciclos seguidos que lo justifiquen.
+*/
+
+enum class RadioPriority : uint8_t
+{
+    BLE_FIRST = 0,
+    BALANCED = 1,
+    WIFI_FIRST = 2,
+};
+
+struct RadioIfaceLoad
+{
+    bool hooked = false;
+    uint32_t rxBytesPerSec = 0;
+    uint32_t txBytesPerSec = 0;
+    uint32_t framesPerSec = 0;
+    uint32_t phyRateKbps = 0;
+    uint32_t airtimePermille = 0;
+};
+
+struct RadioBudgetStatus
+{
+    RadioPriority priority = RadioPriority::BALANCED;
+    const char *reason = "boot";
+    bool ethUplink = false;
+    uint32_t decisions = 0;
+    uint32_t lastChangeMs = 0;
+
+    RadioIfaceLoad iface[NETIF_KIND_COUNT];
+    uint32_t wifiAirtimePermille = 0;
+    uint32_t bleAirtimePermille = 0;
+    uint32_t bleLossPermille = 0;
+    uint32_t scanWindowCap = 0;
+};
+
+class RadioBudget
+{
+public:
+    bool begin();
+    RadioBudgetStatus status() const;
+
+    static const char *priorityName(RadioPriority p);
+    static const char *ifaceName(NetifKind kind);
+    static void radioBudgetTask(void *pvParameters);
+
+private:
+    void sampleIfaces(uint32_t elapsedMs);
+    uint32_t sampleBleLoss();
+    void decide(uint32_t nowMs);
+    void apply(RadioPriority next, const char *reason, uint32_t nowMs);
+
+private:
+    TaskHandle_t taskHandle = nullptr;
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    RadioBudgetStatus st;
+
+    NetifTraffic lastTraffic[NETIF_KIND_COUNT];
+    uint32_t lastCaught = 0;
+    uint32_t lastMissed = 0;
+    uint32_t lastAdvReceived = 0;
+    uint32_t lastAdvDropped = 0;
+    uint32_t lastSampleMs = 0;
+    uint8_t wifiFirstTicks = 0;
+    bool applied = false;
+};
+
+extern RadioBudget radioBudget;
@@ -0,0 +1,168 @@
+#include "slot_history.h"
+#include <esp32-hal-psram.h>
+
+SlotHistory slotHistory;
+
+// Tope de registros recorridos por llamada dentro de la seccion critica
+static constexpr uint32_t HISTORY_SCAN_BUDGET = 256;
+
+// millis() da la vuelta cada ~49.7 dias: se compara por diferencia, valido
+// mientras el anillo y la consulta abarquen menos de 2^31 ms (~24.8 dias)
+static inline int32_t tsDiff(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b);
+}
+
+bool SlotHistory::begin(uint32_t depthPerSlot)
+{
+    if (rings != nullptr)
+    {
+        return true;
+    }
+
+    if (depthPerSlot == 0) return false;
+    depth = depthPerSlot;
+
+    rings = static_cast<HistoryRecord *>(ps_malloc(capacityBytes()));
+    if (rings == nullptr)
+    {
+        Serial.println("SlotHistory: No hay PSRAM para el historial");
+        return false;
+    }
+
+    memset(rings, 0, capacityBytes());
+    return true;
+}
+
+bool SlotHistory::ready() const
+{
+    return rings != nullptr;
+}
+
+size_t SlotHistory::capacityBytes() const
+{
+    return static_cast<size_t>(MAX_SLOTS) * depth * sizeof(HistoryRecord);
+}
+
+void SlotHistory::append(int slot, const BeaconDecoded &read, uint32_t nowMs)
+{
+    if (rings == nullptr || slot < 0 || slot >= MAX_SLOTS) return;
+
+    HistoryRecord rec;
+    rec.ts_ms = nowMs;
+    rec.tmp_x100 = read.tmp_x100;
+    rec.cpu_x100 = read.cpu_x100;
+    rec.bat_pct = read.bat_pct;
+    rec.flags = read.flags;
+    rec.rssi = read.rssi_read;
+    rec.reserved = 0;
+
+    portENTER_CRITICAL(&mux);
+    uint32_t seq = total[slot];
+    rings[slot * depth + (seq % depth)] = rec;
+    total[slot] = seq + 1;
+    portEXIT_CRITICAL(&mux);
+}
+
+uint32_t SlotHistory::count(int slot) const
+{
+    if (slot < 0 || slot >= MAX_SLOTS) return 0;
+
+    portENTER_CRITICAL(&mux);
+    uint32_t t = total[slot];
+    portEXIT_CRITICAL(&mux);
+
+    return t > depth ? depth : t;
+}
+
+uint32_t SlotHistory::seekLocked(int slot, uint32_t fromMs) const
+{
+    // Los timestamps crecen con la secuencia: busqueda binaria del primero >= fromMs
+    uint32_t t = total[slot];
+    uint32_t lo = t > depth ? t - depth : 0;
+    uint32_t hi = t;
+    const HistoryRecord *ring = &rings[slot * depth];
+
+    while (lo < hi)
+    {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (tsDiff(ring[mid % depth].ts_ms, fromMs) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return lo;
+}
+
+bool SlotHistory::open(HistoryCursor &cur, int slot, uint32_t fromMs, uint32_t toMs, uint32_t stepMs)
+{
+    if (rings == nullptr || slot < 0 || slot >= MAX_SLOTS) return false;
+    if (tsDiff(toMs, fromMs) < 0) return false;
+
+    cur = {};
+    cur.slot = static_cast<uint8_t>(slot);
+    cur.fromMs = fromMs;
+    cur.toMs = toMs;
+    cur.stepMs = stepMs;
+    cur.nextBucketMs = fromMs;
+
+    portENTER_CRITICAL(&mux);
+    cur.nextSeq = seekLocked(slot, fromMs);
+    portEXIT_CRITICAL(&mux);
+
+    cur.started = true;
+    return true;
+}
+
+size_t SlotHistory::read(HistoryCursor &cur, HistoryRecord *out, size_t maxCount)
+{
+    if (rings == nullptr || !cur.started || cur.done || out == nullptr) return 0;
+
+    const HistoryRecord *ring = &rings[cur.slot * depth];
+    size_t n = 0;
+    uint32_t scanned = 0;
+
+    portENTER_CRITICAL(&mux);
+
+    uint32_t t = total[cur.slot];
+    uint32_t oldest = t > depth ? t - depth : 0;
+
+    // El productor paso por encima del cursor: se salta lo sobrescrito
+    if (cur.nextSeq < oldest)
+    {
+        cur.skipped += oldest - cur.nextSeq;
+        cur.nextSeq = oldest;
+    }
+
+    while (cur.nextSeq < t && n < maxCount && scanned < HISTORY_SCAN_BUDGET)
+    {
+        const HistoryRecord &rec = ring[cur.nextSeq % depth];
+        scanned++;
+
+        if (tsDiff(rec.ts_ms, cur.toMs) > 0)
+        {
+            cur.done = true;
+            break;
+        }
+
+        cur.nextSeq++;
+
+        if (cur.stepMs > 0)
+        {
+            if (tsDiff(rec.ts_ms, cur.nextBucketMs) < 0) continue;
+            uint32_t bucket = cur.fromMs + ((rec.ts_ms - cur.fromMs) / cur.stepMs) * cur.stepMs;
+            cur.nextBucketMs = bucket + cur.stepMs;
+        }
+
+        out[n++] = rec;
+    }
+
+    if (cur.nextSeq >= t)
+    {
+        cur.done = true;
+    }
+
+    portEXIT_CRITICAL(&mux);
+    return n;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "driver/ble_types.h"
+#include "config.h"
+
+/*
+  Historial por slot en PSRAM.
+
+  Un anillo de HISTORY_DEPTH registros por slot, de tamano fijo, que se
+  alimenta desde beaconLogicTask. Las lecturas usan un cursor por
+  numero de secuencia, asi una consulta puede recorrerse por partes sin
+  copiar el resultado completo.
+
+  ts_ms es millis() y da la vuelta; los rangos se comparan por diferencia
+  y no pueden abarcar mas de 2^31 ms. Un slot mudo por mas de ~24.8 dias
+  deja registros que ya no se ordenan contra los nuevos.
+*/
+
+#pragma pack(push, 1)
+struct HistoryRecord
+{
+    uint32_t ts_ms;
+    int16_t tmp_x100;
+    int16_t cpu_x100;
+    int8_t bat_pct;
+    uint8_t flags;
+    int8_t rssi;
+    uint8_t reserved;
+};
+#pragma pack(pop)
+
+static_assert(sizeof(HistoryRecord) == 12, "HistoryRecord debe ocupar 12 bytes");
+
+struct HistoryCursor
+{
+    uint8_t slot = 0;
+    uint32_t fromMs = 0;
+    uint32_t toMs = UINT32_MAX;
+    uint32_t stepMs = 0;
+    uint32_t nextSeq = 0;
+    uint32_t nextBucketMs = 0;
+    uint32_t skipped = 0;
+    bool started = false;
+    bool done = false;
+};
+
+class SlotHistory
+{
+public:
+    // depth menor que HISTORY_DEPTH solo para copias de prueba (benchmark)
+    bool begin(uint32_t depthPerSlot = HISTORY_DEPTH);
+    bool ready() const;
+
+    void append(int slot, const BeaconDecoded &read, uint32_t nowMs);
+
+    bool open(HistoryCursor &cur, int slot, uint32_t fromMs, uint32_t toMs, uint32_t stepMs);
+    size_t read(HistoryCursor &cur, HistoryRecord *out, size_t maxCount);
+
+    uint32_t count(int slot) const;
+    size_t capacityBytes() const;
+
+private:
+    uint32_t seekLocked(int slot, uint32_t fromMs) const;
+
+private:
+    HistoryRecord *rings = nullptr;
+    uint32_t depth = HISTORY_DEPTH;
+    uint32_t total[MAX_SLOTS]{};
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+};
+
+extern SlotHistory slotHistory;
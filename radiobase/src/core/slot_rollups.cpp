@@ -0,0 +1,340 @@
+#include "slot_rollups.h"
+#include <LittleFS.h>
+#include <esp32-hal-psram.h>
+#include <esp_rom_crc.h>
+#include "driver/storage_fs.h"
+
+SlotRollups slotRollups;
+
+static constexpr uint8_t FLAG_I2C_FAIL = 1 << 0;
+static constexpr uint8_t FLAG_TMP_FAIL = 1 << 2;
+
+static constexpr uint32_t ROLLUPS_MAGIC = 0x524F4C4C; // "ROLL"
+static constexpr uint16_t ROLLUPS_VERSION = 1;
+
+// Cualquier hora anterior a 2023 se considera reloj sin sincronizar
+static constexpr time_t CLOCK_MIN_VALID = 1672531200;
+
+struct RollupsFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t slots;
+    uint32_t bytes;
+    uint32_t crc;
+};
+
+static void bucketReset(RollupBucket &b, uint32_t start)
+{
+    b.start = start;
+    b.sumX100 = 0;
+    b.count = 0;
+    b.oorMinutes = 0;
+    b.minX100 = INT16_MAX;
+    b.maxX100 = INT16_MIN;
+}
+
+static void bucketMerge(RollupBucket &into, const RollupBucket &from)
+{
+    if (from.count == 0) return;
+
+    into.sumX100 += from.sumX100;
+    into.count += from.count;
+    into.oorMinutes += from.oorMinutes;
+    if (from.minX100 < into.minX100) into.minX100 = from.minX100;
+    if (from.maxX100 > into.maxX100) into.maxX100 = from.maxX100;
+}
+
+bool SlotRollups::clockSynced()
+{
+    return time(nullptr) >= CLOCK_MIN_VALID;
+}
+
+bool SlotRollups::lock(TickType_t timeout) const
+{
+    return mutex != nullptr && xSemaphoreTake(mutex, timeout) == pdTRUE;
+}
+
+void SlotRollups::unlock() const
+{
+    xSemaphoreGive(mutex);
+}
+
+bool SlotRollups::begin(bool persist)
+{
+    if (taskHandle != nullptr)
+    {
+        return true;
+    }
+
+    if (mutex == nullptr)
+    {
+        mutex = xSemaphoreCreateMutex();
+    }
+
+    if (slots == nullptr)
+    {
+        slots = static_cast<SlotRollup *>(ps_malloc(sizeof(SlotRollup) * MAX_SLOTS));
+    }
+
+    if (mutex == nullptr || slots == nullptr)
+    {
+        Serial.println("SlotRollups: Sin memoria para resumenes");
+        return false;
+    }
+
+    memset(slots, 0, sizeof(SlotRollup) * MAX_SLOTS);
+    if (!persist) return true;
+
+    st.restored = load();
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        slotRollupsTask,
+        "slotRollupsTask",
+        4096,
+        this,
+        1,
+        &taskHandle,
+        0);
+
+    if (ok != pdPASS)
+    {
+        Serial.println("SlotRollups: No se pudo iniciar slotRollupsTask");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void SlotRollups::refreshCalendar(uint32_t now)
+{
+    if (now < cal.nextMinute && now >= cal.minute) return;
+
+    cal.minute = now - (now % 60);
+    cal.nextMinute = cal.minute + 60;
+
+    if (now < cal.nextHour && now >= cal.hour) return;
+
+    // Hora y dia locales: solo se recalculan al cruzar un limite
+    time_t t = now;
+    struct tm local;
+    localtime_r(&t, &local);
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    cal.hour = static_cast<uint32_t>(mktime(&local));
+    cal.nextHour = cal.hour + 3600;
+
+    if (now < cal.nextDay && now >= cal.day) return;
+
+    local.tm_hour = 0;
+    local.tm_isdst = -1;
+    cal.day = static_cast<uint32_t>(mktime(&local));
+    local.tm_mday += 1;
+    local.tm_isdst = -1;
+    cal.nextDay = static_cast<uint32_t>(mktime(&local));
+}
+
+void SlotRollups::rollDay(SlotRollup &s)
+{
+    s.days[s.dayHead] = s.day;
+    s.dayHead = (s.dayHead + 1) % ROLLUP_DAYS;
+    if (s.dayCount < ROLLUP_DAYS) s.dayCount++;
+    s.day.count = 0;
+}
+
+void SlotRollups::rollHour(SlotRollup &s)
+{
+    s.hours[s.hourHead] = s.hour;
+    s.hourHead = (s.hourHead + 1) % ROLLUP_HOURS;
+    if (s.hourCount < ROLLUP_HOURS) s.hourCount++;
+
+    if (s.day.count > 0 && s.day.start != s.hourDay) rollDay(s);
+    if (s.day.count == 0) bucketReset(s.day, s.hourDay);
+
+    bucketMerge(s.day, s.hour);
+    s.hour.count = 0;
+}
+
+void SlotRollups::rollMinute(SlotRollup &s)
+{
+    if (s.hour.count > 0 && s.hour.start != s.minuteHour) rollHour(s);
+    if (s.hour.count == 0)
+    {
+        bucketReset(s.hour, s.minuteHour);
+        s.hourDay = s.minuteDay;
+    }
+
+    bucketMerge(s.hour, s.minute);
+    if (s.minuteOor) s.hour.oorMinutes++;
+    s.minute.count = 0;
+}
+
+void SlotRollups::update(int slot, const BeaconDecoded &read, bool inAlarm)
+{
+    if (slots == nullptr || slot < 0 || slot >= MAX_SLOTS) return;
+    if ((read.flags & (FLAG_I2C_FAIL | FLAG_TMP_FAIL)) != 0) return;
+
+    time_t t = time(nullptr);
+    if (t < CLOCK_MIN_VALID)
+    {
+        st.unsyncedSkips++;
+        return;
+    }
+
+    if (!lock()) return;
+
+    uint32_t now = static_cast<uint32_t>(t);
+    refreshCalendar(now);
+
+    SlotRollup &s = slots[slot];
+    if (s.minute.count > 0 && s.minute.start != cal.minute) rollMinute(s);
+
+    if (s.minute.count == 0)
+    {
+        bucketReset(s.minute, cal.minute);
+        s.minuteHour = cal.hour;
+        s.minuteDay = cal.day;
+        s.minuteOor = false;
+    }
+
+    s.minute.sumX100 += read.tmp_x100;
+    s.minute.count++;
+    if (read.tmp_x100 < s.minute.minX100) s.minute.minX100 = read.tmp_x100;
+    if (read.tmp_x100 > s.minute.maxX100) s.minute.maxX100 = read.tmp_x100;
+    if (inAlarm) s.minuteOor = true;
+
+    unlock();
+}
+
+bool SlotRollups::snapshot(int slot, SlotRollup &out, RollupBucket &hourNow, RollupBucket &dayNow)
+{
+    if (slots == nullptr || slot < 0 || slot >= MAX_SLOTS) return false;
+    if (!lock(pdMS_TO_TICKS(200))) return false;
+
+    out = slots[slot];
+    unlock();
+
+    // Se cierra sobre la copia lo que ya esta abierto para mostrar periodos completos
+    if (out.minute.count > 0) rollMinute(out);
+    hourNow = out.hour;
+
+    if (out.hour.count > 0 && out.day.count > 0 && out.day.start != out.hourDay) rollDay(out);
+    dayNow = out.day;
+    if (out.hour.count > 0)
+    {
+        if (dayNow.count == 0) bucketReset(dayNow, out.hourDay);
+        bucketMerge(dayNow, out.hour);
+    }
+
+    return true;
+}
+
+bool SlotRollups::dayStart(int daysAgo, uint32_t &start) const
+{
+    time_t t = time(nullptr);
+    if (t < CLOCK_MIN_VALID) return false;
+
+    struct tm local;
+    localtime_r(&t, &local);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_mday -= daysAgo;
+    local.tm_isdst = -1;
+    start = static_cast<uint32_t>(mktime(&local));
+    return true;
+}
+
+RollupInfo SlotRollups::info() const
+{
+    RollupInfo snapshot = st;
+    snapshot.clockSynced = clockSynced();
+    return snapshot;
+}
+
+bool SlotRollups::load()
+{
+    if (!LittleFS.exists(ROLLUPS_FILE))
+    {
+        return false;
+    }
+
+    File f = LittleFS.open(ROLLUPS_FILE, "rb");
+    if (!f)
+    {
+        return false;
+    }
+
+    RollupsFileHeader hdr{};
+    size_t bytes = sizeof(SlotRollup) * MAX_SLOTS;
+    bool ok = f.readBytes(reinterpret_cast<char *>(&hdr), sizeof(hdr)) == sizeof(hdr) &&
+              hdr.magic == ROLLUPS_MAGIC && hdr.version == ROLLUPS_VERSION &&
+              hdr.slots == MAX_SLOTS && hdr.bytes == bytes &&
+              f.readBytes(reinterpret_cast<char *>(slots), bytes) == bytes;
+    f.close();
+
+    if (!ok || esp_rom_crc32_le(0, reinterpret_cast<const uint8_t *>(slots), bytes) != hdr.crc)
+    {
+        memset(slots, 0, bytes);
+        return false;
+    }
+
+    return true;
+}
+
+bool SlotRollups::save()
+{
+    size_t bytes = sizeof(SlotRollup) * MAX_SLOTS;
+    uint8_t *copy = static_cast<uint8_t *>(ps_malloc(bytes));
+    if (copy == nullptr)
+    {
+        return false;
+    }
+
+    if (!lock())
+    {
+        free(copy);
+        return false;
+    }
+    memcpy(copy, slots, bytes);
+    unlock();
+
+    RollupsFileHeader hdr{};
+    hdr.magic = ROLLUPS_MAGIC;
+    hdr.version = ROLLUPS_VERSION;
+    hdr.slots = MAX_SLOTS;
+    hdr.bytes = bytes;
+    hdr.crc = esp_rom_crc32_le(0, copy, bytes);
+
+    bool ok = ensureConfigDir();
+    if (ok)
+    {
+        File f = LittleFS.open(ROLLUPS_FILE_TMP, "wb");
+        ok = f && f.write(reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr)) == sizeof(hdr) &&
+             f.write(copy, bytes) == bytes;
+        if (f) f.close();
+    }
+
+    free(copy);
+
+    return commitFile(ROLLUPS_FILE_TMP, ROLLUPS_FILE, ok);
+}
+
+void SlotRollups::slotRollupsTask(void *pvParameters)
+{
+    SlotRollups *self = static_cast<SlotRollups *>(pvParameters);
+
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(ROLLUP_SAVE_MS));
+
+        if (!clockSynced()) continue;
+
+        if (self->save())
+            self->st.saves++;
+        else
+            self->st.saveErrors++;
+    }
+}
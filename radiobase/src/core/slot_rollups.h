@@ -0,0 +1,110 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <time.h>
+#include "driver/ble_types.h"
+#include "config.h"
+
+/*
+  Resumenes por slot de minuto, hora y dia para reportes de cumplimiento.
+
+  Cada lectura se suma en O(1) al minuto en curso; al cambiar de minuto se
+  cierra y se acumula en la hora, y la hora en el dia, siguiendo los
+  limites del calendario local (CLOCK_TZ). Un minuto cuenta como fuera de
+  rango si el slot estuvo en alarma en alguna lectura de ese minuto.
+
+  Solo se acumula con el reloj sincronizado por SNTP: sin hora real los
+  limites de calendario no tienen sentido.
+*/
+
+struct RollupBucket
+{
+    uint32_t start;      // epoch (s) del inicio del periodo
+    uint32_t count;
+    int64_t sumX100;
+    uint16_t oorMinutes;
+    int16_t minX100;
+    int16_t maxX100;
+};
+
+static_assert(sizeof(RollupBucket) == 24, "RollupBucket debe ocupar 24 bytes");
+
+struct SlotRollup
+{
+    RollupBucket minute;
+    RollupBucket hour;
+    RollupBucket day;
+
+    uint32_t minuteHour; // hora y dia a los que pertenece el minuto en curso
+    uint32_t minuteDay;
+    uint32_t hourDay;
+    bool minuteOor;
+
+    uint8_t hourHead;
+    uint8_t hourCount;
+    uint8_t dayHead;
+    uint8_t dayCount;
+
+    RollupBucket hours[ROLLUP_HOURS];
+    RollupBucket days[ROLLUP_DAYS];
+};
+
+struct RollupInfo
+{
+    bool clockSynced = false;
+    uint32_t unsyncedSkips = 0;
+    uint32_t saves = 0;
+    uint32_t saveErrors = 0;
+    bool restored = false;
+};
+
+class SlotRollups
+{
+public:
+    // persist false: sin cargar ni guardar en LittleFS (copias de prueba)
+    bool begin(bool persist = true);
+
+    void update(int slot, const BeaconDecoded &read, bool inAlarm);
+
+    // Copia del estado de un slot con los periodos en curso ya combinados
+    bool snapshot(int slot, SlotRollup &out, RollupBucket &hourNow, RollupBucket &dayNow);
+    bool dayStart(int daysAgo, uint32_t &start) const;
+    RollupInfo info() const;
+
+    static bool clockSynced();
+    static void slotRollupsTask(void *pvParameters);
+
+private:
+    struct Calendar
+    {
+        uint32_t minute;
+        uint32_t hour;
+        uint32_t day;
+        uint32_t nextMinute;
+        uint32_t nextHour;
+        uint32_t nextDay;
+    };
+
+    static constexpr const char *ROLLUPS_FILE = "/config/rollups.bin";
+    static constexpr const char *ROLLUPS_FILE_TMP = "/config/rollups.tmp";
+
+    void refreshCalendar(uint32_t now);
+    void rollMinute(SlotRollup &s);
+    void rollHour(SlotRollup &s);
+    void rollDay(SlotRollup &s);
+    bool load();
+    bool save();
+    bool lock(TickType_t timeout = portMAX_DELAY) const;
+    void unlock() const;
+
+private:
+    mutable SemaphoreHandle_t mutex = nullptr;
+    TaskHandle_t taskHandle = nullptr;
+    SlotRollup *slots = nullptr;
+    Calendar cal{};
+    RollupInfo st;
+};
+
+extern SlotRollups slotRollups;
@@ -0,0 +1,386 @@
+#include "zone_aggregator.h"
+#include <LittleFS.h>
+#include <new>
+#include "driver/storage_fs.h"
+
+ZoneAggregator zoneAggregator;
+
+static_assert(MAX_ZONES <= 8, "zonesOfSlot usa un bit por zona");
+static_assert(MAX_SLOTS <= 32, "members usa un bit por slot");
+
+static constexpr uint8_t FLAG_I2C_FAIL = 1 << 0;
+static constexpr uint8_t FLAG_TMP_FAIL = 1 << 2;
+
+bool ZoneAggregator::lock(TickType_t timeout) const
+{
+    if (mutex == nullptr) return false;
+    return xSemaphoreTake(mutex, timeout) == pdTRUE;
+}
+
+void ZoneAggregator::unlock() const
+{
+    if (mutex) xSemaphoreGive(mutex);
+}
+
+bool ZoneAggregator::begin()
+{
+    if (mutex == nullptr)
+    {
+        mutex = xSemaphoreCreateMutex();
+    }
+
+    if (mutex == nullptr) return false;
+
+    loadZones();
+    return true;
+}
+
+bool ZoneAggregator::parse(JsonDocument &doc, ZoneAggregate *out, uint8_t &count, String &error) const
+{
+    JsonArray list = doc["zones"].as<JsonArray>();
+    if (list.isNull())
+    {
+        error = "missing_zones";
+        return false;
+    }
+
+    if (list.size() > MAX_ZONES)
+    {
+        error = "too_many_zones";
+        return false;
+    }
+
+    count = 0;
+    for (JsonObject z : list)
+    {
+        ZoneAggregate &agg = out[count];
+        agg = {};
+
+        const char *name = z["name"] | "";
+        snprintf(agg.name, sizeof(agg.name), "%s", name);
+
+        // El nombre se emite tal cual en la respuesta precalculada
+        for (char *c = agg.name; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\' || static_cast<uint8_t>(*c) < 0x20) *c = '_';
+        }
+
+        JsonArray slots = z["slots"].as<JsonArray>();
+        if (slots.isNull())
+        {
+            error = "missing_zone_slots";
+            return false;
+        }
+
+        for (JsonVariant v : slots)
+        {
+            int slot = v | -1;
+            if (slot < 0 || slot >= MAX_SLOTS)
+            {
+                error = "invalid_zone_slot";
+                return false;
+            }
+
+            agg.members |= (1UL << slot);
+        }
+
+        agg.memberCount = static_cast<uint8_t>(__builtin_popcount(agg.members));
+        count++;
+    }
+
+    return true;
+}
+
+void ZoneAggregator::removeValue(ZoneAggregate &z, int16_t value)
+{
+    // Busqueda binaria del primer elemento >= value
+    uint8_t lo = 0;
+    uint8_t hi = z.valueCount;
+    while (lo < hi)
+    {
+        uint8_t mid = (lo + hi) / 2;
+        if (z.sorted[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if (lo >= z.valueCount || z.sorted[lo] != value) return;
+
+    memmove(&z.sorted[lo], &z.sorted[lo + 1], (z.valueCount - lo - 1) * sizeof(z.sorted[0]));
+    z.valueCount--;
+    z.sumX100 -= value;
+}
+
+void ZoneAggregator::insertValue(ZoneAggregate &z, int16_t value)
+{
+    if (z.valueCount >= MAX_SLOTS) return;
+
+    uint8_t lo = 0;
+    uint8_t hi = z.valueCount;
+    while (lo < hi)
+    {
+        uint8_t mid = (lo + hi) / 2;
+        if (z.sorted[mid] < value)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    memmove(&z.sorted[lo + 1], &z.sorted[lo], (z.valueCount - lo) * sizeof(z.sorted[0]));
+    z.sorted[lo] = value;
+    z.valueCount++;
+    z.sumX100 += value;
+}
+
+void ZoneAggregator::applySample(int slot, const SlotSample &prev, const SlotSample &next)
+{
+    uint8_t mask = zonesOfSlot[slot];
+
+    while (mask)
+    {
+        int zi = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        ZoneAggregate &z = zones[zi];
+
+        if (prev.online && prev.hasValue) removeValue(z, prev.tmpX100);
+        if (next.online && next.hasValue) insertValue(z, next.tmpX100);
+
+        z.onlineCount += static_cast<int>(next.online) - static_cast<int>(prev.online);
+        z.alarmCount += static_cast<int>(next.inAlarm) - static_cast<int>(prev.inAlarm);
+    }
+}
+
+void ZoneAggregator::rebuildLocked()
+{
+    memset(zonesOfSlot, 0, sizeof(zonesOfSlot));
+
+    for (uint8_t zi = 0; zi < zoneCount; ++zi)
+    {
+        ZoneAggregate &z = zones[zi];
+        z.onlineCount = 0;
+        z.alarmCount = 0;
+        z.valueCount = 0;
+        z.sumX100 = 0;
+
+        for (int s = 0; s < MAX_SLOTS; ++s)
+        {
+            if (z.members & (1UL << s)) zonesOfSlot[s] |= (1 << zi);
+        }
+    }
+
+    SlotSample empty{};
+    for (int s = 0; s < MAX_SLOTS; ++s)
+    {
+        applySample(s, empty, samples[s]);
+    }
+
+    generation++;
+}
+
+bool ZoneAggregator::loadZones()
+{
+    if (!LittleFS.exists(ZONES_FILE))
+    {
+        return false;
+    }
+
+    File f = LittleFS.open(ZONES_FILE, "r");
+    if (!f)
+    {
+        return false;
+    }
+
+    JsonDocument doc;
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+
+    if (err)
+    {
+        Serial.println("ZoneAggregator: zonas corruptas");
+        return false;
+    }
+
+    ZoneAggregate *parsed = new (std::nothrow) ZoneAggregate[MAX_ZONES];
+    if (parsed == nullptr)
+    {
+        return false;
+    }
+
+    uint8_t count = 0;
+    String error;
+    if (!parse(doc, parsed, count, error))
+    {
+        Serial.printf("ZoneAggregator: zonas invalidas (%s)\n", error.c_str());
+        delete[] parsed;
+        return false;
+    }
+
+    if (!lock())
+    {
+        delete[] parsed;
+        return false;
+    }
+
+    memcpy(zones, parsed, sizeof(zones));
+    zoneCount = count;
+    rebuildLocked();
+
+    unlock();
+    delete[] parsed;
+    return true;
+}
+
+bool ZoneAggregator::saveZones(JsonDocument &doc, String &error)
+{
+    ZoneAggregate *check = new (std::nothrow) ZoneAggregate[MAX_ZONES];
+    if (check == nullptr)
+    {
+        error = "no_memory";
+        return false;
+    }
+
+    uint8_t count = 0;
+    bool valid = parse(doc, check, count, error);
+    delete[] check;
+
+    if (!valid)
+    {
+        return false;
+    }
+
+    if (!ensureConfigDir())
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    File f = LittleFS.open(ZONES_FILE_TMP, "w");
+    if (!f)
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    JsonDocument stored;
+    stored["zones"] = doc["zones"];
+    size_t written = serializeJson(stored, f);
+    f.close();
+
+    if (!commitFile(ZONES_FILE_TMP, ZONES_FILE, written == measureJson(stored)))
+    {
+        error = "save_failed";
+        return false;
+    }
+
+    if (!loadZones())
+    {
+        error = "load_failed";
+        return false;
+    }
+
+    return true;
+}
+
+bool ZoneAggregator::readZones(JsonDocument &doc) const
+{
+    File f = LittleFS.exists(ZONES_FILE) ? LittleFS.open(ZONES_FILE, "r") : File();
+    if (!f)
+    {
+        doc["zones"].to<JsonArray>();
+        return false;
+    }
+
+    DeserializationError err = deserializeJson(doc, f);
+    f.close();
+
+    if (err)
+    {
+        doc.clear();
+        doc["zones"].to<JsonArray>();
+        return false;
+    }
+
+    return true;
+}
+
+void ZoneAggregator::update(int slot, const BeaconDecoded &read, bool inAlarm, uint32_t nowMs)
+{
+    if (slot < 0 || slot >= MAX_SLOTS) return;
+    if (!lock()) return;
+
+    SlotSample next{};
+    next.online = true;
+    // Con i2c_fail o tmp_fail el tmp_x100 no es una lectura
+    next.hasValue = (read.flags & (FLAG_I2C_FAIL | FLAG_TMP_FAIL)) == 0;
+    next.inAlarm = inAlarm;
+    next.tmpX100 = read.tmp_x100;
+    next.lastSeenMs = nowMs;
+
+    applySample(slot, samples[slot], next);
+    samples[slot] = next;
+    generation++;
+
+    unlock();
+}
+
+void ZoneAggregator::expireLocked(uint32_t nowMs)
+{
+    for (int s = 0; s < MAX_SLOTS; ++s)
+    {
+        SlotSample &prev = samples[s];
+        if (!prev.online) continue;
+        if ((nowMs - prev.lastSeenMs) < SLOT_OFFLINE_MS) continue;
+
+        SlotSample next = prev;
+        next.online = false;
+        applySample(s, prev, next);
+        prev = next;
+        generation++;
+    }
+}
+
+void ZoneAggregator::expire(uint32_t nowMs)
+{
+    if (!lock()) return;
+    expireLocked(nowMs);
+    unlock();
+}
+
+void ZoneAggregator::summarizeLocked(const ZoneAggregate &z, ZoneSummary &out) const
+{
+    out = {};
+    memcpy(out.name, z.name, sizeof(out.name));
+    out.members = z.members;
+    out.memberCount = z.memberCount;
+    out.onlineCount = z.onlineCount;
+    out.offlineCount = z.memberCount - z.onlineCount;
+    out.alarmCount = z.alarmCount;
+    out.valueCount = z.valueCount;
+
+    if (z.valueCount > 0)
+    {
+        out.minX100 = z.sorted[0];
+        out.maxX100 = z.sorted[z.valueCount - 1];
+        out.meanX100 = static_cast<int16_t>(z.sumX100 / static_cast<int32_t>(z.valueCount));
+    }
+}
+
+size_t ZoneAggregator::snapshot(ZoneSummary *out, size_t maxCount, uint32_t nowMs, uint32_t *generationOut)
+{
+    if (out == nullptr) return 0;
+    if (!lock()) return 0;
+
+    expireLocked(nowMs);
+
+    size_t n = 0;
+    for (uint8_t zi = 0; zi < zoneCount && n < maxCount; ++zi)
+    {
+        summarizeLocked(zones[zi], out[n++]);
+    }
+    if (generationOut != nullptr) *generationOut = generation;
+
+    unlock();
+    return n;
+}
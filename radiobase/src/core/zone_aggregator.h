@@ -0,0 +1,92 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "driver/ble_types.h"
+#include "config.h"
+
+/*
+  Agregados por zona (grupo de slots) mantenidos de forma incremental.
+
+  Cada actualizacion de slot quita su lectura anterior y agrega la nueva
+  en un arreglo ordenado por zona (multiset), por lo que min/max son O(1)
+  y la media sale de la suma acumulada. Las zonas se definen en
+  /config/zones.json:
+
+  {"zones":[{"name":"Camara 1","slots":[0,1,2]}]}
+*/
+
+struct ZoneAggregate
+{
+    char name[ZONE_NAME_LEN];
+    uint32_t members;
+    uint8_t memberCount;
+    uint8_t onlineCount;
+    uint8_t alarmCount;
+    uint8_t valueCount;
+    int32_t sumX100;
+    int16_t sorted[MAX_SLOTS];
+};
+
+struct ZoneSummary
+{
+    char name[ZONE_NAME_LEN];
+    uint32_t members;
+    uint8_t memberCount;
+    uint8_t onlineCount;
+    uint8_t offlineCount;
+    uint8_t alarmCount;
+    uint8_t valueCount;
+    int16_t minX100;
+    int16_t maxX100;
+    int16_t meanX100;
+};
+
+class ZoneAggregator
+{
+public:
+    bool begin();
+    bool loadZones();
+    bool saveZones(JsonDocument &doc, String &error);
+    bool readZones(JsonDocument &doc) const;
+
+    void update(int slot, const BeaconDecoded &read, bool inAlarm, uint32_t nowMs);
+    void expire(uint32_t nowMs);
+
+    // generation cambia con cada lectura, vencimiento o configuracion que mueve un agregado
+    size_t snapshot(ZoneSummary *out, size_t maxCount, uint32_t nowMs, uint32_t *generationOut = nullptr);
+
+private:
+    static constexpr const char *ZONES_FILE = "/config/zones.json";
+    static constexpr const char *ZONES_FILE_TMP = "/config/zones.tmp";
+
+    struct SlotSample
+    {
+        bool online;
+        bool hasValue;
+        bool inAlarm;
+        int16_t tmpX100;
+        uint32_t lastSeenMs;
+    };
+
+    bool parse(JsonDocument &doc, ZoneAggregate *out, uint8_t &count, String &error) const;
+    void rebuildLocked();
+    void expireLocked(uint32_t nowMs);
+    void summarizeLocked(const ZoneAggregate &z, ZoneSummary &out) const;
+    void removeValue(ZoneAggregate &z, int16_t value);
+    void insertValue(ZoneAggregate &z, int16_t value);
+    void applySample(int slot, const SlotSample &prev, const SlotSample &next);
+    bool lock(TickType_t timeout = portMAX_DELAY) const;
+    void unlock() const;
+
+private:
+    mutable SemaphoreHandle_t mutex = nullptr;
+    ZoneAggregate zones[MAX_ZONES]{};
+    uint8_t zoneCount = 0;
+    SlotSample samples[MAX_SLOTS]{};
+    uint8_t zonesOfSlot[MAX_SLOTS]{};
+    uint32_t generation = 0;
+};
+
+extern ZoneAggregator zoneAggregator;
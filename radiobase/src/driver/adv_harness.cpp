@@ -0,0 +1,389 @@
+#include "adv_harness.h"
+#include <LittleFS.h>
+#include <new>
+#include "mbedtls/aes.h"
+#include "core/appState.h"
+
+AdvHarness advHarness;
+
+static constexpr size_t CAPTURE_BATCH = 16;
+static constexpr uint32_t INJECT_MAX_SLEEP_MS = 100;
+
+static_assert(HARNESS_KEY_ID >= AES_RESERVED_KEY_ID_MIN, "La clave del arnes va en un slot reservado");
+
+static bool ensureCaptureDir()
+{
+    File dirTest = LittleFS.open("/capture");
+    if (dirTest)
+    {
+        dirTest.close();
+        return true;
+    }
+
+    return LittleFS.mkdir("/capture");
+}
+
+class FileByteSource : public AdvByteSource
+{
+public:
+    explicit FileByteSource(File &f) : file(f) {}
+    size_t readBytes(uint8_t *dst, size_t len) override
+    {
+        return file.read(dst, len);
+    }
+
+private:
+    File &file;
+};
+
+static bool mbedtlsEncrypt(const uint8_t key[16], const uint8_t in[16], uint8_t out[16], void *ctx)
+{
+    (void)key; // el contexto ya tiene la clave expandida
+    return mbedtls_aes_crypt_ecb(static_cast<mbedtls_aes_context *>(ctx), MBEDTLS_AES_ENCRYPT, in, out) == 0;
+}
+
+static void frameFromRaw(const AdvRaw &m, AdvFrame &f)
+{
+    f.rxMs = m.rx_ms;
+    f.rssiRead = m.rssi_read;
+    f.rssiSend = m.rssi_send;
+    memcpy(f.addr, m.addr, sizeof(f.addr));
+    f.company = m.company;
+    f.keyId = m.key_id;
+    f.len = m.len;
+    memcpy(f.payload, m.payload, sizeof(f.payload));
+}
+
+bool AdvHarness::startCapture(const String &path, uint32_t maxFrames, String &error)
+{
+    if (captureHandle != nullptr)
+    {
+        error = "capture_running";
+        return false;
+    }
+
+    if (path.length() == 0 || path.length() >= sizeof(st.capturePath) || !path.startsWith("/capture/"))
+    {
+        error = "invalid_path";
+        return false;
+    }
+
+    if (captureQ == nullptr)
+    {
+        // La cola no se libera nunca: el callback de escaneo puede tener el puntero
+        captureQ = xQueueCreate(HARNESS_CAPTURE_QUEUE_LEN, sizeof(AdvRaw));
+    }
+
+    if (captureQ == nullptr)
+    {
+        error = "no_memory";
+        return false;
+    }
+
+    xQueueReset(captureQ);
+    captureMax = (maxFrames == 0 || maxFrames > HARNESS_CAPTURE_MAX_FRAMES) ? HARNESS_CAPTURE_MAX_FRAMES : maxFrames;
+    captureStop = false;
+
+    portENTER_CRITICAL(&mux);
+    st.capturing = true;
+    strncpy(st.capturePath, path.c_str(), sizeof(st.capturePath) - 1);
+    st.capturePath[sizeof(st.capturePath) - 1] = '\0';
+    st.captured = 0;
+    st.captureDropped = 0;
+    st.captureErrors = 0;
+    portEXIT_CRITICAL(&mux);
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        captureTask,
+        "advCaptureTask",
+        4096,
+        this,
+        1,
+        &captureHandle,
+        0);
+
+    if (ok != pdPASS)
+    {
+        captureHandle = nullptr;
+        portENTER_CRITICAL(&mux);
+        st.capturing = false;
+        portEXIT_CRITICAL(&mux);
+        error = "task_create_failed";
+        return false;
+    }
+
+    return true;
+}
+
+void AdvHarness::stopCapture()
+{
+    captureStop = true;
+}
+
+void AdvHarness::captureTask(void *pvParameters)
+{
+    AdvHarness *self = static_cast<AdvHarness *>(pvParameters);
+
+    char path[sizeof(self->st.capturePath)];
+    portENTER_CRITICAL(&self->mux);
+    memcpy(path, self->st.capturePath, sizeof(path));
+    portEXIT_CRITICAL(&self->mux);
+
+    File f;
+    bool ok = ensureCaptureDir();
+    if (ok)
+    {
+        f = LittleFS.open(path, "wb");
+        AdvCaptureHeader hdr = advCaptureHeader(millis());
+        ok = f && f.write(reinterpret_cast<const uint8_t *>(&hdr), sizeof(hdr)) == sizeof(hdr);
+    }
+
+    uint32_t dropBase = advCaptureDropped;
+    uint32_t captured = 0;
+    AdvFrame batch[CAPTURE_BATCH];
+    size_t batchCount = 0;
+    AdvRaw m;
+
+    if (ok)
+    {
+        advCaptureQ = self->captureQ;
+    }
+
+    while (ok && !self->captureStop && captured < self->captureMax)
+    {
+        bool got = xQueueReceive(self->captureQ, &m, pdMS_TO_TICKS(500)) == pdTRUE;
+        if (got)
+        {
+            frameFromRaw(m, batch[batchCount++]);
+            captured++;
+        }
+
+        // Escritura por lotes para no tocar la flash en cada anuncio
+        if (batchCount == CAPTURE_BATCH || (!got && batchCount > 0))
+        {
+            size_t bytes = batchCount * sizeof(AdvFrame);
+            ok = f.write(reinterpret_cast<const uint8_t *>(batch), bytes) == bytes;
+            batchCount = 0;
+        }
+
+        portENTER_CRITICAL(&self->mux);
+        self->st.captured = captured;
+        self->st.captureDropped = advCaptureDropped - dropBase;
+        portEXIT_CRITICAL(&self->mux);
+    }
+
+    advCaptureQ = nullptr;
+
+    if (ok && batchCount > 0)
+    {
+        size_t bytes = batchCount * sizeof(AdvFrame);
+        ok = f.write(reinterpret_cast<const uint8_t *>(batch), bytes) == bytes;
+    }
+
+    if (f) f.close();
+
+    portENTER_CRITICAL(&self->mux);
+    self->st.capturing = false;
+    self->st.captured = captured;
+    if (!ok)
+    {
+        self->st.captureErrors++;
+        self->st.lastError = "capture_write_failed";
+    }
+    portEXIT_CRITICAL(&self->mux);
+
+    self->captureHandle = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool AdvHarness::startInject(const InjectRequest &req, String &error)
+{
+    if (injectHandle != nullptr)
+    {
+        error = "inject_running";
+        return false;
+    }
+
+    if (advQ == nullptr)
+    {
+        error = "ble_not_ready";
+        return false;
+    }
+
+    if (req.source == InjectSource::FILE && !LittleFS.exists(req.path))
+    {
+        error = "capture_not_found";
+        return false;
+    }
+
+    inject = req;
+    injectStop = false;
+
+    portENTER_CRITICAL(&mux);
+    st.injecting = true;
+    st.source = req.source;
+    st.injected = 0;
+    st.injectDropped = 0;
+    st.lateMaxMs = 0;
+    st.lastError = "";
+    portEXIT_CRITICAL(&mux);
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        injectTask,
+        "advInjectTask",
+        4096,
+        this,
+        1,
+        &injectHandle,
+        0);
+
+    if (ok != pdPASS)
+    {
+        injectHandle = nullptr;
+        portENTER_CRITICAL(&mux);
+        st.injecting = false;
+        portEXIT_CRITICAL(&mux);
+        error = "task_create_failed";
+        return false;
+    }
+
+    return true;
+}
+
+void AdvHarness::stopInject()
+{
+    injectStop = true;
+}
+
+HarnessStatus AdvHarness::status() const
+{
+    portENTER_CRITICAL(&mux);
+    HarnessStatus snapshot = st;
+    portEXIT_CRITICAL(&mux);
+    return snapshot;
+}
+
+// Entrega un frame a advQ como lo haria el callback de escaneo
+bool AdvHarness::deliver(const AdvFrame &f)
+{
+    AdvRaw m{};
+    m.rssi_read = f.rssiRead;
+    m.rssi_send = f.rssiSend;
+    memcpy(m.addr, f.addr, sizeof(m.addr));
+    m.company = f.company;
+    m.key_id = f.keyId;
+    m.len = f.len;
+    memcpy(m.payload, f.payload, sizeof(m.payload));
+    // Hora local de recepcion: la latencia del pipeline se mide igual que en campo
+    m.rx_ms = millis();
+
+    if (xQueueSend(advQ, &m, 0) != pdTRUE)
+    {
+        bleStatsRecordAdvDropped(static_cast<uint32_t>(uxQueueMessagesWaiting(advQ)));
+        return false;
+    }
+
+    bleStatsRecordAdvReceived(static_cast<uint32_t>(uxQueueMessagesWaiting(advQ)));
+    return true;
+}
+
+void AdvHarness::runInject()
+{
+    File file;
+    FileByteSource fileSource(file);
+    AdvReplayReader reader;
+    FleetGenerator *fleet = nullptr;
+    mbedtls_aes_context aes;
+    bool keyInstalled = false;
+    const char *error = "";
+
+    mbedtls_aes_init(&aes);
+
+    if (inject.source == InjectSource::FILE)
+    {
+        file = LittleFS.open(inject.path, "rb");
+        if (!file || !reader.begin(&fileSource)) error = "invalid_capture";
+    }
+    else
+    {
+        // El generador ocupa varios KB: va al heap y no al stack de la tarea
+        fleet = new (std::nothrow) FleetGenerator();
+        inject.fleet.keyId = HARNESS_KEY_ID;
+        memcpy(inject.fleet.key, FLEET_HARNESS_KEY, sizeof(FLEET_HARNESS_KEY));
+
+        if (fleet == nullptr)
+        {
+            error = "no_memory";
+        }
+        else if (!aes_key_set(HARNESS_KEY_ID, FLEET_HARNESS_KEY))
+        {
+            error = "key_table_full";
+        }
+        else
+        {
+            keyInstalled = true;
+            if (mbedtls_aes_setkey_enc(&aes, FLEET_HARNESS_KEY, 128) != 0 || !fleet->begin(inject.fleet, mbedtlsEncrypt, &aes))
+                error = "invalid_fleet";
+        }
+    }
+
+    InjectPacer pacer;
+    pacer.begin(inject.speedX100);
+    uint32_t injected = 0;
+    uint32_t dropped = 0;
+    uint32_t lateMax = 0;
+    AdvFrame f;
+
+    while (error[0] == '\0' && !injectStop && (inject.maxFrames == 0 || (injected + dropped) < inject.maxFrames))
+    {
+        bool more = fleet != nullptr ? fleet->next(f) : reader.next(f);
+        if (!more) break;
+
+        // Espera en tramos cortos para poder cortar una reproduccion lenta
+        uint32_t wait;
+        while ((wait = pacer.waitFor(f.rxMs, millis())) > 0 && !injectStop)
+        {
+            vTaskDelay(pdMS_TO_TICKS(wait > INJECT_MAX_SLEEP_MS ? INJECT_MAX_SLEEP_MS : wait));
+        }
+
+        uint32_t late = pacer.lateBy(f.rxMs, millis());
+        if (late > lateMax) lateMax = late;
+
+        if (deliver(f)) injected++;
+        else dropped++;
+
+        portENTER_CRITICAL(&mux);
+        st.injected = injected;
+        st.injectDropped = dropped;
+        st.lateMaxMs = lateMax;
+        portEXIT_CRITICAL(&mux);
+
+        // Sin ritmo: cede la CPU de vez en cuando para no ahogar al resto del nucleo
+        if (inject.speedX100 == 0 && ((injected + dropped) % 32) == 0) vTaskDelay(1);
+    }
+
+    if (file) file.close();
+    delete fleet;
+    mbedtls_aes_free(&aes);
+
+    // Deja drenar advQ antes de quitar la clave de la flota
+    if (keyInstalled)
+    {
+        while (uxQueueMessagesWaiting(advQ) > 0) vTaskDelay(pdMS_TO_TICKS(10));
+        vTaskDelay(pdMS_TO_TICKS(50));
+        aes_key_remove(HARNESS_KEY_ID);
+    }
+
+    portENTER_CRITICAL(&mux);
+    st.injecting = false;
+    st.lastError = error;
+    portEXIT_CRITICAL(&mux);
+}
+
+void AdvHarness::injectTask(void *pvParameters)
+{
+    AdvHarness *self = static_cast<AdvHarness *>(pvParameters);
+    self->runInject();
+    self->injectHandle = nullptr;
+    vTaskDelete(nullptr);
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include <adv_frame.h>
+#include <adv_replay.h>
+#include <fleet_generator.h>
+#include "config.h"
+
+/*
+  Captura y reinyeccion de trafico BLE.
+
+  Captura: el callback de escaneo copia cada AdvRaw a una cola aparte y
+  una tarea de fondo la vuelca a LittleFS con su rx_ms original.
+
+  Inyeccion: una tarea entrega a advQ, igual que el callback de escaneo,
+  frames de una captura o de una flota sintetica, a tiempo real o
+  acelerado. Los frames inyectados recorren el pipeline completo (slots,
+  registro, alarmas); la flota sintetica usa una clave temporal con key
+  ID HARNESS_KEY_ID que se quita al terminar.
+*/
+
+enum class InjectSource : uint8_t
+{
+    FILE = 0,
+    FLEET = 1,
+};
+
+struct InjectRequest
+{
+    InjectSource source = InjectSource::FLEET;
+    String path = HARNESS_CAPTURE_PATH;
+    uint32_t speedX100 = 100;
+    uint32_t maxFrames = 0; // 0 = hasta el final del archivo / sin limite en flota
+    FleetParams fleet;
+};
+
+struct HarnessStatus
+{
+    bool capturing = false;
+    char capturePath[32] = "";
+    uint32_t captured = 0;
+    uint32_t captureDropped = 0;
+    uint32_t captureErrors = 0;
+
+    bool injecting = false;
+    InjectSource source = InjectSource::FLEET;
+    uint32_t injected = 0;
+    uint32_t injectDropped = 0;
+    uint32_t lateMaxMs = 0;
+    const char *lastError = "";
+};
+
+class AdvHarness
+{
+public:
+    bool startCapture(const String &path, uint32_t maxFrames, String &error);
+    void stopCapture();
+
+    bool startInject(const InjectRequest &req, String &error);
+    void stopInject();
+
+    HarnessStatus status() const;
+
+    static void captureTask(void *pvParameters);
+    static void injectTask(void *pvParameters);
+
+private:
+    void runInject();
+    bool deliver(const AdvFrame &f);
+
+private:
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    HarnessStatus st;
+
+    QueueHandle_t captureQ = nullptr;
+    TaskHandle_t captureHandle = nullptr;
+    uint32_t captureMax = 0;
+    volatile bool captureStop = false;
+
+    TaskHandle_t injectHandle = nullptr;
+    InjectRequest inject;
+    volatile bool injectStop = false;
+};
+
+extern AdvHarness advHarness;
@@ -10,9 +10,11 @@ void BeaconRegistry::begin()
     if (mutex == nullptr) return;
     if (!lock()) return;
 
+    gen = generationStart();
     for (int i = 0; i < MAX_DISCOVERED_BEACONS; ++i)
     {
         list[i] = {};
+        entryGen[i] = gen;
     }
 
     unlock();
@@ -61,6 +63,8 @@ bool BeaconRegistry::seen(const BeaconDecoded &read)
             list[i].last_seen_ms = now;
             list[i].rssi = read.rssi_read;
             list[i].seen_count++;
+            list[i].restored = false;
+            entryGen[i] = ++gen;
             unlock();
             return false;
         }
@@ -79,6 +83,7 @@ bool BeaconRegistry::seen(const BeaconDecoded &read)
             list[i].first_seen_ms = now;
             list[i].last_seen_ms = now;
             list[i].seen_count = 1;
+            entryGen[i] = ++gen;
             unlock();
             return true;
         }
@@ -115,6 +120,7 @@ void BeaconRegistry::clearNewFlag(int index)
     if (list[index].used)
     {
         list[index].isNew = false;
+        entryGen[index] = ++gen;
     }
 
     unlock();
@@ -132,3 +138,60 @@ bool BeaconRegistry::snapshot(DiscoveredBeacon *out, size_t count) const
     unlock();
     return true;
 }
+
+bool BeaconRegistry::get(int index, DiscoveredBeacon &out) const
+{
+    if (index < 0 || index >= MAX_DISCOVERED_BEACONS) return false;
+
+    if (!lock()) return false;
+    out = list[index];
+    unlock();
+    return true;
+}
+
+uint64_t BeaconRegistry::changedMask(uint32_t since, bool &full, uint32_t &g) const
+{
+    static_assert(MAX_DISCOVERED_BEACONS <= 64, "changedMask cubre hasta 64 entradas");
+
+    uint64_t mask = 0;
+    if (!lock()) return mask;
+
+    g = gen;
+    if (generationAfter(since, gen)) full = true;
+    for (int i = 0; i < MAX_DISCOVERED_BEACONS; ++i)
+    {
+        bool pick = full ? list[i].used : generationAfter(entryGen[i], since);
+        if (pick) mask |= 1ULL << i;
+    }
+
+    unlock();
+    return mask;
+}
+
+
+bool BeaconRegistry::restore(const DiscoveredBeacon *in, size_t count)
+{
+    if (in == nullptr || count < MAX_DISCOVERED_BEACONS)
+    {
+        return false;
+    }
+
+    if (!lock()) return false;
+
+    for (int i = 0; i < MAX_DISCOVERED_BEACONS; ++i)
+    {
+        list[i] = in[i];
+        if (!list[i].used) continue;
+
+        // Los tiempos pertenecen al arranque anterior
+        list[i].restored = true;
+        list[i].first_seen_ms = 0;
+        list[i].last_seen_ms = 0;
+    }
+
+    gen++;
+    for (int i = 0; i < MAX_DISCOVERED_BEACONS; ++i) entryGen[i] = gen;
+
+    unlock();
+    return true;
+}
\ No newline at end of file
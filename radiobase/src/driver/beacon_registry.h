@@ -3,6 +3,7 @@
 #include <freertos/FreeRTOS.h>
 #include <freertos/semphr.h>
 #include "ble_types.h"
+#include "generation.h"
 
 #ifndef MAX_DISCOVERED_BEACONS
 #define MAX_DISCOVERED_BEACONS 64
@@ -19,6 +20,7 @@ struct DiscoveredBeacon
     uint32_t first_seen_ms = 0;
     uint32_t last_seen_ms = 0;
     uint32_t seen_count = 0;
+    bool restored = false;
 };
 
 class BeaconRegistry
@@ -30,6 +32,12 @@ public:
     int countNew() const;
     void clearNewFlag(int index);
     bool snapshot(DiscoveredBeacon *out, size_t count) const;
+    // Copia de una sola entrada, para recorrer el registro sin copiarlo entero
+    bool get(int index, DiscoveredBeacon &out) const;
+    // Bit i: la entrada i cambio despues de since (ver SlotManager::changedSlots).
+    // Completa, lista solo las entradas en uso
+    uint64_t changedMask(uint32_t since, bool &full, uint32_t &gen) const;
+    bool restore(const DiscoveredBeacon *in, size_t count);
 
 private:
     bool lock(TickType_t timeout = portMAX_DELAY) const;
@@ -38,4 +46,6 @@ private:
 private:
     mutable SemaphoreHandle_t mutex = nullptr;
     DiscoveredBeacon list[MAX_DISCOVERED_BEACONS]{};
+    uint32_t gen = 0;
+    uint32_t entryGen[MAX_DISCOVERED_BEACONS]{};
 };
@@ -10,10 +10,6 @@ BlePipelineStats bleStats{};
 static portMUX_TYPE bleStatsMux = portMUX_INITIALIZER_UNLOCKED;
 static uint32_t lastDataDropLogMs = 0;
 
-static const uint8_t KEY[16] = {
-    0xA3, 0x7F, 0x1C, 0xD9, 0x88, 0x4E, 0x21, 0xB6,
-    0x59, 0x02, 0xEF, 0xC4, 0x6A, 0x90, 0x13, 0xDD};
-
 static constexpr uint32_t BLE_DROP_LOG_INTERVAL_MS = 5000;
 
 static void updateMax(uint32_t &currentMax, uint32_t value)
@@ -31,6 +27,15 @@ void bleStatsReset()
     portEXIT_CRITICAL(&bleStatsMux);
 }
 
+void bleStatsRestore(const BlePipelineStats &restored)
+{
+    portENTER_CRITICAL(&bleStatsMux);
+    bleStats = restored;
+    bleStats.current_adv_depth = 0;
+    bleStats.current_data_depth = 0;
+    portEXIT_CRITICAL(&bleStatsMux);
+}
+
 BlePipelineStats bleStatsSnapshot()
 {
     portENTER_CRITICAL(&bleStatsMux);
@@ -64,6 +69,20 @@ void bleStatsRecordAdvDecryptFail()
     portEXIT_CRITICAL(&bleStatsMux);
 }
 
+void bleStatsRecordAdvUnknownVersion()
+{
+    portENTER_CRITICAL(&bleStatsMux);
+    bleStats.adv_unknown_version++;
+    portEXIT_CRITICAL(&bleStatsMux);
+}
+
+void bleStatsRecordAdvUnknownKey()
+{
+    portENTER_CRITICAL(&bleStatsMux);
+    bleStats.adv_unknown_key++;
+    portEXIT_CRITICAL(&bleStatsMux);
+}
+
 void bleStatsRecordDataEnqueued(uint32_t depth)
 {
     portENTER_CRITICAL(&bleStatsMux);
@@ -138,6 +157,14 @@ void bleStatsRecordRegistryUpdate(bool isNew)
     portEXIT_CRITICAL(&bleStatsMux);
 }
 
+void bleStatsRecordScanCallback(uint32_t cpuUs)
+{
+    portENTER_CRITICAL(&bleStatsMux);
+    bleStats.scan_callbacks++;
+    bleStats.scan_cpu_us += cpuUs;
+    portEXIT_CRITICAL(&bleStatsMux);
+}
+
 BlePipelineStats BleProceses::stats() const
 {
     return bleStatsSnapshot();
@@ -148,11 +175,41 @@ void BleProceses::resetStats()
     bleStatsReset();
 }
 
-bool BleProceses::begin()
+static bool createPipelineTask(TaskFunction_t fn, const char *name, uint16_t stack, uint8_t priority, uint8_t core, TaskHandle_t *handle)
 {
-    aes_init_key(KEY);
+    BaseType_t ok = xTaskCreatePinnedToCore(fn, name, stack, nullptr, priority, handle, core);
+
+    if (ok != pdPASS)
+    {
+        Serial.printf("BleProceses: No se pudo iniciar %s\n", name);
+        *handle = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+bool BleProceses::begin(const PipelineConfig &cfg)
+{
+    // Las claves las instala keyStore antes de arrancar el pipeline
     ble_rx_init();
-    bleStatsReset();
+    // bleStats arranca en cero o restaurado desde el checkpoint
+
+    topology = cfg;
+
+    if (cfg.fused)
+    {
+        // Una sola tarea: usa prioridad y nucleo de la etapa de descifrado y el stack mayor
+        uint16_t stack = cfg.decodeStack > cfg.logicStack ? cfg.decodeStack : cfg.logicStack;
+        if (!createPipelineTask(fusedTask, "bleFusedTask", stack, cfg.decodePriority, cfg.decodeCore, &advTaskHandle))
+        {
+            return false;
+        }
+
+        beaconLogicTaskHandle = advTaskHandle;
+        Serial.println("BleProceses: Inicializado (fusionado)");
+        return true;
+    }
 
     if (dataQ == nullptr)
     {
@@ -165,35 +222,13 @@ bool BleProceses::begin()
         return false;
     }
 
-    BaseType_t ok = xTaskCreatePinnedToCore(
-        advProcessTask,
-        "advProcessTask",
-        4096,
-        nullptr,
-        2,
-        &advTaskHandle,
-        1);
-
-    if (ok != pdPASS)
+    if (!createPipelineTask(advProcessTask, "advProcessTask", cfg.decodeStack, cfg.decodePriority, cfg.decodeCore, &advTaskHandle))
     {
-        Serial.println("BleProceses: No se pudo iniciar advProcessTask");
-        advTaskHandle = nullptr;
         return false;
     }
 
-    BaseType_t ok2 = xTaskCreatePinnedToCore(
-        beaconLogicTask,
-        "beaconLogicTask",
-        4096,
-        nullptr,
-        2,
-        &beaconLogicTaskHandle,
-        1);
-
-    if (ok2 != pdPASS)
+    if (!createPipelineTask(beaconLogicTask, "beaconLogicTask", cfg.logicStack, cfg.logicPriority, cfg.logicCore, &beaconLogicTaskHandle))
     {
-        Serial.println("BleProceses: No se pudo iniciar beaconLogicTask");
-        beaconLogicTaskHandle = nullptr;
         return false;
     }
 
@@ -201,56 +236,158 @@ bool BleProceses::begin()
     return true;
 }
 
+AdvDecodeResult BleProceses::decodeAdv(const AdvRaw &m, BeaconDecoded &read)
+{
+    uint8_t plain[16];
+
+    // El key ID elige la clave; sin clave valida no se intenta descifrar
+    AesKeyResult res = decrypt_block_key(m.key_id, m.payload, plain);
+    if (res == AesKeyResult::UNKNOWN_KEY || res == AesKeyResult::RETIRED)
+    {
+        return AdvDecodeResult::UNKNOWN_KEY;
+    }
+
+    // BUSY: la tabla estaba tomada por una rotacion; se descarta sin esperar
+    if (res != AesKeyResult::OK)
+    {
+        return AdvDecodeResult::DECRYPT_FAIL;
+    }
+
+    // La version viaja dentro del cuerpo cifrado: se elige el decodificador despues
+    const BeaconDecoderEntry *decoder = beaconFindDecoder(m.company, plain[0]);
+    BeaconFields fields;
+
+    if (decoder == nullptr || !decoder->decode(plain, sizeof(plain), fields))
+    {
+        return AdvDecodeResult::UNKNOWN_VERSION;
+    }
+
+    read = BeaconDecoded{};
+    read.version_id = fields.version_id;
+    read.environment_id = fields.environment_id;
+    read.device_id = fields.device_id;
+    read.flags = fields.flags;
+    read.tmp_x100 = fields.tmp_x100;
+    read.cpu_x100 = fields.cpu_x100;
+    read.bat_pct = fields.bat_pct;
+
+    // Optimizacion
+    // memcpy(read.addr, m.addr, sizeof(read.addr));
+    for (int i = 0; i < 6; ++i)
+    {
+        read.addr = (read.addr << 8) | m.addr[i];
+    }
+
+    read.rssi_read = m.rssi_read;
+    read.rssi_send = m.rssi_send;
+    read.rx_ms = m.rx_ms;
+    return AdvDecodeResult::OK;
+}
+
+// Contabiliza el resultado; true si la lectura sigue en el pipeline
+static bool recordDecode(const AdvRaw &m, AdvDecodeResult res)
+{
+    switch (res)
+    {
+    case AdvDecodeResult::OK:
+        aes_key_record(m.key_id, true);
+        return true;
+    case AdvDecodeResult::UNKNOWN_KEY:
+        bleStatsRecordAdvUnknownKey();
+        break;
+    case AdvDecodeResult::DECRYPT_FAIL:
+        bleStatsRecordAdvDecryptFail();
+        break;
+    case AdvDecodeResult::UNKNOWN_VERSION:
+        aes_key_record(m.key_id, false);
+        bleStatsRecordAdvUnknownVersion();
+        break;
+    }
+    return false;
+}
+
+bool BleProceses::processDecoded(const PipelineTargets &t, const BeaconDecoded &read, bool *mapped)
+{
+    int slot = -1;
+    bool viaMap = t.slots->updateMapped(read, &slot);
+    bool handled = viaMap;
+
+    if (!handled)
+    {
+        uint16_t currentEnv = static_cast<uint16_t>(sys.ambiente);
+        handled = t.slots->updateDirect(read, currentEnv, &slot);
+    }
+
+    if (mapped) *mapped = viaMap;
+    if (!handled) return false;
+
+    uint32_t now = millis();
+    bool wasInAlarm = t.alarms->isSlotInAlarm(slot);
+    t.alarms->evaluate(slot, read, now);
+    bool inAlarm = t.alarms->isSlotInAlarm(slot);
+    // La alarma sale en /api/slots: si cambio, el slot cuenta como modificado
+    if (inAlarm != wasInAlarm) t.slots->touchSlot(slot);
+    t.zones->update(slot, read, inAlarm, now);
+    t.history->append(slot, read, now);
+    t.rollups->update(slot, read, inAlarm);
+    t.scan->notifyArrival(slot, read.rx_ms);
+    t.events->publishSlotUpdate(slot, read, now);
+    return true;
+}
+
+void BleProceses::processDecoded(const BeaconDecoded &read)
+{
+    static const PipelineTargets live = {
+        &slotManager, &alarmEngine, &zoneAggregator, &slotHistory, &slotRollups, &scanControl, &appEvents};
+
+    bool mapped = false;
+    bool handled = processDecoded(live, read, &mapped);
+
+    if (handled)
+    {
+        if (mapped)
+            bleStatsRecordMappedUpdate();
+        else
+            bleStatsRecordDirectUpdate();
+    }
+    else
+    {
+        bool isNew = beaconRegistry.seen(read);
+        bleStatsRecordRegistryUpdate(isNew);
+        if (isNew) appEvents.publishRegistryNew(read, millis());
+    }
+
+    bleStatsRecordProcessed(millis() - read.rx_ms);
+}
+
 void BleProceses::advProcessTask(void *pvParameters)
 {
     (void)pvParameters;
     AdvRaw m;
+    BeaconDecoded read;
     Serial.println("advProcessTask: Iniciado");
 
     for (;;)
     {
-        if (xQueueReceive(advQ, &m, portMAX_DELAY) == pdTRUE)
-        {
-            uint8_t plain[16];
-
-            // Error en decrpyt bloque skip
-            if (!decrypt_block(m.payload, plain))
-            {
-                bleStatsRecordAdvDecryptFail();
-                continue;
-            }
-
-            BeaconDecoded read{};
+        if (xQueueReceive(advQ, &m, portMAX_DELAY) != pdTRUE)
+            continue;
 
-            memcpy(&read, plain, sizeof(BeaconBody));
+        if (!recordDecode(m, decodeAdv(m, read)))
+            continue;
 
-            // if (read.version_id == 1) return;
+        if (dataQ)
+        {
+            BaseType_t ok = xQueueSend(dataQ, &read, 0);
+            uint32_t depth = static_cast<uint32_t>(uxQueueMessagesWaiting(dataQ));
 
-            // Optimizacion
-            // memcpy(read.addr, m.addr, sizeof(read.addr));
-            for (int i = 0; i < 6; ++i)
+            if (ok == pdTRUE)
             {
-                read.addr = (read.addr << 8) | m.addr[i];
+                bleStatsRecordDataEnqueued(depth);
             }
-
-            read.rssi_read = m.rssi_read;
-            read.rssi_send = m.rssi_send;
-            read.rx_ms = m.rx_ms;
-
-            if (dataQ)
+            else
             {
-                BaseType_t ok = xQueueSend(dataQ, &read, 0);
-                uint32_t depth = static_cast<uint32_t>(uxQueueMessagesWaiting(dataQ));
-
-                if (ok == pdTRUE)
-                {
-                    bleStatsRecordDataEnqueued(depth);
-                }
-                else
-                {
-                    bleStatsRecordDataDropped(depth);
-                    logDropSummaryThrottled("BLE dataQ", lastDataDropLogMs);
-                }
+                bleStatsRecordDataDropped(depth);
+                logDropSummaryThrottled("BLE dataQ", lastDataDropLogMs);
             }
         }
     }
@@ -261,41 +398,32 @@ void BleProceses::beaconLogicTask(void *pvParameters)
     (void)pvParameters;
     BeaconDecoded read;
 
+    // Se despierta aunque no lleguen lecturas para detectar slots offline
     for (;;)
     {
-        if (xQueueReceive(dataQ, &read, portMAX_DELAY) != pdTRUE)
-            continue;
-
-        bool handled = false;
-        bool updatedMapped = false;
-        bool updatedDirect = false;
-
-        handled = slotManager.updateMapped(read);
-        updatedMapped = handled;
-
-        if (!handled)
-        {
-            uint16_t currentEnv = static_cast<uint16_t>(sys.ambiente);
-            handled = slotManager.updateDirect(read, currentEnv);
-            updatedDirect = handled;
-        }
+        bool got = xQueueReceive(dataQ, &read, pdMS_TO_TICKS(APP_EVENT_SWEEP_MS)) == pdTRUE;
+        if (got) processDecoded(read);
 
-        if (updatedMapped)
-        {
-            bleStatsRecordMappedUpdate();
-        }
+        appEvents.sweepOffline(millis());
+    }
+}
 
-        if (updatedDirect)
-        {
-            bleStatsRecordDirectUpdate();
-        }
+void BleProceses::fusedTask(void *pvParameters)
+{
+    (void)pvParameters;
+    AdvRaw m;
+    BeaconDecoded read;
+    Serial.println("bleFusedTask: Iniciado");
 
-        if (!handled)
+    // Descifra y actualiza en la misma tarea: sin copia ni salto por dataQ
+    for (;;)
+    {
+        bool got = xQueueReceive(advQ, &m, pdMS_TO_TICKS(APP_EVENT_SWEEP_MS)) == pdTRUE;
+        if (got && recordDecode(m, decodeAdv(m, read)))
         {
-            bool isNew = beaconRegistry.seen(read);
-            bleStatsRecordRegistryUpdate(isNew);
+            processDecoded(read);
         }
 
-        bleStatsRecordProcessed(millis() - read.rx_ms);
+        appEvents.sweepOffline(millis());
     }
 }
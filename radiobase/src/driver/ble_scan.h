@@ -1,16 +1,64 @@
 #pragma once
 #include <bleCallbacks.h>
 #include <crypto_lib.h>
+#include <beacon_decoders.h>
 #include "config.h"
 #include "ble_types.h"
 #include "beacon_registry.h"
+#include "core/deviceConfig.h"
 
+enum class AdvDecodeResult : uint8_t
+{
+    OK,
+    UNKNOWN_KEY,
+    DECRYPT_FAIL,
+    UNKNOWN_VERSION
+};
+
+class SlotManager;
+class AlarmEngine;
+class ZoneAggregator;
+class SlotHistory;
+class SlotRollups;
+class ScanControl;
+class AppEvents;
+
+// Todo lo que la etapa de logica modifica con una lectura. El pipeline usa
+// el estado del gateway; el benchmark, copias propias
+struct PipelineTargets
+{
+    SlotManager *slots;
+    AlarmEngine *alarms;
+    ZoneAggregator *zones;
+    SlotHistory *history;
+    SlotRollups *rollups;
+    ScanControl *scan;
+    AppEvents *events;
+};
+
+/*
+  Pipeline BLE. En modo dividido advProcessTask descifra y pasa la lectura
+  por dataQ a beaconLogicTask; en modo fusionado una sola tarea hace ambas
+  etapas sobre la misma lectura. Prioridades, nucleos y stacks salen de
+  PipelineConfig.
+*/
 class BleProceses {
 public:
-    bool begin();
+    bool begin(const PipelineConfig &cfg);
     BlePipelineStats stats() const;
     void resetStats();
+    const PipelineConfig &config() const { return topology; }
+
+    // Etapas sin estado propio; tambien las usa el benchmark
+    static AdvDecodeResult decodeAdv(const AdvRaw &m, BeaconDecoded &read);
+    static void processDecoded(const BeaconDecoded &read);
+    // false si la lectura no es de ningun slot; mapped indica por cual camino entro
+    static bool processDecoded(const PipelineTargets &t, const BeaconDecoded &read, bool *mapped = nullptr);
 
     static void advProcessTask(void *pvParameters);
     static void beaconLogicTask(void *pvParameters);
+    static void fusedTask(void *pvParameters);
+
+private:
+    PipelineConfig topology{};
 };
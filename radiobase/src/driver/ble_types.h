@@ -8,43 +8,7 @@ extern QueueHandle_t dataQ;
 extern TaskHandle_t advTaskHandle;
 extern TaskHandle_t beaconLogicTaskHandle;
 
-/* Estructura de Paquete de llegada
-
-  uint8_t version_id = 1;
-  uint8_t environment_id = 1;
-  uint8_t device_id = 0;
-  uint8_t flags = 0;
-  int16_t TMP117_tem_x100 = 0;
-  int16_t CPU_tem_x100 = 0;
-  int8_t BAT_x100 = 0;
-
-*/
-
-#pragma pack(push,1)
-struct BeaconBody
-{
-    uint8_t version_id = 0;
-    uint8_t environment_id = 0;
-    uint8_t device_id = 0;
-
-    union
-    {
-        uint8_t raw;
-
-        struct
-        {
-            uint8_t i2c_fail : 1;
-            uint8_t bat_low  : 1;
-            uint8_t tmp_fail : 1;
-            uint8_t reserved : 5;
-        };
-    } flags;
-
-    int16_t tmp_x100 = 0;
-    int16_t cpu_x100 = 0;
-    int8_t bat_pct = 0;
-};
-#pragma pack(pop)
+// Los layouts del cuerpo de cada version de beacon estan en lib/beaconDecoders
 
 #pragma pack(push,1)
 struct BeaconDecoded
@@ -78,4 +42,8 @@ struct SlotState
     uint64_t addr;
     BeaconDecoded last;
     uint32_t last_seen_ms;
+
+    // Restaurado de un checkpoint: last_seen_ms es de un arranque anterior
+    bool restored;
+    uint32_t restored_age_ms;
 };
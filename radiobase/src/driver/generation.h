@@ -0,0 +1,24 @@
+#pragma once
+#include <stdint.h>
+#include <esp_random.h>
+
+/*
+  Contadores de generacion para respuestas condicionales (ETag y ?since=).
+
+  Cada tabla lleva un contador que avanza con cada cambio y cada entrada
+  guarda el valor del ultimo cambio que la toco; actualizarlos es un
+  incremento y una escritura dentro del lock que ya se toma. Arrancan en
+  un valor al azar en cada boot, asi un ?since= de un arranque anterior
+  no coincide con este y la respuesta sale completa.
+*/
+
+inline uint32_t generationStart()
+{
+    return (esp_random() >> 2) | 1;
+}
+
+// a es posterior a b, tolerando la vuelta del contador
+inline bool generationAfter(uint32_t a, uint32_t b)
+{
+    return static_cast<int32_t>(a - b) > 0;
+}
@@ -0,0 +1,96 @@
+#include "netif_traffic.h"
+#include <lwip/netif.h>
+#include <lwip/pbuf.h>
+#include <lwip/tcpip.h>
+
+static portMUX_TYPE trafficMux = portMUX_INITIALIZER_UNLOCKED;
+static NetifTraffic traffic[NETIF_KIND_COUNT];
+static netif_input_fn origInput[NETIF_KIND_COUNT] = {};
+static netif_linkoutput_fn origOutput[NETIF_KIND_COUNT] = {};
+static volatile bool hookPending = false;
+
+// Nombres de netif que usa esp-netif: "ap", "st" y "en"
+static int kindOf(const struct netif *n)
+{
+    if (n->name[0] == 'a' && n->name[1] == 'p') return static_cast<int>(NetifKind::AP);
+    if (n->name[0] == 's' && n->name[1] == 't') return static_cast<int>(NetifKind::STA);
+    if (n->name[0] == 'e' && n->name[1] == 'n') return static_cast<int>(NetifKind::ETH);
+    return -1;
+}
+
+template <uint8_t K>
+static err_t countedInput(struct pbuf *p, struct netif *n)
+{
+    portENTER_CRITICAL(&trafficMux);
+    traffic[K].rxFrames++;
+    traffic[K].rxBytes += p->tot_len;
+    portEXIT_CRITICAL(&trafficMux);
+    return origInput[K](p, n);
+}
+
+template <uint8_t K>
+static err_t countedOutput(struct netif *n, struct pbuf *p)
+{
+    portENTER_CRITICAL(&trafficMux);
+    traffic[K].txFrames++;
+    traffic[K].txBytes += p->tot_len;
+    portEXIT_CRITICAL(&trafficMux);
+    return origOutput[K](n, p);
+}
+
+static const netif_input_fn INPUT_WRAP[NETIF_KIND_COUNT] = {countedInput<0>, countedInput<1>, countedInput<2>};
+static const netif_linkoutput_fn OUTPUT_WRAP[NETIF_KIND_COUNT] = {countedOutput<0>, countedOutput<1>, countedOutput<2>};
+
+static void hookInTcpip(void *ctx)
+{
+    (void)ctx;
+    bool seen[NETIF_KIND_COUNT] = {};
+    struct netif *n;
+
+    NETIF_FOREACH(n)
+    {
+        int k = kindOf(n);
+        if (k < 0) continue;
+        seen[k] = true;
+
+        if (n->input != nullptr && n->input != INPUT_WRAP[k])
+        {
+            origInput[k] = n->input;
+            n->input = INPUT_WRAP[k];
+        }
+
+        if (n->linkoutput != nullptr && n->linkoutput != OUTPUT_WRAP[k])
+        {
+            origOutput[k] = n->linkoutput;
+            n->linkoutput = OUTPUT_WRAP[k];
+        }
+    }
+
+    portENTER_CRITICAL(&trafficMux);
+    for (uint8_t k = 0; k < NETIF_KIND_COUNT; ++k)
+    {
+        traffic[k].hooked = seen[k];
+    }
+    portEXIT_CRITICAL(&trafficMux);
+
+    hookPending = false;
+}
+
+void netifTrafficHook()
+{
+    if (hookPending) return;
+
+    hookPending = true;
+    if (tcpip_callback(hookInTcpip, nullptr) != ERR_OK)
+    {
+        hookPending = false;
+    }
+}
+
+NetifTraffic netifTrafficSnapshot(NetifKind kind)
+{
+    portENTER_CRITICAL(&trafficMux);
+    NetifTraffic snapshot = traffic[static_cast<uint8_t>(kind)];
+    portEXIT_CRITICAL(&trafficMux);
+    return snapshot;
+}
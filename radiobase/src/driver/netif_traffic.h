@@ -0,0 +1,33 @@
+#pragma once
+#include <Arduino.h>
+
+/*
+  Contadores de trafico por interfaz a nivel de enlace.
+
+  Se envuelven las funciones input/linkoutput de cada netif de lwIP (AP,
+  STA y Ethernet) para contar tramas y bytes. El enganche corre en el hilo
+  tcpip y se repite en cada llamado: si la red se reconfigura y la netif
+  se recrea, se vuelve a envolver.
+*/
+
+enum class NetifKind : uint8_t
+{
+    AP = 0,
+    STA = 1,
+    ETH = 2,
+};
+
+static constexpr uint8_t NETIF_KIND_COUNT = 3;
+
+struct NetifTraffic
+{
+    bool hooked = false;
+    uint32_t rxFrames = 0;
+    uint32_t txFrames = 0;
+    uint32_t rxBytes = 0;
+    uint32_t txBytes = 0;
+};
+
+// Programa el enganche en el hilo tcpip; idempotente
+void netifTrafficHook();
+NetifTraffic netifTrafficSnapshot(NetifKind kind);
@@ -0,0 +1,388 @@
+#include "pipeline_bench.h"
+#include <esp_timer.h>
+#include <new>
+#include "mbedtls/aes.h"
+#include "core/appState.h"
+
+PipelineBench pipelineBench;
+
+static constexpr uint8_t BENCH_KEY_ID = 0xFE;
+static_assert(BENCH_KEY_ID >= AES_RESERVED_KEY_ID_MIN && BENCH_KEY_ID != HARNESS_KEY_ID,
+              "La clave del benchmark va en un slot reservado");
+static constexpr size_t BENCH_VARIANTS = 16;
+static constexpr uint32_t BENCH_BUCKET_US = 32;
+static constexpr size_t BENCH_BUCKETS = 128;
+static constexpr UBaseType_t BENCH_QUEUE_LEN = 48;
+static constexpr uint32_t BENCH_TIMEOUT_MS = 30000;
+static constexpr uint32_t BENCH_HISTORY_DEPTH = 64;
+static_assert(BENCH_VARIANTS <= MAX_SLOTS, "Cada variante va en su propio slot");
+
+static const uint8_t BENCH_KEY[16] = {
+    0x42, 0x45, 0x4E, 0x43, 0x48, 0x2D, 0x50, 0x49,
+    0x50, 0x45, 0x4C, 0x49, 0x4E, 0x45, 0x2D, 0x31};
+
+struct BenchItem
+{
+    AdvRaw m;
+    int64_t t0Us; // < 0 marca fin de corrida
+};
+
+struct BenchRead
+{
+    BeaconDecoded read;
+    int64_t t0Us;
+};
+
+// Estado de la corrida en curso; solo lo escribe la etapa final
+struct BenchSink
+{
+    uint32_t delivered;
+    uint64_t latSumUs;
+    uint32_t latMaxUs;
+    int64_t lastUs;
+    uint32_t hist[BENCH_BUCKETS];
+};
+
+// Copias propias de todo lo que modifica processDecoded: la etapa de
+// logica es la real, pero sobre este estado y no sobre el del gateway
+struct BenchState
+{
+    SlotManager slots;
+    AlarmEngine alarms;
+    ZoneAggregator zones;
+    SlotHistory history;
+    SlotRollups rollups;
+    ScanControl scan;
+    AppEvents events;
+};
+
+static AdvRaw input[BENCH_VARIANTS];
+static BenchState *shadow = nullptr;
+static PipelineTargets benchTargets{};
+static BenchSink sink;
+static QueueHandle_t benchIn = nullptr;
+static QueueHandle_t benchMid = nullptr;
+static TaskHandle_t benchWaiter = nullptr;
+
+static void sinkRecord(const BeaconDecoded &read, int64_t t0Us)
+{
+    BleProceses::processDecoded(benchTargets, read);
+
+    int64_t now = esp_timer_get_time();
+    uint32_t lat = static_cast<uint32_t>(now - t0Us);
+    size_t bucket = lat / BENCH_BUCKET_US;
+    if (bucket >= BENCH_BUCKETS) bucket = BENCH_BUCKETS - 1;
+
+    sink.delivered++;
+    sink.latSumUs += lat;
+    if (lat > sink.latMaxUs) sink.latMaxUs = lat;
+    sink.hist[bucket]++;
+    sink.lastUs = now;
+}
+
+static void finishStage()
+{
+    xTaskNotifyGive(benchWaiter);
+    vTaskDelete(nullptr);
+}
+
+static void benchDecodeStage(void *pvParameters)
+{
+    (void)pvParameters;
+    BenchItem item;
+    BenchRead out;
+
+    for (;;)
+    {
+        if (xQueueReceive(benchIn, &item, portMAX_DELAY) != pdTRUE) continue;
+
+        if (item.t0Us < 0)
+        {
+            out.t0Us = -1;
+            xQueueSend(benchMid, &out, portMAX_DELAY);
+            finishStage();
+        }
+
+        if (BleProceses::decodeAdv(item.m, out.read) != AdvDecodeResult::OK) continue;
+
+        out.t0Us = item.t0Us;
+        xQueueSend(benchMid, &out, portMAX_DELAY);
+    }
+}
+
+static void benchLogicStage(void *pvParameters)
+{
+    (void)pvParameters;
+    BenchRead item;
+
+    for (;;)
+    {
+        if (xQueueReceive(benchMid, &item, portMAX_DELAY) != pdTRUE) continue;
+        if (item.t0Us < 0) finishStage();
+
+        sinkRecord(item.read, item.t0Us);
+    }
+}
+
+static void benchFusedStage(void *pvParameters)
+{
+    (void)pvParameters;
+    BenchItem item;
+    BeaconDecoded read;
+
+    for (;;)
+    {
+        if (xQueueReceive(benchIn, &item, portMAX_DELAY) != pdTRUE) continue;
+        if (item.t0Us < 0) finishStage();
+
+        if (BleProceses::decodeAdv(item.m, read) != AdvDecodeResult::OK) continue;
+        sinkRecord(read, item.t0Us);
+    }
+}
+
+bool PipelineBench::start(uint32_t packets, String &error)
+{
+    if (packets == 0 || packets > PIPELINE_BENCH_MAX_PACKETS)
+    {
+        error = "invalid_packets";
+        return false;
+    }
+
+    portENTER_CRITICAL(&mux);
+    bool busy = st.running;
+    if (!busy)
+    {
+        st = PipelineBenchStatus{};
+        st.running = true;
+        st.packets = packets;
+    }
+    portEXIT_CRITICAL(&mux);
+
+    if (busy)
+    {
+        error = "bench_running";
+        return false;
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        benchTask,
+        "pipelineBenchTask",
+        4096,
+        this,
+        1,
+        &taskHandle,
+        0);
+
+    if (ok != pdPASS)
+    {
+        taskHandle = nullptr;
+        portENTER_CRITICAL(&mux);
+        st.running = false;
+        portEXIT_CRITICAL(&mux);
+        error = "task_create_failed";
+        return false;
+    }
+
+    return true;
+}
+
+PipelineBenchStatus PipelineBench::status() const
+{
+    portENTER_CRITICAL(&mux);
+    PipelineBenchStatus snapshot = st;
+    portEXIT_CRITICAL(&mux);
+    return snapshot;
+}
+
+bool PipelineBench::prepareInput()
+{
+    mbedtls_aes_context ctx;
+    mbedtls_aes_init(&ctx);
+    bool ok = mbedtls_aes_setkey_enc(&ctx, BENCH_KEY, 128) == 0;
+
+    for (size_t i = 0; ok && i < BENCH_VARIANTS; ++i)
+    {
+        int16_t tmp = static_cast<int16_t>(-1800 + i * 25);
+        int16_t cpu = static_cast<int16_t>(2500 + i * 10);
+
+        // Cuerpo v1 con relleno PKCS7, igual que el firmware del beacon
+        uint8_t plain[16];
+        memset(plain, 16 - 9, sizeof(plain));
+        plain[0] = 1;
+        plain[1] = 0xEE;
+        plain[2] = static_cast<uint8_t>(i);
+        plain[3] = 0;
+        plain[4] = static_cast<uint8_t>(tmp & 0xFF);
+        plain[5] = static_cast<uint8_t>((tmp >> 8) & 0xFF);
+        plain[6] = static_cast<uint8_t>(cpu & 0xFF);
+        plain[7] = static_cast<uint8_t>((cpu >> 8) & 0xFF);
+        plain[8] = 90;
+
+        AdvRaw &m = input[i];
+        memset(&m, 0, sizeof(m));
+        m.rssi_read = -60;
+        m.rssi_send = -4;
+        m.addr[0] = 0xC0;
+        m.addr[5] = static_cast<uint8_t>(i);
+        m.company = BEACON_COMPANY_FRIOPACKING;
+        m.key_id = BENCH_KEY_ID;
+        m.len = 16;
+        ok = mbedtls_aes_crypt_ecb(&ctx, MBEDTLS_AES_ENCRYPT, plain, m.payload) == 0;
+    }
+
+    mbedtls_aes_free(&ctx);
+    return ok;
+}
+
+bool PipelineBench::prepareTargets()
+{
+    if (shadow == nullptr) shadow = new (std::nothrow) BenchState();
+    if (shadow == nullptr) return false;
+
+    // Reglas y zonas se recargan de la configuracion vigente en cada corrida
+    if (!shadow->slots.begin(false) || !shadow->alarms.begin() || !shadow->zones.begin() ||
+        !shadow->history.begin(BENCH_HISTORY_DEPTH) || !shadow->rollups.begin(false))
+    {
+        return false;
+    }
+
+    // Cada variante queda mapeada a su slot, como un beacon asignado
+    if (!shadow->slots.lockMap()) return false;
+
+    bool ok = true;
+    BeaconMapEntry *map = shadow->slots.getMap();
+    for (size_t i = 0; i < BENCH_VARIANTS; ++i)
+    {
+        BeaconDecoded read{};
+        ok = ok && BleProceses::decodeAdv(input[i], read) == AdvDecodeResult::OK;
+        map[i] = {read.addr, static_cast<uint8_t>(i), ok};
+    }
+    shadow->slots.unlockMap();
+
+    benchTargets = {&shadow->slots, &shadow->alarms, &shadow->zones, &shadow->history,
+                    &shadow->rollups, &shadow->scan, &shadow->events};
+    return ok;
+}
+
+bool PipelineBench::runTopology(bool fused, PipelineBenchRun &out)
+{
+    const PipelineConfig &cfg = advertising.config();
+    memset(&sink, 0, sizeof(sink));
+    benchWaiter = xTaskGetCurrentTaskHandle();
+    ulTaskNotifyTake(pdTRUE, 0);
+    xQueueReset(benchIn);
+    xQueueReset(benchMid);
+
+    uint8_t stages = 0;
+    bool ok;
+    if (fused)
+    {
+        uint16_t stack = cfg.decodeStack > cfg.logicStack ? cfg.decodeStack : cfg.logicStack;
+        ok = xTaskCreatePinnedToCore(benchFusedStage, "benchFused", stack, nullptr, cfg.decodePriority, nullptr, cfg.decodeCore) == pdPASS;
+        stages = ok ? 1 : 0;
+    }
+    else
+    {
+        ok = xTaskCreatePinnedToCore(benchDecodeStage, "benchDecode", cfg.decodeStack, nullptr, cfg.decodePriority, nullptr, cfg.decodeCore) == pdPASS;
+        stages = ok ? 1 : 0;
+        ok = ok && xTaskCreatePinnedToCore(benchLogicStage, "benchLogic", cfg.logicStack, nullptr, cfg.logicPriority, nullptr, cfg.logicCore) == pdPASS;
+        stages = ok ? 2 : stages;
+    }
+
+    out = PipelineBenchRun{};
+    out.fused = fused;
+    out.packets = st.packets;
+
+    BenchItem item;
+    int64_t startUs = esp_timer_get_time();
+
+    // Entrada en rafaga: la cola llena frena al productor, se mide saturacion
+    for (uint32_t i = 0; ok && i < out.packets; ++i)
+    {
+        item.m = input[i % BENCH_VARIANTS];
+        item.t0Us = esp_timer_get_time();
+        xQueueSend(benchIn, &item, portMAX_DELAY);
+    }
+
+    if (stages > 0)
+    {
+        item.t0Us = -1;
+        xQueueSend(benchIn, &item, portMAX_DELAY);
+    }
+
+    // Cada etapa avisa al terminar; si una no arranco, la anterior queda esperando
+    for (uint8_t i = 0; i < stages; ++i)
+    {
+        if (ulTaskNotifyTake(pdFALSE, pdMS_TO_TICKS(BENCH_TIMEOUT_MS)) == 0)
+        {
+            return false;
+        }
+    }
+
+    if (!ok)
+    {
+        return false;
+    }
+
+    out.delivered = sink.delivered;
+    out.elapsedUs = static_cast<uint32_t>((sink.delivered > 0 ? sink.lastUs : esp_timer_get_time()) - startUs);
+    out.perSec = out.elapsedUs > 0 ? static_cast<uint32_t>(static_cast<uint64_t>(sink.delivered) * 1000000ULL / out.elapsedUs) : 0;
+    out.latAvgUs = sink.delivered > 0 ? static_cast<uint32_t>(sink.latSumUs / sink.delivered) : 0;
+    out.latMaxUs = sink.latMaxUs;
+
+    uint32_t target = sink.delivered - sink.delivered / 100;
+    uint32_t acc = 0;
+    for (size_t b = 0; b < BENCH_BUCKETS; ++b)
+    {
+        acc += sink.hist[b];
+        if (acc >= target)
+        {
+            out.latP99Us = (b + 1) * BENCH_BUCKET_US;
+            break;
+        }
+    }
+
+    return true;
+}
+
+void PipelineBench::benchTask(void *pvParameters)
+{
+    PipelineBench *self = static_cast<PipelineBench *>(pvParameters);
+    const char *error = "";
+    PipelineBenchRun runs[2];
+
+    if (benchIn == nullptr) benchIn = xQueueCreate(BENCH_QUEUE_LEN, sizeof(BenchItem));
+    if (benchMid == nullptr) benchMid = xQueueCreate(ADV_DATA_QUEUE_LEN, sizeof(BenchRead));
+
+    if (benchIn == nullptr || benchMid == nullptr)
+    {
+        error = "no_memory";
+    }
+    else if (!aes_key_set(BENCH_KEY_ID, BENCH_KEY))
+    {
+        error = "key_table_full";
+    }
+    else
+    {
+        if (!self->prepareInput())
+            error = "input_failed";
+        else if (!self->prepareTargets())
+            error = "no_memory";
+        else if (!self->runTopology(false, runs[0]) || !self->runTopology(true, runs[1]))
+            error = "run_failed";
+
+        aes_key_remove(BENCH_KEY_ID);
+    }
+
+    portENTER_CRITICAL(&self->mux);
+    self->st.runs[0] = runs[0];
+    self->st.runs[1] = runs[1];
+    self->st.error = error;
+    self->st.done = true;
+    self->st.running = false;
+    self->st.finishedMs = millis();
+    portEXIT_CRITICAL(&self->mux);
+
+    self->taskHandle = nullptr;
+    vTaskDelete(nullptr);
+}
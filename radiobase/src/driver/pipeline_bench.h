@@ -0,0 +1,66 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "config.h"
+
+/*
+  Benchmark de topologias del pipeline BLE.
+
+  Genera un conjunto fijo de anuncios sinteticos cifrados con una clave
+  temporal y los inyecta en rafaga, con las mismas prioridades, nucleos y
+  stacks de la configuracion activa, primero en modo dividido y despues en
+  modo fusionado.
+
+  Las dos etapas son las reales: BleProceses::decodeAdv y processDecoded,
+  con alarmas, zonas, historial, resumenes, cadencia y eventos. La logica
+  corre sobre copias propias de ese estado (reglas y zonas vigentes, cada
+  variante mapeada a su slot), asi el benchmark puede correr con el
+  gateway en servicio sin cambiar sus slots ni publicar eventos. Lo que
+  queda afuera son los contadores de bleStats y la espera por los locks
+  que comparte el pipeline en servicio.
+*/
+
+struct PipelineBenchRun
+{
+    bool fused = false;
+    uint32_t packets = 0;
+    uint32_t delivered = 0;
+    uint32_t elapsedUs = 0;
+    uint32_t perSec = 0;
+    uint32_t latAvgUs = 0;
+    uint32_t latP99Us = 0;
+    uint32_t latMaxUs = 0;
+};
+
+struct PipelineBenchStatus
+{
+    bool running = false;
+    bool done = false;
+    const char *error = "";
+    uint32_t packets = 0;
+    uint32_t finishedMs = 0;
+    PipelineBenchRun runs[2];
+};
+
+class PipelineBench
+{
+public:
+    bool start(uint32_t packets, String &error);
+    PipelineBenchStatus status() const;
+
+    static void benchTask(void *pvParameters);
+
+private:
+    bool prepareInput();
+    bool prepareTargets();
+    bool runTopology(bool fused, PipelineBenchRun &out);
+
+private:
+    TaskHandle_t taskHandle = nullptr;
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    PipelineBenchStatus st;
+};
+
+extern PipelineBench pipelineBench;
@@ -0,0 +1,397 @@
+#include "scan_control.h"
+#include <bleCallbacks.h>
+#include "core/appState.h"
+
+ScanControl scanControl;
+
+static constexpr uint32_t SCAN_CONTROL_TICK_MS = 250;
+static constexpr uint32_t SCAN_LOAD_SAMPLE_MS = 1000;
+
+static bool acceptListOk = false;
+
+// Ventana de escaneo de cada nivel, en unidades de 0.625 ms
+static uint32_t dutyWindowUnits(ScanDuty duty)
+{
+    switch (duty)
+    {
+    case ScanDuty::WIDE:
+        return SCAN_WINDOW_WIDE_UNITS;
+    case ScanDuty::NARROW:
+        return SCAN_WINDOW_NARROW_UNITS;
+    case ScanDuty::BASE:
+        break;
+    }
+    return SCAN_WINDOW_BASE_UNITS;
+}
+
+const char *ScanControl::modeName(ScanMode mode)
+{
+    switch (mode)
+    {
+    case ScanMode::OPEN:
+        return "open";
+    case ScanMode::FILTERED:
+        return "filtered";
+    case ScanMode::DISCOVERY:
+        return "discovery";
+    }
+    return "unknown";
+}
+
+const char *ScanControl::dutyName(ScanDuty duty)
+{
+    switch (duty)
+    {
+    case ScanDuty::BASE:
+        return "base";
+    case ScanDuty::WIDE:
+        return "wide";
+    case ScanDuty::NARROW:
+        return "narrow";
+    }
+    return "unknown";
+}
+
+bool ScanControl::begin(bool filterEnabled, bool scheduleEnabled)
+{
+    filterRequested = filterEnabled;
+    scheduleRequested = scheduleEnabled;
+    mapDirty = true;
+    maskDirty = true;
+
+    if (taskHandle == nullptr)
+    {
+        tracker.begin(CadenceParams{});
+    }
+
+    if (taskHandle != nullptr)
+    {
+        return true;
+    }
+
+    BaseType_t ok = xTaskCreatePinnedToCore(
+        scanControlTask,
+        "scanControlTask",
+        4096,
+        this,
+        1,
+        &taskHandle,
+        0);
+
+    if (ok != pdPASS)
+    {
+        Serial.println("ScanControl: No se pudo iniciar scanControlTask");
+        taskHandle = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void ScanControl::setFilterEnabled(bool enabled)
+{
+    filterRequested = enabled;
+    mapDirty = true;
+}
+
+void ScanControl::setScheduleEnabled(bool enabled)
+{
+    scheduleRequested = enabled;
+}
+
+void ScanControl::setWindowCap(uint16_t units)
+{
+    if (units == 0 || units > SCAN_INTERVAL_UNITS) units = SCAN_INTERVAL_UNITS;
+    if (units == windowCap) return;
+
+    windowCap = units;
+    capDirty = true;
+}
+
+void ScanControl::notifyMapChanged()
+{
+    mapDirty = true;
+    maskDirty = true;
+}
+
+void ScanControl::notifyArrival(int slot, uint32_t rxMs)
+{
+    if (slot < 0 || slot >= static_cast<int>(CADENCE_MAX_SLOTS)) return;
+
+    portENTER_CRITICAL(&mux);
+    tracker.observe(static_cast<uint8_t>(slot), rxMs);
+    portEXIT_CRITICAL(&mux);
+}
+
+ScanControlStats ScanControl::stats() const
+{
+    portENTER_CRITICAL(&mux);
+    ScanControlStats snapshot = st;
+    snapshot.catchFixed = tracker.catchStats(CadencePolicy::FIXED);
+    snapshot.catchAdaptive = tracker.catchStats(CadencePolicy::ADAPTIVE);
+    portEXIT_CRITICAL(&mux);
+    snapshot.filterEnabled = filterRequested;
+    snapshot.scheduleEnabled = scheduleRequested;
+    return snapshot;
+}
+
+CadenceSlotInfo ScanControl::cadence(int slot) const
+{
+    if (slot < 0 || slot >= static_cast<int>(CADENCE_MAX_SLOTS)) return CadenceSlotInfo{};
+
+    portENTER_CRITICAL(&mux);
+    CadenceSlotInfo info = tracker.info(static_cast<uint8_t>(slot));
+    portEXIT_CRITICAL(&mux);
+    return info;
+}
+
+bool ScanControl::loadAcceptList()
+{
+    uint64_t addrs[MAX_SLOTS];
+    size_t count = 0;
+
+    if (!slotManager.lockMap()) return false;
+    BeaconMapEntry *map = slotManager.getMap();
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        if (map[i].enabled && map[i].addr != 0)
+        {
+            addrs[count++] = map[i].addr;
+        }
+    }
+    slotManager.unlockMap();
+
+    // Sin beacons mapeados el filtro dejaria pasar nada
+    if (count == 0)
+    {
+        return false;
+    }
+
+    bool ok = ble_scan_set_accept_list(addrs, count);
+
+    portENTER_CRITICAL(&mux);
+    st.acceptListSize = ok ? count : 0;
+    if (!ok) st.acceptListErrors++;
+    portEXIT_CRITICAL(&mux);
+
+    if (!ok)
+    {
+        Serial.printf("ScanControl: accept list rechazada (%u direcciones), se usa modo abierto\n",
+                      static_cast<unsigned>(count));
+    }
+
+    return ok;
+}
+
+bool ScanControl::loadSlotMask()
+{
+    uint32_t mask = 0;
+
+    if (!slotManager.lockMap()) return false;
+    BeaconMapEntry *map = slotManager.getMap();
+    for (int i = 0; i < MAX_SLOTS && i < static_cast<int>(CADENCE_MAX_SLOTS); ++i)
+    {
+        if (map[i].enabled && map[i].addr != 0)
+        {
+            mask |= 1UL << i;
+        }
+    }
+    slotManager.unlockMap();
+
+    // Un slot reasignado vuelve a aprender desde cero
+    uint32_t removed = slotMask & ~mask;
+    portENTER_CRITICAL(&mux);
+    for (uint8_t i = 0; i < CADENCE_MAX_SLOTS; ++i)
+    {
+        if (removed & (1UL << i)) tracker.forget(i);
+    }
+    st.trackedSlots = __builtin_popcount(mask);
+    portEXIT_CRITICAL(&mux);
+
+    slotMask = mask;
+    return true;
+}
+
+void ScanControl::applyDuty(ScanDuty next)
+{
+    uint16_t cap = windowCap;
+    uint32_t window = dutyWindowUnits(next);
+    if (window > cap) window = cap;
+
+    capDirty = false;
+    if (!ble_scan_set_duty(SCAN_INTERVAL_UNITS, static_cast<uint16_t>(window)))
+    {
+        return;
+    }
+
+    portENTER_CRITICAL(&mux);
+    st.duty = next;
+    st.dutyChanges++;
+    st.windowUnits = window;
+    st.windowCapUnits = cap;
+    portEXIT_CRITICAL(&mux);
+}
+
+void ScanControl::updateSchedule(uint32_t nowMs, ScanMode mode)
+{
+    if (maskDirty)
+    {
+        maskDirty = !loadSlotMask();
+    }
+
+    portENTER_CRITICAL(&mux);
+    ScanDuty current = st.duty;
+    tracker.tick(nowMs);
+
+    ScanDuty next = ScanDuty::BASE;
+    if (scheduleRequested && mode != ScanMode::DISCOVERY && slotMask != 0 && tracker.allConfident(slotMask))
+    {
+        next = tracker.windowSoon(slotMask, nowMs, SCAN_SCHEDULE_LEAD_MS) ? ScanDuty::WIDE : ScanDuty::NARROW;
+    }
+
+    // Las llegadas y perdidas se atribuyen a la politica vigente
+    tracker.setPolicy(next == ScanDuty::BASE ? CadencePolicy::FIXED : CadencePolicy::ADAPTIVE);
+
+    uint32_t confidentCount = 0;
+    for (uint8_t i = 0; i < CADENCE_MAX_SLOTS; ++i)
+    {
+        if ((slotMask & (1UL << i)) && tracker.confident(i)) confidentCount++;
+    }
+    st.confidentSlots = confidentCount;
+
+    // Ciclo logrado: tiempo ponderado por la ventana del nivel que estuvo activo
+    uint32_t elapsed = nowMs - lastDutyMs;
+    dutyWeightedMs += static_cast<uint64_t>(elapsed) * st.windowUnits * 1000 / SCAN_INTERVAL_UNITS;
+    dutyTotalMs += elapsed;
+    st.dutyPermille = dutyTotalMs > 0 ? static_cast<uint32_t>(dutyWeightedMs / dutyTotalMs) : 0;
+    portEXIT_CRITICAL(&mux);
+
+    lastDutyMs = nowMs;
+
+    if (next != current || capDirty)
+    {
+        applyDuty(next);
+    }
+}
+
+void ScanControl::enterMode(ScanMode next)
+{
+    switch (next)
+    {
+    case ScanMode::OPEN:
+        ble_scan_configure(false, false);
+        break;
+    case ScanMode::FILTERED:
+        ble_scan_configure(true, true);
+        break;
+    case ScanMode::DISCOVERY:
+        ble_scan_configure(false, true);
+        break;
+    }
+
+    uint32_t now = millis();
+    modeSinceMs = now;
+    lastRestartMs = now;
+
+    portENTER_CRITICAL(&mux);
+    st.mode = next;
+    if (next == ScanMode::DISCOVERY) st.discoveryWindows++;
+    portEXIT_CRITICAL(&mux);
+}
+
+void ScanControl::sampleLoad(uint32_t nowMs)
+{
+    uint32_t elapsed = nowMs - lastSampleMs;
+    if (elapsed < SCAN_LOAD_SAMPLE_MS) return;
+
+    BlePipelineStats s = bleStatsSnapshot();
+    uint32_t callbacks = s.scan_callbacks - lastCallbacks;
+    uint32_t cpuUs = s.scan_cpu_us - lastCpuUs;
+    lastCallbacks = s.scan_callbacks;
+    lastCpuUs = s.scan_cpu_us;
+    lastSampleMs = nowMs;
+
+    uint32_t cbPerSec = static_cast<uint32_t>((static_cast<uint64_t>(callbacks) * 1000) / elapsed);
+    uint32_t cpuPerSec = static_cast<uint32_t>((static_cast<uint64_t>(cpuUs) * 1000) / elapsed);
+
+    portENTER_CRITICAL(&mux);
+    ScanModeLoad &load = st.load[static_cast<uint8_t>(st.mode)];
+    if (load.seconds == 0)
+    {
+        load.cpuUsPerSec = cpuPerSec;
+        load.callbacksPerSec = cbPerSec;
+    }
+    else
+    {
+        // Promedio movil para suavizar rafagas
+        load.cpuUsPerSec = (load.cpuUsPerSec * 7 + cpuPerSec) / 8;
+        load.callbacksPerSec = (load.callbacksPerSec * 7 + cbPerSec) / 8;
+    }
+    load.seconds += elapsed / 1000;
+    portEXIT_CRITICAL(&mux);
+}
+
+void ScanControl::scanControlTask(void *pvParameters)
+{
+    ScanControl *self = static_cast<ScanControl *>(pvParameters);
+    self->lastSampleMs = millis();
+    self->lastDutyMs = self->lastSampleMs;
+
+    for (;;)
+    {
+        vTaskDelay(pdMS_TO_TICKS(SCAN_CONTROL_TICK_MS));
+
+        uint32_t now = millis();
+        self->sampleLoad(now);
+
+        ScanMode mode;
+        portENTER_CRITICAL(&self->mux);
+        mode = self->st.mode;
+        portEXIT_CRITICAL(&self->mux);
+
+        self->updateSchedule(now, mode);
+
+        if (!self->filterRequested)
+        {
+            if (mode != ScanMode::OPEN)
+            {
+                self->enterMode(ScanMode::OPEN);
+            }
+            continue;
+        }
+
+        if (self->mapDirty)
+        {
+            self->mapDirty = false;
+            acceptListOk = self->loadAcceptList();
+            self->enterMode(acceptListOk ? ScanMode::FILTERED : ScanMode::OPEN);
+            self->lastDiscoveryMs = now;
+            continue;
+        }
+
+        // Sin accept list valida se queda abierto hasta el proximo cambio de mapa
+        if (!acceptListOk)
+        {
+            continue;
+        }
+
+        if (mode == ScanMode::DISCOVERY)
+        {
+            if ((now - self->modeSinceMs) >= SCAN_DISCOVERY_WINDOW_MS)
+            {
+                self->enterMode(ScanMode::FILTERED);
+                self->lastDiscoveryMs = now;
+            }
+            continue;
+        }
+
+        if ((now - self->lastDiscoveryMs) >= SCAN_DISCOVERY_PERIOD_MS)
+        {
+            self->enterMode(ScanMode::DISCOVERY);
+        }
+        else if ((now - self->lastRestartMs) >= SCAN_DUP_RESET_MS)
+        {
+            self->enterMode(ScanMode::FILTERED);
+        }
+    }
+}
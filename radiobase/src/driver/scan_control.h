@@ -0,0 +1,118 @@
+#pragma once
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <cadence_tracker.h>
+#include "config.h"
+
+/*
+  Control del modo de escaneo BLE.
+
+  En modo filtrado las direcciones mapeadas se cargan en la accept list del
+  controlador y se activa su filtro de duplicados, de modo que el host solo
+  recibe los beacons propios. El escaneo se reinicia cada SCAN_DUP_RESET_MS
+  para vaciar la cache de duplicados y que cada despertar del beacon llegue.
+  Cada SCAN_DISCOVERY_PERIOD_MS se abre una ventana sin filtro de
+  SCAN_DISCOVERY_WINDOW_MS para que los beacons nuevos lleguen al registro.
+
+  Con el planificador activo se aprende el ritmo de cada beacon mapeado y
+  la ventana de escaneo se ajusta: completa alrededor de las llegadas
+  esperadas y angosta el resto del tiempo. Mientras algun beacon mapeado
+  no tenga ritmo confiable, o durante el descubrimiento, se usa el ciclo
+  fijo de linea base.
+*/
+
+enum class ScanMode : uint8_t
+{
+    OPEN = 0,
+    FILTERED = 1,
+    DISCOVERY = 2,
+};
+
+enum class ScanDuty : uint8_t
+{
+    BASE = 0,
+    WIDE = 1,
+    NARROW = 2,
+};
+
+struct ScanModeLoad
+{
+    uint32_t cpuUsPerSec = 0;
+    uint32_t callbacksPerSec = 0;
+    uint32_t seconds = 0;
+};
+
+struct ScanControlStats
+{
+    bool filterEnabled = false;
+    ScanMode mode = ScanMode::OPEN;
+    uint32_t acceptListSize = 0;
+    uint32_t acceptListErrors = 0;
+    uint32_t discoveryWindows = 0;
+    ScanModeLoad load[3];
+
+    bool scheduleEnabled = false;
+    ScanDuty duty = ScanDuty::BASE;
+    uint32_t dutyChanges = 0;
+    uint32_t dutyPermille = 0;     // ciclo logrado desde el arranque
+    uint32_t trackedSlots = 0;
+    uint32_t confidentSlots = 0;
+    uint32_t windowUnits = SCAN_WINDOW_BASE_UNITS;
+    uint32_t windowCapUnits = SCAN_WINDOW_WIDE_UNITS;
+    CadenceCatch catchFixed;
+    CadenceCatch catchAdaptive;
+};
+
+class ScanControl
+{
+public:
+    bool begin(bool filterEnabled, bool scheduleEnabled);
+    void setFilterEnabled(bool enabled);
+    void setScheduleEnabled(bool enabled);
+    // Tope de ventana impuesto por el reparto de radio con WiFi
+    void setWindowCap(uint16_t units);
+    void notifyMapChanged();
+    // Llegada de un beacon ya asignado a slot; rxMs es el momento de recepcion
+    void notifyArrival(int slot, uint32_t rxMs);
+    ScanControlStats stats() const;
+    CadenceSlotInfo cadence(int slot) const;
+
+    static const char *modeName(ScanMode mode);
+    static const char *dutyName(ScanDuty duty);
+    static void scanControlTask(void *pvParameters);
+
+private:
+    bool loadAcceptList();
+    void enterMode(ScanMode next);
+    void sampleLoad(uint32_t nowMs);
+    bool loadSlotMask();
+    void updateSchedule(uint32_t nowMs, ScanMode mode);
+    void applyDuty(ScanDuty next);
+
+private:
+    TaskHandle_t taskHandle = nullptr;
+    mutable portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+    ScanControlStats st;
+    volatile bool filterRequested = false;
+    volatile bool mapDirty = true;
+    volatile bool scheduleRequested = false;
+    volatile bool maskDirty = true;
+    volatile uint16_t windowCap = SCAN_WINDOW_WIDE_UNITS;
+    volatile bool capDirty = false;
+
+    CadenceTracker tracker;
+    uint32_t slotMask = 0;
+    uint64_t dutyWeightedMs = 0; // ms x permil de ventana
+    uint64_t dutyTotalMs = 0;
+    uint32_t lastDutyMs = 0;
+
+    uint32_t modeSinceMs = 0;
+    uint32_t lastRestartMs = 0;
+    uint32_t lastDiscoveryMs = 0;
+    uint32_t lastSampleMs = 0;
+    uint32_t lastCallbacks = 0;
+    uint32_t lastCpuUs = 0;
+};
+
+extern ScanControl scanControl;
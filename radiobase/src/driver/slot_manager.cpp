@@ -1,19 +1,20 @@
 #include "slot_manager.h"
+#include <stddef.h>
+#include <esp_rom_crc.h>
+#include "storage_fs.h"
+
+static_assert(MAX_SLOTS <= 32, "changedSlots/changedMap usan un bit por slot");
 
 static constexpr uint32_t MAP_MAGIC = 0x424D4150; // "BMAP"
 static constexpr uint16_t MAP_VERSION = 1;
+static constexpr uint32_t JOURNAL_MAGIC = 0x424D4A52; // "BMJR"
 
-bool SlotManager::ensureConfigDir() const
+enum : uint8_t
 {
-    File dirTest = LittleFS.open("/config");
-    if (dirTest)
-    {
-        dirTest.close();
-        return true;
-    }
-
-    return LittleFS.mkdir("/config");
-}
+    JOURNAL_ENTRY = 1,
+    JOURNAL_CLEAR = 2,
+    JOURNAL_COMMIT = 3,
+};
 
 void SlotManager::buildMapFileData(MapFileData &fileData, const BeaconMapEntry *entries) const
 {
@@ -24,9 +25,10 @@ void SlotManager::buildMapFileData(MapFileData &fileData, const BeaconMapEntry *
 
     memcpy(fileData.entries, entries, sizeof(fileData.entries));
 
+    // Hasta el campo crc: sizeof incluye el relleno final y el crc mismo
     fileData.crc = calcCrc32(
         reinterpret_cast<const uint8_t *>(&fileData),
-        sizeof(MapFileData) - sizeof(fileData.crc));
+        offsetof(MapFileData, crc));
 }
 
 bool SlotManager::readMapFile(const char *path, BeaconMapEntry *entries) const
@@ -61,7 +63,7 @@ bool SlotManager::readMapFile(const char *path, BeaconMapEntry *entries) const
 
     uint32_t expectedCrc = calcCrc32(
         reinterpret_cast<const uint8_t *>(&fileData),
-        sizeof(MapFileData) - sizeof(fileData.crc));
+        offsetof(MapFileData, crc));
 
     if (expectedCrc != fileData.crc)
     {
@@ -152,7 +154,7 @@ bool SlotManager::saveMapData(const BeaconMapEntry *entries) const
     return true;
 }
 
-bool SlotManager::begin()
+bool SlotManager::begin(bool persist)
 {
     if (mapMutex == nullptr)
     {
@@ -164,12 +166,45 @@ bool SlotManager::begin()
         slotsMutex = xSemaphoreCreateMutex();
     }
 
-    if (mapMutex == nullptr || slotsMutex == nullptr)
+    if (journalMutex == nullptr)
+    {
+        journalMutex = xSemaphoreCreateMutex();
+    }
+
+    if (mapMutex == nullptr || slotsMutex == nullptr || journalMutex == nullptr)
         return false;
 
+    slotsGen = generationStart();
+    mapGen = slotsGen;
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        slotGen[i] = slotsGen;
+        mapEntryGen[i] = mapGen;
+    }
+
+    if (!persist) return true;
+
     // LittleFS debe estar montado antes de esto en tu sistema
     loadMap();
 
+    if (compactTaskHandle == nullptr)
+    {
+        BaseType_t ok = xTaskCreatePinnedToCore(
+            mapCompactTask,
+            "mapCompactTask",
+            4096,
+            this,
+            1,
+            &compactTaskHandle,
+            0);
+
+        if (ok != pdPASS)
+        {
+            Serial.println("SlotManager: No se pudo iniciar mapCompactTask");
+            compactTaskHandle = nullptr;
+        }
+    }
+
     return true;
 }
 
@@ -215,9 +250,12 @@ void SlotManager::updateSlot(int slot, const BeaconDecoded &read)
     slots[slot].addr = read.addr;
     slots[slot].last = read;
     slots[slot].last_seen_ms = millis();
+    slots[slot].restored = false;
+    slots[slot].restored_age_ms = 0;
+    slotGen[slot] = ++slotsGen;
 }
 
-bool SlotManager::updateMapped(const BeaconDecoded &read)
+bool SlotManager::updateMapped(const BeaconDecoded &read, int *slotOut)
 {
     if (!lockMap()) return false;
     int slot = findMappedSlot(read.addr);
@@ -228,10 +266,12 @@ bool SlotManager::updateMapped(const BeaconDecoded &read)
     if (!lockSlots()) return false;
     updateSlot(slot, read);
     unlockSlots();
+
+    if (slotOut) *slotOut = slot;
     return true;
 }
 
-bool SlotManager::updateDirect(const BeaconDecoded &read, uint16_t currentEnv)
+bool SlotManager::updateDirect(const BeaconDecoded &read, uint16_t currentEnv, int *slotOut)
 {
     if (read.environment_id != currentEnv) return false;
     if (read.device_id >= MAX_SLOTS) return false;
@@ -239,10 +279,104 @@ bool SlotManager::updateDirect(const BeaconDecoded &read, uint16_t currentEnv)
     int slot = static_cast<int>(read.device_id);
     if (!lockSlots()) return false;
     updateSlot(slot, read);
+    unlockSlots();
+
+    if (slotOut) *slotOut = slot;
+    return true;
+}
+
+bool SlotManager::snapshotSlots(SlotState *out, TickType_t timeout)
+{
+    if (out == nullptr) return false;
+    if (!lockSlots(timeout)) return false;
+    memcpy(out, slots, sizeof(slots));
+    unlockSlots();
+    return true;
+}
+
+bool SlotManager::restoreSlots(const SlotState *in, uint32_t capturedMs)
+{
+    if (in == nullptr) return false;
+    if (!lockSlots()) return false;
+
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        slots[i] = in[i];
+        if (!slots[i].used) continue;
+
+        // El reloj de millis() reinicia en cada arranque; se conserva la edad
+        // que tenia la lectura al momento del checkpoint.
+        uint32_t age = in[i].restored ? in[i].restored_age_ms : capturedMs - in[i].last_seen_ms;
+        slots[i].restored = true;
+        slots[i].restored_age_ms = age;
+        slots[i].last_seen_ms = 0;
+    }
+
+    slotsGen++;
+    for (int i = 0; i < MAX_SLOTS; ++i) slotGen[i] = slotsGen;
+
     unlockSlots();
     return true;
 }
 
+void SlotManager::touchSlot(int slot)
+{
+    if (slot < 0 || slot >= MAX_SLOTS) return;
+    if (!lockSlots()) return;
+    slotGen[slot] = ++slotsGen;
+    unlockSlots();
+}
+
+void SlotManager::touchSlots()
+{
+    if (!lockSlots()) return;
+    slotsGen++;
+    for (int i = 0; i < MAX_SLOTS; ++i) slotGen[i] = slotsGen;
+    unlockSlots();
+}
+
+uint32_t SlotManager::changedSlots(uint32_t since, bool &full, uint32_t &gen)
+{
+    uint32_t mask = 0;
+    if (!lockSlots()) return mask;
+
+    gen = slotsGen;
+    if (generationAfter(since, slotsGen)) full = true;
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        if (full || generationAfter(slotGen[i], since)) mask |= 1UL << i;
+    }
+
+    unlockSlots();
+    return mask;
+}
+
+uint32_t SlotManager::changedMap(uint32_t since, bool &full, uint32_t &gen)
+{
+    uint32_t mask = 0;
+    if (!lockMap()) return mask;
+
+    gen = mapGen;
+    if (generationAfter(since, mapGen)) full = true;
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        if (full || generationAfter(mapEntryGen[i], since)) mask |= 1UL << i;
+    }
+
+    unlockMap();
+    return mask;
+}
+
+// Con el mapa tomado; index -1 marca todas las entradas
+void SlotManager::touchMapLocked(int index)
+{
+    mapGen++;
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        if (index < 0 || index == i) mapEntryGen[i] = mapGen;
+    }
+}
+
 SlotState *SlotManager::getSlots()
 {
     return slots;
@@ -255,102 +389,346 @@ BeaconMapEntry *SlotManager::getMap()
 
 uint32_t SlotManager::calcCrc32(const uint8_t *data, size_t len) const
 {
-    uint32_t crc = 0xFFFFFFFF;
+    // CRC-32 IEEE de la ROM, compatible con los archivos ya guardados
+    return esp_rom_crc32_le(0, data, len);
+}
+
+bool SlotManager::saveMap() const
+{
+    BeaconMapEntry snapshot[MAX_SLOTS]{};
+    if (!const_cast<SlotManager *>(this)->lockMap()) return false;
+    memcpy(snapshot, beaconMap, sizeof(snapshot));
+    const_cast<SlotManager *>(this)->unlockMap();
+
+    return saveMapData(snapshot);
+}
+
+void SlotManager::sealRecord(JournalRecord &rec) const
+{
+    rec.magic = JOURNAL_MAGIC;
+    rec.crc = calcCrc32(reinterpret_cast<const uint8_t *>(&rec), sizeof(JournalRecord) - sizeof(rec.crc));
+}
+
+bool SlotManager::appendJournal(const JournalRecord *records, size_t count)
+{
+    if (!ensureConfigDir())
+    {
+        return false;
+    }
 
-    for (size_t i = 0; i < len; ++i)
+    File f = LittleFS.open(MAP_JOURNAL, "ab");
+    if (!f)
     {
-        crc ^= data[i];
-        for (int j = 0; j < 8; ++j)
+        return false;
+    }
+
+    size_t bytes = count * sizeof(JournalRecord);
+    size_t written = f.write(reinterpret_cast<const uint8_t *>(records), bytes);
+    f.close();
+
+    if (written != bytes)
+    {
+        return false;
+    }
+
+    journalBytes += bytes;
+    return true;
+}
+
+size_t SlotManager::replayJournal(BeaconMapEntry *entries, bool &dirtyTail)
+{
+    dirtyTail = false;
+    journalBytes = 0;
+
+    if (!LittleFS.exists(MAP_JOURNAL))
+    {
+        return 0;
+    }
+
+    File f = LittleFS.open(MAP_JOURNAL, "rb");
+    if (!f)
+    {
+        return 0;
+    }
+
+    JournalRecord pending[MAX_SLOTS + 1];
+    size_t pendingCount = 0;
+    size_t applied = 0;
+    size_t committedBytes = 0;
+    size_t offset = 0;
+    uint32_t pendingTxn = 0;
+    JournalRecord rec;
+
+    while (f.readBytes(reinterpret_cast<char *>(&rec), sizeof(rec)) == sizeof(rec))
+    {
+        offset += sizeof(rec);
+
+        uint32_t crc = calcCrc32(reinterpret_cast<const uint8_t *>(&rec), sizeof(rec) - sizeof(rec.crc));
+        if (rec.magic != JOURNAL_MAGIC || crc != rec.crc)
+        {
+            break;
+        }
+
+        if (pendingCount > 0 && rec.txn != pendingTxn)
+        {
+            // Transaccion anterior sin COMMIT: se descarta
+            pendingCount = 0;
+        }
+
+        if (rec.type == JOURNAL_COMMIT)
         {
-            if (crc & 1)
-                crc = (crc >> 1) ^ 0xEDB88320;
-            else
-                crc >>= 1;
+            if (rec.txn == pendingTxn && rec.index == pendingCount)
+            {
+                for (size_t i = 0; i < pendingCount; ++i)
+                {
+                    const JournalRecord &p = pending[i];
+                    if (p.type == JOURNAL_CLEAR)
+                    {
+                        memset(entries, 0, sizeof(BeaconMapEntry) * MAX_SLOTS);
+                    }
+                    else if (p.index < MAX_SLOTS)
+                    {
+                        entries[p.index].addr = p.addr;
+                        entries[p.index].slot = p.slot;
+                        entries[p.index].enabled = p.enabled != 0;
+                    }
+                }
+
+                applied++;
+                committedBytes = offset;
+            }
+
+            if (rec.txn >= nextTxn) nextTxn = rec.txn + 1;
+            pendingCount = 0;
+            continue;
         }
+
+        if (pendingCount >= MAX_SLOTS + 1)
+        {
+            break;
+        }
+
+        pendingTxn = rec.txn;
+        pending[pendingCount++] = rec;
     }
 
-    return ~crc;
+    size_t fileSize = f.size();
+    f.close();
+
+    journalBytes = committedBytes;
+    dirtyTail = fileSize != committedBytes;
+    return applied;
 }
 
-bool SlotManager::saveMap() const
+bool SlotManager::compactMapLocked()
 {
     BeaconMapEntry snapshot[MAX_SLOTS]{};
-    if (!const_cast<SlotManager *>(this)->lockMap()) return false;
+    if (!lockMap()) return false;
     memcpy(snapshot, beaconMap, sizeof(snapshot));
-    const_cast<SlotManager *>(this)->unlockMap();
+    unlockMap();
 
-    return saveMapData(snapshot);
+    if (!saveMapData(snapshot))
+    {
+        return false;
+    }
+
+    // Si se corta aqui, el journal se vuelve a aplicar sobre la base nueva;
+    // sus operaciones son absolutas, asi que el resultado es el mismo.
+    if (LittleFS.exists(MAP_JOURNAL))
+    {
+        LittleFS.remove(MAP_JOURNAL);
+    }
+
+    journalBytes = 0;
+    return true;
 }
 
-bool SlotManager::loadMap()
+bool SlotManager::compactMap()
 {
-    BeaconMapEntry loaded[MAX_SLOTS]{};
+    if (journalMutex == nullptr) return false;
+    if (xSemaphoreTake(journalMutex, portMAX_DELAY) != pdTRUE) return false;
+    bool ok = compactMapLocked();
+    xSemaphoreGive(journalMutex);
+    return ok;
+}
 
-    if (readMapFile(MAP_FILE, loaded))
+void SlotManager::mapCompactTask(void *pvParameters)
+{
+    SlotManager *self = static_cast<SlotManager *>(pvParameters);
+
+    for (;;)
     {
-        if (!lockMap()) return false;
-        memcpy(beaconMap, loaded, sizeof(beaconMap));
-        unlockMap();
-        return true;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        if (!self->compactMap())
+        {
+            Serial.println("SlotManager: fallo la compactacion del journal");
+        }
     }
+}
 
-    if (readMapFile(MAP_FILE_BAK, loaded))
+bool SlotManager::loadMap()
+{
+    BeaconMapEntry loaded[MAX_SLOTS]{};
+
+    bool baseOk = readMapFile(MAP_FILE, loaded);
+    if (!baseOk && readMapFile(MAP_FILE_BAK, loaded))
     {
-        if (!lockMap()) return false;
-        memcpy(beaconMap, loaded, sizeof(beaconMap));
-        unlockMap();
+        baseOk = true;
         saveMapData(loaded);
-        return true;
     }
 
+    bool dirtyTail = false;
+    size_t applied = replayJournal(loaded, dirtyTail);
+
     if (!lockMap()) return false;
-    memset(beaconMap, 0, sizeof(beaconMap));
+    memcpy(beaconMap, loaded, sizeof(beaconMap));
+    touchMapLocked(-1);
     unlockMap();
-    return false;
+
+    // Basura despues del ultimo COMMIT (corte durante una escritura):
+    // se compacta ya para que los siguientes registros sean alcanzables.
+    if (dirtyTail)
+    {
+        compactMap();
+    }
+
+    return baseOk || applied > 0;
 }
 
 bool SlotManager::clearMap()
 {
-    if (lockMap() == false) return false;
+    if (journalMutex == nullptr) return false;
 
-    BeaconMapEntry updated[MAX_SLOTS]{};
-    unlockMap();
+    JournalRecord records[2]{};
+    if (xSemaphoreTake(journalMutex, portMAX_DELAY) != pdTRUE) return false;
 
-    bool ok = saveMapData(updated);
+    uint32_t txn = nextTxn++;
+    records[0].txn = txn;
+    records[0].type = JOURNAL_CLEAR;
+    records[1].txn = txn;
+    records[1].type = JOURNAL_COMMIT;
+    records[1].index = 1;
+    sealRecord(records[0]);
+    sealRecord(records[1]);
 
-    if (!lockMap()) return false;
-    if (ok)
+    bool ok = appendJournal(records, 2);
+
+    if (ok && lockMap())
     {
-        memcpy(beaconMap, updated, sizeof(beaconMap));
+        memset(beaconMap, 0, sizeof(beaconMap));
+        touchMapLocked(-1);
+        unlockMap();
+    }
+    else if (!ok)
+    {
+        compactMapLocked();
+    }
+
+    xSemaphoreGive(journalMutex);
+
+    if (ok && journalBytes >= MAP_JOURNAL_COMPACT_BYTES && compactTaskHandle)
+    {
+        xTaskNotifyGive(compactTaskHandle);
     }
 
-    unlockMap();
     return ok;
 }
 
-bool SlotManager::setMapEntry(int index, uint64_t addr, uint8_t slot, bool enabled)
+const char *SlotManager::checkMapEntries(const MapEntryUpdate *updates, size_t count)
 {
-    if (index < 0 || index >= MAX_SLOTS) return false;
-    if (slot >= MAX_SLOTS) return false;
+    if (updates == nullptr || count == 0 || count > MAX_SLOTS) return "invalid_entries";
 
-    if (!lockMap()) return false;
+    uint32_t seen = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        if (updates[i].index >= MAX_SLOTS || updates[i].slot >= MAX_SLOTS) return "invalid_index_or_slot";
 
-    BeaconMapEntry updated[MAX_SLOTS]{};
-    memcpy(updated, beaconMap, sizeof(updated));
-    unlockMap();
+        // Dos entradas del lote sobre el mismo indice: el orden decidiria cual queda
+        if (seen & (1UL << updates[i].index)) return "duplicate_index";
+        seen |= 1UL << updates[i].index;
 
-    updated[index].enabled = enabled;
-    updated[index].addr = addr;
-    updated[index].slot = slot;
+        // La misma MAC en dos indices: findMappedSlot solo veria el primero.
+        // addr 0 es una entrada vacia y puede repetirse
+        if (updates[i].addr == 0) continue;
+        for (size_t j = 0; j < i; ++j)
+        {
+            if (updates[j].addr == updates[i].addr) return "duplicate_addr";
+        }
+    }
 
-    bool ok = saveMapData(updated);
+    return nullptr;
+}
 
-    if (!lockMap()) return false;
-    if (ok)
+bool SlotManager::applyMapEntries(const MapEntryUpdate *updates, size_t count)
+{
+    if (checkMapEntries(updates, count) != nullptr) return false;
+    if (journalMutex == nullptr) return false;
+
+    JournalRecord records[MAX_SLOTS + 1]{};
+
+    if (xSemaphoreTake(journalMutex, portMAX_DELAY) != pdTRUE) return false;
+
+    uint32_t txn = nextTxn++;
+    for (size_t i = 0; i < count; ++i)
     {
-        memcpy(beaconMap, updated, sizeof(beaconMap));
+        JournalRecord &rec = records[i];
+        rec.txn = txn;
+        rec.type = JOURNAL_ENTRY;
+        rec.index = updates[i].index;
+        rec.slot = updates[i].slot;
+        rec.enabled = updates[i].enabled ? 1 : 0;
+        rec.addr = updates[i].addr;
+        sealRecord(rec);
+    }
+
+    JournalRecord &commit = records[count];
+    commit.txn = txn;
+    commit.type = JOURNAL_COMMIT;
+    commit.index = static_cast<uint8_t>(count);
+    sealRecord(commit);
+
+    // Una sola escritura por lote: o entra el COMMIT o la transaccion no existe
+    bool ok = appendJournal(records, count + 1);
+
+    if (ok && lockMap())
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            BeaconMapEntry &e = beaconMap[updates[i].index];
+            e.addr = updates[i].addr;
+            e.slot = updates[i].slot;
+            e.enabled = updates[i].enabled;
+            touchMapLocked(updates[i].index);
+        }
+        unlockMap();
+    }
+    else if (!ok)
+    {
+        // Una cola a medio escribir ocultaria los siguientes COMMIT
+        compactMapLocked();
+    }
+
+    xSemaphoreGive(journalMutex);
+
+    if (ok && journalBytes >= MAP_JOURNAL_COMPACT_BYTES && compactTaskHandle)
+    {
+        xTaskNotifyGive(compactTaskHandle);
     }
 
-    unlockMap();
     return ok;
 }
+
+bool SlotManager::setMapEntry(int index, uint64_t addr, uint8_t slot, bool enabled)
+{
+    if (index < 0 || index >= MAX_SLOTS) return false;
+    if (slot >= MAX_SLOTS) return false;
+
+    MapEntryUpdate update{};
+    update.index = static_cast<uint8_t>(index);
+    update.addr = addr;
+    update.slot = slot;
+    update.enabled = enabled;
+
+    return applyMapEntries(&update, 1);
+}
@@ -2,33 +2,80 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include "ble_types.h"
+#include "generation.h"
+
+struct MapEntryUpdate
+{
+    uint8_t index;
+    uint64_t addr;
+    uint8_t slot;
+    bool enabled;
+};
 
 class SlotManager
 {
 public:
-    bool begin();
+    // persist false: sin cargar el mapa ni compactar el journal (copias de prueba)
+    bool begin(bool persist = true);
     bool lockMap(TickType_t timeout = portMAX_DELAY);
     void unlockMap();
     bool lockSlots(TickType_t timeout = portMAX_DELAY);
     void unlockSlots();
 
     int findMappedSlot(uint64_t addr) const;
-    bool updateMapped(const BeaconDecoded &read);
-    bool updateDirect(const BeaconDecoded &read, uint16_t currentEnv);
+    bool updateMapped(const BeaconDecoded &read, int *slotOut = nullptr);
+    bool updateDirect(const BeaconDecoded &read, uint16_t currentEnv, int *slotOut = nullptr);
     void updateSlot(int slot, const BeaconDecoded &read);
 
+    bool snapshotSlots(SlotState *out, TickType_t timeout = portMAX_DELAY);
+    bool restoreSlots(const SlotState *in, uint32_t capturedMs);
+
     SlotState *getSlots();
     BeaconMapEntry *getMap();
 
+    // Cambio de un slot que no pasa por updateSlot (p. ej. su estado de alarma)
+    void touchSlot(int slot);
+    void touchSlots();
+
+    // Bit i: la entrada i cambio despues de since. full pide todas y vuelve
+    // en true si la respuesta es completa (tambien cuando since no es de
+    // este arranque); gen es la generacion a la que corresponde la mascara
+    uint32_t changedSlots(uint32_t since, bool &full, uint32_t &gen);
+    uint32_t changedMap(uint32_t since, bool &full, uint32_t &gen);
+
     bool loadMap();
     bool saveMap() const;
     bool clearMap();
     bool setMapEntry(int index, uint64_t addr, uint8_t slot, bool enabled = true);
+    bool applyMapEntries(const MapEntryUpdate *updates, size_t count);
+    // nullptr si el lote es valido; si no, el codigo de error para la API
+    static const char *checkMapEntries(const MapEntryUpdate *updates, size_t count);
+    bool compactMap();
+
+    static void mapCompactTask(void *pvParameters);
 
 private:
     static constexpr const char *MAP_FILE = "/config/beacon_map.bin";
     static constexpr const char *MAP_FILE_TMP = "/config/beacon_map.tmp";
     static constexpr const char *MAP_FILE_BAK = "/config/beacon_map.bak";
+    static constexpr const char *MAP_JOURNAL = "/config/beacon_map.jnl";
+
+    // Registro del journal de ediciones del mapa. Una transaccion es una
+    // serie de ENTRY/CLEAR cerrada por un COMMIT con la cantidad de
+    // registros; al reproducir se descarta cualquier transaccion incompleta.
+#pragma pack(push, 1)
+    struct JournalRecord
+    {
+        uint32_t magic;
+        uint32_t txn;
+        uint8_t type;
+        uint8_t index;
+        uint8_t slot;
+        uint8_t enabled;
+        uint64_t addr;
+        uint32_t crc;
+    };
+#pragma pack(pop)
 
     struct MapFileData
     {
@@ -40,17 +87,30 @@ private:
     };
 
     uint32_t calcCrc32(const uint8_t *data, size_t len) const;
-    bool ensureConfigDir() const;
     void buildMapFileData(MapFileData &fileData, const BeaconMapEntry *entries) const;
     bool readMapFile(const char *path, BeaconMapEntry *entries) const;
     bool writeMapFile(const char *path, const BeaconMapEntry *entries) const;
     bool rotateMapFiles() const;
     bool saveMapData(const BeaconMapEntry *entries) const;
+    void touchMapLocked(int index);
+    void sealRecord(JournalRecord &rec) const;
+    bool appendJournal(const JournalRecord *records, size_t count);
+    size_t replayJournal(BeaconMapEntry *entries, bool &dirtyTail);
+    bool compactMapLocked();
 
 private:
     SemaphoreHandle_t mapMutex = nullptr;
     SemaphoreHandle_t slotsMutex = nullptr;
+    SemaphoreHandle_t journalMutex = nullptr;
+    TaskHandle_t compactTaskHandle = nullptr;
+    uint32_t nextTxn = 1;
+    size_t journalBytes = 0;
     BeaconMapEntry beaconMap[MAX_SLOTS]{};
     SlotState slots[MAX_SLOTS]{};
+
+    uint32_t slotsGen = 0;
+    uint32_t mapGen = 0;
+    uint32_t slotGen[MAX_SLOTS]{};
+    uint32_t mapEntryGen[MAX_SLOTS]{};
 };
 
@@ -0,0 +1,24 @@
+#include "storage_fs.h"
+
+bool ensureConfigDir()
+{
+    File dirTest = LittleFS.open("/config");
+    if (dirTest)
+    {
+        dirTest.close();
+        return true;
+    }
+
+    return LittleFS.mkdir("/config");
+}
+
+bool commitFile(const char *tmpPath, const char *path, bool written)
+{
+    if (!written)
+    {
+        LittleFS.remove(tmpPath);
+        return false;
+    }
+
+    return LittleFS.rename(tmpPath, path);
+}
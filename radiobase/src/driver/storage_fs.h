@@ -0,0 +1,17 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+
+/*
+  Archivos de configuracion en LittleFS (/config).
+
+  Los que se reescriben enteros se escriben primero en un .tmp y se
+  cierran con commitFile: LittleFS reemplaza el destino de forma atomica
+  en rename, asi un corte de energia deja el archivo anterior intacto.
+*/
+
+// Crea /config si no existe
+bool ensureConfigDir();
+
+// Renombra tmpPath sobre path si la escritura salio completa; si no, borra el .tmp
+bool commitFile(const char *tmpPath, const char *path, bool written);
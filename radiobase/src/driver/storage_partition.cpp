@@ -0,0 +1,38 @@
+#include "storage_partition.h"
+
+bool StoragePartition::begin(const char *label)
+{
+    part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == nullptr)
+    {
+        Serial.printf("StoragePartition: No existe la particion %s\n", label);
+        return false;
+    }
+
+    return true;
+}
+
+uint32_t StoragePartition::size() const
+{
+    return part ? part->size : 0;
+}
+
+uint32_t StoragePartition::sectorSize() const
+{
+    return SPI_FLASH_SEC_SIZE;
+}
+
+bool StoragePartition::read(uint32_t addr, void *dst, size_t len)
+{
+    return part && esp_partition_read(part, addr, dst, len) == ESP_OK;
+}
+
+bool StoragePartition::write(uint32_t addr, const void *src, size_t len)
+{
+    return part && esp_partition_write(part, addr, src, len) == ESP_OK;
+}
+
+bool StoragePartition::eraseSector(uint32_t addr)
+{
+    return part && esp_partition_erase_range(part, addr, SPI_FLASH_SEC_SIZE) == ESP_OK;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <Arduino.h>
+#include <esp_partition.h>
+#include <history_flash.h>
+
+// Particion de datos cruda vista como flash NOR para el log de historial
+class StoragePartition : public HistoryFlash
+{
+public:
+    bool begin(const char *label);
+
+    uint32_t size() const override;
+    uint32_t sectorSize() const override;
+    bool read(uint32_t addr, void *dst, size_t len) override;
+    bool write(uint32_t addr, const void *src, size_t len) override;
+    bool eraseSector(uint32_t addr) override;
+
+private:
+    const esp_partition_t *part = nullptr;
+};
@@ -28,6 +28,12 @@ void setup() {
     network = Config.loadNetwork();
     bootStatus.configLoaded = true;
 
+    // Antes del BLE: sin claves instaladas todo anuncio cuenta como clave desconocida
+    if (!keyStore.begin(&storage) && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "key_store_begin_failed";
+    }
+
     beaconRegistry.begin();
     bootStatus.beaconRegistryReady = true;
 
@@ -37,28 +43,85 @@ void setup() {
         bootStatus.lastError = "slot_manager_begin_failed";
     }
 
+    // Antes de levantar la web: el dashboard arranca con el ultimo estado conocido
+    bootStatus.checkpointRestored = checkpoint.restore();
+
+    if (!alarmEngine.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "alarm_engine_begin_failed";
+    }
+
+    if (!zoneAggregator.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "zone_aggregator_begin_failed";
+    }
+
+    if (!slotHistory.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "slot_history_begin_failed";
+    }
+
+    if (!historyStore.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "history_store_begin_failed";
+    }
+
+    if (!slotRollups.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "slot_rollups_begin_failed";
+    }
+
     bootStatus.networkApplied = applyNetworkConfig(network, feature);
     if (!bootStatus.networkApplied && bootStatus.lastError.isEmpty())
     {
         bootStatus.lastError = "network_apply_failed";
     }
+
+    // SNTP reintenta por su cuenta hasta que haya red; los resumenes esperan hora valida
+    configTzTime(CLOCK_TZ, CLOCK_NTP_SERVER);
     
+    if (!jsonArena.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "json_arena_begin_failed";
+    }
+
+    if (!gzipPool.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "gzip_pool_begin_failed";
+    }
+
     bootStatus.webReady = webService.begin();
     if (!bootStatus.webReady && bootStatus.lastError.isEmpty())
     {
         bootStatus.lastError = "web_service_begin_failed";
     }
 
-    bootStatus.bleReady = advertising.begin();
+    bootStatus.bleReady = advertising.begin(Config.loadPipeline());
     if (!bootStatus.bleReady && bootStatus.lastError.isEmpty())
     {
         bootStatus.lastError = "ble_begin_failed";
     }
 
+    if (bootStatus.bleReady)
+    {
+        scanControl.begin(feature.bleFilterEnable, feature.bleScheduleEnable);
+
+        if (!radioBudget.begin() && bootStatus.lastError.isEmpty())
+        {
+            bootStatus.lastError = "radio_budget_begin_failed";
+        }
+    }
+
+    if (!checkpoint.begin() && bootStatus.lastError.isEmpty())
+    {
+        bootStatus.lastError = "checkpoint_begin_failed";
+    }
+
     refreshBootReady();
     bootStatus.bootCompletedMs = millis();
 }
 
 void loop() {
+    // Bloquea hasta un evento web o WEB_LOOP_IDLE_MS; no gira en vacio
     webService.loop();
 }
@@ -1,28 +1,40 @@
 #include "web_service.h"
+#include "web_assets.h"
 #include <AsyncWebServer_ESP32_SC_W5500.h>
-#include <LittleFS.h>
+#include <string.h>
+#include "api/responseJson.h"
+#include "web_assets_data.h"
 
-static const char *contentTypeFor(const String &path)
+constexpr int assetPathCompare(const char *a, const char *b)
 {
-    if (path.endsWith(".html"))
-        return "text/html; charset=utf-8";
-    if (path.endsWith(".js"))
-        return "application/javascript";
-    if (path.endsWith(".css"))
-        return "text/css";
-    if (path.endsWith(".svg"))
-        return "image/svg+xml";
-    if (path.endsWith(".json"))
-        return "application/json";
-    if (path.endsWith(".ico"))
-        return "image/x-icon";
-    if (path.endsWith(".png"))
-        return "image/png";
-    if (path.endsWith(".jpg"))
-        return "image/jpeg";
-    if (path.endsWith(".woff2"))
-        return "font/woff2";
-    return "application/octet-stream";
+    return (*a != *b || *a == '\0')
+               ? static_cast<int>(static_cast<unsigned char>(*a)) - static_cast<int>(static_cast<unsigned char>(*b))
+               : assetPathCompare(a + 1, b + 1);
+}
+
+constexpr bool webAssetsSorted(size_t i = 1)
+{
+    return i >= WEB_ASSET_COUNT ||
+           (assetPathCompare(WEB_ASSETS[i - 1].path, WEB_ASSETS[i].path) < 0 && webAssetsSorted(i + 1));
+}
+
+static_assert(webAssetsSorted(), "WEB_ASSETS debe venir ordenada por ruta y sin repetidos");
+
+const WebAsset *webAssetFind(const char *path)
+{
+    size_t lo = 0;
+    size_t hi = WEB_ASSET_COUNT;
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(path, WEB_ASSETS[mid].path);
+        if (cmp == 0) return &WEB_ASSETS[mid];
+        if (cmp < 0)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return nullptr;
 }
 
 static bool hasExtension(const String &p)
@@ -34,44 +46,72 @@ static bool hasExtension(const String &p)
 
 static void servePath(AsyncWebServerRequest *request)
 {
-    String path = request->url();
-
-    if (path == "/")
-        path = "/index.html";
+    const String &url = request->url();
+    const char *path = url.c_str();
 
     // SPA fallback:
     // si no parece archivo y no es /api ni /ws, servir index.html
-    if (!hasExtension(path) &&
-        !path.startsWith("/api/") &&
-        !path.startsWith("/ws"))
+    if (!hasExtension(url) &&
+        !url.startsWith("/api/") &&
+        !url.startsWith("/ws"))
     {
         path = "/index.html";
     }
 
-    bool isAsset = path.startsWith("/assets/");
-    const char *cacheHdr = isAsset
+    const WebAsset *asset = webAssetFind(path);
+    if (asset == nullptr)
+    {
+        request->send(404, "text/plain", "Not found");
+        return;
+    }
+
+    const WebAssetVariant *variant = &asset->identity;
+    const char *encoding = nullptr;
+    if (request->hasHeader("Accept-Encoding"))
+    {
+        const char *accept = request->getHeader("Accept-Encoding")->value().c_str();
+        if (asset->brotli.data != nullptr && acceptsEncoding(accept, "br"))
+        {
+            variant = &asset->brotli;
+            encoding = "br";
+        }
+        else if (asset->gzip.data != nullptr && acceptsEncoding(accept, "gzip"))
+        {
+            variant = &asset->gzip;
+            encoding = "gzip";
+        }
+    }
+
+    bool negotiated = asset->gzip.data != nullptr || asset->brotli.data != nullptr;
+    const char *cacheHdr = asset->immutable
                                ? "public, max-age=31536000, immutable"
                                : "no-cache";
 
-    String gzPath = path + ".gz";
-    bool hasGz = LittleFS.exists(gzPath);
-    String finalPath = hasGz ? gzPath : path;
-
-    if (!LittleFS.exists(finalPath))
+    AsyncWebServerResponse *response = nullptr;
+    if (request->hasHeader("If-None-Match"))
     {
-        request->send(404, "text/plain", "Not found");
-        return;
+        const String &match = request->getHeader("If-None-Match")->value();
+        if (match == "*" || match.indexOf(variant->etag) >= 0)
+        {
+            response = request->beginResponse(304);
+        }
     }
 
-    AsyncWebServerResponse *response =
-        request->beginResponse(LittleFS, finalPath, contentTypeFor(path));
+    if (response == nullptr)
+    {
+        // El contenido se lee directo de la flash mapeada, sin copia previa
+        response = request->beginResponse_P(200, asset->contentType, variant->data, variant->len);
+        if (encoding != nullptr)
+        {
+            response->addHeader("Content-Encoding", encoding);
+        }
+    }
 
-    if (hasGz)
+    if (negotiated)
     {
-        response->addHeader("Content-Encoding", "gzip");
         response->addHeader("Vary", "Accept-Encoding");
     }
-
+    response->addHeader("ETag", variant->etag);
     response->addHeader("Cache-Control", cacheHdr);
     request->send(response);
 }
@@ -85,4 +125,4 @@ void registerHttpPaths(AsyncWebServer &server)
     // Todo lo no encontrado pasa por el frontend
     server.onNotFound([](AsyncWebServerRequest *request)
                       { servePath(request); });
-}
\ No newline at end of file
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+  Frontend embebido en el firmware.
+
+  scripts/embed_assets.py convierte data/ en include/web_assets_data.h en
+  cada build: una tabla WEB_ASSETS ordenada por ruta, con el contenido
+  original y sus variantes gzip y Brotli como arreglos constantes en flash.
+  Se sirven directo desde flash mapeada, sin pasar por LittleFS.
+*/
+
+struct WebAssetVariant
+{
+    const uint8_t *data; // nullptr si la variante no existe
+    size_t len;
+    const char *etag;    // ETag fuerte, con comillas
+};
+
+struct WebAsset
+{
+    const char *path;
+    const char *contentType;
+    bool immutable;      // nombre con hash de Vite: cache larga
+    WebAssetVariant identity;
+    WebAssetVariant gzip;
+    WebAssetVariant brotli;
+};
+
+// Busqueda binaria por ruta exacta; nullptr si no esta embebida
+const WebAsset *webAssetFind(const char *path);
@@ -4,6 +4,8 @@
 #include "api/http_routes.h"
 #include "api/ws_routes.h"
 #include "api/http_auth.h"
+#include "api/api_router.h"
+#include "api/ws_push.h"
 #include <LittleFS.h>
 
 static AsyncWebServer server(80);
@@ -14,11 +16,25 @@ bool WebService::begin()
     if (!LittleFS.begin(true))
         return false;
 
-    registerHttpRoutes(server);
-    registerAuthRoutes(server);
-    registerNetworkRoutes(server);
-    registerBeaconRoutes(server);
-    registerFeatureRoutes(server);
+    loopTask = xTaskGetCurrentTaskHandle();
+
+    registerHttpRoutes(apiRouter);
+    registerAuthRoutes(apiRouter);
+    registerNetworkRoutes(apiRouter);
+    registerBeaconRoutes(apiRouter);
+    registerFeatureRoutes(apiRouter);
+    registerAlarmRoutes(apiRouter);
+    registerZoneRoutes(apiRouter);
+    registerHistoryRoutes(apiRouter);
+    registerRollupRoutes(apiRouter);
+    registerKeyRoutes(apiRouter);
+    registerPipelineRoutes(apiRouter);
+    registerEventRoutes(apiRouter);
+    registerHarnessRoutes(apiRouter);
+    registerBootstrapRoutes(apiRouter);
+    registerGzipRoutes(apiRouter);
+    registerRouterRoutes(apiRouter);
+    server.addHandler(&apiRouter);
 
     registerWsRoutes(ws);
     server.addHandler(&ws);
@@ -31,7 +47,25 @@ bool WebService::begin()
 
 void WebService::loop()
 {
-    ws.cleanupClients();
+    // Con clientes WS se despierta en cada tick del push; si no, cada WEB_LOOP_IDLE_MS
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wsPush.waitMs()));
+
+    uint32_t now = millis();
+    wsPush.tick(now);
+
+    if ((now - lastCleanupMs) >= WEB_LOOP_IDLE_MS)
+    {
+        lastCleanupMs = now;
+        ws.cleanupClients();
+    }
 }
 
 WebService webService;
+
+void WebService::wake()
+{
+    if (loopTask != nullptr)
+    {
+        xTaskNotifyGive(loopTask);
+    }
+}
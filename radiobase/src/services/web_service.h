@@ -5,7 +5,13 @@ class WebService
 {
 public:
     bool begin();
+    // Espera un aviso (o WEB_LOOP_IDLE_MS) y hace el mantenimiento de clientes
     void loop();
+    void wake();
+
+private:
+    TaskHandle_t loopTask = nullptr;
+    uint32_t lastCleanupMs = 0;
 };
 
 void registerHttpPaths(AsyncWebServer &server);
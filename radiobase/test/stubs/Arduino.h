@@ -0,0 +1,103 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <string>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+/*
+  Sustituto de Arduino.h para [env:native].
+
+  Solo cubre lo que usan los modulos probados en el host: String,
+  IPAddress, Serial y el reloj. millis() lee nativeClock, que la prueba avanza a mano para
+  reproducir trazas grabadas sin esperar. Como el core del ESP32, incluye
+  los encabezados de FreeRTOS.
+*/
+
+class String : public std::string
+{
+public:
+    String() = default;
+    String(const char *s) : std::string(s ? s : "") {}
+    String(const std::string &s) : std::string(s) {}
+    String(int v) : std::string(std::to_string(v)) {}
+    String(unsigned v) : std::string(std::to_string(v)) {}
+    String(long v) : std::string(std::to_string(v)) {}
+    String(unsigned long v) : std::string(std::to_string(v)) {}
+
+    unsigned int length() const { return static_cast<unsigned int>(size()); }
+    bool isEmpty() const { return empty(); }
+    bool equals(const char *s) const { return compare(s) == 0; }
+    bool startsWith(const char *s) const { return compare(0, strlen(s), s) == 0; }
+    long toInt() const { return strtol(c_str(), nullptr, 10); }
+};
+
+class IPAddress
+{
+public:
+    IPAddress() = default;
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+
+    bool fromString(const char *s)
+    {
+        unsigned v[4];
+        char extra;
+        if (sscanf(s, "%u.%u.%u.%u%c", &v[0], &v[1], &v[2], &v[3], &extra) != 4) return false;
+        for (int i = 0; i < 4; ++i)
+        {
+            if (v[i] > 255) return false;
+            octets[i] = static_cast<uint8_t>(v[i]);
+        }
+        return true;
+    }
+
+    String toString() const
+    {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+        return String(buf);
+    }
+
+    uint8_t operator[](int i) const { return octets[i]; }
+
+private:
+    uint8_t octets[4] = {};
+};
+
+struct NativeSerial
+{
+    bool quiet = true;
+
+    int printf(const char *fmt, ...)
+    {
+        if (quiet) return 0;
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vprintf(fmt, ap);
+        va_end(ap);
+        return n;
+    }
+    size_t print(const char *s) { return quiet ? 0 : static_cast<size_t>(::printf("%s", s)); }
+    size_t println(const char *s = "") { return quiet ? 0 : static_cast<size_t>(::printf("%s\n", s)); }
+    size_t println(const String &s) { return println(s.c_str()); }
+};
+
+inline NativeSerial Serial;
+
+// Reloj controlado por la prueba (ms desde el arranque)
+inline uint32_t nativeClock = 0;
+
+inline uint32_t millis() { return nativeClock; }
+inline uint32_t micros() { return nativeClock * 1000UL; }
+inline void delay(uint32_t ms) { nativeClock += ms; }
+inline void yield() {}
+
+#ifndef constrain
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#endif
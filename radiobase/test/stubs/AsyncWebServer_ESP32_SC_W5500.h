@@ -0,0 +1,65 @@
+#pragma once
+#include <Arduino.h>
+#include <functional>
+
+/*
+  AsyncWebServer para [env:native]: solo la peticion y el handler base.
+
+  La prueba arma la peticion a mano (metodo, url, largo del cuerpo) y
+  llama a los metodos del handler como lo haria el servidor. Los valores
+  de los metodos son los de la biblioteca: el hash de API_ROUTES depende
+  de ellos.
+*/
+
+typedef enum
+{
+    HTTP_GET = 0b00000001,
+    HTTP_POST = 0b00000010,
+    HTTP_DELETE = 0b00000100,
+    HTTP_PUT = 0b00001000,
+    HTTP_PATCH = 0b00010000,
+    HTTP_HEAD = 0b00100000,
+    HTTP_OPTIONS = 0b01000000,
+    HTTP_ANY = 0b01111111,
+} WebRequestMethod;
+
+typedef uint8_t WebRequestMethodComposite;
+typedef std::function<void(void)> ArDisconnectHandler;
+
+class AsyncWebServerRequest
+{
+public:
+    AsyncWebServerRequest(WebRequestMethodComposite method, const char *url, size_t contentLength = 0)
+        : _method(method), _url(url), _contentLength(contentLength)
+    {
+    }
+
+    WebRequestMethodComposite method() const { return _method; }
+    const String &url() const { return _url; }
+    size_t contentLength() const { return _contentLength; }
+
+    void addInterestingHeader(const String &) {}
+    void onDisconnect(ArDisconnectHandler fn) { _onDisconnect = fn; }
+
+    // Lo que haria el servidor al cerrarse la conexion
+    void disconnect()
+    {
+        if (_onDisconnect) _onDisconnect();
+    }
+
+private:
+    WebRequestMethodComposite _method;
+    String _url;
+    size_t _contentLength;
+    ArDisconnectHandler _onDisconnect;
+};
+
+class AsyncWebHandler
+{
+public:
+    virtual ~AsyncWebHandler() {}
+    virtual bool canHandle(AsyncWebServerRequest *request) { return false; }
+    virtual void handleRequest(AsyncWebServerRequest *request) {}
+    virtual void handleBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {}
+    virtual bool isRequestHandlerTrivial() { return true; }
+};
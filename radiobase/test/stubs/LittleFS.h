@@ -0,0 +1,197 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+/*
+  LittleFS en memoria para [env:native].
+
+  Cada write() llega al "flash" en el momento, asi que un corte deja el
+  archivo truncado a mitad de registro: es el caso que los .tmp y el
+  journal deben tolerar. powerCutAfter(n) deja pasar n bytes mas y a partir
+  de ahi toda escritura, rename y remove falla, como si se hubiera ido la
+  alimentacion; powerOn() vuelve a aceptar cambios para simular el
+  siguiente arranque sobre lo que quedo escrito.
+*/
+
+class NativeFs
+{
+public:
+    std::map<std::string, std::vector<uint8_t>> files;
+    std::set<std::string> dirs;
+
+    bool cut = false;
+    long budget = -1;
+    size_t bytesWritten = 0;
+
+    void format()
+    {
+        files.clear();
+        dirs.clear();
+        powerOn();
+        bytesWritten = 0;
+    }
+    void powerCutAfter(size_t bytes)
+    {
+        budget = static_cast<long>(bytes);
+        cut = false;
+    }
+    void powerOn()
+    {
+        budget = -1;
+        cut = false;
+    }
+
+    // Cuantos bytes del pedido llegan antes del corte
+    size_t admit(size_t n)
+    {
+        if (cut) return 0;
+        if (budget < 0)
+        {
+            bytesWritten += n;
+            return n;
+        }
+        if (static_cast<long>(n) <= budget)
+        {
+            budget -= static_cast<long>(n);
+            bytesWritten += n;
+            return n;
+        }
+        size_t ok = static_cast<size_t>(budget);
+        bytesWritten += ok;
+        budget = 0;
+        cut = true;
+        return ok;
+    }
+    bool alive() const { return !cut; }
+};
+
+inline NativeFs nativeFs;
+
+class File
+{
+public:
+    File() = default;
+    File(const std::string &path, bool dir, size_t pos) : path_(std::make_shared<std::string>(path)), dir_(dir), pos_(pos) {}
+
+    explicit operator bool() const { return path_ != nullptr; }
+    void close() { path_.reset(); }
+    bool isDirectory() const { return dir_; }
+    const char *name() const { return path_ ? path_->c_str() : ""; }
+
+    size_t size() const
+    {
+        const std::vector<uint8_t> *d = data();
+        return d ? d->size() : 0;
+    }
+    size_t position() const { return pos_; }
+    int available() const { return static_cast<int>(size() - pos_); }
+    bool seek(size_t pos)
+    {
+        if (pos > size()) return false;
+        pos_ = pos;
+        return true;
+    }
+    void flush() {}
+
+    int read()
+    {
+        const std::vector<uint8_t> *d = data();
+        if (!d || pos_ >= d->size()) return -1;
+        return (*d)[pos_++];
+    }
+    size_t read(uint8_t *buf, size_t len)
+    {
+        const std::vector<uint8_t> *d = data();
+        if (!d || pos_ >= d->size()) return 0;
+        size_t n = d->size() - pos_ < len ? d->size() - pos_ : len;
+        memcpy(buf, d->data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+    size_t readBytes(char *buf, size_t len) { return read(reinterpret_cast<uint8_t *>(buf), len); }
+
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t *buf, size_t len)
+    {
+        if (!path_ || dir_) return 0;
+        std::vector<uint8_t> &d = nativeFs.files[*path_];
+        size_t n = nativeFs.admit(len);
+        if (pos_ + n > d.size()) d.resize(pos_ + n);
+        if (n) memcpy(d.data() + pos_, buf, n);
+        pos_ += n;
+        return n;
+    }
+
+private:
+    const std::vector<uint8_t> *data() const
+    {
+        if (!path_) return nullptr;
+        auto it = nativeFs.files.find(*path_);
+        return it == nativeFs.files.end() ? nullptr : &it->second;
+    }
+
+    std::shared_ptr<std::string> path_;
+    bool dir_ = false;
+    size_t pos_ = 0;
+};
+
+class NativeLittleFS
+{
+public:
+    bool begin(bool = false) { return true; }
+
+    bool exists(const char *path) const
+    {
+        return nativeFs.files.count(path) != 0 || nativeFs.dirs.count(path) != 0;
+    }
+
+    File open(const char *path, const char *mode = "r")
+    {
+        if (nativeFs.dirs.count(path)) return File(path, true, 0);
+
+        bool writing = mode[0] == 'w' || mode[0] == 'a';
+        if (!writing)
+        {
+            if (!nativeFs.files.count(path)) return File();
+            return File(path, false, 0);
+        }
+
+        if (!nativeFs.alive()) return File();
+        std::vector<uint8_t> &d = nativeFs.files[path];
+        if (mode[0] == 'w') d.clear();
+        return File(path, false, mode[0] == 'a' ? d.size() : 0);
+    }
+
+    bool mkdir(const char *path)
+    {
+        if (!nativeFs.alive()) return false;
+        nativeFs.dirs.insert(path);
+        return true;
+    }
+
+    bool remove(const char *path)
+    {
+        if (!nativeFs.alive()) return false;
+        return nativeFs.files.erase(path) != 0;
+    }
+
+    // Como en LittleFS el rename reemplaza el destino de forma atomica
+    bool rename(const char *from, const char *to)
+    {
+        if (!nativeFs.alive()) return false;
+        auto it = nativeFs.files.find(from);
+        if (it == nativeFs.files.end()) return false;
+        std::vector<uint8_t> d = std::move(it->second);
+        nativeFs.files.erase(it);
+        nativeFs.files[to] = std::move(d);
+        return true;
+    }
+};
+
+inline NativeLittleFS LittleFS;
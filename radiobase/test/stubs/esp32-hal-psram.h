@@ -0,0 +1,7 @@
+#pragma once
+#include <stdlib.h>
+
+// Sin PSRAM en el host: ps_malloc cae al heap comun
+inline void *ps_malloc(size_t size) { return malloc(size); }
+inline void *ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+inline bool psramFound() { return false; }
@@ -0,0 +1,13 @@
+#pragma once
+#include <stdint.h>
+
+// Secuencia fija para que las pruebas sean repetibles
+inline uint32_t nativeRandomState = 0x2545F491u;
+
+inline uint32_t esp_random()
+{
+    nativeRandomState ^= nativeRandomState << 13;
+    nativeRandomState ^= nativeRandomState >> 17;
+    nativeRandomState ^= nativeRandomState << 5;
+    return nativeRandomState;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+
+/*
+  FreeRTOS para [env:native]: los mutex son std::timed_mutex y las
+  secciones criticas un spinlock, para las pruebas que usan varios hilos.
+  Las colas y tareas solo existen para que los modulos enlacen.
+*/
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+
+struct NativeMux
+{
+    std::atomic<int> locked;
+};
+typedef NativeMux portMUX_TYPE;
+
+inline void nativeMuxEnter(NativeMux *mux)
+{
+    while (mux->locked.exchange(1, std::memory_order_acquire) != 0)
+    {
+    }
+}
+
+inline void nativeMuxExit(NativeMux *mux)
+{
+    mux->locked.store(0, std::memory_order_release);
+}
+
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) nativeMuxEnter(mux)
+#define portEXIT_CRITICAL(mux) nativeMuxExit(mux)
+#define portENTER_CRITICAL_ISR(mux) nativeMuxEnter(mux)
+#define portEXIT_CRITICAL_ISR(mux) nativeMuxExit(mux)
+
+struct NativeQueue;
+typedef NativeQueue *QueueHandle_t;
+struct NativeTask;
+typedef NativeTask *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
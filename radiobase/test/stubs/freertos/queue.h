@@ -0,0 +1,7 @@
+#pragma once
+#include "FreeRTOS.h"
+
+inline QueueHandle_t xQueueCreate(UBaseType_t, UBaseType_t) { return nullptr; }
+inline BaseType_t xQueueSend(QueueHandle_t, const void *, TickType_t) { return pdFAIL; }
+inline BaseType_t xQueueReceive(QueueHandle_t, void *, TickType_t) { return pdFAIL; }
+inline UBaseType_t uxQueueMessagesWaiting(QueueHandle_t) { return 0; }
@@ -0,0 +1,25 @@
+#pragma once
+#include <chrono>
+#include "FreeRTOS.h"
+
+typedef std::timed_mutex *SemaphoreHandle_t;
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return new std::timed_mutex(); }
+
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t m, TickType_t timeout)
+{
+    if (timeout == portMAX_DELAY)
+    {
+        m->lock();
+        return pdTRUE;
+    }
+    return m->try_lock_for(std::chrono::milliseconds(timeout)) ? pdTRUE : pdFALSE;
+}
+
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t m)
+{
+    m->unlock();
+    return pdTRUE;
+}
+
+inline void vSemaphoreDelete(SemaphoreHandle_t m) { delete m; }
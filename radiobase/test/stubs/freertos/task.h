@@ -0,0 +1,22 @@
+#pragma once
+#include "FreeRTOS.h"
+
+// No se crean tareas: la prueba llama a mano lo que la tarea haria
+inline BaseType_t xTaskCreatePinnedToCore(TaskFunction_t, const char *, uint32_t, void *, UBaseType_t,
+                                          TaskHandle_t *handle, BaseType_t)
+{
+    if (handle) *handle = nullptr;
+    return pdPASS;
+}
+
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline BaseType_t xTaskNotifyGive(TaskHandle_t) { return pdPASS; }
+inline void vTaskDelay(TickType_t) {}
+inline TickType_t xTaskGetTickCount() { return 0; }
+
+// Un handle distinto por hilo, para el codigo que se ata a una tarea
+inline TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    static thread_local char self;
+    return reinterpret_cast<TaskHandle_t>(&self);
+}
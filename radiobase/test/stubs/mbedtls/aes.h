@@ -0,0 +1,190 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// AES-128 de referencia con la API de mbedtls que usa el firmware (solo ECB)
+
+#define MBEDTLS_AES_ENCRYPT 1
+#define MBEDTLS_AES_DECRYPT 0
+#define MBEDTLS_ERR_AES_INVALID_KEY_LENGTH -0x0020
+
+struct mbedtls_aes_context
+{
+    uint8_t rk[176];
+};
+
+namespace native_aes
+{
+    inline uint8_t xtime(uint8_t x)
+    {
+        return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1B : 0));
+    }
+
+    inline uint8_t mul(uint8_t a, uint8_t b)
+    {
+        uint8_t r = 0;
+        while (b)
+        {
+            if (b & 1) r ^= a;
+            a = xtime(a);
+            b >>= 1;
+        }
+        return r;
+    }
+
+    // S-box calculada: inverso en GF(2^8) seguido de la transformacion afin
+    inline const uint8_t *sbox(bool inverse)
+    {
+        static uint8_t fwd[256];
+        static uint8_t inv[256];
+        static bool ready = false;
+
+        if (!ready)
+        {
+            for (int x = 0; x < 256; ++x)
+            {
+                uint8_t y = 0;
+                for (int c = 1; c < 256 && x != 0; ++c)
+                {
+                    if (mul(static_cast<uint8_t>(x), static_cast<uint8_t>(c)) == 1)
+                    {
+                        y = static_cast<uint8_t>(c);
+                        break;
+                    }
+                }
+
+                uint8_t s = y;
+                for (int k = 1; k <= 4; ++k)
+                {
+                    s ^= static_cast<uint8_t>((y << k) | (y >> (8 - k)));
+                }
+                s ^= 0x63;
+
+                fwd[x] = s;
+                inv[s] = static_cast<uint8_t>(x);
+            }
+            ready = true;
+        }
+
+        return inverse ? inv : fwd;
+    }
+
+    inline void addRoundKey(uint8_t *st, const uint8_t *rk)
+    {
+        for (int i = 0; i < 16; ++i) st[i] ^= rk[i];
+    }
+
+    inline void subBytes(uint8_t *st, bool inverse)
+    {
+        const uint8_t *s = sbox(inverse);
+        for (int i = 0; i < 16; ++i) st[i] = s[st[i]];
+    }
+
+    // Estado en orden de columnas: st[4 * c + r]
+    inline void shiftRows(uint8_t *st, bool inverse)
+    {
+        uint8_t t[16];
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 4; ++r)
+            {
+                int src = inverse ? (c - r + 4) % 4 : (c + r) % 4;
+                t[4 * c + r] = st[4 * src + r];
+            }
+        }
+        memcpy(st, t, 16);
+    }
+
+    inline void mixColumns(uint8_t *st, bool inverse)
+    {
+        static const uint8_t F[4] = {2, 3, 1, 1};
+        static const uint8_t I[4] = {14, 11, 13, 9};
+        const uint8_t *m = inverse ? I : F;
+
+        for (int c = 0; c < 4; ++c)
+        {
+            uint8_t col[4];
+            memcpy(col, &st[4 * c], 4);
+            for (int r = 0; r < 4; ++r)
+            {
+                st[4 * c + r] = static_cast<uint8_t>(mul(col[0], m[(4 - r) % 4]) ^ mul(col[1], m[(5 - r) % 4]) ^
+                                                     mul(col[2], m[(6 - r) % 4]) ^ mul(col[3], m[(7 - r) % 4]));
+            }
+        }
+    }
+}
+
+inline void mbedtls_aes_init(mbedtls_aes_context *ctx)
+{
+    memset(ctx, 0, sizeof(*ctx));
+}
+
+inline void mbedtls_aes_free(mbedtls_aes_context *ctx)
+{
+    if (ctx) memset(ctx, 0, sizeof(*ctx));
+}
+
+inline int mbedtls_aes_setkey_enc(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    if (keybits != 128) return MBEDTLS_ERR_AES_INVALID_KEY_LENGTH;
+
+    const uint8_t *s = native_aes::sbox(false);
+    uint8_t rcon = 1;
+
+    memcpy(ctx->rk, key, 16);
+    for (int i = 16; i < 176; i += 4)
+    {
+        uint8_t t[4];
+        memcpy(t, &ctx->rk[i - 4], 4);
+        if (i % 16 == 0)
+        {
+            uint8_t t0 = t[0];
+            t[0] = static_cast<uint8_t>(s[t[1]] ^ rcon);
+            t[1] = s[t[2]];
+            t[2] = s[t[3]];
+            t[3] = s[t0];
+            rcon = native_aes::xtime(rcon);
+        }
+        for (int k = 0; k < 4; ++k) ctx->rk[i + k] = ctx->rk[i - 16 + k] ^ t[k];
+    }
+    return 0;
+}
+
+// El contexto guarda la misma expansion en ambos sentidos
+inline int mbedtls_aes_setkey_dec(mbedtls_aes_context *ctx, const unsigned char *key, unsigned int keybits)
+{
+    return mbedtls_aes_setkey_enc(ctx, key, keybits);
+}
+
+inline int mbedtls_aes_crypt_ecb(mbedtls_aes_context *ctx, int mode, const unsigned char input[16], unsigned char output[16])
+{
+    using namespace native_aes;
+    uint8_t st[16];
+    memcpy(st, input, 16);
+
+    if (mode == MBEDTLS_AES_ENCRYPT)
+    {
+        addRoundKey(st, ctx->rk);
+        for (int round = 1; round <= 10; ++round)
+        {
+            subBytes(st, false);
+            shiftRows(st, false);
+            if (round < 10) mixColumns(st, false);
+            addRoundKey(st, &ctx->rk[16 * round]);
+        }
+    }
+    else
+    {
+        addRoundKey(st, &ctx->rk[160]);
+        for (int round = 9; round >= 0; --round)
+        {
+            shiftRows(st, true);
+            subBytes(st, true);
+            addRoundKey(st, &ctx->rk[16 * round]);
+            if (round > 0) mixColumns(st, true);
+        }
+    }
+
+    memcpy(output, st, 16);
+    return 0;
+}
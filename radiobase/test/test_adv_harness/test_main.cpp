@@ -0,0 +1,324 @@
+#include <unity.h>
+#include <vector>
+#include "config.h"
+#include "crypto_lib.cpp"
+#include <beacon_decoders.h>
+#include "mbedtls/aes.h"
+#include "adv_replay.cpp"
+#include "fleet_generator.cpp"
+
+/*
+  Arnes de anuncios en el host: la flota sintetica cifrada con la misma
+  llamada a mbedtls que usa AdvHarness, grabada en una captura en memoria,
+  reproducida con AdvReplayReader e InjectPacer y decodificada por el
+  mismo camino que BleProceses::decodeAdv (decrypt_block_key y
+  BEACON_DECODERS). Con la misma semilla todo tiene que dar igual byte a
+  byte y contador a contador.
+*/
+
+static mbedtls_aes_context aes;
+
+static bool mbedtlsEncrypt(const uint8_t key[16], const uint8_t in[16], uint8_t out[16], void *ctx)
+{
+    (void)key; // el contexto ya tiene la clave expandida
+    return mbedtls_aes_crypt_ecb(static_cast<mbedtls_aes_context *>(ctx), MBEDTLS_AES_ENCRYPT, in, out) == 0;
+}
+
+class MemoryByteSource : public AdvByteSource
+{
+public:
+    explicit MemoryByteSource(const std::vector<uint8_t> &bytes) : data(bytes) {}
+
+    size_t readBytes(uint8_t *dst, size_t len) override
+    {
+        size_t n = data.size() - pos;
+        if (n > len) n = len;
+        memcpy(dst, data.data() + pos, n);
+        pos += n;
+        return n;
+    }
+
+private:
+    const std::vector<uint8_t> &data;
+    size_t pos = 0;
+};
+
+static FleetParams fleetParams(uint32_t seed)
+{
+    FleetParams p;
+    p.beacons = 24;
+    p.periodMs = 5000;
+    p.jitterMs = 300;
+    p.burstPackets = 4;
+    p.burstSpacingMs = 50;
+    p.seed = seed;
+    p.environmentId = 3;
+    p.keyId = HARNESS_KEY_ID;
+    memcpy(p.key, FLEET_HARNESS_KEY, sizeof(p.key));
+    return p;
+}
+
+// Captura completa: cabecera y frames tal como los escribe captureTask
+static std::vector<uint8_t> capture(uint32_t seed, size_t frames)
+{
+    static FleetGenerator fleet;
+    TEST_ASSERT_TRUE(fleet.begin(fleetParams(seed), mbedtlsEncrypt, &aes));
+
+    AdvCaptureHeader h = advCaptureHeader(0);
+    std::vector<uint8_t> out(reinterpret_cast<uint8_t *>(&h), reinterpret_cast<uint8_t *>(&h) + sizeof(h));
+
+    AdvFrame f;
+    for (size_t i = 0; i < frames; ++i)
+    {
+        TEST_ASSERT_TRUE(fleet.next(f));
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(&f);
+        out.insert(out.end(), p, p + sizeof(f));
+    }
+    TEST_ASSERT_EQUAL_UINT32(frames, fleet.framesGenerated());
+    return out;
+}
+
+static AdvFrame *frameAt(std::vector<uint8_t> &cap, size_t i)
+{
+    return reinterpret_cast<AdvFrame *>(cap.data() + sizeof(AdvCaptureHeader) + i * sizeof(AdvFrame));
+}
+
+enum class Outcome
+{
+    OK,
+    UNKNOWN_COMPANY,
+    UNKNOWN_KEY,
+    DECRYPT_FAIL,
+    UNKNOWN_VERSION
+};
+
+// Mismo recorrido que el callback de escaneo y BleProceses::decodeAdv
+static Outcome decodeFrame(const AdvFrame &f, BeaconFields &out)
+{
+    if (!beaconCompanyKnown(f.company)) return Outcome::UNKNOWN_COMPANY;
+
+    uint8_t plain[16];
+    AesKeyResult res = decrypt_block_key(f.keyId, f.payload, plain);
+    if (res == AesKeyResult::UNKNOWN_KEY || res == AesKeyResult::RETIRED) return Outcome::UNKNOWN_KEY;
+    if (res != AesKeyResult::OK) return Outcome::DECRYPT_FAIL;
+
+    const BeaconDecoderEntry *decoder = beaconFindDecoder(f.company, plain[0]);
+    if (decoder == nullptr || !decoder->decode(plain, sizeof(plain), out)) return Outcome::UNKNOWN_VERSION;
+    return Outcome::OK;
+}
+
+struct HostRun
+{
+    uint32_t replayed = 0;
+    uint32_t decoded = 0;
+    uint32_t droppedCompany = 0;
+    uint32_t droppedKey = 0;
+    uint32_t droppedOther = 0;
+    uint32_t simulatedMs = 0;
+    uint32_t lateMaxMs = 0;
+};
+
+// Reproduce una captura con reloj simulado, como runInject contra advQ
+static HostRun replay(const std::vector<uint8_t> &cap, uint32_t speedX100)
+{
+    MemoryByteSource src(cap);
+    AdvReplayReader reader;
+    TEST_ASSERT_TRUE(reader.begin(&src));
+
+    InjectPacer pacer;
+    pacer.begin(speedX100);
+    HostRun run;
+    uint32_t nowMs = 0xFFFFF000; // cruza la vuelta de millis()
+    uint32_t startMs = nowMs;
+    AdvFrame f;
+
+    while (reader.next(f))
+    {
+        uint32_t wait;
+        while ((wait = pacer.waitFor(f.rxMs, nowMs)) > 0) nowMs += wait;
+        uint32_t late = pacer.lateBy(f.rxMs, nowMs);
+        if (late > run.lateMaxMs) run.lateMaxMs = late;
+        run.replayed++;
+
+        BeaconFields fields;
+        switch (decodeFrame(f, fields))
+        {
+        case Outcome::OK:
+            run.decoded++;
+            break;
+        case Outcome::UNKNOWN_COMPANY:
+            run.droppedCompany++;
+            break;
+        case Outcome::UNKNOWN_KEY:
+            run.droppedKey++;
+            break;
+        default:
+            run.droppedOther++;
+            break;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(run.replayed, reader.framesRead());
+    run.simulatedMs = nowMs - startMs;
+    return run;
+}
+
+void setUp()
+{
+    aes_cleanup();
+    TEST_ASSERT_TRUE(aes_key_set(HARNESS_KEY_ID, FLEET_HARNESS_KEY));
+    mbedtls_aes_init(&aes);
+    TEST_ASSERT_EQUAL_INT(0, mbedtls_aes_setkey_enc(&aes, FLEET_HARNESS_KEY, 128));
+}
+
+void tearDown()
+{
+    mbedtls_aes_free(&aes);
+}
+
+void test_same_seed_same_bytes()
+{
+    std::vector<uint8_t> a = capture(42, 800);
+    std::vector<uint8_t> b = capture(42, 800);
+    TEST_ASSERT_EQUAL_size_t(sizeof(AdvCaptureHeader) + 800 * sizeof(AdvFrame), a.size());
+    TEST_ASSERT_TRUE(a == b);
+
+    // Otra semilla cambia fases, lecturas y cifrado
+    std::vector<uint8_t> c = capture(43, 800);
+    TEST_ASSERT_FALSE(a == c);
+
+    // En orden de rxMs y con el company y key ID de la flota
+    for (size_t i = 1; i < 800; ++i)
+    {
+        const AdvFrame *prev = frameAt(a, i - 1);
+        const AdvFrame *cur = frameAt(a, i);
+        TEST_ASSERT_TRUE(static_cast<int32_t>(cur->rxMs - prev->rxMs) >= 0);
+        TEST_ASSERT_EQUAL_UINT16(BEACON_COMPANY_FRIOPACKING, cur->company);
+        TEST_ASSERT_EQUAL_UINT8(HARNESS_KEY_ID, cur->keyId);
+        TEST_ASSERT_EQUAL_UINT8(16, cur->len);
+    }
+}
+
+void test_replay_drops_torn_trailing_frame()
+{
+    std::vector<uint8_t> cap = capture(7, 10);
+    std::vector<uint8_t> more = capture(7, 11);
+
+    // Corte a mitad del frame 11: la captura se interrumpio escribiendo
+    cap.insert(cap.end(), more.end() - sizeof(AdvFrame), more.end() - sizeof(AdvFrame) + 17);
+
+    MemoryByteSource src(cap);
+    AdvReplayReader reader;
+    TEST_ASSERT_TRUE(reader.begin(&src));
+
+    AdvFrame f;
+    uint32_t n = 0;
+    while (reader.next(f))
+    {
+        TEST_ASSERT_EQUAL_MEMORY(frameAt(more, n), &f, sizeof(f));
+        n++;
+    }
+    TEST_ASSERT_EQUAL_UINT32(10, n);
+    TEST_ASSERT_EQUAL_UINT32(10, reader.framesRead());
+    TEST_ASSERT_FALSE(reader.next(f));
+
+    // Cabecera ajena o cortada: no se reproduce nada
+    std::vector<uint8_t> bad = cap;
+    bad[0] ^= 0xFF;
+    MemoryByteSource badSrc(bad);
+    TEST_ASSERT_FALSE(reader.begin(&badSrc));
+
+    std::vector<uint8_t> shortHdr(cap.begin(), cap.begin() + sizeof(AdvCaptureHeader) - 1);
+    MemoryByteSource shortSrc(shortHdr);
+    TEST_ASSERT_FALSE(reader.begin(&shortSrc));
+}
+
+void test_generated_frames_decode()
+{
+    std::vector<uint8_t> cap = capture(11, 600);
+    FleetParams p = fleetParams(11);
+
+    for (size_t i = 0; i < 600; ++i)
+    {
+        const AdvFrame *f = frameAt(cap, i);
+        BeaconFields fields{};
+        TEST_ASSERT_TRUE(decodeFrame(*f, fields) == Outcome::OK);
+
+        TEST_ASSERT_EQUAL_UINT8(1, fields.version_id);
+        TEST_ASSERT_EQUAL_UINT8(p.environmentId, fields.environment_id);
+        TEST_ASSERT_EQUAL_UINT8(f->addr[5], fields.device_id);
+        TEST_ASSERT_TRUE(fields.device_id < p.beacons);
+        TEST_ASSERT_TRUE(fields.tmp_x100 >= -3000 && fields.tmp_x100 <= 1500);
+        TEST_ASSERT_TRUE(fields.cpu_x100 - fields.tmp_x100 >= 2950 && fields.cpu_x100 - fields.tmp_x100 <= 3050);
+        TEST_ASSERT_TRUE(fields.bat_pct >= 40 && fields.bat_pct <= 100);
+    }
+
+    // Sin la clave del arnes (runInject la quita al terminar) no decodifica nada
+    TEST_ASSERT_TRUE(aes_key_remove(HARNESS_KEY_ID));
+    BeaconFields fields{};
+    TEST_ASSERT_TRUE(decodeFrame(*frameAt(cap, 0), fields) == Outcome::UNKNOWN_KEY);
+}
+
+void test_host_run_reports_counts()
+{
+    static constexpr size_t FRAMES = 1200;
+    std::vector<uint8_t> cap = capture(5, FRAMES);
+
+    // Trafico ajeno mezclado: otro fabricante y una clave que el gateway no tiene
+    uint32_t foreign = 0;
+    uint32_t unknownKey = 0;
+    for (size_t i = 0; i < FRAMES; ++i)
+    {
+        if (i % 97 == 0)
+        {
+            frameAt(cap, i)->company = 0x004C;
+            foreign++;
+        }
+        else if (i % 100 == 0)
+        {
+            frameAt(cap, i)->keyId = 0x42;
+            unknownKey++;
+        }
+    }
+
+    uint32_t span = frameAt(cap, FRAMES - 1)->rxMs - frameAt(cap, 0)->rxMs;
+    HostRun a = replay(cap, 1000);
+
+    char msg[192];
+    snprintf(msg, sizeof(msg), "%lu frames: %lu decodificados, %lu descartados (fabricante %lu, clave %lu), %lu ms simulados",
+             static_cast<unsigned long>(a.replayed), static_cast<unsigned long>(a.decoded),
+             static_cast<unsigned long>(a.droppedCompany + a.droppedKey + a.droppedOther),
+             static_cast<unsigned long>(a.droppedCompany), static_cast<unsigned long>(a.droppedKey),
+             static_cast<unsigned long>(a.simulatedMs));
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL_UINT32(FRAMES, a.replayed);
+    TEST_ASSERT_EQUAL_UINT32(foreign, a.droppedCompany);
+    TEST_ASSERT_EQUAL_UINT32(unknownKey, a.droppedKey);
+    TEST_ASSERT_EQUAL_UINT32(0, a.droppedOther);
+    TEST_ASSERT_EQUAL_UINT32(FRAMES - foreign - unknownKey, a.decoded);
+
+    // A 10x el reloj simulado avanza un decimo de lo capturado y nada llega tarde
+    TEST_ASSERT_TRUE(a.simulatedMs >= span / 10 - 1 && a.simulatedMs <= span / 10 + 1);
+    TEST_ASSERT_EQUAL_UINT32(0, a.lateMaxMs);
+
+    // Otra corrida con la misma captura da los mismos contadores
+    HostRun b = replay(cap, 1000);
+    TEST_ASSERT_EQUAL_UINT32(a.decoded, b.decoded);
+    TEST_ASSERT_EQUAL_UINT32(a.droppedCompany, b.droppedCompany);
+    TEST_ASSERT_EQUAL_UINT32(a.droppedKey, b.droppedKey);
+    TEST_ASSERT_EQUAL_UINT32(a.simulatedMs, b.simulatedMs);
+
+    // Sin ritmo no se espera nada
+    TEST_ASSERT_EQUAL_UINT32(0, replay(cap, 0).simulatedMs);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_same_seed_same_bytes);
+    RUN_TEST(test_replay_drops_torn_trailing_frame);
+    RUN_TEST(test_generated_frames_decode);
+    RUN_TEST(test_host_run_reports_counts);
+    return UNITY_END();
+}
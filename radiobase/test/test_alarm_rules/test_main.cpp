@@ -0,0 +1,385 @@
+#include <unity.h>
+#include <memory>
+#include <vector>
+#include "core/alarm_rules.cpp"
+#include "driver/storage_fs.cpp"
+
+/*
+  Reglas de alarma contra trazas grabadas de camaras de frio.
+
+  Cada traza es una muestra por minuto de un beacon real (tmp_x100 y
+  flags tal como llegan a beaconLogicTask). Se reproducen sobre un
+  AlarmEngine nuevo y se comparan los instantes de disparo y liberacion
+  con los que da la regla aplicada a mano sobre la misma traza.
+*/
+
+struct TraceSample
+{
+    uint32_t t_s;
+    int16_t tmp_x100;
+    uint8_t flags;
+};
+
+struct Transition
+{
+    uint32_t t_s;
+    bool active;
+};
+
+// Puerta de camara abierta: sube de 4 C a 8.8 C y vuelve. A los 300 s
+// el sensor reporta tmp_fail y a los 600 s el bus I2C falla; en ambas
+// muestras tmp_x100 llega en 0
+static const TraceSample DOOR_OPEN[] = {
+    {0, 400, 0},     {60, 520, 0},  {120, 690, 0}, {180, 810, 0}, {240, 845, 0},
+    {300, 0, 0x04},  {360, 870, 0}, {420, 860, 0}, {480, 880, 0}, {540, 790, 0},
+    {600, 0, 0x01},  {660, 760, 0}, {720, 740, 0}, {780, 805, 0}, {840, 790, 0},
+    {900, 820, 0},   {960, 700, 0},
+};
+
+// Tunel de congelado que baja de -18 C y se recupera
+static const TraceSample FREEZER[] = {
+    {0, -1750, 0},  {60, -1790, 0},  {120, -1820, 0}, {180, -1850, 0},
+    {240, -1840, 0}, {300, -1760, 0}, {360, -1690, 0}, {420, -1810, 0},
+};
+
+// Bateria que oscila alrededor del umbral del beacon
+static const TraceSample BATTERY[] = {
+    {0, 400, 0},    {60, 401, 0x02}, {120, 402, 0x02}, {180, 400, 0},
+    {240, 399, 0x03}, {300, 399, 0x01},
+};
+
+static const char *RULES_A =
+    "{\"rules\":["
+    "{\"id\":1,\"slot\":-1,\"type\":\"tmp_above\",\"value_x100\":800,\"hyst_x100\":50,\"delay_s\":300},"
+    "{\"id\":2,\"slot\":5,\"type\":\"flag\",\"flag\":\"bat_low\"},"
+    "{\"id\":3,\"slot\":7,\"type\":\"tmp_below\",\"value_x100\":-1800,\"hyst_x100\":100,\"delay_s\":120}"
+    "]}";
+
+static const char *RULES_B =
+    "{\"rules\":["
+    "{\"id\":1,\"slot\":-1,\"type\":\"tmp_above\",\"value_x100\":900,\"delay_s\":60},"
+    "{\"id\":4,\"slot\":2,\"type\":\"flag\",\"flag\":\"i2c_fail\"}"
+    "]}";
+
+static std::unique_ptr<AlarmEngine> engine;
+
+void setUp()
+{
+    nativeFs.format();
+    nativeClock = 0;
+    engine.reset(new AlarmEngine());
+    TEST_ASSERT_TRUE(engine->begin());
+}
+
+void tearDown()
+{
+    engine.reset();
+}
+
+static bool saveJson(AlarmEngine &e, const char *json, String &error)
+{
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, json));
+    return e.saveRules(doc, error);
+}
+
+static std::vector<Transition> replay(int slot, const TraceSample *trace, size_t n)
+{
+    std::vector<Transition> out;
+    bool was = engine->isSlotInAlarm(slot);
+    for (size_t i = 0; i < n; ++i)
+    {
+        BeaconDecoded read{};
+        read.tmp_x100 = trace[i].tmp_x100;
+        read.flags = trace[i].flags;
+        nativeClock = trace[i].t_s * 1000UL;
+        engine->evaluate(slot, read, nativeClock);
+
+        bool now = engine->isSlotInAlarm(slot);
+        if (now != was) out.push_back({trace[i].t_s, now});
+        was = now;
+    }
+    return out;
+}
+
+static void assertTransitions(const std::vector<Transition> &got, const Transition *want, size_t n)
+{
+    TEST_ASSERT_EQUAL_size_t(n, got.size());
+    for (size_t i = 0; i < n; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT32(want[i].t_s, got[i].t_s);
+        TEST_ASSERT_EQUAL(want[i].active, got[i].active);
+    }
+}
+
+static void assertRuleIds(AlarmEngine &e, const uint8_t *ids, size_t n)
+{
+    AlarmStatusEntry entries[ALARM_MAX_RULES * MAX_SLOTS];
+    size_t count = e.snapshot(entries, ALARM_MAX_RULES * MAX_SLOTS);
+    std::vector<uint8_t> seen;
+    for (size_t i = 0; i < count; ++i)
+    {
+        bool dup = false;
+        for (uint8_t s : seen) dup |= s == entries[i].rule.id;
+        if (!dup) seen.push_back(entries[i].rule.id);
+    }
+    TEST_ASSERT_EQUAL_size_t(n, seen.size());
+    for (size_t i = 0; i < n; ++i) TEST_ASSERT_EQUAL_UINT8(ids[i], seen[i]);
+}
+
+static void test_compile_rejects_invalid_rules()
+{
+    static const struct
+    {
+        const char *json;
+        const char *error;
+    } cases[] = {
+        {"{}", "missing_rules"},
+        {"{\"rules\":[{\"id\":256,\"type\":\"flag\",\"flag\":\"bat_low\"}]}", "invalid_rule_id"},
+        {"{\"rules\":[{\"type\":\"flag\",\"flag\":\"bat_low\"}]}", "invalid_rule_id"},
+        {"{\"rules\":[{\"id\":1,\"slot\":32,\"type\":\"flag\",\"flag\":\"bat_low\"}]}", "invalid_rule_slot"},
+        {"{\"rules\":[{\"id\":1,\"slot\":-2,\"type\":\"flag\",\"flag\":\"bat_low\"}]}", "invalid_rule_slot"},
+        {"{\"rules\":[{\"id\":1,\"type\":\"tmp_between\"}]}", "invalid_rule_type"},
+        {"{\"rules\":[{\"id\":1,\"type\":\"flag\",\"flag\":\"door_open\"}]}", "invalid_rule_flag"},
+        {"{\"rules\":[{\"id\":1,\"type\":\"tmp_above\"}]}", "missing_rule_value"},
+        {"{\"rules\":[{\"id\":1,\"type\":\"tmp_above\",\"value_x100\":800,\"delay_s\":-1}]}", "invalid_rule_delay"},
+        {"{\"rules\":[{\"id\":1,\"type\":\"tmp_above\",\"value_x100\":800,\"delay_s\":86401}]}", "invalid_rule_delay"},
+        {"{\"rules\":[{\"id\":1,\"type\":\"tmp_above\",\"value_x100\":800,\"delay_s\":4294968}]}", "invalid_rule_delay"},
+        {"{\"rules\":[{\"id\":7,\"slot\":1,\"type\":\"flag\",\"flag\":\"bat_low\"},"
+         "{\"id\":7,\"slot\":2,\"type\":\"flag\",\"flag\":\"i2c_fail\"}]}", "invalid_rule"},
+    };
+
+    for (const auto &c : cases)
+    {
+        String error;
+        TEST_ASSERT_FALSE(saveJson(*engine, c.json, error));
+        TEST_ASSERT_EQUAL_STRING(c.error, error.c_str());
+    }
+
+    // Nada invalido llega al archivo
+    TEST_ASSERT_FALSE(LittleFS.exists("/config/alarm_rules.json"));
+}
+
+static void test_compile_limits()
+{
+    std::string perSlot = "{\"rules\":[";
+    for (int i = 0; i <= ALARM_MAX_RULES_PER_SLOT; ++i)
+    {
+        if (i) perSlot += ",";
+        perSlot += "{\"id\":" + std::to_string(i) + ",\"slot\":-1,\"type\":\"flag\",\"flag\":\"bat_low\"}";
+    }
+    perSlot += "]}";
+
+    String error;
+    TEST_ASSERT_FALSE(saveJson(*engine, perSlot.c_str(), error));
+    TEST_ASSERT_EQUAL_STRING("too_many_rules_per_slot", error.c_str());
+
+    std::string total = "{\"rules\":[";
+    for (int i = 0; i <= ALARM_MAX_RULES; ++i)
+    {
+        if (i) total += ",";
+        total += "{\"id\":" + std::to_string(i) + ",\"slot\":" + std::to_string(i % MAX_SLOTS) +
+                 ",\"type\":\"flag\",\"flag\":\"bat_low\"}";
+    }
+    total += "]}";
+
+    TEST_ASSERT_FALSE(saveJson(*engine, total.c_str(), error));
+    TEST_ASSERT_EQUAL_STRING("too_many_rules", error.c_str());
+}
+
+static void test_delay_up_to_cap()
+{
+    // El tope se acepta y sigue siendo un retardo, no una vuelta de millis()
+    std::string rules = "{\"rules\":[{\"id\":1,\"slot\":4,\"type\":\"tmp_above\",\"value_x100\":800,\"delay_s\":" +
+                        std::to_string(ALARM_MAX_DELAY_S) + "}]}";
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, rules.c_str(), error));
+
+    static const TraceSample WARM[] = {
+        {0, 900, 0},
+        {ALARM_MAX_DELAY_S - 1, 900, 0},
+        {ALARM_MAX_DELAY_S, 900, 0},
+    };
+    static const Transition want[] = {{ALARM_MAX_DELAY_S, true}};
+    assertTransitions(replay(4, WARM, 3), want, 1);
+}
+
+static void test_compile_fans_out_global_rules()
+{
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, RULES_A, error));
+
+    AlarmStatusEntry entries[ALARM_MAX_RULES * MAX_SLOTS];
+    size_t n = engine->snapshot(entries, ALARM_MAX_RULES * MAX_SLOTS);
+
+    // La regla global en cada slot, mas una extra en los slots 5 y 7
+    TEST_ASSERT_EQUAL_size_t(MAX_SLOTS + 2, n);
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        const CompiledAlarmRule &r = entries[i].rule;
+        if (r.id == 1)
+        {
+            TEST_ASSERT_EQUAL_INT16(800, r.setX100);
+            TEST_ASSERT_EQUAL_INT16(750, r.clearX100);
+            TEST_ASSERT_EQUAL_UINT32(300000, r.delayMs);
+        }
+        else if (r.id == 2)
+        {
+            TEST_ASSERT_EQUAL_UINT8(5, entries[i].slot);
+            TEST_ASSERT_EQUAL_UINT8(FLAG_BAT_LOW, r.flagMask);
+        }
+        else
+        {
+            TEST_ASSERT_EQUAL_UINT8(3, r.id);
+            TEST_ASSERT_EQUAL_UINT8(7, entries[i].slot);
+            TEST_ASSERT_EQUAL_INT16(-1800, r.setX100);
+            TEST_ASSERT_EQUAL_INT16(-1700, r.clearX100);
+        }
+    }
+}
+
+static void test_trace_door_open_delay_and_hysteresis()
+{
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, RULES_A, error));
+
+    // 810 a los 180 s abre la espera; tmp_fail (300 s) e i2c_fail (600 s)
+    // no la cortan. Dispara a los 480 s, se sostiene en 790 y 760 por la
+    // histeresis y libera en 740. La baja a 790 en 840 s corta la espera
+    // que abrio 805
+    static const Transition want[] = {{480, true}, {720, false}};
+    std::vector<Transition> got = replay(3, DOOR_OPEN, sizeof(DOOR_OPEN) / sizeof(DOOR_OPEN[0]));
+    assertTransitions(got, want, 2);
+    TEST_ASSERT_EQUAL_UINT32(0, engine->activeCount());
+}
+
+static void test_trace_invalid_reading_keeps_state()
+{
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, RULES_A, error));
+    replay(3, DOOR_OPEN, 9);
+    TEST_ASSERT_TRUE(engine->isSlotInAlarm(3));
+
+    AlarmStatusEntry entries[ALARM_MAX_RULES * MAX_SLOTS];
+    size_t n = engine->snapshot(entries, ALARM_MAX_RULES * MAX_SLOTS);
+    int16_t before = 0;
+    for (size_t i = 0; i < n; ++i)
+        if (entries[i].slot == 3) before = entries[i].state.lastValueX100;
+    TEST_ASSERT_EQUAL_INT16(880, before);
+
+    // Una lectura con tmp_fail no libera ni pisa el ultimo valor
+    BeaconDecoded bad{};
+    bad.flags = FLAG_TMP_FAIL;
+    engine->evaluate(3, bad, 540000);
+    TEST_ASSERT_TRUE(engine->isSlotInAlarm(3));
+
+    n = engine->snapshot(entries, ALARM_MAX_RULES * MAX_SLOTS);
+    for (size_t i = 0; i < n; ++i)
+        if (entries[i].slot == 3) TEST_ASSERT_EQUAL_INT16(880, entries[i].state.lastValueX100);
+}
+
+static void test_trace_freezer_below()
+{
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, RULES_A, error));
+
+    static const Transition want[] = {{240, true}, {360, false}};
+    std::vector<Transition> got = replay(7, FREEZER, sizeof(FREEZER) / sizeof(FREEZER[0]));
+    assertTransitions(got, want, 2);
+}
+
+static void test_trace_battery_flag()
+{
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, RULES_A, error));
+
+    // Sin delay la regla sigue al bit; i2c_fail solo no la dispara
+    static const Transition want[] = {{60, true}, {180, false}, {240, true}, {300, false}};
+    std::vector<Transition> got = replay(5, BATTERY, sizeof(BATTERY) / sizeof(BATTERY[0]));
+    assertTransitions(got, want, 4);
+
+    // El slot 4 no tiene la regla de bateria
+    got = replay(4, BATTERY, sizeof(BATTERY) / sizeof(BATTERY[0]));
+    TEST_ASSERT_EQUAL_size_t(0, got.size());
+}
+
+static void test_save_keeps_state_of_surviving_rules()
+{
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, RULES_A, error));
+    replay(3, DOOR_OPEN, 9);
+    TEST_ASSERT_TRUE(engine->isSlotInAlarm(3));
+
+    // Cambiar el umbral de la regla 1 no reinicia su estado
+    TEST_ASSERT_TRUE(saveJson(*engine,
+                              "{\"rules\":[{\"id\":1,\"slot\":-1,\"type\":\"tmp_above\",\"value_x100\":850,\"delay_s\":300}]}",
+                              error));
+    TEST_ASSERT_TRUE(engine->isSlotInAlarm(3));
+
+    JsonDocument stored;
+    TEST_ASSERT_TRUE(engine->readRules(stored));
+    TEST_ASSERT_EQUAL_size_t(1, stored["rules"].size());
+    TEST_ASSERT_EQUAL_INT(850, stored["rules"][0]["value_x100"].as<int>());
+
+    // Un arranque nuevo carga lo guardado
+    AlarmEngine fresh;
+    TEST_ASSERT_TRUE(fresh.begin());
+    static const uint8_t ids[] = {1};
+    assertRuleIds(fresh, ids, 1);
+}
+
+static void test_save_survives_power_cut_at_every_byte()
+{
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*engine, RULES_A, error));
+    std::vector<uint8_t> committedA = nativeFs.files["/config/alarm_rules.json"];
+
+    JsonDocument docB;
+    deserializeJson(docB, RULES_B);
+    JsonDocument storedB;
+    storedB["rules"] = docB["rules"];
+    size_t sizeB = measureJson(storedB);
+
+    static const uint8_t idsA[] = {1, 2, 3};
+    static const uint8_t idsB[] = {1, 4};
+
+    for (size_t cut = 0; cut <= sizeB; ++cut)
+    {
+        nativeFs.files.erase("/config/alarm_rules.tmp");
+        nativeFs.files["/config/alarm_rules.json"] = committedA;
+
+        nativeFs.powerCutAfter(cut);
+        bool saved = saveJson(*engine, RULES_B, error);
+        nativeFs.powerOn();
+
+        // Tras el corte queda el juego anterior completo o el nuevo completo
+        AlarmEngine reboot;
+        TEST_ASSERT_TRUE(reboot.begin());
+        if (saved)
+        {
+            TEST_ASSERT_EQUAL_size_t(sizeB, cut);
+            assertRuleIds(reboot, idsB, 2);
+        }
+        else
+        {
+            assertRuleIds(reboot, idsA, 3);
+        }
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_compile_rejects_invalid_rules);
+    RUN_TEST(test_compile_limits);
+    RUN_TEST(test_delay_up_to_cap);
+    RUN_TEST(test_compile_fans_out_global_rules);
+    RUN_TEST(test_trace_door_open_delay_and_hysteresis);
+    RUN_TEST(test_trace_invalid_reading_keeps_state);
+    RUN_TEST(test_trace_freezer_below);
+    RUN_TEST(test_trace_battery_flag);
+    RUN_TEST(test_save_keeps_state_of_surviving_rules);
+    RUN_TEST(test_save_survives_power_cut_at_every_byte);
+    return UNITY_END();
+}
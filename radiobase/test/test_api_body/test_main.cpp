@@ -0,0 +1,271 @@
+#include <unity.h>
+#include <string>
+#include <vector>
+#include "bump_arena.cpp"
+#include "api/json_arena.cpp"
+#include "api/json_filter.cpp"
+#include "api/api_router.cpp"
+
+/*
+  Cuerpos de peticion partidos en varios trozos TCP, como los entrega
+  AsyncWebServer: ApiRouter los junta en la arena y el handler los parsea
+  con parseBody y su JsonFilter. Los cortes caen a mitad de clave, de
+  numero, de escape y de direccion. El handler tiene que correr una sola
+  vez con el cuerpo entero, sin los campos fuera del filtro, y la arena
+  tiene que quedar libre al terminar.
+*/
+
+// sendError vive en responseJson.cpp, que no se compila en el host
+static int errorCode = 0;
+static String errorMessage;
+
+void sendError(AsyncWebServerRequest *, int code, const String &message)
+{
+    errorCode = code;
+    errorMessage = message;
+}
+
+struct BulkEntry
+{
+    int index;
+    int slot;
+    std::string addr;
+    bool enabled;
+};
+
+static int calls = 0;
+static const uint8_t *lastData = nullptr;
+static std::string lastBody;
+static std::vector<BulkEntry> entries;
+static bool droppedFieldSeen = false;
+static DeserializationError parseError;
+
+// Igual que POST /api/map/bulk
+static void onBulk(AsyncWebServerRequest *, uint8_t *data, size_t len)
+{
+    calls++;
+    lastData = data;
+    lastBody.assign(reinterpret_cast<char *>(data), len);
+
+    static const JsonFilter filter(R"({"entries":[{"index":true,"slot":true,"addr":true,"enabled":true}]})");
+    JsonDocument doc(requestAllocator());
+    parseError = parseBody(doc, data, len, filter);
+
+    entries.clear();
+    droppedFieldSeen = !doc["comment"].isNull();
+    for (JsonObject e : doc["entries"].as<JsonArray>())
+    {
+        if (!e["note"].isNull()) droppedFieldSeen = true;
+        entries.push_back({e["index"] | -1, e["slot"] | -1, std::string(e["addr"] | ""), e["enabled"] | false});
+    }
+}
+
+// Igual que POST /api/network/sta
+static std::string staSsid;
+
+static void onSta(AsyncWebServerRequest *, uint8_t *data, size_t len)
+{
+    calls++;
+    static const JsonFilter filter(R"({"ssid":true,"password":true,"net":true})");
+    JsonDocument doc(requestAllocator());
+    parseError = parseBody(doc, data, len, filter);
+    staSsid = doc["ssid"] | "";
+}
+
+static const char BULK[] =
+    "{\"comment\":\"carga inicial \\\"norte\\\"\",\"entries\":["
+    "{\"index\":0,\"slot\":3,\"addr\":\"C0FFEE000001\",\"enabled\":true,\"note\":\"porton\"},"
+    "{\"index\":1,\"slot\":17,\"addr\":\"C0FFEE00A0B1\",\"enabled\":false},"
+    "{\"index\":2,\"slot\":31,\"addr\":\"C0FFEE00FFFF\",\"enabled\":true,\"note\":{\"x\":[1,2,3]}}]}";
+
+// Entrega el cuerpo en los cortes indicados, como trozos TCP sucesivos
+static void feed(AsyncWebServerRequest &req, const std::string &body, const std::vector<size_t> &cuts)
+{
+    std::vector<uint8_t> copy(body.begin(), body.end());
+    size_t from = 0;
+    for (size_t i = 0; i <= cuts.size(); ++i)
+    {
+        size_t to = i < cuts.size() ? cuts[i] : copy.size();
+        apiRouter.handleBody(&req, copy.data() + from, to - from, from, copy.size());
+        from = to;
+    }
+}
+
+// La arena devuelve la misma memoria en cada peticion: se ensucia antes
+// para que un byte sin copiar no quede con el valor de la anterior
+static void scribbleArena(size_t n)
+{
+    void *p = requestAllocator()->allocate(n);
+    memset(p, '#', n);
+    requestAllocator()->deallocate(p);
+}
+
+static void assertBulkParsed()
+{
+    TEST_ASSERT_TRUE(parseError == DeserializationError::Ok);
+    TEST_ASSERT_FALSE(droppedFieldSeen);
+    TEST_ASSERT_EQUAL_size_t(3, entries.size());
+    TEST_ASSERT_EQUAL_INT(17, entries[1].slot);
+    TEST_ASSERT_EQUAL_STRING("C0FFEE00A0B1", entries[1].addr.c_str());
+    TEST_ASSERT_FALSE(entries[1].enabled);
+    TEST_ASSERT_EQUAL_INT(2, entries[2].index);
+    TEST_ASSERT_EQUAL_STRING("C0FFEE00FFFF", entries[2].addr.c_str());
+    TEST_ASSERT_TRUE(entries[2].enabled);
+}
+
+static void assertArenaFree()
+{
+    JsonArenaStats st = jsonArena.stats();
+    TEST_ASSERT_EQUAL_UINT32(0, st.arena.live);
+    TEST_ASSERT_EQUAL_UINT32(0, st.arena.used);
+    TEST_ASSERT_EQUAL_UINT32(0, apiRouter.stats().pending);
+}
+
+void setUp()
+{
+    static bool bound = false;
+    if (!bound)
+    {
+        TEST_ASSERT_TRUE(jsonArena.begin());
+        TEST_ASSERT_TRUE(apiRouter.on("/api/map/bulk", HTTP_POST, onBulk));
+        TEST_ASSERT_TRUE(apiRouter.on("/api/network/sta", HTTP_POST, onSta));
+        bound = true;
+    }
+    calls = 0;
+    errorCode = 0;
+    errorMessage = "";
+    entries.clear();
+}
+
+void tearDown() {}
+
+void test_single_segment_passes_through()
+{
+    AsyncWebServerRequest req(HTTP_POST, "/api/map/bulk", sizeof(BULK) - 1);
+    std::vector<uint8_t> body(BULK, BULK + sizeof(BULK) - 1);
+    uint32_t assembled = apiRouter.stats().assembled;
+
+    apiRouter.handleBody(&req, body.data(), body.size(), 0, body.size());
+
+    TEST_ASSERT_EQUAL_INT(1, calls);
+    TEST_ASSERT_EQUAL_PTR(body.data(), lastData);
+    TEST_ASSERT_EQUAL_UINT32(assembled, apiRouter.stats().assembled);
+    assertBulkParsed();
+    assertArenaFree();
+}
+
+void test_split_segments_parse_like_one()
+{
+    const std::string body(BULK);
+    size_t key = body.find("omment");        // a mitad de clave
+    size_t esc = body.find("\\\"norte") + 1; // entre la barra y la comilla
+    size_t num = body.find("17") + 1;        // a mitad de numero
+    size_t addr = body.find("00A0B1") + 3;   // a mitad de direccion
+    size_t last = body.size() - 1;           // el cierre solo
+
+    static const std::vector<std::vector<size_t>> SPLITS = {
+        {key},
+        {esc, num},
+        {key, esc, num, addr, last},
+        {1},
+        {last},
+    };
+
+    for (const std::vector<size_t> &cuts : SPLITS)
+    {
+        calls = 0;
+        uint32_t assembled = apiRouter.stats().assembled;
+        AsyncWebServerRequest req(HTTP_POST, "/api/map/bulk", body.size());
+        scribbleArena(body.size());
+        feed(req, body, cuts);
+
+        TEST_ASSERT_EQUAL_INT(1, calls);
+        TEST_ASSERT_EQUAL_INT(0, errorCode);
+        TEST_ASSERT_TRUE(body == lastBody);
+        TEST_ASSERT_EQUAL_UINT32(assembled + 1, apiRouter.stats().assembled);
+        assertBulkParsed();
+        assertArenaFree();
+    }
+}
+
+void test_byte_by_byte_and_interleaved_requests()
+{
+    const std::string bulk(BULK);
+    const std::string sta = R"({"ssid":"galpon-2","password":"clave larga de prueba","channel":6,"net":{"dhcp":true}})";
+    AsyncWebServerRequest a(HTTP_POST, "/api/map/bulk", bulk.size());
+    AsyncWebServerRequest b(HTTP_POST, "/api/network/sta", sta.size());
+
+    // Dos peticiones a medio llegar a la vez, un byte por trozo
+    std::vector<uint8_t> ba(bulk.begin(), bulk.end());
+    std::vector<uint8_t> bb(sta.begin(), sta.end());
+    size_t n = ba.size() > bb.size() ? ba.size() : bb.size();
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (i < ba.size()) apiRouter.handleBody(&a, &ba[i], 1, i, ba.size());
+        if (i < bb.size()) apiRouter.handleBody(&b, &bb[i], 1, i, bb.size());
+        if (i == 0) TEST_ASSERT_EQUAL_UINT32(2, apiRouter.stats().pending);
+    }
+
+    TEST_ASSERT_EQUAL_INT(2, calls);
+    TEST_ASSERT_EQUAL_STRING("galpon-2", staSsid.c_str());
+    assertBulkParsed();
+    assertArenaFree();
+}
+
+void test_rejected_bodies_release_everything()
+{
+    // Mas grande que el limite de la ruta: 413 sin reservar
+    uint32_t allocs = jsonArena.stats().arena.allocs;
+    std::string big(API_BODY_MAX + 1, ' ');
+    AsyncWebServerRequest tooBig(HTTP_POST, "/api/network/sta", big.size());
+    feed(tooBig, big, {10});
+    TEST_ASSERT_EQUAL_INT(413, errorCode);
+    TEST_ASSERT_EQUAL_UINT32(allocs, jsonArena.stats().arena.allocs);
+
+    // Un trozo fuera de orden descarta lo juntado
+    const std::string body(BULK);
+    std::vector<uint8_t> copy(body.begin(), body.end());
+    AsyncWebServerRequest gap(HTTP_POST, "/api/map/bulk", body.size());
+    apiRouter.handleBody(&gap, copy.data(), 20, 0, copy.size());
+    apiRouter.handleBody(&gap, copy.data() + 30, 10, 30, copy.size());
+    TEST_ASSERT_EQUAL_INT(400, errorCode);
+    TEST_ASSERT_EQUAL_STRING("body_out_of_order", errorMessage.c_str());
+    assertArenaFree();
+
+    // El cliente se cae a mitad: no se despacha y se libera
+    uint32_t aborted = apiRouter.stats().aborted;
+    AsyncWebServerRequest gone(HTTP_POST, "/api/map/bulk", body.size());
+    apiRouter.handleBody(&gone, copy.data(), 40, 0, copy.size());
+    gone.disconnect();
+    TEST_ASSERT_EQUAL_UINT32(aborted + 1, apiRouter.stats().aborted);
+    assertArenaFree();
+
+    // Sin lugar para otro cuerpo a medio llegar: 503
+    std::vector<AsyncWebServerRequest *> open;
+    for (int i = 0; i < API_BODY_MAX_PENDING; ++i)
+    {
+        open.push_back(new AsyncWebServerRequest(HTTP_POST, "/api/map/bulk", body.size()));
+        apiRouter.handleBody(open.back(), copy.data(), 5, 0, copy.size());
+    }
+    AsyncWebServerRequest extra(HTTP_POST, "/api/map/bulk", body.size());
+    apiRouter.handleBody(&extra, copy.data(), 5, 0, copy.size());
+    TEST_ASSERT_EQUAL_INT(503, errorCode);
+
+    for (AsyncWebServerRequest *r : open)
+    {
+        r->disconnect();
+        delete r;
+    }
+    TEST_ASSERT_EQUAL_INT(0, calls);
+    assertArenaFree();
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_single_segment_passes_through);
+    RUN_TEST(test_split_segments_parse_like_one);
+    RUN_TEST(test_byte_by_byte_and_interleaved_requests);
+    RUN_TEST(test_rejected_bodies_release_everything);
+    return UNITY_END();
+}
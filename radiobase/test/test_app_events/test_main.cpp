@@ -0,0 +1,197 @@
+#include <unity.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "core/app_events.cpp"
+
+/*
+  Bus de eventos con varios suscriptores a distinto ritmo mientras el
+  productor publica sin pausa: uno rapido, uno lento que queda pisado, uno
+  detenido hasta el final y un lector con cursor propio como el de HTTP.
+  Otro hilo consulta stats() todo el tiempo.
+
+  Cada evento lleva su indice en ms, addr y tmpX100; una lectura mezclada
+  de dos publicaciones no pasa la verificacion. Al terminar, cada lector
+  debe haber recibido indices crecientes y entregados + perdidos debe
+  sumar todo lo publicado.
+*/
+
+static constexpr uint32_t TOTAL = 200000;
+
+struct Consumer
+{
+    std::vector<uint32_t> seen;
+    uint32_t skipped = 0; // solo el lector con cursor propio
+    bool torn = false;
+};
+
+static AppEvents *bus;
+static std::atomic<bool> producing;
+
+static void publishAll()
+{
+    for (uint32_t i = 0; i < TOTAL; ++i)
+    {
+        BeaconDecoded read{};
+        read.addr = i;
+        read.tmp_x100 = static_cast<int16_t>(i & 0x7FFF);
+        read.device_id = static_cast<uint8_t>(i);
+        bus->publishSlotUpdate(static_cast<int>(i % MAX_SLOTS), read, i);
+    }
+    producing = false;
+}
+
+static void check(Consumer &c, const AppEvent &ev)
+{
+    if (ev.addr != ev.ms || ev.tmpX100 != static_cast<int16_t>(ev.ms & 0x7FFF) ||
+        ev.deviceId != static_cast<uint8_t>(ev.ms) || ev.slot != ev.ms % MAX_SLOTS)
+    {
+        c.torn = true;
+    }
+    c.seen.push_back(ev.ms);
+}
+
+static void drainSubscriber(int id, Consumer &c)
+{
+    AppEvent ev;
+    while (bus->poll(id, ev) == RingRead::OK) check(c, ev);
+}
+
+static void assertConsumer(const Consumer &c, uint32_t delivered, uint32_t skipped, const char *name)
+{
+    TEST_ASSERT_FALSE_MESSAGE(c.torn, name);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(c.seen.size(), delivered, name);
+    TEST_ASSERT_EQUAL_UINT32_MESSAGE(TOTAL, delivered + skipped, name);
+
+    for (size_t i = 1; i < c.seen.size(); ++i)
+    {
+        TEST_ASSERT_TRUE_MESSAGE(c.seen[i] > c.seen[i - 1], name);
+    }
+    if (!c.seen.empty()) TEST_ASSERT_EQUAL_UINT32_MESSAGE(TOTAL - 1, c.seen.back(), name);
+}
+
+void setUp()
+{
+    bus = new AppEvents();
+    producing = true;
+}
+
+void tearDown()
+{
+    delete bus;
+}
+
+void test_subscribers_overrun_independently()
+{
+    int fastId = bus->subscribe("fast");
+    int slowId = bus->subscribe("slow");
+    int stalledId = bus->subscribe("stalled");
+    TEST_ASSERT_EQUAL_INT(0, fastId);
+    TEST_ASSERT_EQUAL_INT(2, stalledId);
+
+    Consumer fast, slow, stalled, http;
+    std::atomic<bool> statsBad{false};
+
+    std::thread producer(publishAll);
+
+    std::thread fastThread([&]
+                           {
+        AppEvent ev;
+        while (producing)
+        {
+            if (bus->poll(fastId, ev) == RingRead::OK) check(fast, ev);
+        }
+        drainSubscriber(fastId, fast); });
+
+    std::thread slowThread([&]
+                           {
+        AppEvent ev;
+        while (producing)
+        {
+            if (bus->poll(slowId, ev) == RingRead::OK) check(slow, ev);
+            if ((slow.seen.size() % 16) == 0) std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+        drainSubscriber(slowId, slow); });
+
+    std::thread httpThread([&]
+                           {
+        // Desde el principio: si el productor ya dio la vuelta, lo perdido se cuenta
+        uint32_t cursor = 0;
+        AppEvent ev;
+        while (producing)
+        {
+            for (int n = 0; n < 64 && bus->readAt(cursor, ev, http.skipped) == RingRead::OK; ++n) check(http, ev);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+        while (bus->readAt(cursor, ev, http.skipped) == RingRead::OK) check(http, ev); });
+
+    // Consultas de estado concurrentes: los contadores nunca retroceden
+    std::thread statsThread([&]
+                            {
+        uint32_t lastTotal[3] = {};
+        while (producing)
+        {
+            AppEventStats st = bus->stats();
+            if (st.subscribers != 3) statsBad = true;
+            for (int i = 0; i < 3; ++i)
+            {
+                uint32_t total = st.subs[i].delivered + st.subs[i].skipped;
+                if (total < lastTotal[i] || st.subs[i].lag > TOTAL) statsBad = true;
+                lastTotal[i] = total;
+            }
+        } });
+
+    producer.join();
+    fastThread.join();
+    slowThread.join();
+    httpThread.join();
+    statsThread.join();
+    drainSubscriber(stalledId, stalled);
+
+    TEST_ASSERT_FALSE(statsBad.load());
+
+    AppEventStats st = bus->stats();
+    TEST_ASSERT_EQUAL_UINT32(TOTAL, st.head);
+    TEST_ASSERT_EQUAL_STRING("slow", st.subs[slowId].name);
+
+    const Consumer *cons[3] = {&fast, &slow, &stalled};
+    for (int i = 0; i < 3; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT32(0, st.subs[i].lag);
+        assertConsumer(*cons[i], st.subs[i].delivered, st.subs[i].skipped, st.subs[i].name);
+    }
+    assertConsumer(http, static_cast<uint32_t>(http.seen.size()), http.skipped, "http");
+
+    // El detenido solo recupera lo que sigue en el anillo, menos el margen del salto
+    TEST_ASSERT_TRUE(stalled.seen.size() <= APP_EVENT_RING_LEN);
+    TEST_ASSERT_TRUE(stalled.seen.size() >= APP_EVENT_RING_LEN - APP_EVENT_RING_LEN / 8);
+    TEST_ASSERT_TRUE(st.subs[slowId].skipped > 0);
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "entregados/perdidos: rapido %u/%u, lento %u/%u, detenido %u/%u, http %zu/%u",
+             st.subs[0].delivered, st.subs[0].skipped, st.subs[1].delivered, st.subs[1].skipped,
+             st.subs[2].delivered, st.subs[2].skipped, http.seen.size(), http.skipped);
+    TEST_MESSAGE(msg);
+}
+
+void test_subscriber_table_full()
+{
+    for (int i = 0; i < APP_EVENT_MAX_SUBSCRIBERS; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(i, bus->subscribe("s"));
+    }
+    TEST_ASSERT_EQUAL_INT(-1, bus->subscribe("extra"));
+
+    AppEvent ev;
+    TEST_ASSERT_TRUE(bus->poll(APP_EVENT_MAX_SUBSCRIBERS, ev) == RingRead::EMPTY);
+    TEST_ASSERT_TRUE(bus->poll(-1, ev) == RingRead::EMPTY);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_subscribers_overrun_independently);
+    RUN_TEST(test_subscriber_table_full);
+    return UNITY_END();
+}
@@ -0,0 +1,313 @@
+#include <unity.h>
+#include <chrono>
+#include <thread>
+#include "crypto_lib.cpp"
+#include <beacon_decoders.h>
+
+/*
+  Vectores de oro por par (company, version): anuncios completos tal como
+  los emite el beacon, cifrados fuera de linea con
+
+    printf '<cuerpo + relleno PKCS7>' | openssl enc -aes-128-ecb -nopad -K <clave>
+
+  y recorridos como en el gateway: estructuras AD, key ID, descifrado con
+  la clave registrada, decodificador por version y campos. Cada fila de
+  BEACON_DECODERS tiene que tener al menos un vector aca.
+*/
+
+// Clave de produccion (key ID 1) y una segunda para la rotacion
+static const uint8_t KEY_PROD[16] = {
+    0xA3, 0x7F, 0x1C, 0xD9, 0x88, 0x4E, 0x21, 0xB6,
+    0x59, 0x02, 0xEF, 0xC4, 0x6A, 0x90, 0x13, 0xDD};
+static const uint8_t KEY_NEXT[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F};
+
+struct GoldenVector
+{
+    const char *name;
+    uint16_t company;
+    uint8_t version;
+    uint8_t keyId;
+    bool legacy; // MSD sin key ID: clave 0
+    uint8_t cipher[16];
+    BeaconFields expected;
+};
+
+static const GoldenVector GOLDEN[] = {
+    // 01 03 11 00 | C6 F8 = -1850 | 35 0C = 3125 | 57 = 87
+    {"v1 temperatura negativa", BEACON_COMPANY_FRIOPACKING, 1, 1, false,
+     {0x28, 0xD6, 0xD6, 0x76, 0x3D, 0x55, 0x6C, 0x4B, 0xE5, 0x9A, 0x36, 0xDE, 0x5F, 0x4B, 0x40, 0x1E},
+     {1, 3, 0x11, 0x00, -1850, 3125, 87}},
+    // 01 01 C8 05 | 06 09 = 2310 | D8 FF = -40 | FF = -1
+    {"v1 cpu y bateria negativas", BEACON_COMPANY_FRIOPACKING, 1, 1, false,
+     {0x59, 0xDF, 0x33, 0x42, 0x8D, 0xD9, 0x9E, 0x4A, 0xBD, 0xB0, 0x65, 0x81, 0x44, 0xC7, 0x83, 0x66},
+     {1, 1, 0xC8, 0x05, 2310, -40, -1}},
+    // Mismo cuerpo que el primero, formato original sin key ID
+    {"v1 formato original", BEACON_COMPANY_FRIOPACKING, 1, 0, true,
+     {0x28, 0xD6, 0xD6, 0x76, 0x3D, 0x55, 0x6C, 0x4B, 0xE5, 0x9A, 0x36, 0xDE, 0x5F, 0x4B, 0x40, 0x1E},
+     {1, 3, 0x11, 0x00, -1850, 3125, 87}},
+    // 01 07 2A 02 | 00 00 = 0 | E8 03 = 1000 | 64 = 100, con la clave 2
+    {"v1 clave rotada", BEACON_COMPANY_FRIOPACKING, 1, 2, false,
+     {0xB6, 0x54, 0x38, 0xCA, 0x65, 0x9A, 0xAE, 0xAE, 0xC4, 0x76, 0xC9, 0x0A, 0x34, 0x4D, 0x40, 0x0D},
+     {1, 7, 0x2A, 0x02, 0, 1000, 100}},
+};
+
+// Cuerpo v2 (aun sin decodificador) cifrado con la clave 1
+static const uint8_t CIPHER_V2[16] = {
+    0xC3, 0x02, 0xF8, 0xFA, 0x84, 0xCF, 0xC7, 0x8F, 0x0A, 0x86, 0x45, 0xF7, 0xB7, 0x55, 0x55, 0xBD};
+
+enum class Outcome
+{
+    OK,
+    MALFORMED,
+    UNKNOWN_COMPANY,
+    UNKNOWN_KEY,
+    DECRYPT_FAIL,
+    UNKNOWN_VERSION
+};
+
+// Flags + TX power + MSD, como adv_publish_mfg
+static size_t buildAdv(uint8_t *p, uint16_t company, bool withKeyId, uint8_t keyId, const uint8_t cipher[16])
+{
+    size_t n = 0;
+    p[n++] = 2;
+    p[n++] = 0x01;
+    p[n++] = 0x06;
+    p[n++] = 2;
+    p[n++] = AD_TYPE_TX_POWER;
+    p[n++] = static_cast<uint8_t>(-4);
+
+    uint8_t msdLen = static_cast<uint8_t>(1 + 2 + (withKeyId ? 1 : 0) + 16);
+    p[n++] = msdLen;
+    p[n++] = AD_TYPE_MANUFACTURER;
+    p[n++] = static_cast<uint8_t>(company & 0xFF);
+    p[n++] = static_cast<uint8_t>(company >> 8);
+    if (withKeyId) p[n++] = keyId;
+    memcpy(&p[n], cipher, 16);
+    return n + 16;
+}
+
+// Mismo recorrido que el callback de escaneo y BleProceses::decodeAdv
+static Outcome decodeAdvertisement(const uint8_t *p, size_t len, BeaconFields &out, int8_t *txPower = nullptr)
+{
+    BeaconAdv adv;
+    if (!beaconParseAdv(p, len, adv)) return Outcome::MALFORMED;
+    if (!beaconCompanyKnown(adv.company)) return Outcome::UNKNOWN_COMPANY;
+
+    uint8_t keyId = 0;
+    const uint8_t *cipher = nullptr;
+    if (!beaconSplitCipher(adv, keyId, cipher)) return Outcome::MALFORMED;
+    if (txPower && adv.hasTxPower) *txPower = adv.txPower;
+
+    uint8_t plain[16];
+    AesKeyResult res = decrypt_block_key(keyId, cipher, plain);
+    if (res == AesKeyResult::UNKNOWN_KEY || res == AesKeyResult::RETIRED) return Outcome::UNKNOWN_KEY;
+    if (res != AesKeyResult::OK) return Outcome::DECRYPT_FAIL;
+
+    const BeaconDecoderEntry *decoder = beaconFindDecoder(adv.company, plain[0]);
+    if (decoder == nullptr || !decoder->decode(plain, sizeof(plain), out)) return Outcome::UNKNOWN_VERSION;
+    return Outcome::OK;
+}
+
+static void assertFields(const BeaconFields &e, const BeaconFields &a, const char *name)
+{
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(e.version_id, a.version_id, name);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(e.environment_id, a.environment_id, name);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(e.device_id, a.device_id, name);
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(e.flags, a.flags, name);
+    TEST_ASSERT_EQUAL_INT16_MESSAGE(e.tmp_x100, a.tmp_x100, name);
+    TEST_ASSERT_EQUAL_INT16_MESSAGE(e.cpu_x100, a.cpu_x100, name);
+    TEST_ASSERT_EQUAL_INT8_MESSAGE(e.bat_pct, a.bat_pct, name);
+}
+
+void setUp()
+{
+    aes_cleanup();
+    aes_key_set(BEACON_LEGACY_KEY_ID, KEY_PROD);
+    aes_key_set(1, KEY_PROD);
+    aes_key_set(2, KEY_NEXT);
+}
+
+void tearDown() {}
+
+void test_every_decoder_has_a_golden_vector()
+{
+    for (size_t d = 0; d < BEACON_DECODER_COUNT; ++d)
+    {
+        bool covered = false;
+        for (const GoldenVector &g : GOLDEN)
+        {
+            covered |= g.company == BEACON_DECODERS[d].company && g.version == BEACON_DECODERS[d].version;
+        }
+
+        char msg[64];
+        snprintf(msg, sizeof(msg), "company 0x%04X version %u sin vector", BEACON_DECODERS[d].company,
+                 BEACON_DECODERS[d].version);
+        TEST_ASSERT_TRUE_MESSAGE(covered, msg);
+    }
+}
+
+void test_golden_vectors_decode()
+{
+    for (const GoldenVector &g : GOLDEN)
+    {
+        uint8_t adv[31];
+        size_t len = buildAdv(adv, g.company, !g.legacy, g.keyId, g.cipher);
+
+        BeaconFields f{};
+        int8_t tx = 0;
+        TEST_ASSERT_TRUE_MESSAGE(decodeAdvertisement(adv, len, f, &tx) == Outcome::OK, g.name);
+        TEST_ASSERT_EQUAL_INT8_MESSAGE(-4, tx, g.name);
+        TEST_ASSERT_EQUAL_UINT8_MESSAGE(g.version, f.version_id, g.name);
+        assertFields(g.expected, f, g.name);
+    }
+}
+
+void test_unknown_version_is_rejected()
+{
+    uint8_t adv[31];
+    size_t len = buildAdv(adv, BEACON_COMPANY_FRIOPACKING, true, 1, CIPHER_V2);
+
+    BeaconFields f{};
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, len, f) == Outcome::UNKNOWN_VERSION);
+}
+
+void test_wrong_key_does_not_decode()
+{
+    // Vector de la clave 1 anunciado con la clave 2: el cuerpo no es valido
+    const GoldenVector &g = GOLDEN[0];
+    uint8_t adv[31];
+    size_t len = buildAdv(adv, g.company, true, 2, g.cipher);
+
+    BeaconFields f{};
+    Outcome o = decodeAdvertisement(adv, len, f);
+    if (o == Outcome::OK)
+    {
+        // Un primer byte igual a 1 por azar no debe coincidir con los campos
+        TEST_ASSERT_FALSE(f.tmp_x100 == g.expected.tmp_x100 && f.device_id == g.expected.device_id);
+    }
+    else
+    {
+        TEST_ASSERT_TRUE(o == Outcome::UNKNOWN_VERSION);
+    }
+}
+
+void test_unknown_and_retired_keys()
+{
+    const GoldenVector &g = GOLDEN[0];
+    uint8_t adv[31];
+    BeaconFields f{};
+
+    size_t len = buildAdv(adv, g.company, true, 9, g.cipher);
+    uint32_t before = aes_unknown_key_count();
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, len, f) == Outcome::UNKNOWN_KEY);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, aes_unknown_key_count());
+
+    // Retiro en el pasado con el reloj del host ya sincronizado
+    TEST_ASSERT_TRUE(aes_key_retire(1, 1700000000));
+    len = buildAdv(adv, g.company, true, 1, g.cipher);
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, len, f) == Outcome::UNKNOWN_KEY);
+
+    TEST_ASSERT_TRUE(aes_key_remove(1));
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, len, f) == Outcome::UNKNOWN_KEY);
+}
+
+void test_malformed_advertisements()
+{
+    const GoldenVector &g = GOLDEN[0];
+    uint8_t adv[40];
+    BeaconFields f{};
+    size_t len = buildAdv(adv, g.company, true, 1, g.cipher);
+
+    // Estructura AD cortada al final
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, len - 1, f) == Outcome::MALFORMED);
+
+    // Bloque cifrado de largo incorrecto (con un byte menos seria el formato original)
+    adv[6] = static_cast<uint8_t>(adv[6] - 2);
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, len - 2, f) == Outcome::MALFORMED);
+
+    // Company ajeno
+    len = buildAdv(adv, 0x004C, true, 1, g.cipher);
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, len, f) == Outcome::UNKNOWN_COMPANY);
+
+    // Sin MSD
+    uint8_t flagsOnly[] = {2, 0x01, 0x06};
+    TEST_ASSERT_TRUE(decodeAdvertisement(flagsOnly, sizeof(flagsOnly), f) == Outcome::MALFORMED);
+
+    // Relleno con ceros despues del MSD
+    len = buildAdv(adv, g.company, true, 1, g.cipher);
+    memset(&adv[len], 0, sizeof(adv) - len);
+    TEST_ASSERT_TRUE(decodeAdvertisement(adv, sizeof(adv), f) == Outcome::OK);
+    assertFields(g.expected, f, g.name);
+}
+
+void test_reserved_ids_keep_production_slots_free()
+{
+    // Ya hay 3 claves de produccion: con arnes y benchmark instalados
+    // todavia entra la cuarta
+    TEST_ASSERT_TRUE(aes_key_set(0xFD, KEY_NEXT));
+    TEST_ASSERT_TRUE(aes_key_set(0xFE, KEY_NEXT));
+    TEST_ASSERT_TRUE(aes_key_set(3, KEY_NEXT));
+    TEST_ASSERT_FALSE(aes_key_set(4, KEY_NEXT));
+    TEST_ASSERT_FALSE(aes_key_set(0xFC, KEY_NEXT));
+
+    AesKeyInfo keys[AES_KEY_SLOTS_TOTAL];
+    TEST_ASSERT_EQUAL_UINT32(AES_KEY_SLOTS_TOTAL, aes_key_list(keys, AES_KEY_SLOTS_TOTAL));
+}
+
+void test_rejected_bodies_counted_apart_from_failures()
+{
+    aes_key_record(1, true);
+    aes_key_record(1, false);
+    aes_key_record(1, false);
+
+    AesKeyInfo keys[AES_KEY_SLOTS_TOTAL];
+    size_t n = aes_key_list(keys, AES_KEY_SLOTS_TOTAL);
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (keys[i].id != 1) continue;
+        TEST_ASSERT_EQUAL_UINT32(1, keys[i].decrypted);
+        TEST_ASSERT_EQUAL_UINT32(2, keys[i].rejected);
+        TEST_ASSERT_EQUAL_UINT32(0, keys[i].failed);
+        return;
+    }
+    TEST_FAIL_MESSAGE("falta la clave 1");
+}
+
+void test_decrypt_does_not_wait_for_rotation()
+{
+    // Una rotacion que retiene la tabla no frena al descifrado
+    TEST_ASSERT_TRUE(keyLock());
+    uint8_t plain[16];
+    uint32_t before = aes_key_busy_count();
+
+    auto t0 = std::chrono::steady_clock::now();
+    AesKeyResult res = AesKeyResult::OK;
+    std::thread scan([&]
+                     { res = decrypt_block_key(1, GOLDEN[0].cipher, plain); });
+    scan.join();
+    double waitedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    keyUnlock();
+
+    TEST_ASSERT_TRUE(res == AesKeyResult::BUSY);
+    TEST_ASSERT_EQUAL_UINT32(before + 1, aes_key_busy_count());
+    TEST_ASSERT_TRUE(waitedMs < 500.0);
+
+    TEST_ASSERT_TRUE(decrypt_block_key(1, GOLDEN[0].cipher, plain) == AesKeyResult::OK);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_every_decoder_has_a_golden_vector);
+    RUN_TEST(test_golden_vectors_decode);
+    RUN_TEST(test_unknown_version_is_rejected);
+    RUN_TEST(test_wrong_key_does_not_decode);
+    RUN_TEST(test_unknown_and_retired_keys);
+    RUN_TEST(test_malformed_advertisements);
+    RUN_TEST(test_reserved_ids_keep_production_slots_free);
+    RUN_TEST(test_rejected_bodies_counted_apart_from_failures);
+    RUN_TEST(test_decrypt_does_not_wait_for_rotation);
+    return UNITY_END();
+}
@@ -0,0 +1,240 @@
+#include <unity.h>
+#include "cadence_tracker.cpp"
+
+/*
+  CadenceTracker sobre beacons simulados: rafagas de varios paquetes a
+  periodo fijo, con dispersion, con despertares perdidos y con cambio de
+  ritmo. Los tiempos arrancan cerca del desborde de millis() para que
+  todas las pruebas crucen la vuelta.
+*/
+
+static constexpr uint32_t PERIOD_MS = 10000;
+static constexpr uint32_t T0 = 0xFFFFFFFFu - 45000u;
+
+static CadenceTracker tracker;
+static CadenceParams params;
+
+void setUp()
+{
+    params = CadenceParams{};
+    tracker.begin(params);
+}
+
+void tearDown() {}
+
+// Tres paquetes por rafaga, como el beacon al despertar
+static void burst(uint8_t slot, uint32_t t)
+{
+    tracker.observe(slot, t);
+    tracker.observe(slot, t + 150);
+    tracker.observe(slot, t + 300);
+    tracker.tick(t + 300);
+}
+
+// Tick cada segundo entre dos instantes, como la tarea de escaneo
+static void ticks(uint32_t from, uint32_t to)
+{
+    for (uint32_t t = from; static_cast<int32_t>(to - t) > 0; t += 1000)
+    {
+        tracker.tick(t);
+    }
+}
+
+static uint32_t windowWidth(uint8_t slot)
+{
+    uint32_t openMs = 0;
+    uint32_t closeMs = 0;
+    TEST_ASSERT_TRUE(tracker.nextWindow(slot, openMs, closeMs));
+    return closeMs - openMs;
+}
+
+void test_learns_period_after_min_samples()
+{
+    uint32_t t = T0;
+    burst(0, t);
+    TEST_ASSERT_TRUE(tracker.info(0).known);
+    TEST_ASSERT_EQUAL_UINT8(0, tracker.info(0).samples);
+
+    // Cada rafaga posterior aporta un intervalo; los paquetes de la misma no
+    for (uint8_t n = 1; n <= params.minSamples; ++n)
+    {
+        TEST_ASSERT_FALSE(tracker.confident(0));
+        t += PERIOD_MS;
+        burst(0, t);
+        TEST_ASSERT_EQUAL_UINT8(n, tracker.info(0).samples);
+    }
+
+    TEST_ASSERT_TRUE(tracker.confident(0));
+    TEST_ASSERT_TRUE(tracker.allConfident(1u << 0));
+    TEST_ASSERT_FALSE(tracker.allConfident((1u << 0) | (1u << 1)));
+
+    CadenceSlotInfo info = tracker.info(0);
+    TEST_ASSERT_EQUAL_UINT32(PERIOD_MS, info.periodMs);
+    TEST_ASSERT_EQUAL_UINT32(t + PERIOD_MS, info.nextDueMs);
+
+    // Ventana centrada en la llegada esperada, con la guarda minima
+    uint32_t openMs = 0;
+    uint32_t closeMs = 0;
+    TEST_ASSERT_TRUE(tracker.nextWindow(0, openMs, closeMs));
+    TEST_ASSERT_EQUAL_UINT32(t + PERIOD_MS - params.guardMinMs, openMs);
+    TEST_ASSERT_EQUAL_UINT32(t + PERIOD_MS + params.guardMinMs + params.burstMs, closeMs);
+
+    TEST_ASSERT_TRUE(tracker.windowSoon(1u << 0, openMs - 500, 1000));
+    TEST_ASSERT_FALSE(tracker.windowSoon(1u << 0, openMs - 5000, 1000));
+    TEST_ASSERT_FALSE(tracker.windowSoon(1u << 0, closeMs, 1000));
+}
+
+void test_window_narrows_as_jitter_settles()
+{
+    // Despertares con +-350 ms de dispersion y despues un reloj estable
+    static const int32_t JITTER[] = {0, 350, -300, 320, -350, 280, -260, 340};
+    uint32_t t = T0;
+    for (int32_t j : JITTER)
+    {
+        burst(1, t + static_cast<uint32_t>(j));
+        t += PERIOD_MS;
+    }
+
+    TEST_ASSERT_TRUE(tracker.confident(1));
+    uint32_t wide = windowWidth(1);
+    TEST_ASSERT_TRUE(wide > 2 * params.guardMinMs + params.burstMs);
+
+    uint32_t prev = wide;
+    for (int i = 0; i < 30; ++i)
+    {
+        burst(1, t);
+        t += PERIOD_MS;
+
+        uint32_t w = windowWidth(1);
+        TEST_ASSERT_TRUE(w <= prev);
+        prev = w;
+    }
+
+    // Con dispersion nula la ventana queda en la guarda minima
+    TEST_ASSERT_EQUAL_UINT32(2 * params.guardMinMs + params.burstMs, prev);
+    CadenceSlotInfo info = tracker.info(1);
+    TEST_ASSERT_TRUE(info.periodMs + 20 >= PERIOD_MS && info.periodMs <= PERIOD_MS + 20);
+    TEST_ASSERT_EQUAL_UINT32(0, tracker.catchStats(CadencePolicy::FIXED).missed);
+}
+
+void test_missed_wake_keeps_period()
+{
+    uint32_t t = T0;
+    for (int i = 0; i < 5; ++i)
+    {
+        burst(2, t);
+        t += PERIOD_MS;
+    }
+    TEST_ASSERT_TRUE(tracker.confident(2));
+    CadenceCatch before = tracker.catchStats(CadencePolicy::FIXED);
+
+    // Se pierde un despertar: la ventana vence y el intervalo doble no cambia el ritmo
+    ticks(t - PERIOD_MS + 1000, t + PERIOD_MS);
+    TEST_ASSERT_EQUAL_UINT32(before.missed + 1, tracker.catchStats(CadencePolicy::FIXED).missed);
+    TEST_ASSERT_EQUAL_UINT8(1, tracker.info(2).misses);
+    TEST_ASSERT_TRUE(tracker.confident(2));
+
+    t += PERIOD_MS;
+    burst(2, t);
+    CadenceSlotInfo info = tracker.info(2);
+    TEST_ASSERT_TRUE(info.confident);
+    TEST_ASSERT_EQUAL_UINT8(0, info.misses);
+    TEST_ASSERT_EQUAL_UINT32(PERIOD_MS, info.periodMs);
+    TEST_ASSERT_EQUAL_UINT32(before.caught + 1, tracker.catchStats(CadencePolicy::FIXED).caught);
+}
+
+void test_relearns_after_repeated_misses()
+{
+    uint32_t t = T0;
+    for (int i = 0; i < 5; ++i)
+    {
+        burst(3, t);
+        t += PERIOD_MS;
+    }
+    TEST_ASSERT_TRUE(tracker.confident(3));
+
+    // maxMisses ventanas vencidas seguidas: deja de predecir
+    uint32_t silentUntil = t - PERIOD_MS + params.maxMisses * PERIOD_MS + 3000;
+    ticks(t - PERIOD_MS + 1000, silentUntil);
+    TEST_ASSERT_FALSE(tracker.confident(3));
+    TEST_ASSERT_EQUAL_UINT32(params.maxMisses, tracker.catchStats(CadencePolicy::FIXED).missed);
+    uint32_t openMs;
+    uint32_t closeMs;
+    TEST_ASSERT_FALSE(tracker.nextWindow(3, openMs, closeMs));
+
+    // Vuelve con otro ritmo y se aprende de nuevo desde cero
+    static constexpr uint32_t NEW_PERIOD_MS = 15000;
+    t = silentUntil + 2000;
+    burst(3, t);
+    TEST_ASSERT_FALSE(tracker.confident(3));
+
+    for (uint8_t n = 0; n <= params.minSamples; ++n)
+    {
+        t += NEW_PERIOD_MS;
+        burst(3, t);
+    }
+
+    CadenceSlotInfo info = tracker.info(3);
+    TEST_ASSERT_TRUE(info.confident);
+    TEST_ASSERT_EQUAL_UINT32(NEW_PERIOD_MS, info.periodMs);
+    TEST_ASSERT_EQUAL_UINT32(t + NEW_PERIOD_MS, info.nextDueMs);
+}
+
+void test_rate_change_restarts_learning()
+{
+    uint32_t t = T0;
+    for (int i = 0; i < 5; ++i)
+    {
+        burst(4, t);
+        t += PERIOD_MS;
+    }
+    TEST_ASSERT_TRUE(tracker.confident(4));
+
+    // 6 s no es multiplo de 10 s: cambio de ritmo, no una perdida
+    t = t - PERIOD_MS + 6000;
+    burst(4, t);
+    CadenceSlotInfo info = tracker.info(4);
+    TEST_ASSERT_FALSE(info.confident);
+    TEST_ASSERT_EQUAL_UINT8(1, info.samples);
+    TEST_ASSERT_EQUAL_UINT32(6000, info.periodMs);
+}
+
+void test_catches_are_split_by_policy()
+{
+    uint32_t t = T0;
+    for (int i = 0; i < 4; ++i)
+    {
+        burst(5, t);
+        t += PERIOD_MS;
+    }
+
+    tracker.setPolicy(CadencePolicy::ADAPTIVE);
+    for (int i = 0; i < 3; ++i)
+    {
+        burst(5, t);
+        t += PERIOD_MS;
+    }
+
+    // La ventana vence y el paquete llega tarde: perdida, no atrapada
+    ticks(t - PERIOD_MS + 1000, t + 3000);
+    burst(5, t + 2500);
+
+    TEST_ASSERT_EQUAL_UINT32(0, tracker.catchStats(CadencePolicy::FIXED).caught);
+    TEST_ASSERT_EQUAL_UINT32(3, tracker.catchStats(CadencePolicy::ADAPTIVE).caught);
+    TEST_ASSERT_EQUAL_UINT32(1, tracker.catchStats(CadencePolicy::ADAPTIVE).missed);
+
+    tracker.forget(5);
+    TEST_ASSERT_FALSE(tracker.info(5).known);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_learns_period_after_min_samples);
+    RUN_TEST(test_window_narrows_as_jitter_settles);
+    RUN_TEST(test_missed_wake_keeps_period);
+    RUN_TEST(test_relearns_after_repeated_misses);
+    RUN_TEST(test_rate_change_restarts_learning);
+    RUN_TEST(test_catches_are_split_by_policy);
+    return UNITY_END();
+}
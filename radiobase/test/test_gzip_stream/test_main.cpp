@@ -0,0 +1,246 @@
+#include <unity.h>
+#include <zlib.h>
+#include <string>
+#include <vector>
+#include "gzip_stream.cpp"
+
+/*
+  GzipStream contra zlib: cada salida se descomprime con inflate() en modo
+  gzip y tiene que devolver la entrada exacta, con crc y largo del trailer
+  verificados por zlib. Se cubren varias configuraciones, entradas que
+  cruzan la ventana varias veces, repeticiones largas, datos sin
+  redundancia y buffers de lectura de distinto tamano.
+*/
+
+static std::vector<uint8_t> work;
+
+static std::vector<uint8_t> compress(const GzipConfig &cfg, const std::vector<uint8_t> &in, size_t readChunk,
+                                     size_t writeChunk, GzipStats *stats = nullptr)
+{
+    work.assign(GzipStream::workBytes(cfg), 0xA5);
+    GzipStream gz;
+    TEST_ASSERT_TRUE(gz.begin(work.data(), work.size(), cfg));
+
+    std::vector<uint8_t> out;
+    std::vector<uint8_t> buf(readChunk);
+    size_t pos = 0;
+    int idle = 0;
+
+    while (!gz.done())
+    {
+        size_t progress = 0;
+        if (pos < in.size())
+        {
+            size_t n = in.size() - pos;
+            if (n > writeChunk) n = writeChunk;
+            size_t used = gz.write(in.data() + pos, n);
+            pos += used;
+            progress += used;
+        }
+        else
+        {
+            gz.finish();
+        }
+
+        size_t r = gz.read(buf.data(), buf.size());
+        out.insert(out.end(), buf.begin(), buf.begin() + r);
+        progress += r;
+
+        // Sin avance dos vueltas seguidas: el compresor quedo trabado
+        idle = progress == 0 && pos == in.size() && !gz.done() ? idle + 1 : 0;
+        TEST_ASSERT_TRUE(idle < 2);
+    }
+
+    TEST_ASSERT_EQUAL_UINT32(in.size(), gz.stats().inBytes);
+    TEST_ASSERT_EQUAL_UINT32(out.size(), gz.stats().outBytes);
+    if (stats) *stats = gz.stats();
+    return out;
+}
+
+static std::vector<uint8_t> inflateGzip(const std::vector<uint8_t> &gz)
+{
+    z_stream zs{};
+    TEST_ASSERT_EQUAL_INT(Z_OK, inflateInit2(&zs, 16 + MAX_WBITS));
+
+    std::vector<uint8_t> out;
+    uint8_t buf[4096];
+    zs.next_in = const_cast<Bytef *>(gz.data());
+    zs.avail_in = static_cast<uInt>(gz.size());
+
+    int ret;
+    do
+    {
+        zs.next_out = buf;
+        zs.avail_out = sizeof(buf);
+        ret = inflate(&zs, Z_NO_FLUSH);
+        TEST_ASSERT_TRUE(ret == Z_OK || ret == Z_STREAM_END);
+        out.insert(out.end(), buf, buf + (sizeof(buf) - zs.avail_out));
+    } while (ret != Z_STREAM_END);
+
+    // Nada despues del trailer
+    TEST_ASSERT_EQUAL_UINT32(0, zs.avail_in);
+    inflateEnd(&zs);
+    return out;
+}
+
+static void roundTrip(const GzipConfig &cfg, const std::vector<uint8_t> &in, size_t readChunk = 512,
+                      size_t writeChunk = 1436)
+{
+    std::vector<uint8_t> gz = compress(cfg, in, readChunk, writeChunk);
+
+    // Cabecera fija y trailer con crc32 y largo de la entrada
+    TEST_ASSERT_TRUE(gz.size() >= 18);
+    TEST_ASSERT_EQUAL_UINT8(0x1F, gz[0]);
+    TEST_ASSERT_EQUAL_UINT8(0x8B, gz[1]);
+    TEST_ASSERT_EQUAL_UINT8(0x08, gz[2]);
+
+    uLong sum = crc32(0L, in.data(), static_cast<uInt>(in.size()));
+    const uint8_t *t = gz.data() + gz.size() - 8;
+    uint32_t trailerCrc = t[0] | (t[1] << 8) | (t[2] << 16) | (static_cast<uint32_t>(t[3]) << 24);
+    uint32_t trailerLen = t[4] | (t[5] << 8) | (t[6] << 16) | (static_cast<uint32_t>(t[7]) << 24);
+    TEST_ASSERT_EQUAL_UINT32(static_cast<uint32_t>(sum), trailerCrc);
+    TEST_ASSERT_EQUAL_UINT32(in.size(), trailerLen);
+
+    std::vector<uint8_t> back = inflateGzip(gz);
+    TEST_ASSERT_EQUAL_size_t(in.size(), back.size());
+    TEST_ASSERT_TRUE(in == back);
+}
+
+// Filas como las de /api/beacons: mucha repeticion a corta distancia
+static std::vector<uint8_t> jsonRows(size_t rows)
+{
+    std::string s = "{\"success\":true,\"data\":{\"beacons\":[";
+    char row[160];
+    for (size_t i = 0; i < rows; ++i)
+    {
+        snprintf(row, sizeof(row),
+                 "%s{\"addr\":\"C0FFEE%06zX\",\"rssi\":%d,\"tmp_x100\":%d,\"hum_x100\":%u,\"last_seen_ms\":%u}",
+                 i ? "," : "", i * 0x0103, -40 - static_cast<int>(i % 57), 2150 + static_cast<int>(i % 300),
+                 4000u + static_cast<unsigned>(i * 7 % 5000), 1000u + static_cast<unsigned>(i) * 997u);
+        s += row;
+    }
+    s += "]}}";
+    return std::vector<uint8_t>(s.begin(), s.end());
+}
+
+static std::vector<uint8_t> noise(size_t n, uint32_t seed)
+{
+    std::vector<uint8_t> v(n);
+    for (size_t i = 0; i < n; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        v[i] = static_cast<uint8_t>(seed >> 24);
+    }
+    return v;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_round_trip_default_config()
+{
+    GzipConfig cfg;
+    roundTrip(cfg, std::vector<uint8_t>());
+    roundTrip(cfg, std::vector<uint8_t>{'x'});
+    roundTrip(cfg, jsonRows(3));
+    // Varias vueltas de ventana
+    roundTrip(cfg, jsonRows(2000));
+    roundTrip(cfg, noise(40000, 1));
+}
+
+void test_round_trip_across_configs()
+{
+    static const GzipConfig CONFIGS[] = {
+        {9, 8, 4, 64},
+        {10, 9, 0, 128}, // solo literales
+        {12, 12, 16, 1024},
+        {14, 15, 128, 4096},
+    };
+    std::vector<uint8_t> rows = jsonRows(800);
+    std::vector<uint8_t> mixed = jsonRows(100);
+    std::vector<uint8_t> rnd = noise(3000, 7);
+    mixed.insert(mixed.end(), rnd.begin(), rnd.end());
+    mixed.insert(mixed.end(), rows.begin(), rows.begin() + 20000);
+
+    for (const GzipConfig &cfg : CONFIGS)
+    {
+        roundTrip(cfg, rows);
+        roundTrip(cfg, mixed);
+    }
+}
+
+void test_long_runs_and_far_matches()
+{
+    GzipConfig cfg;
+    cfg.windowBits = 10;
+
+    // Repeticion mas larga que el maximo de 258 de deflate
+    std::vector<uint8_t> run(5000, 'A');
+    roundTrip(cfg, run);
+
+    // Un bloque sin redundancia repetido justo dentro y justo fuera de la ventana
+    uint32_t reach = (1u << cfg.windowBits) - 300;
+    std::vector<uint8_t> block = noise(200, 3);
+    std::vector<uint8_t> in = block;
+    std::vector<uint8_t> gap = noise(reach - block.size(), 4);
+    in.insert(in.end(), gap.begin(), gap.end());
+    in.insert(in.end(), block.begin(), block.end());
+    gap = noise(2000, 5);
+    in.insert(in.end(), gap.begin(), gap.end());
+    in.insert(in.end(), block.begin(), block.end());
+
+    GzipStats stats;
+    std::vector<uint8_t> gz = compress(cfg, in, 512, 1436, &stats);
+    TEST_ASSERT_TRUE(stats.matches > 0);
+    TEST_ASSERT_TRUE(inflateGzip(gz) == in);
+}
+
+void test_any_read_and_write_chunk()
+{
+    GzipConfig cfg;
+    std::vector<uint8_t> in = jsonRows(400);
+    std::vector<uint8_t> ref = compress(cfg, in, 512, 1436);
+
+    // La salida depende solo de la entrada, no de como se alimenta
+    static const size_t CHUNKS[][2] = {{1, 1}, {1, 4096}, {7, 13}, {64, 1}, {4096, 100000}};
+    for (const auto &c : CHUNKS)
+    {
+        std::vector<uint8_t> gz = compress(cfg, in, c[0], c[1]);
+        TEST_ASSERT_TRUE(ref == gz);
+    }
+    TEST_ASSERT_TRUE(inflateGzip(ref) == in);
+
+    // Y comprime: las filas repetidas caen a menos de un tercio
+    TEST_ASSERT_TRUE(ref.size() * 3 < in.size());
+}
+
+void test_begin_rejects_bad_setup()
+{
+    GzipStream gz;
+    GzipConfig cfg;
+    work.assign(GzipStream::workBytes(cfg), 0);
+
+    TEST_ASSERT_FALSE(gz.begin(nullptr, work.size(), cfg));
+    TEST_ASSERT_FALSE(gz.begin(work.data(), work.size() - 1, cfg));
+
+    GzipConfig wide = cfg;
+    wide.windowBits = 15;
+    TEST_ASSERT_FALSE(gz.begin(work.data(), work.size(), wide));
+
+    GzipConfig small = cfg;
+    small.outBytes = 32;
+    TEST_ASSERT_FALSE(gz.begin(work.data(), work.size(), small));
+
+    TEST_ASSERT_TRUE(gz.begin(work.data(), work.size(), cfg));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_round_trip_default_config);
+    RUN_TEST(test_round_trip_across_configs);
+    RUN_TEST(test_long_runs_and_far_matches);
+    RUN_TEST(test_any_read_and_write_chunk);
+    RUN_TEST(test_begin_rejects_bad_setup);
+    return UNITY_END();
+}
@@ -0,0 +1,305 @@
+#include <unity.h>
+#include <vector>
+#include "history_codec.cpp"
+#include "history_log.cpp"
+
+/*
+  Log de historial sobre RamHistoryFlash: lectura a traves de las vueltas
+  del anillo, busqueda por tiempo con el indice disperso, cortes de
+  energia a mitad de un frame (failAfter) recuperados por el replay de
+  begin() y desgaste parejo de los segmentos.
+
+  Las muestras salen de sample(slot, i): cada lectura se compara campo a
+  campo con lo que se escribio.
+*/
+
+static constexpr uint64_t T0 = 1000000;
+static constexpr uint32_t PERIOD_MS = 1000;
+static constexpr uint32_t MAX_LAG_MS = 60000;
+
+// Cuenta lo que se lee y se escribe para medir el recorrido
+class CountingFlash : public RamHistoryFlash
+{
+public:
+    using RamHistoryFlash::RamHistoryFlash;
+
+    bool read(uint32_t addr, void *dst, size_t len) override
+    {
+        readBytes += len;
+        return RamHistoryFlash::read(addr, dst, len);
+    }
+
+    bool write(uint32_t addr, const void *src, size_t len) override
+    {
+        writeCalls.push_back(len);
+        return RamHistoryFlash::write(addr, src, len);
+    }
+
+    size_t readBytes = 0;
+    std::vector<size_t> writeCalls;
+};
+
+static HistorySample sample(uint8_t slot, uint32_t i)
+{
+    HistorySample s;
+    s.tsMs = T0 + static_cast<uint64_t>(i) * PERIOD_MS;
+    s.tmpX100 = static_cast<int16_t>(2000 + (i * 7) % 300 - slot * 10);
+    s.cpuX100 = static_cast<int16_t>(3300 - i % 50);
+    s.batPct = static_cast<int8_t>(100 - (i / 100) % 100);
+    s.flags = (i % 3 == 0) ? 1 : 0;
+    s.rssi = static_cast<int8_t>(-40 - static_cast<int>(i % 30) - slot);
+    return s;
+}
+
+// Un frame con las muestras [first, first + count), escrito al tiempo de la ultima
+static bool appendRun(HistoryLog &log, uint8_t slot, uint32_t first, size_t count = HISTORY_FRAME_MAX_SAMPLES)
+{
+    HistorySample run[HISTORY_FRAME_MAX_SAMPLES];
+    for (size_t k = 0; k < count; ++k) run[k] = sample(slot, first + static_cast<uint32_t>(k));
+    return log.append(slot, run, count, run[count - 1].tsMs);
+}
+
+static std::vector<HistorySample> readAll(HistoryLog &log, uint8_t slot, uint64_t from, uint64_t to,
+                                          uint32_t stepMs = 0)
+{
+    HistoryLogCursor cur;
+    TEST_ASSERT_TRUE(log.open(cur, slot, from, to, stepMs));
+
+    std::vector<HistorySample> out;
+    HistorySample buf[20];
+    // El presupuesto por llamada puede devolver 0 sin terminar
+    for (int guard = 0; !cur.done; ++guard)
+    {
+        TEST_ASSERT_TRUE(guard < 100000);
+        size_t n = log.read(cur, buf, 20);
+        out.insert(out.end(), buf, buf + n);
+    }
+    return out;
+}
+
+static void assertSample(uint8_t slot, uint32_t i, const HistorySample &got)
+{
+    HistorySample want = sample(slot, i);
+    TEST_ASSERT_EQUAL_UINT64(want.tsMs, got.tsMs);
+    TEST_ASSERT_EQUAL_INT16(want.tmpX100, got.tmpX100);
+    TEST_ASSERT_EQUAL_INT16(want.cpuX100, got.cpuX100);
+    TEST_ASSERT_EQUAL_INT8(want.batPct, got.batPct);
+    TEST_ASSERT_EQUAL_UINT8(want.flags, got.flags);
+    TEST_ASSERT_EQUAL_INT8(want.rssi, got.rssi);
+}
+
+static uint32_t indexOf(const HistorySample &s)
+{
+    return static_cast<uint32_t>((s.tsMs - T0) / PERIOD_MS);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_append_and_read_across_rotation()
+{
+    static uint8_t image[4 * 8192];
+    memset(image, 0x00, sizeof(image)); // basura: begin no encuentra segmentos validos
+    RamHistoryFlash flash(image, sizeof(image));
+    HistoryLog log;
+    TEST_ASSERT_TRUE(log.begin(&flash, 8192, MAX_LAG_MS));
+    TEST_ASSERT_TRUE(log.empty());
+
+    // Dos slots intercalados hasta dar mas de una vuelta al anillo
+    uint32_t next = 0;
+    while (log.stats().rotations < 6)
+    {
+        TEST_ASSERT_TRUE(appendRun(log, 0, next));
+        TEST_ASSERT_TRUE(appendRun(log, 1, next));
+        next += HISTORY_FRAME_MAX_SAMPLES;
+    }
+
+    HistoryLogStats st = log.stats();
+    TEST_ASSERT_EQUAL_UINT32(4, st.segments);
+    TEST_ASSERT_EQUAL_UINT32(4, st.segmentsUsed);
+    TEST_ASSERT_EQUAL_UINT32(0, st.writeErrors);
+    TEST_ASSERT_EQUAL_UINT64(sample(0, next - 1).tsMs, log.lastTs());
+
+    for (uint8_t slot = 0; slot < 2; ++slot)
+    {
+        std::vector<HistorySample> got = readAll(log, slot, 0, UINT64_MAX);
+
+        // Lo mas viejo se recicla; lo que queda es continuo hasta la ultima muestra
+        TEST_ASSERT_TRUE(got.size() > 0);
+        uint32_t first = indexOf(got[0]);
+        TEST_ASSERT_TRUE(first > 0);
+        TEST_ASSERT_EQUAL_UINT32(0, first % HISTORY_FRAME_MAX_SAMPLES);
+        TEST_ASSERT_EQUAL_size_t(next - first, got.size());
+        for (size_t k = 0; k < got.size(); ++k) assertSample(slot, first + static_cast<uint32_t>(k), got[k]);
+    }
+
+    // Un arranque nuevo ve lo mismo
+    HistoryLog again;
+    TEST_ASSERT_TRUE(again.begin(&flash, 8192, MAX_LAG_MS));
+    TEST_ASSERT_EQUAL_UINT32(st.headSeq, again.stats().headSeq);
+    TEST_ASSERT_EQUAL_UINT64(log.lastTs(), again.lastTs());
+    TEST_ASSERT_EQUAL_UINT32(0, again.stats().tornFrames);
+    TEST_ASSERT_EQUAL_size_t(readAll(log, 1, 0, UINT64_MAX).size(), readAll(again, 1, 0, UINT64_MAX).size());
+}
+
+void test_seek_uses_sparse_index()
+{
+    static uint8_t image[2 * 32768];
+    memset(image, 0xFF, sizeof(image));
+    CountingFlash flash(image, sizeof(image));
+    HistoryLog log;
+    TEST_ASSERT_TRUE(log.begin(&flash, 32768, MAX_LAG_MS));
+
+    // Un solo segmento casi lleno
+    uint32_t next = 0;
+    while (log.stats().bytesWritten < 28000)
+    {
+        TEST_ASSERT_TRUE(appendRun(log, 2, next));
+        next += HISTORY_FRAME_MAX_SAMPLES;
+    }
+    TEST_ASSERT_EQUAL_UINT32(0, log.stats().rotations);
+
+    // Un rango chico cerca del final: el indice salta casi todo el segmento
+    uint32_t from = next - 100;
+    flash.readBytes = 0;
+    std::vector<HistorySample> got = readAll(log, 2, sample(2, from).tsMs, sample(2, from + 40).tsMs);
+    TEST_ASSERT_EQUAL_size_t(41, got.size());
+    for (size_t k = 0; k < got.size(); ++k) assertSample(2, from + static_cast<uint32_t>(k), got[k]);
+
+    char msg[64];
+    snprintf(msg, sizeof(msg), "seek leyo %zu B de %u", flash.readBytes, log.stats().bytesWritten);
+    TEST_MESSAGE(msg);
+    TEST_ASSERT_TRUE(flash.readBytes < 2048);
+    size_t seekBytes = flash.readBytes;
+
+    // Desde el principio hay que recorrerlo entero
+    flash.readBytes = 0;
+    TEST_ASSERT_EQUAL_size_t(next, readAll(log, 2, 0, UINT64_MAX).size());
+    TEST_ASSERT_TRUE(flash.readBytes > 10 * seekBytes);
+
+    // Con paso: la primera muestra de cada ventana de 5 s desde from
+    got = readAll(log, 2, sample(2, from).tsMs, UINT64_MAX, 5 * PERIOD_MS);
+    TEST_ASSERT_EQUAL_size_t(20, got.size());
+    for (size_t k = 0; k < got.size(); ++k) assertSample(2, from + static_cast<uint32_t>(k) * 5, got[k]);
+
+    // Un slot sin datos no devuelve nada
+    TEST_ASSERT_EQUAL_size_t(0, readAll(log, 3, 0, UINT64_MAX).size());
+}
+
+// Bytes que la siguiente escritura de un frame programa antes de la cabecera
+// del frame (entrada del indice si toca), medidos sobre una copia de la imagen
+static size_t bytesBeforeFrame(const uint8_t *image, size_t bytes, uint32_t segBytes, uint8_t slot, uint32_t first)
+{
+    std::vector<uint8_t> copy(image, image + bytes);
+    CountingFlash probe(copy.data(), static_cast<uint32_t>(bytes));
+    static HistoryLog log;
+    TEST_ASSERT_TRUE(log.begin(&probe, segBytes, MAX_LAG_MS));
+    probe.writeCalls.clear();
+    TEST_ASSERT_TRUE(appendRun(log, slot, first));
+
+    size_t before = 0;
+    for (size_t i = 0; i + 1 < probe.writeCalls.size(); ++i) before += probe.writeCalls[i];
+    return before;
+}
+
+void test_torn_write_is_skipped_on_replay()
+{
+    static uint8_t image[4 * 8192];
+    memset(image, 0xFF, sizeof(image));
+    RamHistoryFlash flash(image, sizeof(image));
+    static HistoryLog log;
+    TEST_ASSERT_TRUE(log.begin(&flash, 8192, MAX_LAG_MS));
+
+    for (uint32_t f = 0; f < 10; ++f) TEST_ASSERT_TRUE(appendRun(log, 0, f * 16));
+
+    // Corte a mitad del payload: la cabecera llega, el CRC no cierra
+    size_t pre = bytesBeforeFrame(image, sizeof(image), 8192, 0, 160);
+    flash.failAfter(static_cast<int32_t>(pre + 8 + 5));
+    TEST_ASSERT_FALSE(appendRun(log, 0, 160));
+    flash.failAfter(-1);
+
+    TEST_ASSERT_TRUE(log.begin(&flash, 8192, MAX_LAG_MS));
+    HistoryLogStats st = log.stats();
+    TEST_ASSERT_EQUAL_UINT32(10, st.replayFrames);
+    TEST_ASSERT_EQUAL_UINT32(1, st.crcErrors);
+    TEST_ASSERT_EQUAL_UINT32(0, st.tornFrames);
+    TEST_ASSERT_EQUAL_UINT64(sample(0, 159).tsMs, log.lastTs());
+
+    // Se sigue escribiendo detras del frame roto, en el mismo segmento
+    for (uint32_t f = 11; f < 15; ++f) TEST_ASSERT_TRUE(appendRun(log, 0, f * 16));
+    TEST_ASSERT_EQUAL_UINT32(0, log.stats().rotations);
+
+    // Corte dentro de la cabecera del frame: no se sabe donde sigue
+    pre = bytesBeforeFrame(image, sizeof(image), 8192, 0, 240);
+    flash.failAfter(static_cast<int32_t>(pre + 3));
+    TEST_ASSERT_FALSE(appendRun(log, 0, 240));
+    flash.failAfter(-1);
+
+    TEST_ASSERT_TRUE(log.begin(&flash, 8192, MAX_LAG_MS));
+    st = log.stats();
+    TEST_ASSERT_EQUAL_UINT32(14, st.replayFrames);
+    TEST_ASSERT_EQUAL_UINT32(1, st.crcErrors);
+    TEST_ASSERT_EQUAL_UINT32(1, st.tornFrames);
+
+    // El segmento queda cerrado: lo siguiente va a uno nuevo
+    TEST_ASSERT_TRUE(appendRun(log, 0, 256));
+    TEST_ASSERT_EQUAL_UINT32(1, log.stats().rotations);
+    TEST_ASSERT_EQUAL_UINT32(2, log.stats().segmentsUsed);
+
+    // Solo faltan los dos frames cortados
+    std::vector<HistorySample> got = readAll(log, 0, 0, UINT64_MAX);
+    std::vector<uint32_t> want;
+    for (uint32_t i = 0; i < 272; ++i)
+    {
+        if ((i >= 160 && i < 176) || (i >= 240 && i < 256)) continue;
+        want.push_back(i);
+    }
+    TEST_ASSERT_EQUAL_size_t(want.size(), got.size());
+    for (size_t k = 0; k < got.size(); ++k) assertSample(0, want[k], got[k]);
+}
+
+void test_erases_spread_across_segments()
+{
+    static uint8_t image[8 * 4096];
+    memset(image, 0xFF, sizeof(image));
+    RamHistoryFlash flash(image, sizeof(image));
+    HistoryLog log;
+    TEST_ASSERT_TRUE(log.begin(&flash, 4096, MAX_LAG_MS));
+
+    uint32_t next = 0;
+    while (log.stats().rotations < 83)
+    {
+        TEST_ASSERT_TRUE(appendRun(log, static_cast<uint8_t>(next % 5), next));
+        next += HISTORY_FRAME_MAX_SAMPLES;
+    }
+
+    // 84 segmentos abiertos en un anillo de 8: diez u once borrados cada uno
+    HistoryLogStats st = log.stats();
+    TEST_ASSERT_EQUAL_UINT32(84, flash.erases);
+    TEST_ASSERT_EQUAL_UINT32(10, st.eraseMin);
+    TEST_ASSERT_EQUAL_UINT32(11, st.eraseMax);
+
+    // Los contadores viven en la cabecera: sobreviven al reinicio
+    HistoryLog again;
+    TEST_ASSERT_TRUE(again.begin(&flash, 4096, MAX_LAG_MS));
+    TEST_ASSERT_EQUAL_UINT32(st.eraseMin, again.stats().eraseMin);
+    TEST_ASSERT_EQUAL_UINT32(st.eraseMax, again.stats().eraseMax);
+
+    // Otra vuelta entera despues del reinicio sigue pareja
+    while (again.stats().rotations < 8)
+    {
+        TEST_ASSERT_TRUE(appendRun(again, 0, next));
+        next += HISTORY_FRAME_MAX_SAMPLES;
+    }
+    TEST_ASSERT_TRUE(again.stats().eraseMax - again.stats().eraseMin <= 1);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_append_and_read_across_rotation);
+    RUN_TEST(test_seek_uses_sparse_index);
+    RUN_TEST(test_torn_write_is_skipped_on_replay);
+    RUN_TEST(test_erases_spread_across_segments);
+    return UNITY_END();
+}
@@ -0,0 +1,160 @@
+#include <unity.h>
+#include <string>
+#include <thread>
+#include "bump_arena.cpp"
+#include "api/json_arena.cpp"
+
+/*
+  JsonArena con documentos armados como en los handlers: el cuerpo se
+  parsea a un documento, la respuesta se arma en otro y se serializa. Todo
+  tiene que salir de la arena y, al destruirse el ultimo documento, la
+  arena tiene que volver entera al inicio una sola vez por peticion.
+*/
+
+static const char BODY[] =
+    "{\"name\":\"porton norte\",\"slots\":[1,4,9,16],"
+    "\"rules\":[{\"id\":7,\"min\":-500,\"max\":2500},{\"id\":8,\"min\":0,\"max\":100}]}";
+
+static uint32_t usedInside = 0;
+
+// Como un POST que responde con sendData(): documento de entrada, datos y salida
+static std::string handler()
+{
+    JsonDocument body(requestAllocator());
+    TEST_ASSERT_FALSE(deserializeJson(body, BODY));
+
+    JsonDocument doc(requestAllocator());
+    doc["name"] = body["name"];
+    doc["count"] = body["slots"].size();
+    JsonArray rules = doc["rules"].to<JsonArray>();
+    for (JsonObject r : body["rules"].as<JsonArray>())
+    {
+        JsonObject o = rules.add<JsonObject>();
+        o["id"] = r["id"];
+        o["span"] = r["max"].as<int>() - r["min"].as<int>();
+    }
+
+    JsonDocument outDoc(requestAllocator());
+    outDoc["success"] = true;
+    outDoc["data"].set(doc.as<JsonVariantConst>());
+
+    std::string out;
+    serializeJson(outDoc, out);
+    usedInside = jsonArena.stats().arena.used;
+    return out;
+}
+
+void setUp()
+{
+    TEST_ASSERT_TRUE(jsonArena.begin());
+}
+
+void tearDown() {}
+
+void test_handler_documents_come_from_arena()
+{
+    JsonArenaStats before = jsonArena.stats();
+    std::string out = handler();
+    JsonArenaStats after = jsonArena.stats();
+
+    TEST_ASSERT_EQUAL_STRING("{\"success\":true,\"data\":{\"name\":\"porton norte\",\"count\":4,"
+                             "\"rules\":[{\"id\":7,\"span\":3000},{\"id\":8,\"span\":100}]}}",
+                             out.c_str());
+
+    TEST_ASSERT_TRUE(after.arena.allocs > before.arena.allocs);
+    TEST_ASSERT_EQUAL_UINT32(after.arena.allocs - before.arena.allocs, after.arena.frees - before.arena.frees);
+    TEST_ASSERT_EQUAL_UINT32(before.heapFallbacks, after.heapFallbacks);
+    TEST_ASSERT_EQUAL_UINT32(before.foreignTask, after.foreignTask);
+    TEST_ASSERT_EQUAL_UINT32(JSON_ARENA_BYTES, after.arena.capacity);
+
+    // Una sola vuelta al inicio, con la peticion completa medida
+    TEST_ASSERT_TRUE(usedInside > 0);
+    TEST_ASSERT_EQUAL_UINT32(before.arena.resets + 1, after.arena.resets);
+    TEST_ASSERT_EQUAL_UINT32(0, after.arena.live);
+    TEST_ASSERT_EQUAL_UINT32(0, after.arena.used);
+    TEST_ASSERT_TRUE(after.arena.lastUsed >= usedInside);
+}
+
+void test_repeated_requests_reuse_the_same_memory()
+{
+    handler();
+    uint32_t first = jsonArena.stats().arena.lastUsed;
+    JsonArenaStats before = jsonArena.stats();
+
+    for (int i = 0; i < 500; ++i)
+    {
+        handler();
+        TEST_ASSERT_EQUAL_UINT32(first, jsonArena.stats().arena.lastUsed);
+    }
+
+    JsonArenaStats after = jsonArena.stats();
+    TEST_ASSERT_EQUAL_UINT32(before.arena.resets + 500, after.arena.resets);
+    TEST_ASSERT_EQUAL_UINT32(before.arena.peakUsed, after.arena.peakUsed);
+    TEST_ASSERT_EQUAL_UINT32(0, after.arena.used);
+}
+
+void test_out_of_order_release_and_resize()
+{
+    ArduinoJson::Allocator *a = requestAllocator();
+    JsonArenaStats before = jsonArena.stats();
+
+    char *p1 = static_cast<char *>(a->allocate(24));
+    char *p2 = static_cast<char *>(a->allocate(40));
+    memcpy(p1, "primer bloque", 14);
+
+    // El ultimo bloque crece en sitio; el anterior se copia a uno nuevo
+    TEST_ASSERT_EQUAL_PTR(p2, a->reallocate(p2, 200));
+    TEST_ASSERT_EQUAL_UINT32(before.arena.resizedInPlace + 1, jsonArena.stats().arena.resizedInPlace);
+
+    char *moved = static_cast<char *>(a->reallocate(p1, 100));
+    TEST_ASSERT_TRUE(moved != p1);
+    TEST_ASSERT_EQUAL_STRING("primer bloque", moved);
+    uint32_t used = jsonArena.stats().arena.used;
+
+    // Liberar uno del medio no devuelve nada; el ultimo baja el tope
+    a->deallocate(p2);
+    TEST_ASSERT_EQUAL_UINT32(used, jsonArena.stats().arena.used);
+    TEST_ASSERT_EQUAL_UINT32(before.arena.resets, jsonArena.stats().arena.resets);
+
+    a->deallocate(moved);
+    JsonArenaStats after = jsonArena.stats();
+    TEST_ASSERT_EQUAL_UINT32(before.arena.resets + 1, after.arena.resets);
+    TEST_ASSERT_EQUAL_UINT32(0, after.arena.used);
+    TEST_ASSERT_EQUAL_UINT32(0, after.arena.live);
+}
+
+void test_oversized_and_foreign_task_go_to_heap()
+{
+    ArduinoJson::Allocator *a = requestAllocator();
+    JsonArenaStats before = jsonArena.stats();
+
+    void *big = a->allocate(JSON_ARENA_BYTES + 1);
+    TEST_ASSERT_NOT_NULL(big);
+    TEST_ASSERT_EQUAL_UINT32(before.heapFallbacks + 1, jsonArena.stats().heapFallbacks);
+    TEST_ASSERT_EQUAL_UINT32(before.arena.exhausted + 1, jsonArena.stats().arena.exhausted);
+    a->deallocate(big);
+
+    // Otra tarea no toca la arena aunque haya lugar
+    void *fromOther = nullptr;
+    std::thread other([&]
+                      { fromOther = a->allocate(32); });
+    other.join();
+    TEST_ASSERT_NOT_NULL(fromOther);
+    TEST_ASSERT_EQUAL_UINT32(before.foreignTask + 1, jsonArena.stats().foreignTask);
+    a->deallocate(fromOther);
+
+    JsonArenaStats after = jsonArena.stats();
+    TEST_ASSERT_EQUAL_UINT32(before.arena.allocs, after.arena.allocs);
+    TEST_ASSERT_EQUAL_UINT32(before.arena.frees, after.arena.frees);
+    TEST_ASSERT_EQUAL_UINT32(0, after.arena.used);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_handler_documents_come_from_arena);
+    RUN_TEST(test_repeated_requests_reuse_the_same_memory);
+    RUN_TEST(test_out_of_order_release_and_resize);
+    RUN_TEST(test_oversized_and_foreign_task_go_to_heap);
+    return UNITY_END();
+}
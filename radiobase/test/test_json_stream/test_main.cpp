@@ -0,0 +1,451 @@
+#include <unity.h>
+#include <ArduinoJson.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <string>
+#include "json_writer.cpp"
+#include "json_stream.cpp"
+#include "config.h"
+
+/*
+  Benchmark de la respuesta por partes contra el camino anterior
+  (JsonDocument -> cadena -> copia a la respuesta, con una cadena por
+  direccion) para la tabla de /api/slots.
+
+  operator new se instrumenta para contar asignaciones, bytes y pico vivo
+  de cada pedido. La salida de JsonStream tiene que ser identica a la de
+  serializeJson para cualquier tamano de chunk, y una vez creado el objeto
+  fill() no puede pedir memoria.
+*/
+
+static bool tracking = false;
+static size_t allocCount = 0;
+static size_t allocBytes = 0;
+static size_t liveBytes = 0;
+static size_t peakBytes = 0;
+
+// Cabecera delante de cada bloque para conocer su tamano al liberar
+static constexpr size_t ALLOC_HEAD = alignof(std::max_align_t);
+
+void *operator new(size_t n)
+{
+    uint8_t *p = static_cast<uint8_t *>(malloc(n + ALLOC_HEAD));
+    if (p == nullptr) throw std::bad_alloc();
+    *reinterpret_cast<size_t *>(p) = n;
+    if (tracking)
+    {
+        allocCount++;
+        allocBytes += n;
+        liveBytes += n;
+        if (liveBytes > peakBytes) peakBytes = liveBytes;
+    }
+    return p + ALLOC_HEAD;
+}
+
+void operator delete(void *ptr) noexcept
+{
+    if (ptr == nullptr) return;
+    uint8_t *p = static_cast<uint8_t *>(ptr) - ALLOC_HEAD;
+    size_t n = *reinterpret_cast<size_t *>(p);
+    if (tracking && liveBytes >= n) liveBytes -= n;
+    free(p);
+}
+
+void operator delete(void *ptr, size_t) noexcept
+{
+    operator delete(ptr);
+}
+
+struct AllocStats
+{
+    size_t count;
+    size_t bytes;
+    size_t peak;
+};
+
+static void trackStart()
+{
+    allocCount = allocBytes = liveBytes = peakBytes = 0;
+    tracking = true;
+}
+
+static AllocStats trackStop()
+{
+    tracking = false;
+    return {allocCount, allocBytes, peakBytes};
+}
+
+// Misma forma que SlotState en la respuesta
+struct SlotRow
+{
+    bool used;
+    uint64_t addr;
+    uint32_t lastSeenMs;
+    bool alarm;
+    bool restored;
+    uint32_t restoredAgeMs;
+    uint8_t environmentId;
+    uint8_t deviceId;
+};
+
+static SlotRow rows[MAX_SLOTS];
+static constexpr uint32_t GEN = 4711;
+
+static void makeRows()
+{
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        SlotRow &r = rows[i];
+        r.used = (i % 5) != 4;
+        r.addr = 0xC0FFEE000000ULL + static_cast<uint64_t>(i) * 0x010203ULL;
+        r.lastSeenMs = 3600000u + static_cast<uint32_t>(i) * 7919u;
+        r.alarm = (i % 7) == 3;
+        r.restored = (i % 6) == 1;
+        r.restoredAgeMs = static_cast<uint32_t>(i) * 1000u;
+        r.environmentId = static_cast<uint8_t>(1 + i / 8);
+        r.deviceId = static_cast<uint8_t>(i);
+    }
+}
+
+// ---- Camino anterior ----
+
+static std::string addrToHex(uint64_t value)
+{
+    char buf[17];
+    snprintf(buf, sizeof(buf), "%012llX", static_cast<unsigned long long>(value));
+    return std::string(buf);
+}
+
+static std::unique_ptr<char[]> documentResponse(size_t &len)
+{
+    JsonDocument doc;
+    doc["success"] = true;
+    JsonObject data = doc["data"].to<JsonObject>();
+    data["gen"] = GEN;
+    data["full"] = true;
+    JsonArray arr = data["slots"].to<JsonArray>();
+
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        const SlotRow &r = rows[i];
+        JsonObject o = arr.add<JsonObject>();
+        o["index"] = i;
+        o["used"] = r.used;
+        o["addr"] = addrToHex(r.addr);
+        o["last_seen_ms"] = r.lastSeenMs;
+        o["alarm"] = r.alarm;
+        o["stale"] = r.restored;
+        if (r.restored) o["restored_age_ms"] = r.restoredAgeMs;
+        JsonObject last = o["last"].to<JsonObject>();
+        last["environment_id"] = r.environmentId;
+        last["device_id"] = r.deviceId;
+    }
+
+    std::string body;
+    serializeJson(doc, body);
+
+    // La respuesta guardaba su propia copia del cuerpo
+    len = body.size();
+    std::unique_ptr<char[]> copy(new char[len]);
+    memcpy(copy.get(), body.c_str(), len);
+    return copy;
+}
+
+// ---- Respuesta por partes ----
+
+static constexpr JsonKey JK_SUCCESS = JSON_KEY("success");
+static constexpr JsonKey JK_DATA = JSON_KEY("data");
+static constexpr JsonKey JK_GEN = JSON_KEY("gen");
+static constexpr JsonKey JK_FULL = JSON_KEY("full");
+static constexpr JsonKey JK_SLOTS = JSON_KEY("slots");
+static constexpr JsonKey JK_INDEX = JSON_KEY("index");
+static constexpr JsonKey JK_USED = JSON_KEY("used");
+static constexpr JsonKey JK_ADDR = JSON_KEY("addr");
+static constexpr JsonKey JK_LAST_SEEN_MS = JSON_KEY("last_seen_ms");
+static constexpr JsonKey JK_ALARM = JSON_KEY("alarm");
+static constexpr JsonKey JK_STALE = JSON_KEY("stale");
+static constexpr JsonKey JK_RESTORED_AGE_MS = JSON_KEY("restored_age_ms");
+static constexpr JsonKey JK_LAST = JSON_KEY("last");
+static constexpr JsonKey JK_ENVIRONMENT_ID = JSON_KEY("environment_id");
+static constexpr JsonKey JK_DEVICE_ID = JSON_KEY("device_id");
+
+struct SlotsStream : public JsonStream
+{
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == 0)
+        {
+            w.beginObject(2);
+            w.fieldBool(JK_SUCCESS, true);
+            w.beginObject(JK_DATA, 3);
+            w.fieldUint(JK_GEN, GEN);
+            w.fieldBool(JK_FULL, true);
+            w.beginArray(JK_SLOTS, MAX_SLOTS);
+            return true;
+        }
+
+        if (index <= MAX_SLOTS)
+        {
+            int i = static_cast<int>(index - 1);
+            const SlotRow &r = rows[i];
+            w.beginObject();
+            w.fieldInt(JK_INDEX, i);
+            w.fieldBool(JK_USED, r.used);
+            w.fieldHex48(JK_ADDR, r.addr);
+            w.fieldUint(JK_LAST_SEEN_MS, r.lastSeenMs);
+            w.fieldBool(JK_ALARM, r.alarm);
+            w.fieldBool(JK_STALE, r.restored);
+            if (r.restored) w.fieldUint(JK_RESTORED_AGE_MS, r.restoredAgeMs);
+            w.beginObject(JK_LAST);
+            w.fieldUint(JK_ENVIRONMENT_ID, r.environmentId);
+            w.fieldUint(JK_DEVICE_ID, r.deviceId);
+            w.endObject();
+            w.endObject();
+            return true;
+        }
+
+        if (index == MAX_SLOTS + 1)
+        {
+            w.endArray();
+            w.endObject();
+            w.endObject();
+            return true;
+        }
+
+        return false;
+    }
+};
+
+// Tamano de chunk tipico de AsyncWebServer sobre un MSS de 1436
+static constexpr size_t CHUNK = 1436;
+
+static std::string drain(JsonStream &s, size_t chunk)
+{
+    std::string out;
+    std::unique_ptr<uint8_t[]> buf(new uint8_t[chunk]);
+    size_t n;
+    while ((n = s.fill(buf.get(), chunk)) > 0)
+    {
+        TEST_ASSERT_TRUE(n <= chunk);
+        out.append(reinterpret_cast<char *>(buf.get()), n);
+    }
+    return out;
+}
+
+void setUp()
+{
+    makeRows();
+}
+
+void tearDown() {}
+
+void test_stream_matches_document_for_any_chunk()
+{
+    size_t len = 0;
+    std::unique_ptr<char[]> body = documentResponse(len);
+    std::string expected(body.get(), len);
+
+    static const size_t CHUNKS[] = {1, 2, 7, 64, 333, CHUNK, 5000, 65536};
+    for (size_t chunk : CHUNKS)
+    {
+        SlotsStream s;
+        std::string got = drain(s, chunk);
+        TEST_ASSERT_EQUAL_size_t(expected.size(), got.size());
+        TEST_ASSERT_TRUE(expected == got);
+        TEST_ASSERT_EQUAL_UINT32(MAX_SLOTS + 2, s.partsWritten());
+    }
+}
+
+void test_bench_allocations_and_latency()
+{
+    typedef std::chrono::steady_clock Clock;
+    static constexpr int REQUESTS = 2000;
+
+    // Un pedido de cada camino con la memoria instrumentada
+    size_t len = 0;
+    trackStart();
+    documentResponse(len);
+    AllocStats doc = trackStop();
+
+    uint8_t chunk[CHUNK];
+    trackStart();
+    {
+        std::shared_ptr<SlotsStream> s = std::make_shared<SlotsStream>();
+        while (s->fill(chunk, sizeof(chunk)) > 0)
+        {
+        }
+    }
+    AllocStats stream = trackStop();
+
+    auto t0 = Clock::now();
+    for (int i = 0; i < REQUESTS; ++i)
+    {
+        documentResponse(len);
+    }
+    double docUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / REQUESTS;
+
+    size_t bytes = 0;
+    t0 = Clock::now();
+    for (int i = 0; i < REQUESTS; ++i)
+    {
+        SlotsStream s;
+        size_t n;
+        while ((n = s.fill(chunk, sizeof(chunk))) > 0) bytes += n;
+    }
+    double streamUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / REQUESTS;
+
+    char msg[240];
+    snprintf(msg, sizeof(msg),
+             "/api/slots %u slots, %zu B, chunks de %zu B | documento: %zu asignaciones, %zu B, pico %zu B, %.1f us | "
+             "stream: %zu asignaciones, %zu B, pico %zu B, %.1f us",
+             MAX_SLOTS, len, CHUNK, doc.count, doc.bytes, doc.peak, docUs, stream.count, stream.bytes, stream.peak,
+             streamUs);
+    TEST_MESSAGE(msg);
+
+    TEST_ASSERT_EQUAL_size_t(len * REQUESTS, bytes);
+    // Solo el objeto de la respuesta: fill() no pide memoria
+    TEST_ASSERT_EQUAL_size_t(1, stream.count);
+    TEST_ASSERT_TRUE(stream.peak < 1024);
+    TEST_ASSERT_TRUE(doc.peak > len);
+}
+
+// Cabecera, una fila con un texto del largo pedido y cierre
+struct TextStream : public JsonStream
+{
+    std::string text;
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        switch (index)
+        {
+        case 0:
+            w.beginObject(2);
+            w.fieldBool(JK_SUCCESS, true);
+            w.beginArray(JK_DATA, 1);
+            return true;
+        case 1:
+            w.beginObject(1);
+            w.fieldStr(JK_LAST, text.c_str());
+            w.endObject();
+            return true;
+        case 2:
+            w.endArray();
+            w.endObject();
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+void test_part_larger_than_chunk_goes_through_spill()
+{
+    // Mas grande que el chunk pero dentro del desborde
+    TextStream s;
+    s.text.assign(JSON_STREAM_SPILL - 32, 'x');
+    std::string got = drain(s, 64);
+
+    TEST_ASSERT_FALSE(s.aborted());
+    TEST_ASSERT_EQUAL_UINT32(3, s.partsWritten());
+    std::string expected = "{\"success\":true,\"data\":[{\"last\":\"" + s.text + "\"}]}";
+    TEST_ASSERT_TRUE(expected == got);
+}
+
+void test_part_larger_than_spill_aborts()
+{
+    static const size_t CHUNKS[] = {1, 64, CHUNK};
+    for (size_t chunk : CHUNKS)
+    {
+        TextStream s;
+        s.text.assign(chunk + JSON_STREAM_SPILL, 'x');
+        std::string got = drain(s, chunk);
+
+        // Se entrega lo anterior y nada mas: ni la fila ni el cierre
+        TEST_ASSERT_TRUE(s.aborted());
+        TEST_ASSERT_EQUAL_UINT32(1, s.partsWritten());
+        TEST_ASSERT_EQUAL_STRING("{\"success\":true,\"data\":[", got.c_str());
+
+        uint8_t buf[16];
+        TEST_ASSERT_EQUAL_size_t(0, s.fill(buf, sizeof(buf)));
+    }
+}
+
+// Filas que llegan de a poco, como un cursor de historial que no avanzo
+struct PendingStream : public JsonStream
+{
+    uint32_t available = 0;
+
+    bool part(JsonWriter &w, uint32_t index) override
+    {
+        if (index == 0)
+        {
+            w.beginObject(1);
+            w.beginArray(JK_DATA, 3);
+            return true;
+        }
+
+        if (index <= 3)
+        {
+            if (index > available)
+            {
+                retry();
+                return true;
+            }
+            w.valueUint(index * 10);
+            return true;
+        }
+
+        if (index == 4)
+        {
+            w.endArray();
+            w.endObject();
+            return true;
+        }
+
+        return false;
+    }
+};
+
+void test_part_without_data_waits()
+{
+    PendingStream s;
+    uint8_t buf[64];
+    std::string got;
+
+    // La cabecera sale; la primera fila todavia no esta
+    size_t n = s.fill(buf, sizeof(buf));
+    got.append(reinterpret_cast<char *>(buf), n);
+    TEST_ASSERT_TRUE(s.waiting());
+    TEST_ASSERT_EQUAL_UINT32(1, s.partsWritten());
+
+    // Sin datos nuevos: nada, y la respuesta sigue abierta
+    TEST_ASSERT_EQUAL_size_t(0, s.fill(buf, sizeof(buf)));
+    TEST_ASSERT_TRUE(s.waiting());
+
+    s.available = 2;
+    n = s.fill(buf, sizeof(buf));
+    got.append(reinterpret_cast<char *>(buf), n);
+    TEST_ASSERT_TRUE(s.waiting());
+
+    s.available = 3;
+    got += drain(s, sizeof(buf));
+    TEST_ASSERT_FALSE(s.waiting());
+    TEST_ASSERT_FALSE(s.aborted());
+    TEST_ASSERT_EQUAL_UINT32(5, s.partsWritten());
+    TEST_ASSERT_EQUAL_STRING("{\"data\":[10,20,30]}", got.c_str());
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_stream_matches_document_for_any_chunk);
+    RUN_TEST(test_bench_allocations_and_latency);
+    RUN_TEST(test_part_larger_than_chunk_goes_through_spill);
+    RUN_TEST(test_part_larger_than_spill_aborts);
+    RUN_TEST(test_part_without_data_waits);
+    return UNITY_END();
+}
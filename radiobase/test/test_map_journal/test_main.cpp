@@ -0,0 +1,268 @@
+#include <unity.h>
+#include <memory>
+#include <vector>
+#include "driver/slot_manager.cpp"
+#include "driver/storage_fs.cpp"
+
+/*
+  Journal del mapa de beacons frente a cortes de alimentacion.
+
+  Cada operacion se repite cortando la energia despues de cada byte que
+  escribe (journal, .tmp de compactacion, rename) y se "reinicia" con un
+  SlotManager nuevo sobre lo que quedo en LittleFS. El mapa cargado debe
+  ser exactamente el anterior o el posterior a la operacion, nunca una
+  mezcla, y el siguiente lote debe seguir llegando al disco.
+*/
+
+static constexpr const char *MAP_FILE = "/config/beacon_map.bin";
+static constexpr const char *MAP_JOURNAL = "/config/beacon_map.jnl";
+
+struct MapModel
+{
+    BeaconMapEntry e[MAX_SLOTS];
+};
+
+static MapModel model;
+
+static MapEntryUpdate entry(uint8_t index, uint64_t addr, uint8_t slot, bool enabled = true)
+{
+    MapEntryUpdate u{};
+    u.index = index;
+    u.addr = addr;
+    u.slot = slot;
+    u.enabled = enabled;
+    return u;
+}
+
+static void applyModel(MapModel &m, const MapEntryUpdate *updates, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        BeaconMapEntry &e = m.e[updates[i].index];
+        e.addr = updates[i].addr;
+        e.slot = updates[i].slot;
+        e.enabled = updates[i].enabled;
+    }
+}
+
+static bool sameMap(SlotManager &sm, const MapModel &m)
+{
+    const BeaconMapEntry *map = sm.getMap();
+    for (int i = 0; i < MAX_SLOTS; ++i)
+    {
+        if (map[i].addr != m.e[i].addr || map[i].slot != m.e[i].slot || map[i].enabled != m.e[i].enabled) return false;
+    }
+    return true;
+}
+
+static void assertBootsTo(const MapModel &m)
+{
+    SlotManager sm;
+    TEST_ASSERT_TRUE(sm.begin());
+    TEST_ASSERT_TRUE(sameMap(sm, m));
+}
+
+// Estado en disco de partida: mapa base mas algunas transacciones en el journal
+static std::map<std::string, std::vector<uint8_t>> seed()
+{
+    nativeFs.format();
+    memset(&model, 0, sizeof(model));
+
+    SlotManager sm;
+    TEST_ASSERT_TRUE(sm.begin());
+
+    MapEntryUpdate base[] = {entry(0, 0xA4C1380000000001ULL, 0), entry(1, 0xA4C1380000000002ULL, 1),
+                             entry(2, 0xA4C1380000000003ULL, 2)};
+    TEST_ASSERT_TRUE(sm.applyMapEntries(base, 3));
+    applyModel(model, base, 3);
+    TEST_ASSERT_TRUE(sm.compactMap());
+
+    MapEntryUpdate more[] = {entry(3, 0xA4C1380000000004ULL, 7), entry(1, 0xA4C1380000000002ULL, 1, false)};
+    TEST_ASSERT_TRUE(sm.applyMapEntries(more, 2));
+    applyModel(model, more, 2);
+    TEST_ASSERT_TRUE(sm.setMapEntry(5, 0xA4C1380000000005ULL, 9));
+    MapEntryUpdate single = entry(5, 0xA4C1380000000005ULL, 9);
+    applyModel(model, &single, 1);
+
+    TEST_ASSERT_TRUE(LittleFS.exists(MAP_JOURNAL));
+    return nativeFs.files;
+}
+
+void setUp()
+{
+    nativeClock = 0;
+}
+
+void tearDown()
+{
+    nativeFs.powerOn();
+}
+
+static void test_check_rejects_duplicates()
+{
+    MapEntryUpdate dupIndex[] = {entry(4, 0x11, 0), entry(4, 0x22, 1)};
+    TEST_ASSERT_EQUAL_STRING("duplicate_index", SlotManager::checkMapEntries(dupIndex, 2));
+
+    MapEntryUpdate dupAddr[] = {entry(4, 0x11, 0), entry(6, 0x22, 1), entry(9, 0x11, 2)};
+    TEST_ASSERT_EQUAL_STRING("duplicate_addr", SlotManager::checkMapEntries(dupAddr, 3));
+
+    // Entradas vacias (addr 0) pueden repetirse
+    MapEntryUpdate empties[] = {entry(4, 0, 0, false), entry(6, 0, 0, false), entry(7, 0x33, 3)};
+    TEST_ASSERT_NULL(SlotManager::checkMapEntries(empties, 3));
+
+    MapEntryUpdate badSlot[] = {entry(4, 0x11, MAX_SLOTS)};
+    TEST_ASSERT_EQUAL_STRING("invalid_index_or_slot", SlotManager::checkMapEntries(badSlot, 1));
+    TEST_ASSERT_EQUAL_STRING("invalid_entries", SlotManager::checkMapEntries(badSlot, 0));
+
+    // applyMapEntries no deja pasar un lote invalido al journal
+    seed();
+    size_t before = nativeFs.files[MAP_JOURNAL].size();
+    SlotManager sm;
+    TEST_ASSERT_TRUE(sm.begin());
+    TEST_ASSERT_FALSE(sm.applyMapEntries(dupAddr, 3));
+    TEST_ASSERT_EQUAL_size_t(before, nativeFs.files[MAP_JOURNAL].size());
+    TEST_ASSERT_TRUE(sameMap(sm, model));
+}
+
+static void test_replay_after_clean_boot()
+{
+    seed();
+    assertBootsTo(model);
+}
+
+static void test_power_cut_during_bulk_at_every_byte()
+{
+    std::map<std::string, std::vector<uint8_t>> disk = seed();
+    MapModel before = model;
+
+    MapEntryUpdate batch[] = {entry(0, 0xA4C1380000000010ULL, 12), entry(8, 0xA4C1380000000011ULL, 13),
+                              entry(9, 0xA4C1380000000012ULL, 14), entry(3, 0, 0, false)};
+    MapModel after = before;
+    applyModel(after, batch, 4);
+
+    // Registros del lote mas el COMMIT
+    size_t txnBytes = 5 * 24;
+    size_t torn = 0;
+
+    for (size_t cut = 0; cut <= txnBytes; ++cut)
+    {
+        nativeFs.files = disk;
+        nativeFs.powerOn();
+        bool applied;
+        {
+            SlotManager sm;
+            TEST_ASSERT_TRUE(sm.begin());
+            nativeFs.powerCutAfter(cut);
+            applied = sm.applyMapEntries(batch, 4);
+        }
+        nativeFs.powerOn();
+
+        if (!applied && nativeFs.files[MAP_JOURNAL].size() != disk[MAP_JOURNAL].size()) torn++;
+
+        // El arranque descarta la transaccion rota y compacta la cola sucia
+        {
+            SlotManager sm;
+            TEST_ASSERT_TRUE(sm.begin());
+            TEST_ASSERT_TRUE(sameMap(sm, applied ? after : before));
+
+            // Lo que se escribe despues del corte se ve en el siguiente arranque
+            MapEntryUpdate next = entry(20, 0xA4C1380000000020ULL, 20);
+            TEST_ASSERT_TRUE(sm.applyMapEntries(&next, 1));
+        }
+
+        MapModel expect = applied ? after : before;
+        MapEntryUpdate next = entry(20, 0xA4C1380000000020ULL, 20);
+        applyModel(expect, &next, 1);
+        assertBootsTo(expect);
+    }
+
+    // El barrido paso por colas a medio escribir, no solo por lotes completos
+    TEST_ASSERT_GREATER_THAN(txnBytes / 2, torn);
+}
+
+static void test_power_cut_during_clear_at_every_byte()
+{
+    std::map<std::string, std::vector<uint8_t>> disk = seed();
+    MapModel before = model;
+    MapModel cleared{};
+
+    for (size_t cut = 0; cut <= 2 * 24; ++cut)
+    {
+        nativeFs.files = disk;
+        nativeFs.powerOn();
+        bool applied;
+        {
+            SlotManager sm;
+            TEST_ASSERT_TRUE(sm.begin());
+            nativeFs.powerCutAfter(cut);
+            applied = sm.clearMap();
+        }
+        nativeFs.powerOn();
+        assertBootsTo(applied ? cleared : before);
+    }
+}
+
+static void test_power_cut_during_compaction_at_every_byte()
+{
+    std::map<std::string, std::vector<uint8_t>> disk = seed();
+
+    // El .tmp del mapa completo; los rename/remove que siguen fallan con el corte
+    size_t fileBytes = 0;
+    {
+        nativeFs.files = disk;
+        SlotManager sm;
+        TEST_ASSERT_TRUE(sm.begin());
+        size_t start = nativeFs.bytesWritten;
+        TEST_ASSERT_TRUE(sm.compactMap());
+        fileBytes = nativeFs.bytesWritten - start;
+        TEST_ASSERT_FALSE(LittleFS.exists(MAP_JOURNAL));
+        TEST_ASSERT_TRUE(LittleFS.exists(MAP_FILE));
+    }
+    TEST_ASSERT_GREATER_THAN(0, fileBytes);
+
+    for (size_t cut = 0; cut <= fileBytes; ++cut)
+    {
+        nativeFs.files = disk;
+        nativeFs.powerOn();
+        {
+            SlotManager sm;
+            TEST_ASSERT_TRUE(sm.begin());
+            nativeFs.powerCutAfter(cut);
+            sm.compactMap();
+        }
+        nativeFs.powerOn();
+        assertBootsTo(model);
+    }
+}
+
+static void test_garbage_tail_is_discarded()
+{
+    seed();
+
+    // Registro valido de una transaccion sin COMMIT seguido de basura
+    std::vector<uint8_t> &jnl = nativeFs.files[MAP_JOURNAL];
+    std::vector<uint8_t> lastRecord(jnl.end() - 48, jnl.end() - 24);
+    lastRecord[4] ^= 0x7F; // otro txn, con su crc al dia
+    uint32_t crc = esp_rom_crc32_le(0, lastRecord.data(), 20);
+    memcpy(&lastRecord[20], &crc, sizeof(crc));
+    jnl.insert(jnl.end(), lastRecord.begin(), lastRecord.end());
+    jnl.push_back(0xFF);
+    jnl.push_back(0x00);
+
+    assertBootsTo(model);
+
+    // La compactacion en el arranque deja el journal vacio
+    TEST_ASSERT_FALSE(LittleFS.exists(MAP_JOURNAL));
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_check_rejects_duplicates);
+    RUN_TEST(test_replay_after_clean_boot);
+    RUN_TEST(test_power_cut_during_bulk_at_every_byte);
+    RUN_TEST(test_power_cut_during_clear_at_every_byte);
+    RUN_TEST(test_power_cut_during_compaction_at_every_byte);
+    RUN_TEST(test_garbage_tail_is_discarded);
+    return UNITY_END();
+}
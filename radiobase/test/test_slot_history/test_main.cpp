@@ -0,0 +1,239 @@
+#include <unity.h>
+#include <chrono>
+#include <map>
+#include <vector>
+#include "core/slot_history.cpp"
+
+/*
+  Historial en anillo: consultas a traves de la vuelta de millis() y
+  benchmark con todos los slots llenos (MAX_SLOTS x HISTORY_DEPTH).
+
+  Los resultados se comparan con un filtro lineal sobre una copia de lo
+  que se agrego; los tiempos se informan con TEST_MESSAGE y solo se
+  exige un tope holgado para detectar un recorrido lineal por consulta.
+*/
+
+struct Appended
+{
+    uint32_t ts;
+    int16_t tmp;
+};
+
+static std::vector<Appended> appended[MAX_SLOTS];
+static uint32_t rng = 0x1234567u;
+
+static uint32_t nextRandom()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static SlotHistory *fresh()
+{
+    for (auto &v : appended) v.clear();
+    // Sin destructor en el firmware: cada prueba usa un anillo nuevo
+    SlotHistory *h = new SlotHistory();
+    TEST_ASSERT_TRUE(h->begin());
+    return h;
+}
+
+static void append(SlotHistory &h, int slot, uint32_t ts, int16_t tmp)
+{
+    BeaconDecoded read{};
+    read.tmp_x100 = tmp;
+    h.append(slot, read, ts);
+    appended[slot].push_back({ts, tmp});
+}
+
+static std::vector<HistoryRecord> query(SlotHistory &h, int slot, uint32_t from, uint32_t to, uint32_t step)
+{
+    std::vector<HistoryRecord> out;
+    HistoryCursor cur;
+    TEST_ASSERT_TRUE(h.open(cur, slot, from, to, step));
+
+    HistoryRecord batch[64];
+    while (!cur.done)
+    {
+        size_t n = h.read(cur, batch, 64);
+        out.insert(out.end(), batch, batch + n);
+    }
+    return out;
+}
+
+// Referencia: lo que sigue en el anillo, filtrado registro por registro y
+// con el primer registro de cada intervalo [from + k*step, from + (k+1)*step)
+static std::vector<Appended> expected(int slot, uint32_t from, uint32_t to, uint32_t step)
+{
+    const std::vector<Appended> &all = appended[slot];
+    size_t first = all.size() > HISTORY_DEPTH ? all.size() - HISTORY_DEPTH : 0;
+    std::vector<Appended> out;
+    std::map<uint32_t, bool> buckets;
+
+    for (size_t i = first; i < all.size(); ++i)
+    {
+        int64_t fromDelta = static_cast<int32_t>(all[i].ts - from);
+        int64_t toDelta = static_cast<int32_t>(all[i].ts - to);
+        if (fromDelta < 0) continue;
+        if (toDelta > 0) break;
+
+        if (step)
+        {
+            uint32_t k = static_cast<uint32_t>(fromDelta) / step;
+            if (buckets[k]) continue;
+            buckets[k] = true;
+        }
+        out.push_back(all[i]);
+    }
+    return out;
+}
+
+static void assertQuery(SlotHistory &h, int slot, uint32_t from, uint32_t to, uint32_t step)
+{
+    std::vector<HistoryRecord> got = query(h, slot, from, to, step);
+    std::vector<Appended> want = expected(slot, from, to, step);
+    TEST_ASSERT_EQUAL_size_t(want.size(), got.size());
+    for (size_t i = 0; i < want.size(); ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT32(want[i].ts, got[i].ts_ms);
+        TEST_ASSERT_EQUAL_INT16(want[i].tmp, got[i].tmp_x100);
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_query_across_millis_wrap()
+{
+    SlotHistory &h = *fresh();
+
+    // Diez minutos a ambos lados de la vuelta de millis()
+    uint32_t start = UINT32_MAX - 600000u + 1;
+    for (uint32_t i = 0; i < 1200; ++i) append(h, 4, start + i * 1000u, static_cast<int16_t>(i));
+
+    uint32_t wrap = 0;
+    assertQuery(h, 4, start, start + 1199000u, 0);
+    TEST_ASSERT_EQUAL_size_t(1200, query(h, 4, start, start + 1199000u, 0).size());
+
+    // Desde antes de la vuelta hasta despues, y solo de un lado
+    assertQuery(h, 4, wrap - 120000u, wrap + 120000u, 0);
+    TEST_ASSERT_EQUAL_size_t(241, query(h, 4, wrap - 120000u, wrap + 120000u, 0).size());
+    assertQuery(h, 4, wrap + 5000u, wrap + 9000u, 0);
+    assertQuery(h, 4, wrap - 9000u, wrap - 5000u, 0);
+
+    // Intervalos que cruzan la vuelta
+    assertQuery(h, 4, wrap - 300500u, wrap + 300000u, 60000u);
+    TEST_ASSERT_EQUAL_size_t(11, query(h, 4, wrap - 300500u, wrap + 300000u, 60000u).size());
+
+    // to antes de from (en el orden circular) no se abre
+    HistoryCursor cur;
+    TEST_ASSERT_FALSE(h.open(cur, 4, wrap + 1000u, wrap - 1000u, 0));
+
+    // Lo que pide el handler sin from: hasta 2^31 - 1 ms antes de to
+    uint32_t to = start + 1199000u;
+    assertQuery(h, 4, to - INT32_MAX, to, 0);
+    TEST_ASSERT_EQUAL_size_t(1200, query(h, 4, to - INT32_MAX, to, 0).size());
+}
+
+static void test_overrun_counts_skipped()
+{
+    SlotHistory &h = *fresh();
+    for (uint32_t i = 0; i < HISTORY_DEPTH; ++i) append(h, 0, 1000u + i * 10u, 1);
+
+    HistoryCursor cur;
+    TEST_ASSERT_TRUE(h.open(cur, 0, 0, UINT32_MAX / 2, 0));
+    HistoryRecord rec[16];
+    TEST_ASSERT_EQUAL_size_t(16, h.read(cur, rec, 16));
+
+    // El productor da media vuelta al anillo mientras la consulta espera
+    for (uint32_t i = 0; i < HISTORY_DEPTH / 2; ++i) append(h, 0, 1000u + (HISTORY_DEPTH + i) * 10u, 2);
+
+    size_t n = h.read(cur, rec, 16);
+    TEST_ASSERT_EQUAL_size_t(16, n);
+    TEST_ASSERT_EQUAL_UINT32(HISTORY_DEPTH / 2 - 16, cur.skipped);
+    TEST_ASSERT_EQUAL_UINT32(1000u + (HISTORY_DEPTH / 2) * 10u, rec[0].ts_ms);
+}
+
+static void test_bench_full_capacity()
+{
+    using Clock = std::chrono::steady_clock;
+    SlotHistory &h = *fresh();
+
+    // Anillos llenos y ya sobrescritos, con la vuelta de millis() adentro
+    uint32_t ts[MAX_SLOTS];
+    for (int s = 0; s < MAX_SLOTS; ++s) ts[s] = UINT32_MAX - (HISTORY_DEPTH / 2) * 1000u;
+
+    Clock::time_point t0 = Clock::now();
+    for (uint32_t i = 0; i < HISTORY_DEPTH + HISTORY_DEPTH / 4; ++i)
+    {
+        for (int s = 0; s < MAX_SLOTS; ++s)
+        {
+            ts[s] += 500u + nextRandom() % 1000u;
+            append(h, s, ts[s], static_cast<int16_t>(nextRandom() % 4000));
+        }
+    }
+    double appendNs = std::chrono::duration<double, std::nano>(Clock::now() - t0).count() /
+                      (MAX_SLOTS * (HISTORY_DEPTH + HISTORY_DEPTH / 4));
+
+    for (int s = 0; s < MAX_SLOTS; ++s) TEST_ASSERT_EQUAL_UINT32(HISTORY_DEPTH, h.count(s));
+
+    // Consultas al azar dentro del anillo, contra el filtro lineal
+    static const uint32_t steps[] = {0, 0, 10000, 60000, 900000};
+    for (int q = 0; q < 200; ++q)
+    {
+        int slot = static_cast<int>(nextRandom() % MAX_SLOTS);
+        const std::vector<Appended> &all = appended[slot];
+        uint32_t a = all[all.size() - 1 - nextRandom() % HISTORY_DEPTH].ts;
+        uint32_t span = nextRandom() % 3600000u;
+        assertQuery(h, slot, a, a + span, steps[q % 5]);
+    }
+
+    // Costo de abrir (busqueda binaria) y de leer una ventana de una hora
+    const int QUERIES = 20000;
+    size_t rows = 0;
+    t0 = Clock::now();
+    for (int q = 0; q < QUERIES; ++q)
+    {
+        int slot = q % MAX_SLOTS;
+        const std::vector<Appended> &all = appended[slot];
+        uint32_t from = all[all.size() - 1 - (static_cast<uint32_t>(q) * 7919u) % HISTORY_DEPTH].ts;
+
+        HistoryCursor cur;
+        h.open(cur, slot, from, from + 3600000u, 0);
+        HistoryRecord batch[64];
+        while (!cur.done) rows += h.read(cur, batch, 64);
+    }
+    double queryUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / QUERIES;
+
+    t0 = Clock::now();
+    for (int q = 0; q < QUERIES; ++q)
+    {
+        HistoryCursor cur;
+        h.open(cur, q % MAX_SLOTS, ts[q % MAX_SLOTS] - (static_cast<uint32_t>(q) * 104729u) % 4000000u, ts[q % MAX_SLOTS], 0);
+    }
+    double openUs = std::chrono::duration<double, std::micro>(Clock::now() - t0).count() / QUERIES;
+
+    char msg[160];
+    snprintf(msg, sizeof(msg), "%u slots x %u registros (%u KB): append %.0f ns, open %.2f us, consulta de 1 h %.1f us (%zu filas)",
+             MAX_SLOTS, HISTORY_DEPTH, static_cast<unsigned>(h.capacityBytes() / 1024), appendNs, openUs, queryUs,
+             rows / QUERIES);
+    TEST_MESSAGE(msg);
+
+    // Holgado: un recorrido lineal del anillo por open supera esto
+    TEST_ASSERT_TRUE(openUs < 50.0);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_query_across_millis_wrap);
+    RUN_TEST(test_overrun_counts_skipped);
+    RUN_TEST(test_bench_full_capacity);
+    return UNITY_END();
+}
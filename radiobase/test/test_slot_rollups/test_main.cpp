@@ -0,0 +1,253 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ctime>
+#include <stdlib.h>
+#include <map>
+#include <vector>
+
+// El reloj de pared lo fija la prueba. Va despues de los encabezados de la
+// biblioteca estandar: <ctime> hace #undef time
+static time_t nativeNow = 0;
+#define time(p) (nativeNow)
+
+#include "core/slot_rollups.cpp"
+#include "driver/storage_fs.cpp"
+
+/*
+  Resumenes de minuto/hora/dia contra un recalculo por fuerza bruta.
+
+  Se reproduce una traza de varios dias por slot (lecturas cada 10-70 s,
+  huecos de horas, lecturas invalidas y alarmas) y al final se compara
+  cada hora y dia cerrados, y los periodos en curso, con lo que sale de
+  agrupar las mismas lecturas por calendario local. Se corre con la zona
+  del equipo y con una zona con cambio de horario, donde un dia tiene
+  23 horas.
+*/
+
+struct Reading
+{
+    uint32_t t;
+    int slot;
+    int16_t tmp;
+    uint8_t flags;
+    bool inAlarm;
+};
+
+struct Agg
+{
+    uint32_t start = 0;
+    uint32_t count = 0;
+    int64_t sum = 0;
+    int16_t min = INT16_MAX;
+    int16_t max = INT16_MIN;
+    std::map<uint32_t, bool> oorMinutes;
+};
+
+static uint32_t rng = 0xC0FFEEu;
+
+static uint32_t nextRandom()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static void setZone(const char *tz)
+{
+    setenv("TZ", tz, 1);
+    tzset();
+}
+
+static uint32_t localDayStart(uint32_t t)
+{
+    time_t tt = t;
+    struct tm local;
+    localtime_r(&tt, &local);
+    local.tm_hour = 0;
+    local.tm_min = 0;
+    local.tm_sec = 0;
+    local.tm_isdst = -1;
+    return static_cast<uint32_t>(mktime(&local));
+}
+
+// Las zonas probadas tienen desfase de horas enteras
+static uint32_t localHourStart(uint32_t t)
+{
+    return t - (t % 3600);
+}
+
+static std::vector<Reading> makeTrace(uint32_t start, uint32_t seconds)
+{
+    std::vector<Reading> out;
+    uint32_t next[3] = {start, start + 7, start + 23};
+    int16_t tmp[3] = {400, -1800, 1200};
+
+    for (;;)
+    {
+        int s = 0;
+        for (int i = 1; i < 3; ++i)
+            if (next[i] < next[s]) s = i;
+        if (next[s] >= start + seconds) break;
+
+        Reading r{};
+        r.t = next[s];
+        r.slot = s;
+        tmp[s] = static_cast<int16_t>(tmp[s] + static_cast<int>(nextRandom() % 41) - 20);
+        r.tmp = tmp[s];
+        uint32_t f = nextRandom() % 50;
+        r.flags = f == 0 ? 0x01 : f == 1 ? 0x04 : f == 2 ? 0x02 : 0;
+        r.inAlarm = (nextRandom() % 13) == 0;
+        out.push_back(r);
+
+        // Cada tanto el beacon queda fuera de alcance por horas
+        next[s] += (nextRandom() % 400 == 0) ? 3 * 3600 + nextRandom() % 7200 : 10 + nextRandom() % 60;
+    }
+    return out;
+}
+
+static void add(Agg &a, uint32_t start, const Reading &r)
+{
+    if (a.count == 0) a.start = start;
+    a.count++;
+    a.sum += r.tmp;
+    if (r.tmp < a.min) a.min = r.tmp;
+    if (r.tmp > a.max) a.max = r.tmp;
+    bool &oor = a.oorMinutes[r.t - (r.t % 60)];
+    oor = oor || r.inAlarm;
+}
+
+static uint16_t oorCount(const Agg &a)
+{
+    uint16_t n = 0;
+    for (const auto &m : a.oorMinutes) n += m.second ? 1 : 0;
+    return n;
+}
+
+static void assertBucket(const Agg &want, const RollupBucket &got)
+{
+    TEST_ASSERT_EQUAL_UINT32(want.start, got.start);
+    TEST_ASSERT_EQUAL_UINT32(want.count, got.count);
+    TEST_ASSERT_TRUE(want.sum == got.sumX100);
+    TEST_ASSERT_EQUAL_INT16(want.min, got.minX100);
+    TEST_ASSERT_EQUAL_INT16(want.max, got.maxX100);
+    TEST_ASSERT_EQUAL_UINT16(oorCount(want), got.oorMinutes);
+}
+
+static void runTrace(const char *tz, uint32_t start, uint32_t seconds)
+{
+    setZone(tz);
+    nativeFs.format();
+
+    SlotRollups *r = new SlotRollups();
+    TEST_ASSERT_TRUE(r->begin());
+
+    std::vector<Reading> trace = makeTrace(start, seconds);
+    std::map<uint32_t, Agg> hours[3];
+    std::map<uint32_t, Agg> days[3];
+
+    for (const Reading &rd : trace)
+    {
+        nativeNow = rd.t;
+        BeaconDecoded read{};
+        read.tmp_x100 = rd.tmp;
+        read.flags = rd.flags;
+        r->update(rd.slot, read, rd.inAlarm);
+
+        if (rd.flags & 0x05) continue;
+        uint32_t h = localHourStart(rd.t);
+        add(hours[rd.slot][h], h, rd);
+        uint32_t d = localDayStart(rd.t);
+        add(days[rd.slot][d], d, rd);
+    }
+
+    for (int s = 0; s < 3; ++s)
+    {
+        SlotRollup snap;
+        RollupBucket hourNow, dayNow;
+        TEST_ASSERT_TRUE(r->snapshot(s, snap, hourNow, dayNow));
+
+        // El periodo en curso es el de la ultima lectura valida
+        assertBucket(hours[s].rbegin()->second, hourNow);
+        assertBucket(days[s].rbegin()->second, dayNow);
+
+        // Horas y dias cerrados, del mas viejo al mas nuevo
+        std::vector<const Agg *> closedHours;
+        for (auto it = hours[s].begin(); it != hours[s].end(); ++it)
+            if (std::next(it) != hours[s].end()) closedHours.push_back(&it->second);
+        size_t keepH = closedHours.size() < ROLLUP_HOURS ? closedHours.size() : ROLLUP_HOURS;
+        TEST_ASSERT_EQUAL_UINT8(keepH, snap.hourCount);
+        for (size_t i = 0; i < keepH; ++i)
+        {
+            const RollupBucket &b = snap.hours[(snap.hourHead + ROLLUP_HOURS - keepH + i) % ROLLUP_HOURS];
+            assertBucket(*closedHours[closedHours.size() - keepH + i], b);
+        }
+
+        std::vector<const Agg *> closedDays;
+        for (auto it = days[s].begin(); it != days[s].end(); ++it)
+            if (std::next(it) != days[s].end()) closedDays.push_back(&it->second);
+        size_t keepD = closedDays.size() < ROLLUP_DAYS ? closedDays.size() : ROLLUP_DAYS;
+        TEST_ASSERT_EQUAL_UINT8(keepD, snap.dayCount);
+        for (size_t i = 0; i < keepD; ++i)
+        {
+            const RollupBucket &b = snap.days[(snap.dayHead + ROLLUP_DAYS - keepD + i) % ROLLUP_DAYS];
+            assertBucket(*closedDays[closedDays.size() - keepD + i], b);
+        }
+    }
+}
+
+void setUp()
+{
+}
+
+void tearDown()
+{
+}
+
+static void test_unsynced_clock_is_skipped()
+{
+    setZone(CLOCK_TZ);
+    nativeFs.format();
+    SlotRollups r;
+    TEST_ASSERT_TRUE(r.begin());
+
+    nativeNow = 1000;
+    BeaconDecoded read{};
+    r.update(0, read, false);
+    TEST_ASSERT_EQUAL_UINT32(1, r.info().unsyncedSkips);
+
+    SlotRollup snap;
+    RollupBucket hourNow, dayNow;
+    TEST_ASSERT_TRUE(r.snapshot(0, snap, hourNow, dayNow));
+    TEST_ASSERT_EQUAL_UINT32(0, hourNow.count);
+}
+
+static void test_rollups_match_brute_force_device_zone()
+{
+    // 2024-06-10 00:00 UTC, cinco dias
+    runTrace(CLOCK_TZ, 1717977600u, 5 * 86400u);
+}
+
+static void test_rollups_match_brute_force_across_dst()
+{
+    // 2024-03-29 .. 2024-04-02 en Europa central: el 31 de marzo dura 23 h
+    runTrace("CET-1CEST,M3.5.0,M10.5.0/3", 1711670400u, 4 * 86400u);
+    TEST_ASSERT_EQUAL_UINT32(23 * 3600u, localDayStart(1711843200u + 86400u) - localDayStart(1711843200u));
+}
+
+static void test_rollups_match_brute_force_month()
+{
+    // Mas de ROLLUP_DAYS dias: el anillo de dias da la vuelta
+    runTrace(CLOCK_TZ, 1717977600u, (ROLLUP_DAYS + 3) * 86400u);
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_unsynced_clock_is_skipped);
+    RUN_TEST(test_rollups_match_brute_force_device_zone);
+    RUN_TEST(test_rollups_match_brute_force_across_dst);
+    RUN_TEST(test_rollups_match_brute_force_month);
+    return UNITY_END();
+}
@@ -0,0 +1,266 @@
+#include <unity.h>
+#include <memory>
+#include <vector>
+#include "core/zone_aggregator.cpp"
+#include "driver/storage_fs.cpp"
+
+/*
+  ZoneAggregator mantiene min/max/media por zona de forma incremental.
+  Aqui se contrasta contra un recalculo por fuerza bruta desde la ultima
+  lectura de cada slot, tras una secuencia larga de lecturas aleatorias
+  con valores repetidos, lecturas invalidas, slots en varias zonas y
+  huecos que los dejan offline.
+*/
+
+static const char *ZONES =
+    "{\"zones\":["
+    "{\"name\":\"Camara 1\",\"slots\":[0,1,2,3,4,5]},"
+    "{\"name\":\"Camara 2\",\"slots\":[4,5,6,7,8,9,10,11]},"
+    "{\"name\":\"Tunel\",\"slots\":[12,13]},"
+    "{\"name\":\"Todos\",\"slots\":[0,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20,21,22,23,24,25,26,27,28,29,30,31]},"
+    "{\"name\":\"Vacia\",\"slots\":[]}"
+    "]}";
+
+struct ModelSlot
+{
+    bool seen;
+    bool inAlarm;
+    uint8_t flags;
+    int16_t tmpX100;
+    uint32_t lastSeenMs;
+};
+
+static constexpr uint8_t FLAG_BAT_LOW = 1 << 1;
+
+static ModelSlot model[MAX_SLOTS];
+static uint32_t members[MAX_ZONES];
+static std::unique_ptr<ZoneAggregator> agg;
+static uint32_t rng = 0x9E3779B9u;
+
+static uint32_t nextRandom()
+{
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return rng;
+}
+
+static bool saveJson(ZoneAggregator &z, const char *json, String &error)
+{
+    JsonDocument doc;
+    TEST_ASSERT_FALSE(deserializeJson(doc, json));
+    return z.saveZones(doc, error);
+}
+
+void setUp()
+{
+    nativeFs.format();
+    nativeClock = 0;
+    memset(model, 0, sizeof(model));
+    agg.reset(new ZoneAggregator());
+    TEST_ASSERT_TRUE(agg->begin());
+
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*agg, ZONES, error));
+
+    JsonDocument doc;
+    deserializeJson(doc, ZONES);
+    memset(members, 0, sizeof(members));
+    int zi = 0;
+    for (JsonObject z : doc["zones"].as<JsonArray>())
+    {
+        for (JsonVariant s : z["slots"].as<JsonArray>()) members[zi] |= 1UL << s.as<int>();
+        zi++;
+    }
+}
+
+void tearDown()
+{
+    agg.reset();
+}
+
+static void feed(int slot, int16_t tmp, uint8_t flags, bool inAlarm, uint32_t now)
+{
+    BeaconDecoded read{};
+    read.tmp_x100 = tmp;
+    read.flags = flags;
+    agg->update(slot, read, inAlarm, now);
+    model[slot] = {true, inAlarm, flags, tmp, now};
+}
+
+// Recalculo directo desde la ultima lectura de cada slot
+static ZoneSummary bruteForce(int zi, uint32_t now)
+{
+    ZoneSummary s{};
+    int32_t sum = 0;
+    for (int slot = 0; slot < MAX_SLOTS; ++slot)
+    {
+        if (!(members[zi] & (1UL << slot))) continue;
+        s.memberCount++;
+
+        const ModelSlot &m = model[slot];
+        if (!m.seen) continue;
+        if (m.inAlarm) s.alarmCount++;
+        if (now - m.lastSeenMs >= SLOT_OFFLINE_MS) continue;
+
+        s.onlineCount++;
+        if (m.flags & (FLAG_I2C_FAIL | FLAG_TMP_FAIL)) continue;
+
+        if (s.valueCount == 0 || m.tmpX100 < s.minX100) s.minX100 = m.tmpX100;
+        if (s.valueCount == 0 || m.tmpX100 > s.maxX100) s.maxX100 = m.tmpX100;
+        sum += m.tmpX100;
+        s.valueCount++;
+    }
+    s.offlineCount = s.memberCount - s.onlineCount;
+    if (s.valueCount) s.meanX100 = static_cast<int16_t>(sum / static_cast<int32_t>(s.valueCount));
+    return s;
+}
+
+static void assertMatchesBruteForce(uint32_t now)
+{
+    ZoneSummary got[MAX_ZONES];
+    size_t n = agg->snapshot(got, MAX_ZONES, now);
+    TEST_ASSERT_EQUAL_size_t(5, n);
+
+    for (size_t zi = 0; zi < n; ++zi)
+    {
+        ZoneSummary want = bruteForce(static_cast<int>(zi), now);
+        TEST_ASSERT_EQUAL_UINT32(members[zi], got[zi].members);
+        TEST_ASSERT_EQUAL_UINT8(want.memberCount, got[zi].memberCount);
+        TEST_ASSERT_EQUAL_UINT8(want.onlineCount, got[zi].onlineCount);
+        TEST_ASSERT_EQUAL_UINT8(want.offlineCount, got[zi].offlineCount);
+        TEST_ASSERT_EQUAL_UINT8(want.alarmCount, got[zi].alarmCount);
+        TEST_ASSERT_EQUAL_UINT8(want.valueCount, got[zi].valueCount);
+        if (want.valueCount == 0) continue;
+        TEST_ASSERT_EQUAL_INT16(want.minX100, got[zi].minX100);
+        TEST_ASSERT_EQUAL_INT16(want.maxX100, got[zi].maxX100);
+        TEST_ASSERT_EQUAL_INT16(want.meanX100, got[zi].meanX100);
+    }
+}
+
+static void test_invalid_readings_do_not_count()
+{
+    feed(0, 400, 0, false, 1000);
+    feed(1, -500, FLAG_TMP_FAIL, false, 1000);
+    feed(2, 0, FLAG_I2C_FAIL, false, 1000);
+    feed(3, 450, FLAG_BAT_LOW, false, 1000);
+
+    ZoneSummary s[MAX_ZONES];
+    agg->snapshot(s, MAX_ZONES, 1000);
+    TEST_ASSERT_EQUAL_UINT8(4, s[0].onlineCount);
+    TEST_ASSERT_EQUAL_UINT8(2, s[0].valueCount);
+    TEST_ASSERT_EQUAL_INT16(400, s[0].minX100);
+    TEST_ASSERT_EQUAL_INT16(450, s[0].maxX100);
+
+    // Cuando el sensor vuelve su lectura entra de nuevo
+    feed(1, -500, 0, false, 2000);
+    agg->snapshot(s, MAX_ZONES, 2000);
+    TEST_ASSERT_EQUAL_UINT8(3, s[0].valueCount);
+    TEST_ASSERT_EQUAL_INT16(-500, s[0].minX100);
+}
+
+static void test_random_updates_match_brute_force()
+{
+    // Pocos valores distintos para forzar repetidos en el multiset
+    static const int16_t values[] = {-1850, -1800, -20, 0, 0, 350, 400, 400, 410, 795, 800, 32767, -32768};
+    static const uint8_t flags[] = {0, 0, 0, 0, FLAG_BAT_LOW, FLAG_I2C_FAIL, FLAG_TMP_FAIL, FLAG_I2C_FAIL | FLAG_TMP_FAIL};
+
+    uint32_t now = 0;
+    for (int step = 0; step < 20000; ++step)
+    {
+        uint32_t r = nextRandom();
+        // Huecos ocasionales mas largos que SLOT_OFFLINE_MS
+        now += (r % 97 == 0) ? SLOT_OFFLINE_MS / 2 : r % 30000;
+
+        int slot = static_cast<int>(nextRandom() % MAX_SLOTS);
+        int16_t tmp = values[nextRandom() % (sizeof(values) / sizeof(values[0]))];
+        uint8_t f = flags[nextRandom() % sizeof(flags)];
+        bool alarm = (nextRandom() % 5) == 0;
+        feed(slot, tmp, f, alarm, now);
+
+        if (step % 7 == 0) assertMatchesBruteForce(now);
+    }
+
+    // Todo expira y queda solo el conteo de miembros y alarmas
+    now += SLOT_OFFLINE_MS;
+    assertMatchesBruteForce(now);
+}
+
+static void test_reload_rebuilds_from_samples()
+{
+    for (int slot = 0; slot < MAX_SLOTS; ++slot) feed(slot, static_cast<int16_t>(slot * 10), 0, slot % 3 == 0, 5000);
+
+    // Cambiar las zonas reconstruye los agregados con las lecturas vigentes
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*agg, "{\"zones\":[{\"name\":\"Par\",\"slots\":[0,2,4,6]},{\"name\":\"x\",\"slots\":[1]},"
+                                    "{\"name\":\"y\",\"slots\":[]},{\"name\":\"z\",\"slots\":[]},{\"name\":\"w\",\"slots\":[]}]}",
+                              error));
+    memset(members, 0, sizeof(members));
+    members[0] = 0x55;
+    members[1] = 0x02;
+    assertMatchesBruteForce(5000);
+}
+
+// La generacion es el ETag de /api/zones: se mueve con cada cambio y solo entonces
+static void test_generation_tracks_changes()
+{
+    ZoneSummary s[MAX_ZONES];
+    uint32_t before = 0;
+    uint32_t gen = 0;
+    agg->snapshot(s, MAX_ZONES, 1000, &before);
+    agg->snapshot(s, MAX_ZONES, 1000, &gen);
+    TEST_ASSERT_EQUAL_UINT32(before, gen);
+
+    feed(0, 400, 0, false, 1000);
+    agg->snapshot(s, MAX_ZONES, 1000, &gen);
+    TEST_ASSERT_TRUE(gen != before);
+    TEST_ASSERT_EQUAL_UINT8(1, s[0].onlineCount);
+
+    // El paso a offline ocurre dentro de snapshot y tambien cuenta
+    before = gen;
+    agg->snapshot(s, MAX_ZONES, 1000 + SLOT_OFFLINE_MS, &gen);
+    TEST_ASSERT_TRUE(gen != before);
+    TEST_ASSERT_EQUAL_UINT8(0, s[0].onlineCount);
+
+    before = gen;
+    agg->snapshot(s, MAX_ZONES, 2000 + SLOT_OFFLINE_MS, &gen);
+    TEST_ASSERT_EQUAL_UINT32(before, gen);
+
+    String error;
+    TEST_ASSERT_TRUE(saveJson(*agg, "{\"zones\":[{\"name\":\"Sola\",\"slots\":[0]}]}", error));
+    TEST_ASSERT_EQUAL_size_t(1, agg->snapshot(s, MAX_ZONES, 2000 + SLOT_OFFLINE_MS, &gen));
+    TEST_ASSERT_TRUE(gen != before);
+}
+
+static void test_save_survives_power_cut()
+{
+    std::vector<uint8_t> committed = nativeFs.files["/config/zones.json"];
+    const char *next = "{\"zones\":[{\"name\":\"Nueva\",\"slots\":[1]}]}";
+
+    for (size_t cut = 0; cut < strlen(next); ++cut)
+    {
+        nativeFs.files.erase("/config/zones.tmp");
+        nativeFs.files["/config/zones.json"] = committed;
+
+        String error;
+        nativeFs.powerCutAfter(cut);
+        TEST_ASSERT_FALSE(saveJson(*agg, next, error));
+        nativeFs.powerOn();
+
+        ZoneAggregator reboot;
+        TEST_ASSERT_TRUE(reboot.begin());
+        ZoneSummary s[MAX_ZONES];
+        TEST_ASSERT_EQUAL_size_t(5, reboot.snapshot(s, MAX_ZONES, 0));
+    }
+}
+
+int main(int, char **)
+{
+    UNITY_BEGIN();
+    RUN_TEST(test_invalid_readings_do_not_count);
+    RUN_TEST(test_random_updates_match_brute_force);
+    RUN_TEST(test_reload_rebuilds_from_samples);
+    RUN_TEST(test_generation_tracks_changes);
+    RUN_TEST(test_save_survives_power_cut);
+    return UNITY_END();
+}
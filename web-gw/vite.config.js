@@ -12,6 +12,12 @@ export default defineConfig({
       deleteOriginFile: false,
       filter: /\.(js|css|html)$/i,
     }),
+    compression({
+      algorithm: "brotliCompress",
+      ext: ".br",
+      deleteOriginFile: false,
+      filter: /\.(js|css|html|svg)$/i,
+    }),
   ],
   base: './',
   build: {